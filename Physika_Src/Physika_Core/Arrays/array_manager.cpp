@@ -31,10 +31,7 @@ void ArrayManager::permutate(unsigned int* ids, unsigned int size)
 {
     std::map<std::string, ArrayBase*>::iterator iter;
     for (iter = arrays_.begin(); iter != arrays_.end(); ++iter)
-    {
-        std::cout<<iter->first<<" ";
         iter->second->permutate(ids, size);
-    }
 }
 
 }  //end of namespace Physika
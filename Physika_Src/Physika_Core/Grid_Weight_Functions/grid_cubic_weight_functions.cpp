@@ -50,6 +50,31 @@ Vector<Scalar,Dim> GridPiecewiseCubicSpline<Scalar,Dim>::gradient(const Vector<S
     return result;
 }
 
+template <typename Scalar, int Dim>
+Scalar GridPiecewiseCubicSpline<Scalar,Dim>::axisWeight(Scalar center_to_x) const
+{
+    return axisWeightKernel(center_to_x);
+}
+
+template <typename Scalar, int Dim>
+Scalar GridPiecewiseCubicSpline<Scalar,Dim>::axisGradient(Scalar center_to_x) const
+{
+    return axisGradientKernel(center_to_x);
+}
+
+template <typename Scalar, int Dim>
+void GridPiecewiseCubicSpline<Scalar,Dim>::axisWeightsAndGradients(const Vector<Scalar,Dim> &center_to_first_node, const Vector<unsigned int,Dim> &node_num,
+                                                                   unsigned int stride, Scalar *weights, Scalar *gradients) const
+{
+    for(unsigned int i = 0; i < Dim; ++i)
+        for(unsigned int j = 0; j < node_num[i]; ++j)
+        {
+            Scalar center_to_x = center_to_first_node[i] - j;
+            weights[i*stride+j] = axisWeightKernel(center_to_x);
+            gradients[i*stride+j] = axisGradientKernel(center_to_x);
+        }
+}
+
 template <typename Scalar, int Dim>
 void GridPiecewiseCubicSpline<Scalar,Dim>::printInfo() const
 {
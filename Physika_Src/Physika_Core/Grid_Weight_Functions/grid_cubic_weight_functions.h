@@ -15,6 +15,7 @@
 #ifndef PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_CUBIC_WEIGHT_FUNCTIONS_H_
 #define PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_CUBIC_WEIGHT_FUNCTIONS_H_
 
+#include <cmath>
 #include "Physika_Core/Vectors/vector_2d.h"
 #include "Physika_Core/Vectors/vector_3d.h"
 #include "Physika_Core/Grid_Weight_Functions/grid_weight_function.h"
@@ -34,10 +35,44 @@ public:
     ~GridPiecewiseCubicSpline(){}
     Scalar weight(const Vector<Scalar,Dim> &center_to_x) const;
     Vector<Scalar,Dim> gradient(const Vector<Scalar,Dim> &center_to_x) const;
+    Scalar axisWeight(Scalar center_to_x) const;
+    Scalar axisGradient(Scalar center_to_x) const;
+    void axisWeightsAndGradients(const Vector<Scalar,Dim> &center_to_first_node, const Vector<unsigned int,Dim> &node_num,
+                                 unsigned int stride, Scalar *weights, Scalar *gradients) const;
     void printInfo() const;
     Scalar supportRadius() const;
+    //the 1D factor and its derivative as static inline functions, for statically dispatched evaluation
+    //see GridWeightFunctionKernel
+    static inline Scalar axisWeightKernel(Scalar center_to_x);
+    static inline Scalar axisGradientKernel(Scalar center_to_x);
 };
 
+template <typename Scalar, int Dim>
+Scalar GridPiecewiseCubicSpline<Scalar,Dim>::axisWeightKernel(Scalar center_to_x)
+{
+    //same as PiecewiseCubicSpline<Scalar,1> with R = 2, i.e., h = 1
+    Scalar s = std::abs(center_to_x);
+    if(s>2)
+        return 0;
+    else if(s>=1)
+        return (2.0-s)*(2.0-s)*(2.0-s)/6.0;
+    else
+        return 2.0/3.0-s*s+1.0/2.0*s*s*s;
+}
+
+template <typename Scalar, int Dim>
+Scalar GridPiecewiseCubicSpline<Scalar,Dim>::axisGradientKernel(Scalar center_to_x)
+{
+    Scalar s = std::abs(center_to_x);
+    Scalar sign = center_to_x>=0 ? 1 : -1;
+    if(s>2)
+        return 0;
+    else if(s>=1)
+        return (2-s)*(2-s)*(-1)/2.0*sign;
+    else
+        return (-2.0*s+3.0/2*s*s)*sign;
+}
+
 } //end of namespace Physika
 
 #endif  //PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_CUBIC_WEIGHT_FUNCTIONS_H_
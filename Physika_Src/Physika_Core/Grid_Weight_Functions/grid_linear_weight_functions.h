@@ -15,6 +15,7 @@
 #ifndef PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_LINEAR_WEIGHT_FUNCTIONS_H_
 #define PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_LINEAR_WEIGHT_FUNCTIONS_H_
 
+#include <cmath>
 #include "Physika_Core/Vectors/vector_2d.h"
 #include "Physika_Core/Vectors/vector_3d.h"
 #include "Physika_Core/Grid_Weight_Functions/grid_weight_function.h"
@@ -34,10 +35,34 @@ public:
     ~GridLinearWeightFunction(){}
     Scalar weight(const Vector<Scalar,Dim> &center_to_x) const;
     Vector<Scalar,Dim> gradient(const Vector<Scalar,Dim> &center_to_x) const;
+    Scalar axisWeight(Scalar center_to_x) const;
+    Scalar axisGradient(Scalar center_to_x) const;
+    void axisWeightsAndGradients(const Vector<Scalar,Dim> &center_to_first_node, const Vector<unsigned int,Dim> &node_num,
+                                 unsigned int stride, Scalar *weights, Scalar *gradients) const;
     void printInfo() const;
     Scalar supportRadius() const;
+    //the 1D factor and its derivative as static inline functions, for statically dispatched evaluation
+    //see GridWeightFunctionKernel
+    static inline Scalar axisWeightKernel(Scalar center_to_x);
+    static inline Scalar axisGradientKernel(Scalar center_to_x);
 };
 
+template <typename Scalar, int Dim>
+Scalar GridLinearWeightFunction<Scalar,Dim>::axisWeightKernel(Scalar center_to_x)
+{
+    //g(x) = 1-|x|, same as LinearWeightFunction<Scalar,1> with R = 1
+    Scalar r = std::abs(center_to_x);
+    return (r>1) ? 0 : 1-r;
+}
+
+template <typename Scalar, int Dim>
+Scalar GridLinearWeightFunction<Scalar,Dim>::axisGradientKernel(Scalar center_to_x)
+{
+    Scalar r = std::abs(center_to_x);
+    Scalar sign = center_to_x>=0 ? 1 : -1;
+    return (r>1) ? 0 : -sign;
+}
+
 }  //end of namespace Physika
 
 #endif //PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_LINEAR_WEIGHT_FUNCTIONS_H_
@@ -12,7 +12,91 @@
  *
  */
 
+#include <iostream>
+#include "Physika_Core/Utilities/physika_assert.h"
 #include "Physika_Core/Grid_Weight_Functions/grid_quadratic_weight_functions.h"
 
 namespace Physika{
+
+template <typename Scalar, int Dim>
+Scalar GridQuadraticBSpline<Scalar,Dim>::weight(const Vector<Scalar,Dim> &center_to_x) const
+{
+    Scalar result = 1.0;
+    for(unsigned int i = 0; i < Dim; ++i)
+        result *= axisWeightKernel(center_to_x[i]);
+    return result;
+}
+
+template <typename Scalar, int Dim>
+Vector<Scalar,Dim> GridQuadraticBSpline<Scalar,Dim>::gradient(const Vector<Scalar,Dim> &center_to_x) const
+{
+    Vector<Scalar,Dim> result(1.0);
+    for(unsigned int i = 0; i < Dim; ++i)
+        for(unsigned int j = 0; j < Dim; ++j)
+        {
+            if(j==i)
+                result[i] *= axisGradientKernel(center_to_x[j]);
+            else
+                result[i] *= axisWeightKernel(center_to_x[j]);
+        }
+    return result;
+}
+
+template <typename Scalar, int Dim>
+Scalar GridQuadraticBSpline<Scalar,Dim>::axisWeight(Scalar center_to_x) const
+{
+    return axisWeightKernel(center_to_x);
+}
+
+template <typename Scalar, int Dim>
+Scalar GridQuadraticBSpline<Scalar,Dim>::axisGradient(Scalar center_to_x) const
+{
+    return axisGradientKernel(center_to_x);
+}
+
+template <typename Scalar, int Dim>
+void GridQuadraticBSpline<Scalar,Dim>::axisWeightsAndGradients(const Vector<Scalar,Dim> &center_to_first_node, const Vector<unsigned int,Dim> &node_num,
+                                                               unsigned int stride, Scalar *weights, Scalar *gradients) const
+{
+    for(unsigned int i = 0; i < Dim; ++i)
+        for(unsigned int j = 0; j < node_num[i]; ++j)
+        {
+            Scalar center_to_x = center_to_first_node[i] - j;
+            weights[i*stride+j] = axisWeightKernel(center_to_x);
+            gradients[i*stride+j] = axisGradientKernel(center_to_x);
+        }
+}
+
+template <typename Scalar, int Dim>
+void GridQuadraticBSpline<Scalar,Dim>::printInfo() const
+{
+    switch(Dim)
+    {
+    case 2:
+        std::cout<<"Grid-based quadratic B-spline with support radius of 1.5 grid cell:\n";
+        std::cout<<"f(x,y) = g(x)*g(y) (0<=|x|<=1.5, 0<=|y|<=1.5)\n";
+        break;
+    case 3:
+        std::cout<<"Grid-based quadratic B-spline with support radius of 1.5 grid cell:\n";
+        std::cout<<"f(x,y,z) = g(x)*g(y)*g(z) (0<=|x|<=1.5, 0<=|y|<=1.5, 0<=|z|<=1.5)\n";
+        break;
+    default:
+        PHYSIKA_ERROR("Wrong dimension specified.");
+    }
+    std::cout<<"g(x) = 3/4-|x|^2 (0<=|x|<=1/2)\n";
+    std::cout<<"g(x) = 1/2*(3/2-|x|)^2 (1/2<=|x|<=3/2)\n";
+}
+
+template <typename Scalar, int Dim>
+Scalar GridQuadraticBSpline<Scalar,Dim>::supportRadius() const
+{
+    return 1.5;
+}
+
+//explicit instantiations
+template class GridQuadraticBSpline<float,2>;
+template class GridQuadraticBSpline<double,2>;
+template class GridQuadraticBSpline<float,3>;
+template class GridQuadraticBSpline<double,3>;
+
 }  //end of namespace Physika
@@ -15,11 +15,64 @@
 #ifndef PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_QUADRATIC_WEIGHT_FUNCTIONS_H_
 #define PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_QUADRATIC_WEIGHT_FUNCTIONS_H_
 
+#include <cmath>
 #include "Physika_Core/Vectors/vector_2d.h"
 #include "Physika_Core/Vectors/vector_3d.h"
 #include "Physika_Core/Grid_Weight_Functions/grid_weight_function.h"
 
 namespace Physika{
+
+/*
+ * GridQuadraticBSpline: dyadic product of 1D quadratic B-spline, common in MPM
+ * Support radius: 1.5 grid cell
+ */
+
+template <typename Scalar, int Dim>
+class GridQuadraticBSpline: public GridWeightFunction<Scalar,Dim>
+{
+public:
+    GridQuadraticBSpline(){}
+    ~GridQuadraticBSpline(){}
+    Scalar weight(const Vector<Scalar,Dim> &center_to_x) const;
+    Vector<Scalar,Dim> gradient(const Vector<Scalar,Dim> &center_to_x) const;
+    Scalar axisWeight(Scalar center_to_x) const;
+    Scalar axisGradient(Scalar center_to_x) const;
+    void axisWeightsAndGradients(const Vector<Scalar,Dim> &center_to_first_node, const Vector<unsigned int,Dim> &node_num,
+                                 unsigned int stride, Scalar *weights, Scalar *gradients) const;
+    void printInfo() const;
+    Scalar supportRadius() const;
+    //the 1D factor and its derivative as static inline functions, for statically dispatched evaluation
+    //see GridWeightFunctionKernel
+    static inline Scalar axisWeightKernel(Scalar center_to_x);
+    static inline Scalar axisGradientKernel(Scalar center_to_x);
+};
+
+template <typename Scalar, int Dim>
+Scalar GridQuadraticBSpline<Scalar,Dim>::axisWeightKernel(Scalar center_to_x)
+{
+    //the 1D quadratic B-spline, it's partition of unity without scaling
+    Scalar r = std::abs(center_to_x);
+    if(r >= 1.5)
+        return 0;
+    else if(r >= 0.5)
+        return 0.5*(1.5-r)*(1.5-r);
+    else
+        return 0.75-r*r;
+}
+
+template <typename Scalar, int Dim>
+Scalar GridQuadraticBSpline<Scalar,Dim>::axisGradientKernel(Scalar center_to_x)
+{
+    Scalar r = std::abs(center_to_x);
+    Scalar sign = center_to_x>=0 ? 1 : -1;
+    if(r >= 1.5)
+        return 0;
+    else if(r >= 0.5)
+        return (r-1.5)*sign;
+    else
+        return -2.0*center_to_x;
+}
+
 } //end of namespace Physika
 
 #endif  //PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_QUADRATIC_WEIGHT_FUNCTIONS_H_
@@ -33,6 +33,12 @@ namespace Physika{
  *
  * Note: center_to_x is represented as multiples of cell edge lengths.
  *
+ * The 1D factors of the dyadic product are exposed via axisWeight() and axisGradient(),
+ * i.e., weight(x) = axisWeight(x[0])*...*axisWeight(x[Dim-1]), such that the weights of
+ * all grid nodes in range can be assembled from Dim*(node number per dimension) evaluations.
+ * axisWeightsAndGradients() evaluates all these 1D factors of one position at once. Subclasses
+ * are encouraged to override it with non-virtual evaluation of their 1D functions.
+ *
  */
 
 template <typename Scalar, int Dim>
@@ -43,6 +49,22 @@ public:
     virtual ~GridWeightFunction(){}
     virtual Scalar weight(const Vector<Scalar,Dim> &center_to_x) const=0;
     virtual Vector<Scalar,Dim> gradient(const Vector<Scalar,Dim> &center_to_x) const=0;
+    virtual Scalar axisWeight(Scalar center_to_x) const=0; //1D factor along one dimension, scaled for partition of unity
+    virtual Scalar axisGradient(Scalar center_to_x) const=0; //derivative of the 1D factor
+    //the 1D factors of consecutive grid nodes along each dimension:
+    //center_to_first_node[i] is center_to_x of the first node along dimension i, and center_to_x of the j-th node is
+    //center_to_first_node[i] - j; the factors of the j-th node along dimension i are written to weights[i*stride+j]
+    //and gradients[i*stride+j] respectively
+    virtual void axisWeightsAndGradients(const Vector<Scalar,Dim> &center_to_first_node, const Vector<unsigned int,Dim> &node_num,
+                                         unsigned int stride, Scalar *weights, Scalar *gradients) const
+    {
+        for(unsigned int i = 0; i < Dim; ++i)
+            for(unsigned int j = 0; j < node_num[i]; ++j)
+            {
+                weights[i*stride+j] = axisWeight(center_to_first_node[i]-j);
+                gradients[i*stride+j] = axisGradient(center_to_first_node[i]-j);
+            }
+    }
     virtual void printInfo() const=0;
     virtual Scalar supportRadius() const=0; //return the support radius, the unit is the cell size
 
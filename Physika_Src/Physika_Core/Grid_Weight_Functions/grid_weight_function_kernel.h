@@ -0,0 +1,83 @@
+/*
+ * @file grid_weight_function_kernel.h
+ * @brief statically dispatched evaluation of grid-based weight functions.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_WEIGHT_FUNCTION_KERNEL_H_
+#define PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_WEIGHT_FUNCTION_KERNEL_H_
+
+#include <typeinfo>
+#include "Physika_Core/Vectors/vector_2d.h"
+#include "Physika_Core/Vectors/vector_3d.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_weight_function.h"
+
+namespace Physika{
+
+/*
+ * GridWeightFunctionKernel: evaluate the 1D factors of a grid-based weight function
+ * whose type is known at compile time, without virtual function calls.
+ *
+ * The weight function type must provide static inline axisWeightKernel() and axisGradientKernel(),
+ * which is the case for the weight functions in Physika_Core/Grid_Weight_Functions. With
+ * GridWeightFunction<Scalar,Dim> as template argument, the virtual methods are used instead,
+ * which works for any grid-based weight function.
+ *
+ * Usage: dispatch on the type of the weight function once, e.g., with isOfType(), and run
+ * the inner loops with GridWeightFunctionKernel of the concrete type.
+ */
+
+template <typename GridWeightFunctionType>
+class GridWeightFunctionKernel
+{
+public:
+    typedef typename GridWeightFunctionType::ScalarType Scalar;
+    static const int Dim = GridWeightFunctionType::DimSize;
+    //same as GridWeightFunction::axisWeightsAndGradients(), weight_function is only used for the virtual path
+    static inline void axisWeightsAndGradients(const GridWeightFunction<Scalar,Dim> &weight_function, const Vector<Scalar,Dim> &center_to_first_node,
+                                               const Vector<unsigned int,Dim> &node_num, unsigned int stride, Scalar *weights, Scalar *gradients)
+    {
+        for(unsigned int i = 0; i < Dim; ++i)
+            for(unsigned int j = 0; j < node_num[i]; ++j)
+            {
+                Scalar center_to_x = center_to_first_node[i] - j;
+                weights[i*stride+j] = GridWeightFunctionType::axisWeightKernel(center_to_x);
+                gradients[i*stride+j] = GridWeightFunctionType::axisGradientKernel(center_to_x);
+            }
+    }
+    //return true if the dynamic type of weight_function is exactly GridWeightFunctionType
+    static inline bool isOfType(const GridWeightFunction<Scalar,Dim> &weight_function)
+    {
+        return typeid(weight_function) == typeid(GridWeightFunctionType);
+    }
+};
+
+//the virtual path
+template <typename ScalarType, int DimSize>
+class GridWeightFunctionKernel<GridWeightFunction<ScalarType,DimSize> >
+{
+public:
+    typedef ScalarType Scalar;
+    static const int Dim = DimSize;
+    static inline void axisWeightsAndGradients(const GridWeightFunction<Scalar,Dim> &weight_function, const Vector<Scalar,Dim> &center_to_first_node,
+                                               const Vector<unsigned int,Dim> &node_num, unsigned int stride, Scalar *weights, Scalar *gradients)
+    {
+        weight_function.axisWeightsAndGradients(center_to_first_node,node_num,stride,weights,gradients);
+    }
+    static inline bool isOfType(const GridWeightFunction<Scalar,Dim> &weight_function)
+    {
+        return true;
+    }
+};
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_GRID_WEIGHT_FUNCTIONS_GRID_WEIGHT_FUNCTION_KERNEL_H_
@@ -0,0 +1,139 @@
+/*
+ * @file bicgstab_solver.cpp
+ * @brief Preconditioned biconjugate gradient stabilized method for nonsymmetric systems.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <limits>
+#include <iostream>
+#include "Physika_Core/Linear_Solvers/bicgstab_solver.h"
+
+namespace Physika{
+
+template <typename Scalar>
+BiCGSTABSolver<Scalar>::BiCGSTABSolver()
+    :IterativeSolver<Scalar>()
+{
+}
+
+template <typename Scalar>
+BiCGSTABSolver<Scalar>::~BiCGSTABSolver()
+{
+}
+
+template <typename Scalar>
+void BiCGSTABSolver<Scalar>::printInfo() const
+{
+    std::cout<<"Preconditioned BiCGSTAB solver\n";
+    if(this->preconditioner_)
+        this->preconditioner_->printInfo();
+    else
+        std::cout<<"No preconditioner\n";
+}
+
+template <typename Scalar>
+bool BiCGSTABSolver<Scalar>::iterate(const VectorND<Scalar> &rhs, VectorND<Scalar> &x)
+{
+    using IterativeSolverInternal::dot;
+    using IterativeSolverInternal::axpy;
+    using IterativeSolverInternal::xpby;
+    unsigned int thread_num = this->thread_num_;
+    unsigned int dim = x.dims();
+    VectorND<Scalar> r, r0, p, v, t, y, z;
+    this->computeResidual(rhs,x,r);
+    if(this->recordResidual(std::sqrt(dot(r,r,thread_num))))
+        return true;
+    Scalar r0_norm2 = 0, rho = 1, alpha = 1, omega = 1;
+    const Scalar epsilon = std::numeric_limits<Scalar>::epsilon();
+    bool restart = true;
+    for(unsigned int iter = 0; iter < this->max_iteration_num_; ++iter)
+    {
+        if(restart)
+        {
+            //the shadow residual is the current residual
+            r0 = r;
+            r0_norm2 = dot(r,r,thread_num);
+            p = VectorND<Scalar>(dim,0);
+            v = VectorND<Scalar>(dim,0);
+            rho = alpha = omega = 1;
+            restart = false;
+        }
+        Scalar rho_old = rho;
+        rho = dot(r0,r,thread_num);
+        if(std::abs(rho) < epsilon*epsilon*r0_norm2)
+        {
+            //the shadow residual is orthogonal to the residual, restart from the true residual
+            this->computeResidual(rhs,x,r);
+            r0 = r;
+            rho = r0_norm2 = dot(r,r,thread_num);
+            p = VectorND<Scalar>(dim,0);
+            v = VectorND<Scalar>(dim,0);
+        }
+        Scalar beta = (rho/rho_old)*(alpha/omega);
+        //p = r + beta*(p - omega*v)
+        axpy(-omega,v,p,thread_num);
+        xpby(r,beta,p,thread_num);
+        this->precondition(p,y);
+        this->matrix_.multiply(y,v);
+        Scalar r0_v = dot(r0,v,thread_num);
+        if(r0_v == 0)
+        {
+            std::cerr<<"Warning: breakdown of BiCGSTABSolver, iteration stopped!\n";
+            return false;
+        }
+        alpha = rho/r0_v;
+        axpy(-alpha,v,r,thread_num);  //r is s = r - alpha*v from now on
+        Scalar s_norm = std::sqrt(dot(r,r,thread_num));
+        bool converged = false;
+        if(s_norm <= this->tolerance_*this->rhs_norm_)
+        {
+            axpy(alpha,y,x,thread_num);
+            converged = true;
+        }
+        else
+        {
+            this->precondition(r,z);
+            this->matrix_.multiply(z,t);
+            Scalar t_norm2 = dot(t,t,thread_num);
+            omega = t_norm2 > 0 ? dot(t,r,thread_num)/t_norm2 : 0;
+            axpy(alpha,y,x,thread_num);
+            axpy(omega,z,x,thread_num);
+            axpy(-omega,t,r,thread_num);
+            converged = std::sqrt(dot(r,r,thread_num)) <= this->tolerance_*this->rhs_norm_;
+            if(!converged && omega == 0)
+            {
+                this->recordResidual(std::sqrt(dot(r,r,thread_num)));
+                std::cerr<<"Warning: stagnation of BiCGSTABSolver, iteration stopped!\n";
+                return false;
+            }
+        }
+        if(converged)
+        {
+            //the updated residual drifts from the true one in ill-conditioned systems, restart from
+            //the true residual if it doesn't meet the tolerance
+            this->computeResidual(rhs,x,r);
+            if(this->recordResidual(std::sqrt(dot(r,r,thread_num))))
+                return true;
+            restart = true;
+        }
+        else
+            this->recordResidual(std::sqrt(dot(r,r,thread_num)));
+    }
+    return false;
+}
+
+//explicit instantiations
+template class BiCGSTABSolver<float>;
+template class BiCGSTABSolver<double>;
+template class BiCGSTABSolver<long double>;
+
+}  //end of namespace Physika
@@ -0,0 +1,42 @@
+/*
+ * @file bicgstab_solver.h
+ * @brief Preconditioned biconjugate gradient stabilized method for nonsymmetric systems.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_LINEAR_SOLVERS_BICGSTAB_SOLVER_H_
+#define PHYSIKA_CORE_LINEAR_SOLVERS_BICGSTAB_SOLVER_H_
+
+#include "Physika_Core/Linear_Solvers/iterative_solver.h"
+
+namespace Physika{
+
+/*
+ * BiCGSTABSolver: preconditioned biconjugate gradient stabilized method (BiCGSTAB) of van der Vorst.
+ * A may be nonsymmetric. Each iteration costs two matrix-vector products and two preconditioner solves.
+ * The iteration restarts from the true residual if the shadow residual becomes orthogonal to it, or if the
+ * updated residual meets the tolerance but the true residual doesn't.
+ */
+
+template <typename Scalar>
+class BiCGSTABSolver: public IterativeSolver<Scalar>
+{
+public:
+    BiCGSTABSolver();
+    ~BiCGSTABSolver();
+    void printInfo() const;
+protected:
+    bool iterate(const VectorND<Scalar> &rhs, VectorND<Scalar> &x);
+};
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_LINEAR_SOLVERS_BICGSTAB_SOLVER_H_
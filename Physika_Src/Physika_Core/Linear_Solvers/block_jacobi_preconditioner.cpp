@@ -0,0 +1,192 @@
+/*
+ * @file block_jacobi_preconditioner.cpp
+ * @brief Block Jacobi preconditioner, the inverse of the diagonal blocks of the matrix.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Core/Linear_Solvers/block_jacobi_preconditioner.h"
+
+namespace Physika{
+
+namespace BlockJacobiPreconditionerInternal{
+
+//invert the size x size row-major matrix in place with Gauss-Jordan elimination and partial pivoting,
+//return false if the matrix is singular
+template <typename Scalar>
+bool invertDenseMatrix(Scalar *matrix, unsigned int size)
+{
+    std::vector<Scalar> inverse(size*size,0);
+    for(unsigned int i = 0; i < size; ++i)
+        inverse[i*size+i] = 1;
+    Scalar max_abs = 0;
+    for(unsigned int i = 0; i < size*size; ++i)
+        max_abs = std::max(max_abs,static_cast<Scalar>(std::abs(matrix[i])));
+    if(max_abs == 0)
+        return false;
+    for(unsigned int col = 0; col < size; ++col)
+    {
+        unsigned int pivot_row = col;
+        for(unsigned int row = col+1; row < size; ++row)
+            if(std::abs(matrix[row*size+col]) > std::abs(matrix[pivot_row*size+col]))
+                pivot_row = row;
+        if(std::abs(matrix[pivot_row*size+col]) <= 1.0e-12*max_abs)
+            return false;
+        if(pivot_row != col)
+            for(unsigned int j = 0; j < size; ++j)
+            {
+                std::swap(matrix[pivot_row*size+j],matrix[col*size+j]);
+                std::swap(inverse[pivot_row*size+j],inverse[col*size+j]);
+            }
+        Scalar inv_pivot = 1/matrix[col*size+col];
+        for(unsigned int j = 0; j < size; ++j)
+        {
+            matrix[col*size+j] *= inv_pivot;
+            inverse[col*size+j] *= inv_pivot;
+        }
+        for(unsigned int row = 0; row < size; ++row)
+        {
+            if(row == col || matrix[row*size+col] == 0)
+                continue;
+            Scalar factor = matrix[row*size+col];
+            for(unsigned int j = 0; j < size; ++j)
+            {
+                matrix[row*size+j] -= factor*matrix[col*size+j];
+                inverse[row*size+j] -= factor*inverse[col*size+j];
+            }
+        }
+    }
+    std::copy(inverse.begin(),inverse.end(),matrix);
+    return true;
+}
+
+}  //end of namespace BlockJacobiPreconditionerInternal
+
+template <typename Scalar>
+BlockJacobiPreconditioner<Scalar>::BlockJacobiPreconditioner(unsigned int block_size)
+    :block_size_(1),dim_(0),thread_num_(1)
+{
+    setBlockSize(block_size);
+}
+
+template <typename Scalar>
+BlockJacobiPreconditioner<Scalar>::~BlockJacobiPreconditioner()
+{
+}
+
+template <typename Scalar>
+BlockJacobiPreconditioner<Scalar>* BlockJacobiPreconditioner<Scalar>::clone() const
+{
+    return new BlockJacobiPreconditioner<Scalar>(*this);
+}
+
+template <typename Scalar>
+unsigned int BlockJacobiPreconditioner<Scalar>::blockSize() const
+{
+    return block_size_;
+}
+
+template <typename Scalar>
+void BlockJacobiPreconditioner<Scalar>::setBlockSize(unsigned int block_size)
+{
+    if(block_size == 0)
+    {
+        std::cerr<<"Warning: block size of BlockJacobiPreconditioner must be positive, 1 is used instead!\n";
+        block_size = 1;
+    }
+    block_size_ = block_size;
+}
+
+template <typename Scalar>
+void BlockJacobiPreconditioner<Scalar>::compute(const CSRMatrix<Scalar> &matrix)
+{
+    dim_ = std::min(matrix.rows(),matrix.cols());
+    thread_num_ = matrix.threadNum();
+    unsigned int block_num = (dim_ + block_size_ - 1)/block_size_, block_entry_num = block_size_*block_size_;
+    inv_blocks_.assign(static_cast<size_t>(block_num)*block_entry_num,0);
+    const std::vector<unsigned int> &row_offset = matrix.rowOffsets();
+    const std::vector<unsigned int> &col_index = matrix.colIndices();
+    const std::vector<Scalar> &values = matrix.values();
+    int block_num_int = static_cast<int>(block_num);
+#pragma omp parallel for num_threads(thread_num_)
+    for(int block_idx = 0; block_idx < block_num_int; ++block_idx)
+    {
+        unsigned int block_start = block_idx*block_size_;
+        unsigned int size = std::min(block_size_,dim_-block_start);
+        //the block is stored in its leading size x size part
+        std::vector<Scalar> block(size*size,0);
+        for(unsigned int i = 0; i < size; ++i)
+        {
+            unsigned int row = block_start+i;
+            std::vector<unsigned int>::const_iterator iter = std::lower_bound(col_index.begin()+row_offset[row],col_index.begin()+row_offset[row+1],block_start);
+            for(; iter != col_index.begin()+row_offset[row+1] && *iter < block_start+size; ++iter)
+                block[i*size+(*iter-block_start)] = values[iter-col_index.begin()];
+        }
+        std::vector<Scalar> diagonal(size);
+        for(unsigned int i = 0; i < size; ++i)
+            diagonal[i] = block[i*size+i];
+        if(!BlockJacobiPreconditionerInternal::invertDenseMatrix(size > 0 ? &block[0] : NULL,size))
+        {
+            std::fill(block.begin(),block.end(),static_cast<Scalar>(0));
+            for(unsigned int i = 0; i < size; ++i)
+                block[i*size+i] = diagonal[i] != 0 ? 1/diagonal[i] : 1;
+        }
+        Scalar *inv_block = &inv_blocks_[static_cast<size_t>(block_idx)*block_entry_num];
+        for(unsigned int i = 0; i < size; ++i)
+            for(unsigned int j = 0; j < size; ++j)
+                inv_block[i*block_size_+j] = block[i*size+j];
+    }
+}
+
+template <typename Scalar>
+void BlockJacobiPreconditioner<Scalar>::apply(const VectorND<Scalar> &residual, VectorND<Scalar> &result) const
+{
+    PHYSIKA_ASSERT(residual.dims() == dim_);
+    PHYSIKA_ASSERT(&residual != &result);
+    if(result.dims() != dim_)
+        result.resize(dim_);
+    if(dim_ == 0)
+        return;
+    const Scalar *residual_data = &residual[0];
+    Scalar *result_data = &result[0];
+    unsigned int block_entry_num = block_size_*block_size_;
+    int block_num = static_cast<int>((dim_ + block_size_ - 1)/block_size_);
+#pragma omp parallel for num_threads(thread_num_)
+    for(int block_idx = 0; block_idx < block_num; ++block_idx)
+    {
+        unsigned int block_start = block_idx*block_size_;
+        unsigned int size = std::min(block_size_,dim_-block_start);
+        const Scalar *inv_block = &inv_blocks_[static_cast<size_t>(block_idx)*block_entry_num];
+        for(unsigned int i = 0; i < size; ++i)
+        {
+            Scalar sum = 0;
+            for(unsigned int j = 0; j < size; ++j)
+                sum += inv_block[i*block_size_+j]*residual_data[block_start+j];
+            result_data[block_start+i] = sum;
+        }
+    }
+}
+
+template <typename Scalar>
+void BlockJacobiPreconditioner<Scalar>::printInfo() const
+{
+    std::cout<<"Block Jacobi preconditioner: M = blockdiag(A), block size "<<block_size_<<"\n";
+}
+
+//explicit instantiations
+template class BlockJacobiPreconditioner<float>;
+template class BlockJacobiPreconditioner<double>;
+template class BlockJacobiPreconditioner<long double>;
+
+}  //end of namespace Physika
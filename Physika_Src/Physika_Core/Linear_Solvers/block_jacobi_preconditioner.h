@@ -0,0 +1,51 @@
+/*
+ * @file block_jacobi_preconditioner.h
+ * @brief Block Jacobi preconditioner, the inverse of the diagonal blocks of the matrix.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_LINEAR_SOLVERS_BLOCK_JACOBI_PRECONDITIONER_H_
+#define PHYSIKA_CORE_LINEAR_SOLVERS_BLOCK_JACOBI_PRECONDITIONER_H_
+
+#include <vector>
+#include "Physika_Core/Linear_Solvers/preconditioner.h"
+
+namespace Physika{
+
+/*
+ * BlockJacobiPreconditioner: M is the block diagonal part of A with blocks of block_size consecutive rows,
+ * e.g., block_size = Dim for the stiffness matrix of elasticity where each node has Dim unknowns.
+ * The last block is smaller if the size of A is not a multiple of block_size.
+ * Singular blocks fall back to the inverse of their diagonal.
+ */
+
+template <typename Scalar>
+class BlockJacobiPreconditioner: public Preconditioner<Scalar>
+{
+public:
+    explicit BlockJacobiPreconditioner(unsigned int block_size = 3);
+    ~BlockJacobiPreconditioner();
+    BlockJacobiPreconditioner<Scalar>* clone() const;
+    unsigned int blockSize() const;
+    void setBlockSize(unsigned int block_size);  //takes effect in next compute()
+    void compute(const CSRMatrix<Scalar> &matrix);
+    void apply(const VectorND<Scalar> &residual, VectorND<Scalar> &result) const;
+    void printInfo() const;
+protected:
+    unsigned int block_size_;
+    unsigned int dim_;
+    std::vector<Scalar> inv_blocks_;  //inverse of the blocks, block_size_*block_size_ entries each in row-major order
+    unsigned int thread_num_;
+};
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_LINEAR_SOLVERS_BLOCK_JACOBI_PRECONDITIONER_H_
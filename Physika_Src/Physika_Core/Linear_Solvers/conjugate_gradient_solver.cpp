@@ -0,0 +1,83 @@
+/*
+ * @file conjugate_gradient_solver.cpp
+ * @brief Preconditioned conjugate gradient method for symmetric positive definite systems.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <iostream>
+#include "Physika_Core/Linear_Solvers/conjugate_gradient_solver.h"
+
+namespace Physika{
+
+template <typename Scalar>
+ConjugateGradientSolver<Scalar>::ConjugateGradientSolver()
+    :IterativeSolver<Scalar>()
+{
+}
+
+template <typename Scalar>
+ConjugateGradientSolver<Scalar>::~ConjugateGradientSolver()
+{
+}
+
+template <typename Scalar>
+void ConjugateGradientSolver<Scalar>::printInfo() const
+{
+    std::cout<<"Preconditioned conjugate gradient solver\n";
+    if(this->preconditioner_)
+        this->preconditioner_->printInfo();
+    else
+        std::cout<<"No preconditioner\n";
+}
+
+template <typename Scalar>
+bool ConjugateGradientSolver<Scalar>::iterate(const VectorND<Scalar> &rhs, VectorND<Scalar> &x)
+{
+    using IterativeSolverInternal::dot;
+    using IterativeSolverInternal::axpy;
+    using IterativeSolverInternal::xpby;
+    unsigned int thread_num = this->thread_num_;
+    VectorND<Scalar> r, z, p, q;
+    this->computeResidual(rhs,x,r);
+    if(this->recordResidual(std::sqrt(dot(r,r,thread_num))))
+        return true;
+    this->precondition(r,z);
+    p = z;
+    Scalar rz = dot(r,z,thread_num);
+    for(unsigned int iter = 0; iter < this->max_iteration_num_; ++iter)
+    {
+        this->matrix_.multiply(p,q);
+        Scalar pq = dot(p,q,thread_num);
+        if(!(pq > 0))
+        {
+            std::cerr<<"Warning: p^T*A*p <= 0 in ConjugateGradientSolver, the matrix is not positive definite, iteration stopped!\n";
+            return false;
+        }
+        Scalar alpha = rz/pq;
+        axpy(alpha,p,x,thread_num);
+        axpy(-alpha,q,r,thread_num);
+        if(this->recordResidual(std::sqrt(dot(r,r,thread_num))))
+            return true;
+        this->precondition(r,z);
+        Scalar rz_new = dot(r,z,thread_num);
+        xpby(z,rz_new/rz,p,thread_num);
+        rz = rz_new;
+    }
+    return false;
+}
+
+//explicit instantiations
+template class ConjugateGradientSolver<float>;
+template class ConjugateGradientSolver<double>;
+template class ConjugateGradientSolver<long double>;
+
+}  //end of namespace Physika
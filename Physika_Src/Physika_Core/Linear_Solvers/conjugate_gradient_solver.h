@@ -0,0 +1,42 @@
+/*
+ * @file conjugate_gradient_solver.h
+ * @brief Preconditioned conjugate gradient method for symmetric positive definite systems.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_LINEAR_SOLVERS_CONJUGATE_GRADIENT_SOLVER_H_
+#define PHYSIKA_CORE_LINEAR_SOLVERS_CONJUGATE_GRADIENT_SOLVER_H_
+
+#include "Physika_Core/Linear_Solvers/iterative_solver.h"
+
+namespace Physika{
+
+/*
+ * ConjugateGradientSolver: preconditioned conjugate gradient method (PCG).
+ * A and the preconditioner must be symmetric positive definite, e.g., the stiffness matrix of elasticity
+ * with Dirichlet boundary. Each iteration costs one matrix-vector product and one preconditioner solve.
+ * The iteration stops with a warning if p^T*A*p <= 0, which means A is not positive definite.
+ */
+
+template <typename Scalar>
+class ConjugateGradientSolver: public IterativeSolver<Scalar>
+{
+public:
+    ConjugateGradientSolver();
+    ~ConjugateGradientSolver();
+    void printInfo() const;
+protected:
+    bool iterate(const VectorND<Scalar> &rhs, VectorND<Scalar> &x);
+};
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_LINEAR_SOLVERS_CONJUGATE_GRADIENT_SOLVER_H_
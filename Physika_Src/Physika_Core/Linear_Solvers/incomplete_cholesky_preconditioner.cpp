@@ -0,0 +1,178 @@
+/*
+ * @file incomplete_cholesky_preconditioner.cpp
+ * @brief Incomplete Cholesky preconditioner with zero fill-in, IC(0).
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Core/Linear_Solvers/incomplete_cholesky_preconditioner.h"
+
+namespace Physika{
+
+template <typename Scalar>
+IncompleteCholeskyPreconditioner<Scalar>::IncompleteCholeskyPreconditioner()
+    :dim_(0),row_offset_(1,0),shift_(0)
+{
+}
+
+template <typename Scalar>
+IncompleteCholeskyPreconditioner<Scalar>::~IncompleteCholeskyPreconditioner()
+{
+}
+
+template <typename Scalar>
+IncompleteCholeskyPreconditioner<Scalar>* IncompleteCholeskyPreconditioner<Scalar>::clone() const
+{
+    return new IncompleteCholeskyPreconditioner<Scalar>(*this);
+}
+
+template <typename Scalar>
+void IncompleteCholeskyPreconditioner<Scalar>::compute(const CSRMatrix<Scalar> &matrix)
+{
+    if(matrix.rows() != matrix.cols())
+    {
+        std::cerr<<"Error: incomplete Cholesky factorization of non-square matrix, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    //pattern of the lower triangle, the diagonal entry is appended if A misses it
+    dim_ = matrix.rows();
+    const std::vector<unsigned int> &a_row_offset = matrix.rowOffsets();
+    const std::vector<unsigned int> &a_col_index = matrix.colIndices();
+    const std::vector<Scalar> &a_values = matrix.values();
+    std::vector<Scalar> lower_values;
+    row_offset_.assign(1,0);
+    col_index_.clear();
+    for(unsigned int row = 0; row < dim_; ++row)
+    {
+        Scalar diagonal = 0;
+        for(unsigned int i = a_row_offset[row]; i < a_row_offset[row+1] && a_col_index[i] <= row; ++i)
+        {
+            if(a_col_index[i] == row)
+                diagonal = a_values[i];
+            else
+            {
+                col_index_.push_back(a_col_index[i]);
+                lower_values.push_back(a_values[i]);
+            }
+        }
+        col_index_.push_back(row);
+        lower_values.push_back(diagonal);
+        row_offset_.push_back(static_cast<unsigned int>(col_index_.size()));
+    }
+    //restart with increasing diagonal shift on breakdown
+    shift_ = 0;
+    while(!factorize(lower_values,shift_))
+    {
+        shift_ = shift_ == 0 ? static_cast<Scalar>(1.0e-3) : 2*shift_;
+        if(shift_ > 1.0e3)
+        {
+            std::cerr<<"Warning: incomplete Cholesky factorization failed, the matrix is not positive definite. Jacobi preconditioner is used instead!\n";
+            for(unsigned int row = 0; row < dim_; ++row)
+            {
+                for(unsigned int i = row_offset_[row]; i < row_offset_[row+1]-1; ++i)
+                    values_[i] = 0;
+                Scalar diagonal = std::abs(lower_values[row_offset_[row+1]-1]);
+                values_[row_offset_[row+1]-1] = diagonal > 0 ? std::sqrt(diagonal) : 1;
+            }
+            break;
+        }
+    }
+}
+
+template <typename Scalar>
+bool IncompleteCholeskyPreconditioner<Scalar>::factorize(const std::vector<Scalar> &lower_values, Scalar shift)
+{
+    values_ = lower_values;
+    for(unsigned int row = 0; row < dim_; ++row)
+    {
+        unsigned int row_start = row_offset_[row], diag_pos = row_offset_[row+1]-1;
+        for(unsigned int i = row_start; i < diag_pos; ++i)
+        {
+            //L(row,k) = (A(row,k) - sum_{j<k} L(row,j)*L(k,j))/L(k,k), merging the sorted rows
+            unsigned int k = col_index_[i];
+            unsigned int k_diag_pos = row_offset_[k+1]-1;
+            Scalar sum = 0;
+            unsigned int p = row_start, q = row_offset_[k];
+            while(p < i && q < k_diag_pos)
+            {
+                if(col_index_[p] == col_index_[q])
+                    sum += values_[p++]*values_[q++];
+                else if(col_index_[p] < col_index_[q])
+                    ++p;
+                else
+                    ++q;
+            }
+            values_[i] = (values_[i] - sum)/values_[k_diag_pos];
+        }
+        Scalar diagonal = values_[diag_pos]*(1+shift);
+        for(unsigned int i = row_start; i < diag_pos; ++i)
+            diagonal -= values_[i]*values_[i];
+        if(!(diagonal > 0))
+            return false;
+        values_[diag_pos] = std::sqrt(diagonal);
+    }
+    return true;
+}
+
+template <typename Scalar>
+void IncompleteCholeskyPreconditioner<Scalar>::apply(const VectorND<Scalar> &residual, VectorND<Scalar> &result) const
+{
+    PHYSIKA_ASSERT(residual.dims() == dim_);
+    PHYSIKA_ASSERT(&residual != &result);
+    if(result.dims() != dim_)
+        result.resize(dim_);
+    if(dim_ == 0)
+        return;
+    const Scalar *residual_data = &residual[0];
+    Scalar *result_data = &result[0];
+    const unsigned int *row_offset = &row_offset_[0], *col_index = &col_index_[0];
+    const Scalar *values = &values_[0];
+    //L*y = residual
+    for(unsigned int row = 0; row < dim_; ++row)
+    {
+        Scalar sum = residual_data[row];
+        unsigned int diag_pos = row_offset[row+1]-1;
+        for(unsigned int i = row_offset[row]; i < diag_pos; ++i)
+            sum -= values[i]*result_data[col_index[i]];
+        result_data[row] = sum/values[diag_pos];
+    }
+    //L^T*result = y, column-oriented with the rows of L
+    for(unsigned int row = dim_; row > 0; --row)
+    {
+        unsigned int diag_pos = row_offset[row]-1;
+        Scalar value = result_data[row-1]/values[diag_pos];
+        result_data[row-1] = value;
+        for(unsigned int i = row_offset[row-1]; i < diag_pos; ++i)
+            result_data[col_index[i]] -= values[i]*value;
+    }
+}
+
+template <typename Scalar>
+void IncompleteCholeskyPreconditioner<Scalar>::printInfo() const
+{
+    std::cout<<"Incomplete Cholesky preconditioner: M = L*L^T with the sparsity pattern of A, diagonal shift "<<shift_<<"\n";
+}
+
+template <typename Scalar>
+Scalar IncompleteCholeskyPreconditioner<Scalar>::shift() const
+{
+    return shift_;
+}
+
+//explicit instantiations
+template class IncompleteCholeskyPreconditioner<float>;
+template class IncompleteCholeskyPreconditioner<double>;
+template class IncompleteCholeskyPreconditioner<long double>;
+
+}  //end of namespace Physika
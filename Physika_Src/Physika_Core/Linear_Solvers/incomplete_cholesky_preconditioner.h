@@ -0,0 +1,56 @@
+/*
+ * @file incomplete_cholesky_preconditioner.h
+ * @brief Incomplete Cholesky preconditioner with zero fill-in, IC(0).
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_LINEAR_SOLVERS_INCOMPLETE_CHOLESKY_PRECONDITIONER_H_
+#define PHYSIKA_CORE_LINEAR_SOLVERS_INCOMPLETE_CHOLESKY_PRECONDITIONER_H_
+
+#include <vector>
+#include "Physika_Core/Linear_Solvers/preconditioner.h"
+
+namespace Physika{
+
+/*
+ * IncompleteCholeskyPreconditioner: M = L*L^T where L is the Cholesky factor of A restricted to the
+ * sparsity pattern of the lower triangle of A, for symmetric positive definite A.
+ *
+ * IC(0) may break down with nonpositive pivots even if A is positive definite. In that case the
+ * factorization is restarted on A + shift*diag(A) with increasing shift, see shift().
+ * Only the lower triangle of A is read. The triangular solves in apply() are sequential.
+ */
+
+template <typename Scalar>
+class IncompleteCholeskyPreconditioner: public Preconditioner<Scalar>
+{
+public:
+    IncompleteCholeskyPreconditioner();
+    ~IncompleteCholeskyPreconditioner();
+    IncompleteCholeskyPreconditioner<Scalar>* clone() const;
+    void compute(const CSRMatrix<Scalar> &matrix);
+    void apply(const VectorND<Scalar> &residual, VectorND<Scalar> &result) const;
+    void printInfo() const;
+    Scalar shift() const;  //relative diagonal shift used in last compute(), 0 if IC(0) of A succeeded
+protected:
+    bool factorize(const std::vector<Scalar> &lower_values, Scalar shift);  //return false on breakdown
+protected:
+    //L in compressed row format, the diagonal entry is the last one of each row
+    unsigned int dim_;
+    std::vector<unsigned int> row_offset_;
+    std::vector<unsigned int> col_index_;
+    std::vector<Scalar> values_;
+    Scalar shift_;
+};
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_LINEAR_SOLVERS_INCOMPLETE_CHOLESKY_PRECONDITIONER_H_
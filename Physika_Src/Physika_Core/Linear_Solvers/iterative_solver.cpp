@@ -0,0 +1,380 @@
+/*
+ * @file iterative_solver.cpp
+ * @brief Base class of the iterative solvers of sparse linear systems.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Core/Linear_Solvers/iterative_solver.h"
+
+namespace Physika{
+
+template <typename Scalar>
+IterativeSolver<Scalar>::IterativeSolver()
+    :tolerance_(static_cast<Scalar>(1.0e-6)),max_iteration_num_(1000),thread_num_(maxThreadNum()),warm_start_(false),
+     preconditioner_(NULL),matrix_(thread_num_),rhs_norm_(0),converged_(false),compute_time_(0),solve_time_(0)
+{
+}
+
+template <typename Scalar>
+IterativeSolver<Scalar>::IterativeSolver(const IterativeSolver<Scalar> &solver)
+    :preconditioner_(NULL)
+{
+    *this = solver;
+}
+
+template <typename Scalar>
+IterativeSolver<Scalar>::~IterativeSolver()
+{
+    if(preconditioner_)
+        delete preconditioner_;
+}
+
+template <typename Scalar>
+IterativeSolver<Scalar>& IterativeSolver<Scalar>::operator= (const IterativeSolver<Scalar> &solver)
+{
+    if(this == &solver)
+        return *this;
+    tolerance_ = solver.tolerance_;
+    max_iteration_num_ = solver.max_iteration_num_;
+    thread_num_ = solver.thread_num_;
+    warm_start_ = solver.warm_start_;
+    if(preconditioner_)
+        delete preconditioner_;
+    preconditioner_ = solver.preconditioner_ ? solver.preconditioner_->clone() : NULL;
+    matrix_ = solver.matrix_;
+    rhs_norm_ = solver.rhs_norm_;
+    converged_ = solver.converged_;
+    residual_history_ = solver.residual_history_;
+    compute_time_ = solver.compute_time_;
+    solve_time_ = solver.solve_time_;
+    return *this;
+}
+
+template <typename Scalar>
+Scalar IterativeSolver<Scalar>::tolerance() const
+{
+    return tolerance_;
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::setTolerance(Scalar tolerance)
+{
+    if(tolerance < 0)
+    {
+        std::cerr<<"Warning: negative tolerance of iterative solver, operation ignored!\n";
+        return;
+    }
+    tolerance_ = tolerance;
+}
+
+template <typename Scalar>
+unsigned int IterativeSolver<Scalar>::maxIterationNum() const
+{
+    return max_iteration_num_;
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::setMaxIterationNum(unsigned int max_iteration_num)
+{
+    max_iteration_num_ = max_iteration_num;
+}
+
+template <typename Scalar>
+unsigned int IterativeSolver<Scalar>::threadNum() const
+{
+    return thread_num_;
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::setThreadNum(unsigned int thread_num)
+{
+    if(thread_num == 0)
+    {
+        std::cerr<<"Warning: cannot set thread number to 0, 1 thread is used instead!\n";
+        thread_num = 1;
+    }
+    thread_num_ = thread_num;
+    matrix_.setThreadNum(thread_num_);
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::setPreconditioner(const Preconditioner<Scalar> &preconditioner)
+{
+    if(preconditioner_)
+        delete preconditioner_;
+    preconditioner_ = preconditioner.clone();
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::removePreconditioner()
+{
+    if(preconditioner_)
+        delete preconditioner_;
+    preconditioner_ = NULL;
+}
+
+template <typename Scalar>
+const Preconditioner<Scalar>* IterativeSolver<Scalar>::preconditioner() const
+{
+    return preconditioner_;
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::enableWarmStart()
+{
+    warm_start_ = true;
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::disableWarmStart()
+{
+    warm_start_ = false;
+}
+
+template <typename Scalar>
+bool IterativeSolver<Scalar>::isWarmStartEnabled() const
+{
+    return warm_start_;
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::compute(const SparseMatrix<Scalar> &matrix)
+{
+    if(matrix.rows() != matrix.cols())
+    {
+        std::cerr<<"Error: iterative solver requires square matrix, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    Timer timer;
+    timer.startTimer();
+    matrix_.setThreadNum(thread_num_);
+    matrix_.setFromSparseMatrix(matrix);
+    if(preconditioner_)
+        preconditioner_->compute(matrix_);
+    timer.stopTimer();
+    compute_time_ = timer.getElapsedTime();
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::compute(const CSRMatrix<Scalar> &matrix)
+{
+    if(matrix.rows() != matrix.cols())
+    {
+        std::cerr<<"Error: iterative solver requires square matrix, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    Timer timer;
+    timer.startTimer();
+    matrix_ = matrix;
+    matrix_.setThreadNum(thread_num_);
+    if(preconditioner_)
+        preconditioner_->compute(matrix_);
+    timer.stopTimer();
+    compute_time_ = timer.getElapsedTime();
+}
+
+template <typename Scalar>
+bool IterativeSolver<Scalar>::solve(const VectorND<Scalar> &rhs, VectorND<Scalar> &x)
+{
+    if(rhs.dims() != matrix_.rows())
+    {
+        std::cerr<<"Error: dimension of right-hand side doesn't match the matrix of iterative solver, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    Timer timer;
+    timer.startTimer();
+    unsigned int dim = matrix_.cols();
+    if(!warm_start_ || x.dims() != dim)
+        x = VectorND<Scalar>(dim,0);
+    residual_history_.clear();
+    rhs_norm_ = std::sqrt(IterativeSolverInternal::dot(rhs,rhs,thread_num_));
+    if(rhs_norm_ == 0)
+    {
+        x = VectorND<Scalar>(dim,0);
+        residual_history_.push_back(0);
+        converged_ = true;
+    }
+    else
+        converged_ = iterate(rhs,x);
+    timer.stopTimer();
+    solve_time_ = timer.getElapsedTime();
+    return converged_;
+}
+
+template <typename Scalar>
+bool IterativeSolver<Scalar>::solve(const SparseMatrix<Scalar> &matrix, const VectorND<Scalar> &rhs, VectorND<Scalar> &x)
+{
+    compute(matrix);
+    return solve(rhs,x);
+}
+
+template <typename Scalar>
+bool IterativeSolver<Scalar>::isConverged() const
+{
+    return converged_;
+}
+
+template <typename Scalar>
+unsigned int IterativeSolver<Scalar>::iterationNum() const
+{
+    return residual_history_.empty() ? 0 : static_cast<unsigned int>(residual_history_.size()) - 1;
+}
+
+template <typename Scalar>
+Scalar IterativeSolver<Scalar>::residual() const
+{
+    return residual_history_.empty() ? 0 : residual_history_.back();
+}
+
+template <typename Scalar>
+const std::vector<Scalar>& IterativeSolver<Scalar>::residualHistory() const
+{
+    return residual_history_;
+}
+
+template <typename Scalar>
+double IterativeSolver<Scalar>::computeTime() const
+{
+    return compute_time_;
+}
+
+template <typename Scalar>
+double IterativeSolver<Scalar>::solveTime() const
+{
+    return solve_time_;
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::printStatistics() const
+{
+    std::cout<<(converged_ ? "Converged" : "Not converged")<<" in "<<iterationNum()<<" iterations, relative residual "<<residual()
+             <<", compute time "<<compute_time_<<" s, solve time "<<solve_time_<<" s\n";
+}
+
+template <typename Scalar>
+bool IterativeSolver<Scalar>::recordResidual(Scalar residual_norm)
+{
+    Scalar relative_residual = residual_norm/rhs_norm_;
+    residual_history_.push_back(relative_residual);
+    return relative_residual <= tolerance_;
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::computeResidual(const VectorND<Scalar> &rhs, const VectorND<Scalar> &x, VectorND<Scalar> &residual) const
+{
+    matrix_.multiply(x,residual);
+    IterativeSolverInternal::xpby(rhs,static_cast<Scalar>(-1),residual,thread_num_);
+}
+
+template <typename Scalar>
+void IterativeSolver<Scalar>::precondition(const VectorND<Scalar> &residual, VectorND<Scalar> &result) const
+{
+    if(preconditioner_)
+        preconditioner_->apply(residual,result);
+    else
+        result = residual;
+}
+
+namespace IterativeSolverInternal{
+
+template <typename Scalar>
+Scalar dot(const VectorND<Scalar> &x, const VectorND<Scalar> &y, unsigned int thread_num)
+{
+    PHYSIKA_ASSERT(x.dims() == y.dims());
+    unsigned int dim = x.dims();
+    if(dim == 0)
+        return 0;
+    const Scalar *x_data = &x[0], *y_data = &y[0];
+    //partial sums of fixed ranges are added in order
+    int range_num = static_cast<int>(thread_num);
+    std::vector<Scalar> partial_sums(thread_num,0);
+#pragma omp parallel for num_threads(thread_num)
+    for(int range = 0; range < range_num; ++range)
+    {
+        unsigned int start = static_cast<unsigned int>(static_cast<unsigned long long>(dim)*range/range_num);
+        unsigned int end = static_cast<unsigned int>(static_cast<unsigned long long>(dim)*(range+1)/range_num);
+        Scalar sum = 0;
+        for(unsigned int i = start; i < end; ++i)
+            sum += x_data[i]*y_data[i];
+        partial_sums[range] = sum;
+    }
+    Scalar sum = 0;
+    for(unsigned int range = 0; range < thread_num; ++range)
+        sum += partial_sums[range];
+    return sum;
+}
+
+template <typename Scalar>
+void axpy(Scalar alpha, const VectorND<Scalar> &x, VectorND<Scalar> &y, unsigned int thread_num)
+{
+    PHYSIKA_ASSERT(x.dims() == y.dims());
+    int dim = static_cast<int>(x.dims());
+    if(dim == 0)
+        return;
+    const Scalar *x_data = &x[0];
+    Scalar *y_data = &y[0];
+#pragma omp parallel for num_threads(thread_num)
+    for(int i = 0; i < dim; ++i)
+        y_data[i] += alpha*x_data[i];
+}
+
+template <typename Scalar>
+void xpby(const VectorND<Scalar> &x, Scalar beta, VectorND<Scalar> &y, unsigned int thread_num)
+{
+    PHYSIKA_ASSERT(x.dims() == y.dims());
+    int dim = static_cast<int>(x.dims());
+    if(dim == 0)
+        return;
+    const Scalar *x_data = &x[0];
+    Scalar *y_data = &y[0];
+#pragma omp parallel for num_threads(thread_num)
+    for(int i = 0; i < dim; ++i)
+        y_data[i] = x_data[i] + beta*y_data[i];
+}
+
+template <typename Scalar>
+void scale(Scalar alpha, VectorND<Scalar> &y, unsigned int thread_num)
+{
+    int dim = static_cast<int>(y.dims());
+    if(dim == 0)
+        return;
+    Scalar *y_data = &y[0];
+#pragma omp parallel for num_threads(thread_num)
+    for(int i = 0; i < dim; ++i)
+        y_data[i] *= alpha;
+}
+
+//explicit instantiations
+template float dot<float>(const VectorND<float>&, const VectorND<float>&, unsigned int);
+template double dot<double>(const VectorND<double>&, const VectorND<double>&, unsigned int);
+template long double dot<long double>(const VectorND<long double>&, const VectorND<long double>&, unsigned int);
+template void axpy<float>(float, const VectorND<float>&, VectorND<float>&, unsigned int);
+template void axpy<double>(double, const VectorND<double>&, VectorND<double>&, unsigned int);
+template void axpy<long double>(long double, const VectorND<long double>&, VectorND<long double>&, unsigned int);
+template void xpby<float>(const VectorND<float>&, float, VectorND<float>&, unsigned int);
+template void xpby<double>(const VectorND<double>&, double, VectorND<double>&, unsigned int);
+template void xpby<long double>(const VectorND<long double>&, long double, VectorND<long double>&, unsigned int);
+template void scale<float>(float, VectorND<float>&, unsigned int);
+template void scale<double>(double, VectorND<double>&, unsigned int);
+template void scale<long double>(long double, VectorND<long double>&, unsigned int);
+
+}  //end of namespace IterativeSolverInternal
+
+//explicit instantiations
+template class IterativeSolver<float>;
+template class IterativeSolver<double>;
+template class IterativeSolver<long double>;
+
+}  //end of namespace Physika
@@ -0,0 +1,135 @@
+/*
+ * @file iterative_solver.h
+ * @brief Base class of the iterative solvers of sparse linear systems.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_LINEAR_SOLVERS_ITERATIVE_SOLVER_H_
+#define PHYSIKA_CORE_LINEAR_SOLVERS_ITERATIVE_SOLVER_H_
+
+#include <vector>
+#include "Physika_Core/Utilities/type_utilities.h"
+#include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Core/Utilities/parallel_utilities.h"
+#include "Physika_Core/Vectors/vector_Nd.h"
+#include "Physika_Core/Matrices/sparse_matrix.h"
+#include "Physika_Core/Matrices/csr_matrix.h"
+#include "Physika_Core/Linear_Solvers/preconditioner.h"
+
+namespace Physika{
+
+/*
+ * IterativeSolver: Base class of the iterative solvers for sparse linear system Ax = b.
+ *
+ * compute() copies A into a CSRMatrix and sets up the preconditioner, solve() can then be called for
+ * several right-hand sides. The matrix-vector products and vector operations run with threadNum() threads.
+ *
+ * Convergence: the relative residual |b-Ax|/|b| is below tolerance(), or maxIterationNum() is reached.
+ * Warm start: if enabled, x passed to solve() is the initial guess, otherwise the iteration starts from 0.
+ * Telemetry of last solve: isConverged(), iterationNum(), residual(), residualHistory() which has the relative
+ * residual of the initial guess and each iteration, and the time of compute() and solve().
+ *
+ * Usage:
+ *     ConjugateGradientSolver<double> solver;
+ *     solver.setPreconditioner(IncompleteCholeskyPreconditioner<double>());
+ *     solver.compute(A);
+ *     solver.solve(b,x);
+ */
+
+template <typename Scalar>
+class IterativeSolver
+{
+public:
+    IterativeSolver();
+    IterativeSolver(const IterativeSolver<Scalar> &solver);
+    virtual ~IterativeSolver();
+    IterativeSolver<Scalar>& operator= (const IterativeSolver<Scalar> &solver);
+    //settings
+    Scalar tolerance() const;
+    void setTolerance(Scalar tolerance);
+    unsigned int maxIterationNum() const;
+    void setMaxIterationNum(unsigned int max_iteration_num);
+    unsigned int threadNum() const;
+    void setThreadNum(unsigned int thread_num);
+    void setPreconditioner(const Preconditioner<Scalar> &preconditioner);  //a copy is kept, takes effect in next compute()
+    void removePreconditioner();
+    const Preconditioner<Scalar>* preconditioner() const;  //NULL if not set
+    void enableWarmStart();
+    void disableWarmStart();
+    bool isWarmStartEnabled() const;
+    //solve
+    void compute(const SparseMatrix<Scalar> &matrix);
+    void compute(const CSRMatrix<Scalar> &matrix);  //the matrix is copied, e.g., a CSRMatrix whose values are refilled on a fixed pattern
+    bool solve(const VectorND<Scalar> &rhs, VectorND<Scalar> &x);  //return true if converged
+    bool solve(const SparseMatrix<Scalar> &matrix, const VectorND<Scalar> &rhs, VectorND<Scalar> &x);  //compute() and solve()
+    //telemetry of last solve
+    bool isConverged() const;
+    unsigned int iterationNum() const;
+    Scalar residual() const;  //relative residual
+    const std::vector<Scalar>& residualHistory() const;
+    double computeTime() const;
+    double solveTime() const;
+    void printStatistics() const;
+    virtual void printInfo() const=0;
+protected:
+    //iterations from the initial guess x, implemented by subclasses which call recordResidual() each iteration
+    //return true if converged
+    virtual bool iterate(const VectorND<Scalar> &rhs, VectorND<Scalar> &x)=0;
+    //record the relative residual and return true if it is below tolerance
+    bool recordResidual(Scalar residual_norm);
+    //residual = rhs - A*x
+    void computeResidual(const VectorND<Scalar> &rhs, const VectorND<Scalar> &x, VectorND<Scalar> &residual) const;
+    //result = M^{-1}*residual, copy of residual if no preconditioner is set
+    void precondition(const VectorND<Scalar> &residual, VectorND<Scalar> &result) const;
+protected:
+    Scalar tolerance_;
+    unsigned int max_iteration_num_;
+    unsigned int thread_num_;
+    bool warm_start_;
+    Preconditioner<Scalar> *preconditioner_;
+    CSRMatrix<Scalar> matrix_;
+    //telemetry
+    Scalar rhs_norm_;
+    bool converged_;
+    std::vector<Scalar> residual_history_;
+    double compute_time_;
+    double solve_time_;
+private:
+    void compileTimeCheck()
+    {
+        PHYSIKA_STATIC_ASSERT(is_floating_point<Scalar>::value,
+                              "IterativeSolver<Scalar> are only defined for floating-point types.");
+    }
+};
+
+//vector operations of the solvers with thread_num threads, the results don't depend on scheduling
+namespace IterativeSolverInternal{
+
+template <typename Scalar>
+Scalar dot(const VectorND<Scalar> &x, const VectorND<Scalar> &y, unsigned int thread_num);
+
+//y += alpha*x
+template <typename Scalar>
+void axpy(Scalar alpha, const VectorND<Scalar> &x, VectorND<Scalar> &y, unsigned int thread_num);
+
+//y = x + beta*y
+template <typename Scalar>
+void xpby(const VectorND<Scalar> &x, Scalar beta, VectorND<Scalar> &y, unsigned int thread_num);
+
+//y = alpha*y
+template <typename Scalar>
+void scale(Scalar alpha, VectorND<Scalar> &y, unsigned int thread_num);
+
+}  //end of namespace IterativeSolverInternal
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_LINEAR_SOLVERS_ITERATIVE_SOLVER_H_
@@ -0,0 +1,75 @@
+/*
+ * @file jacobi_preconditioner.cpp
+ * @brief Jacobi preconditioner, the inverse of the diagonal of the matrix.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <iostream>
+#include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Core/Linear_Solvers/jacobi_preconditioner.h"
+
+namespace Physika{
+
+template <typename Scalar>
+JacobiPreconditioner<Scalar>::JacobiPreconditioner()
+    :thread_num_(1)
+{
+}
+
+template <typename Scalar>
+JacobiPreconditioner<Scalar>::~JacobiPreconditioner()
+{
+}
+
+template <typename Scalar>
+JacobiPreconditioner<Scalar>* JacobiPreconditioner<Scalar>::clone() const
+{
+    return new JacobiPreconditioner<Scalar>(*this);
+}
+
+template <typename Scalar>
+void JacobiPreconditioner<Scalar>::compute(const CSRMatrix<Scalar> &matrix)
+{
+    inv_diagonal_ = matrix.diagonal();
+    for(unsigned int i = 0; i < inv_diagonal_.dims(); ++i)
+        inv_diagonal_[i] = inv_diagonal_[i] != 0 ? 1/inv_diagonal_[i] : 1;
+    thread_num_ = matrix.threadNum();
+}
+
+template <typename Scalar>
+void JacobiPreconditioner<Scalar>::apply(const VectorND<Scalar> &residual, VectorND<Scalar> &result) const
+{
+    PHYSIKA_ASSERT(residual.dims() == inv_diagonal_.dims());
+    PHYSIKA_ASSERT(&residual != &result);
+    if(result.dims() != residual.dims())
+        result.resize(residual.dims());
+    int dim = static_cast<int>(residual.dims());
+    if(dim == 0)
+        return;
+    const Scalar *inv_diagonal = &inv_diagonal_[0], *residual_data = &residual[0];
+    Scalar *result_data = &result[0];
+#pragma omp parallel for num_threads(thread_num_)
+    for(int i = 0; i < dim; ++i)
+        result_data[i] = inv_diagonal[i]*residual_data[i];
+}
+
+template <typename Scalar>
+void JacobiPreconditioner<Scalar>::printInfo() const
+{
+    std::cout<<"Jacobi preconditioner: M = diag(A)\n";
+}
+
+//explicit instantiations
+template class JacobiPreconditioner<float>;
+template class JacobiPreconditioner<double>;
+template class JacobiPreconditioner<long double>;
+
+}  //end of namespace Physika
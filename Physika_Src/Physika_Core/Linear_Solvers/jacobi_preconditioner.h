@@ -0,0 +1,44 @@
+/*
+ * @file jacobi_preconditioner.h
+ * @brief Jacobi preconditioner, the inverse of the diagonal of the matrix.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_LINEAR_SOLVERS_JACOBI_PRECONDITIONER_H_
+#define PHYSIKA_CORE_LINEAR_SOLVERS_JACOBI_PRECONDITIONER_H_
+
+#include "Physika_Core/Linear_Solvers/preconditioner.h"
+
+namespace Physika{
+
+/*
+ * JacobiPreconditioner: M = diag(A).
+ * Zero diagonal entries are treated as 1.
+ */
+
+template <typename Scalar>
+class JacobiPreconditioner: public Preconditioner<Scalar>
+{
+public:
+    JacobiPreconditioner();
+    ~JacobiPreconditioner();
+    JacobiPreconditioner<Scalar>* clone() const;
+    void compute(const CSRMatrix<Scalar> &matrix);
+    void apply(const VectorND<Scalar> &residual, VectorND<Scalar> &result) const;
+    void printInfo() const;
+protected:
+    VectorND<Scalar> inv_diagonal_;
+    unsigned int thread_num_;
+};
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_LINEAR_SOLVERS_JACOBI_PRECONDITIONER_H_
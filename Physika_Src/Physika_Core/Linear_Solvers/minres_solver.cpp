@@ -0,0 +1,148 @@
+/*
+ * @file minres_solver.cpp
+ * @brief Preconditioned minimal residual method for symmetric indefinite systems.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include "Physika_Core/Linear_Solvers/minres_solver.h"
+
+namespace Physika{
+
+template <typename Scalar>
+MINRESSolver<Scalar>::MINRESSolver()
+    :IterativeSolver<Scalar>()
+{
+}
+
+template <typename Scalar>
+MINRESSolver<Scalar>::~MINRESSolver()
+{
+}
+
+template <typename Scalar>
+void MINRESSolver<Scalar>::printInfo() const
+{
+    std::cout<<"Preconditioned MINRES solver\n";
+    if(this->preconditioner_)
+        this->preconditioner_->printInfo();
+    else
+        std::cout<<"No preconditioner\n";
+}
+
+template <typename Scalar>
+bool MINRESSolver<Scalar>::iterate(const VectorND<Scalar> &rhs, VectorND<Scalar> &x)
+{
+    using IterativeSolverInternal::dot;
+    using IterativeSolverInternal::axpy;
+    using IterativeSolverInternal::scale;
+    unsigned int thread_num = this->thread_num_;
+    unsigned int dim = x.dims();
+    //the Lanczos vectors v, the preconditioned ones w = M^{-1}*v, and the search directions p of
+    //consecutive iterations are rotated among the buffers
+    VectorND<Scalar> v_vectors[3], w_vectors[2], p_vectors[3], residual;
+    VectorND<Scalar> *v_old = &v_vectors[0], *v = &v_vectors[1], *v_new = &v_vectors[2];
+    VectorND<Scalar> *w = &w_vectors[0], *w_new = &w_vectors[1];
+    VectorND<Scalar> *p_oold = &p_vectors[0], *p_old = &p_vectors[1], *p = &p_vectors[2];
+    *v_old = VectorND<Scalar>(dim,0);
+    *v = VectorND<Scalar>(dim,0);
+    for(unsigned int i = 0; i < 3; ++i)
+        p_vectors[i] = VectorND<Scalar>(dim,0);
+    this->computeResidual(rhs,x,*v_new);
+    Scalar residual_estimate = std::sqrt(dot(*v_new,*v_new,thread_num));
+    if(this->recordResidual(residual_estimate))
+        return true;
+    this->precondition(*v_new,*w_new);
+    Scalar beta_new2 = dot(*v_new,*w_new,thread_num);
+    if(!(beta_new2 > 0))
+    {
+        std::cerr<<"Warning: preconditioner of MINRESSolver is not positive definite, iteration stopped!\n";
+        return false;
+    }
+    Scalar beta_new = std::sqrt(beta_new2);
+    const Scalar beta_one = beta_new;
+    scale(1/beta_new,*v_new,thread_num);
+    scale(1/beta_new,*w_new,thread_num);
+    Scalar c = 1, c_old = 1, s = 0, s_old = 0, eta = 1;
+    for(unsigned int iter = 0; iter < this->max_iteration_num_; ++iter)
+    {
+        //Lanczos step
+        Scalar beta = beta_new;
+        std::swap(v_old,v);
+        std::swap(v,v_new);
+        std::swap(w,w_new);
+        this->matrix_.multiply(*w,*v_new);
+        axpy(-beta,*v_old,*v_new,thread_num);
+        Scalar alpha = dot(*v_new,*w,thread_num);
+        axpy(-alpha,*v,*v_new,thread_num);
+        this->precondition(*v_new,*w_new);
+        beta_new2 = dot(*v_new,*w_new,thread_num);
+        if(beta_new2 < 0)
+        {
+            std::cerr<<"Warning: preconditioner of MINRESSolver is not positive definite, iteration stopped!\n";
+            return false;
+        }
+        beta_new = std::sqrt(beta_new2);
+        if(beta_new > 0)
+        {
+            scale(1/beta_new,*v_new,thread_num);
+            scale(1/beta_new,*w_new,thread_num);
+        }
+        //QR decomposition of the tridiagonal matrix with Givens rotations
+        Scalar r2 = s*alpha + c*c_old*beta;
+        Scalar r3 = s_old*beta;
+        Scalar r1_hat = c*alpha - c_old*s*beta;
+        Scalar r1 = std::sqrt(r1_hat*r1_hat + beta_new*beta_new);
+        if(r1 == 0)
+        {
+            std::cerr<<"Warning: breakdown of MINRESSolver, iteration stopped!\n";
+            return false;
+        }
+        c_old = c;
+        s_old = s;
+        c = r1_hat/r1;
+        s = beta_new/r1;
+        //update of search direction and solution
+        std::swap(p_oold,p_old);
+        std::swap(p_old,p);
+        const Scalar *w_data = &(*w)[0], *p_old_data = &(*p_old)[0], *p_oold_data = &(*p_oold)[0];
+        Scalar *p_data = &(*p)[0];
+        int dim_int = static_cast<int>(dim);
+#pragma omp parallel for num_threads(thread_num)
+        for(int i = 0; i < dim_int; ++i)
+            p_data[i] = (w_data[i] - r2*p_old_data[i] - r3*p_oold_data[i])/r1;
+        axpy(beta_one*c*eta,*p,x,thread_num);
+        eta = -s*eta;
+        //the estimate is verified with the true residual before stopping
+        residual_estimate *= std::abs(s);
+        if(residual_estimate <= this->tolerance_*this->rhs_norm_ || beta_new == 0)
+        {
+            this->computeResidual(rhs,x,residual);
+            residual_estimate = std::sqrt(dot(residual,residual,thread_num));
+            if(this->recordResidual(residual_estimate))
+                return true;
+            if(beta_new == 0)
+                return false;
+        }
+        else
+            this->recordResidual(residual_estimate);
+    }
+    return false;
+}
+
+//explicit instantiations
+template class MINRESSolver<float>;
+template class MINRESSolver<double>;
+template class MINRESSolver<long double>;
+
+}  //end of namespace Physika
@@ -0,0 +1,43 @@
+/*
+ * @file minres_solver.h
+ * @brief Preconditioned minimal residual method for symmetric indefinite systems.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_LINEAR_SOLVERS_MINRES_SOLVER_H_
+#define PHYSIKA_CORE_LINEAR_SOLVERS_MINRES_SOLVER_H_
+
+#include "Physika_Core/Linear_Solvers/iterative_solver.h"
+
+namespace Physika{
+
+/*
+ * MINRESSolver: preconditioned minimal residual method (MINRES) of Paige and Saunders.
+ * A must be symmetric but may be indefinite, e.g., saddle point systems of constrained dynamics,
+ * while the preconditioner must be symmetric positive definite.
+ * The residual is estimated from the Lanczos recurrence in each iteration, and the true residual
+ * is checked when the estimate meets the tolerance.
+ */
+
+template <typename Scalar>
+class MINRESSolver: public IterativeSolver<Scalar>
+{
+public:
+    MINRESSolver();
+    ~MINRESSolver();
+    void printInfo() const;
+protected:
+    bool iterate(const VectorND<Scalar> &rhs, VectorND<Scalar> &x);
+};
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_LINEAR_SOLVERS_MINRES_SOLVER_H_
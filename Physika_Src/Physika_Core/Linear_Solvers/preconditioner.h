@@ -0,0 +1,46 @@
+/*
+ * @file preconditioner.h
+ * @brief Base class of the preconditioners of iterative linear solvers.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_LINEAR_SOLVERS_PRECONDITIONER_H_
+#define PHYSIKA_CORE_LINEAR_SOLVERS_PRECONDITIONER_H_
+
+#include "Physika_Core/Vectors/vector_Nd.h"
+#include "Physika_Core/Matrices/csr_matrix.h"
+
+namespace Physika{
+
+/*
+ * Preconditioner: Base class of all preconditioners.
+ * A preconditioner M approximates the matrix A of the linear system Ax = b such that M^{-1}*r is cheap to
+ * compute, the iterative solvers apply it to the residual in each iteration.
+ * compute() is called once for each matrix, and apply() computes z = M^{-1}*r.
+ * Preconditioners of ConjugateGradientSolver and MINRESSolver must be symmetric positive definite.
+ */
+
+template <typename Scalar>
+class Preconditioner
+{
+public:
+    Preconditioner(){}
+    virtual ~Preconditioner(){}
+    virtual Preconditioner<Scalar>* clone() const=0;
+    virtual void compute(const CSRMatrix<Scalar> &matrix)=0;
+    //result = M^{-1}*residual, result is resized if needed and must not be residual
+    virtual void apply(const VectorND<Scalar> &residual, VectorND<Scalar> &result) const=0;
+    virtual void printInfo() const=0;
+};
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_LINEAR_SOLVERS_PRECONDITIONER_H_
@@ -0,0 +1,379 @@
+/*
+ * @file csr_matrix.cpp
+ * @brief Sparse matrix in compressed sparse row (CSR) format for fast matrix-vector products.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Core/Matrices/csr_matrix.h"
+
+namespace Physika{
+
+namespace CSRMatrixInternal{
+
+//number of right-hand sides multiplied together in multiply() with several right-hand sides
+const unsigned int rhs_block = 4;
+
+}  //end of namespace CSRMatrixInternal
+
+template <typename Scalar>
+CSRMatrix<Scalar>::CSRMatrix(unsigned int thread_num)
+    :rows_(0),cols_(0),row_offset_(1,0)
+{
+    setThreadNum(thread_num);
+}
+
+template <typename Scalar>
+CSRMatrix<Scalar>::CSRMatrix(const SparseMatrix<Scalar> &matrix, unsigned int thread_num)
+    :rows_(0),cols_(0),row_offset_(1,0)
+{
+    setThreadNum(thread_num);
+    setFromSparseMatrix(matrix);
+}
+
+template <typename Scalar>
+CSRMatrix<Scalar>::~CSRMatrix()
+{
+}
+
+template <typename Scalar>
+unsigned int CSRMatrix<Scalar>::rows() const
+{
+    return rows_;
+}
+
+template <typename Scalar>
+unsigned int CSRMatrix<Scalar>::cols() const
+{
+    return cols_;
+}
+
+template <typename Scalar>
+unsigned int CSRMatrix<Scalar>::nonZeros() const
+{
+    return static_cast<unsigned int>(values_.size());
+}
+
+template <typename Scalar>
+unsigned int CSRMatrix<Scalar>::threadNum() const
+{
+    return thread_num_;
+}
+
+template <typename Scalar>
+void CSRMatrix<Scalar>::setThreadNum(unsigned int thread_num)
+{
+    if(thread_num == 0)
+    {
+        std::cerr<<"Warning: cannot set thread number to 0, 1 thread is used instead!\n";
+        thread_num = 1;
+    }
+    thread_num_ = thread_num;
+    updateRowPartition();
+}
+
+template <typename Scalar>
+void CSRMatrix<Scalar>::setFromSparseMatrix(const SparseMatrix<Scalar> &matrix)
+{
+    rows_ = matrix.rows();
+    cols_ = matrix.cols();
+    //counting sort of the entries on row index, the entries of SparseMatrix are visited in either row-major
+    //or col-major order, and in both cases the entries of each row end up in ascending column order
+#ifdef PHYSIKA_USE_BUILT_IN_SPARSE_MATRIX
+    const std::vector<Trituple<Scalar> > &elements = matrix.elements_;
+    unsigned int entry_num = static_cast<unsigned int>(elements.size());
+    row_offset_.assign(rows_+1,0);
+    for(unsigned int i = 0; i < entry_num; ++i)
+        ++row_offset_[elements[i].row()+1];
+    for(unsigned int i = 0; i < rows_; ++i)
+        row_offset_[i+1] += row_offset_[i];
+    col_index_.resize(entry_num);
+    values_.resize(entry_num);
+    std::vector<unsigned int> insert_pos(row_offset_.begin(),row_offset_.end()-1);
+    for(unsigned int i = 0; i < entry_num; ++i)
+    {
+        unsigned int pos = insert_pos[elements[i].row()]++;
+        col_index_[pos] = elements[i].col();
+        values_[pos] = elements[i].value();
+    }
+#elif defined(PHYSIKA_USE_EIGEN_SPARSE_MATRIX)
+    const Eigen::SparseMatrix<Scalar> &eigen_matrix = *(matrix.ptr_eigen_sparse_matrix_);
+    unsigned int entry_num = static_cast<unsigned int>(eigen_matrix.nonZeros());
+    row_offset_.assign(rows_+1,0);
+    for(int k = 0; k < eigen_matrix.outerSize(); ++k)
+        for(typename Eigen::SparseMatrix<Scalar>::InnerIterator it(eigen_matrix,k); it; ++it)
+            ++row_offset_[it.row()+1];
+    for(unsigned int i = 0; i < rows_; ++i)
+        row_offset_[i+1] += row_offset_[i];
+    col_index_.resize(entry_num);
+    values_.resize(entry_num);
+    std::vector<unsigned int> insert_pos(row_offset_.begin(),row_offset_.end()-1);
+    for(int k = 0; k < eigen_matrix.outerSize(); ++k)
+        for(typename Eigen::SparseMatrix<Scalar>::InnerIterator it(eigen_matrix,k); it; ++it)
+        {
+            unsigned int pos = insert_pos[it.row()]++;
+            col_index_[pos] = it.col();
+            values_[pos] = it.value();
+        }
+#endif
+    updateRowPartition();
+}
+
+template <typename Scalar>
+void CSRMatrix<Scalar>::setPattern(unsigned int rows, unsigned int cols, const std::vector<unsigned int> &row_offsets, const std::vector<unsigned int> &col_indices)
+{
+    if(row_offsets.size() != rows+1 || row_offsets[0] != 0 || row_offsets[rows] != col_indices.size())
+    {
+        std::cerr<<"Error: invalid row offsets of CSRMatrix pattern, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    for(unsigned int i = 0; i < col_indices.size(); ++i)
+        if(col_indices[i] >= cols)
+        {
+            std::cerr<<"Error: column index of CSRMatrix pattern out of range, program abort!\n";
+            std::exit(EXIT_FAILURE);
+        }
+    rows_ = rows;
+    cols_ = cols;
+    row_offset_ = row_offsets;
+    col_index_ = col_indices;
+    values_.assign(col_indices.size(),0);
+    updateRowPartition();
+}
+
+template <typename Scalar>
+const std::vector<unsigned int>& CSRMatrix<Scalar>::rowOffsets() const
+{
+    return row_offset_;
+}
+
+template <typename Scalar>
+const std::vector<unsigned int>& CSRMatrix<Scalar>::colIndices() const
+{
+    return col_index_;
+}
+
+template <typename Scalar>
+const std::vector<Scalar>& CSRMatrix<Scalar>::values() const
+{
+    return values_;
+}
+
+template <typename Scalar>
+std::vector<Scalar>& CSRMatrix<Scalar>::values()
+{
+    return values_;
+}
+
+template <typename Scalar>
+VectorND<Scalar> CSRMatrix<Scalar>::diagonal() const
+{
+    unsigned int diag_num = std::min(rows_,cols_);
+    VectorND<Scalar> diag(diag_num,0);
+    for(unsigned int row = 0; row < diag_num; ++row)
+    {
+        std::vector<unsigned int>::const_iterator row_begin = col_index_.begin() + row_offset_[row];
+        std::vector<unsigned int>::const_iterator row_end = col_index_.begin() + row_offset_[row+1];
+        std::vector<unsigned int>::const_iterator iter = std::lower_bound(row_begin,row_end,row);
+        if(iter != row_end && *iter == row)
+            diag[row] = values_[iter - col_index_.begin()];
+    }
+    return diag;
+}
+
+template <typename Scalar>
+VectorND<Scalar> CSRMatrix<Scalar>::operator* (const VectorND<Scalar> &x) const
+{
+    VectorND<Scalar> result(rows_);
+    multiply(x,result);
+    return result;
+}
+
+template <typename Scalar>
+void CSRMatrix<Scalar>::multiply(const VectorND<Scalar> &x, VectorND<Scalar> &result) const
+{
+    if(x.dims() != cols_)
+    {
+        std::cerr<<"Error: dimension of vector doesn't match the columns of CSRMatrix, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    PHYSIKA_ASSERT(&x != &result);
+    if(result.dims() != rows_)
+        result.resize(rows_);
+    if(rows_ == 0)
+        return;
+    const unsigned int *row_offset = &row_offset_[0];
+    const unsigned int *col_index = col_index_.empty() ? NULL : &col_index_[0];
+    const Scalar *values = values_.empty() ? NULL : &values_[0];
+    const Scalar *x_data = cols_ > 0 ? &x[0] : NULL;
+    Scalar *result_data = &result[0];
+    const unsigned int *row_partition = &row_partition_[0];
+    int range_num = static_cast<int>(thread_num_);
+#pragma omp parallel for num_threads(thread_num_)
+    for(int range = 0; range < range_num; ++range)
+        for(unsigned int row = row_partition[range]; row < row_partition[range+1]; ++row)
+        {
+            Scalar sum = 0;
+            for(unsigned int i = row_offset[row]; i < row_offset[row+1]; ++i)
+                sum += values[i]*x_data[col_index[i]];
+            result_data[row] = sum;
+        }
+}
+
+template <typename Scalar>
+VectorND<Scalar> CSRMatrix<Scalar>::transposeMultiply(const VectorND<Scalar> &x) const
+{
+    VectorND<Scalar> result(cols_);
+    transposeMultiply(x,result);
+    return result;
+}
+
+template <typename Scalar>
+void CSRMatrix<Scalar>::transposeMultiply(const VectorND<Scalar> &x, VectorND<Scalar> &result) const
+{
+    if(x.dims() != rows_)
+    {
+        std::cerr<<"Error: dimension of vector doesn't match the rows of CSRMatrix, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    PHYSIKA_ASSERT(&x != &result);
+    if(result.dims() != cols_)
+        result.resize(cols_);
+    if(cols_ == 0)
+        return;
+    Scalar *result_data = &result[0];
+    for(unsigned int col = 0; col < cols_; ++col)
+        result_data[col] = 0;
+    if(rows_ == 0)
+        return;
+    const unsigned int *row_offset = &row_offset_[0];
+    const unsigned int *col_index = col_index_.empty() ? NULL : &col_index_[0];
+    const Scalar *values = values_.empty() ? NULL : &values_[0];
+    const Scalar *x_data = &x[0];
+    const unsigned int *row_partition = &row_partition_[0];
+    //the first range is scattered into result directly, the others into their buffers
+    std::vector<Scalar> buffers(static_cast<size_t>(thread_num_-1)*cols_,0);
+    int range_num = static_cast<int>(thread_num_);
+#pragma omp parallel for num_threads(thread_num_)
+    for(int range = 0; range < range_num; ++range)
+    {
+        Scalar *target = range == 0 ? result_data : &buffers[static_cast<size_t>(range-1)*cols_];
+        for(unsigned int row = row_partition[range]; row < row_partition[range+1]; ++row)
+        {
+            Scalar x_value = x_data[row];
+            for(unsigned int i = row_offset[row]; i < row_offset[row+1]; ++i)
+                target[col_index[i]] += values[i]*x_value;
+        }
+    }
+    if(thread_num_ > 1)
+    {
+        int col_num = static_cast<int>(cols_);
+#pragma omp parallel for num_threads(thread_num_)
+        for(int col = 0; col < col_num; ++col)
+            for(unsigned int range = 1; range < thread_num_; ++range)
+                result_data[col] += buffers[static_cast<size_t>(range-1)*cols_+col];
+    }
+}
+
+template <typename Scalar>
+void CSRMatrix<Scalar>::multiply(const std::vector<VectorND<Scalar> > &x, std::vector<VectorND<Scalar> > &result) const
+{
+    unsigned int rhs_num = static_cast<unsigned int>(x.size());
+    for(unsigned int rhs = 0; rhs < rhs_num; ++rhs)
+        if(x[rhs].dims() != cols_)
+        {
+            std::cerr<<"Error: dimension of vector doesn't match the columns of CSRMatrix, program abort!\n";
+            std::exit(EXIT_FAILURE);
+        }
+    PHYSIKA_ASSERT(&x != &result);
+    result.resize(rhs_num);
+    for(unsigned int rhs = 0; rhs < rhs_num; ++rhs)
+        if(result[rhs].dims() != rows_)
+            result[rhs].resize(rows_);
+    if(rhs_num == 0 || rows_ == 0)
+        return;
+    const unsigned int *row_offset = &row_offset_[0];
+    const unsigned int *col_index = col_index_.empty() ? NULL : &col_index_[0];
+    const Scalar *values = values_.empty() ? NULL : &values_[0];
+    const unsigned int *row_partition = &row_partition_[0];
+    int range_num = static_cast<int>(thread_num_);
+    //the right-hand sides are processed in blocks of CSRMatrixInternal::rhs_block, the vectors of a block are
+    //interleaved so that entry j of them is contiguous, the last block is padded with zeros
+    const unsigned int block_size = CSRMatrixInternal::rhs_block;
+    std::vector<Scalar> packed_x(static_cast<size_t>(cols_)*block_size);
+    std::vector<const Scalar*> rhs_data(block_size);
+    std::vector<Scalar*> result_data(block_size);
+    Scalar *x_data = packed_x.empty() ? NULL : &packed_x[0];
+    int col_num = static_cast<int>(cols_);
+    for(unsigned int block_start = 0; block_start < rhs_num; block_start += block_size)
+    {
+        unsigned int block_rhs_num = std::min(block_size,rhs_num-block_start);
+        for(unsigned int rhs = 0; rhs < block_rhs_num; ++rhs)
+        {
+            rhs_data[rhs] = cols_ > 0 ? &x[block_start+rhs][0] : NULL;
+            result_data[rhs] = &result[block_start+rhs][0];
+        }
+#pragma omp parallel for num_threads(thread_num_)
+        for(int col = 0; col < col_num; ++col)
+            for(unsigned int rhs = 0; rhs < block_size; ++rhs)
+                x_data[static_cast<size_t>(col)*block_size+rhs] = rhs < block_rhs_num ? rhs_data[rhs][col] : 0;
+#pragma omp parallel for num_threads(thread_num_)
+        for(int range = 0; range < range_num; ++range)
+            for(unsigned int row = row_partition[range]; row < row_partition[range+1]; ++row)
+            {
+                Scalar sum[CSRMatrixInternal::rhs_block] = {0};
+                for(unsigned int i = row_offset[row]; i < row_offset[row+1]; ++i)
+                {
+                    Scalar value = values[i];
+                    const Scalar *col_x = x_data + static_cast<size_t>(col_index[i])*block_size;
+                    for(unsigned int rhs = 0; rhs < CSRMatrixInternal::rhs_block; ++rhs)
+                        sum[rhs] += value*col_x[rhs];
+                }
+                for(unsigned int rhs = 0; rhs < block_rhs_num; ++rhs)
+                    result_data[rhs][row] = sum[rhs];
+            }
+    }
+}
+
+template <typename Scalar>
+void CSRMatrix<Scalar>::updateRowPartition()
+{
+    //range k starts at the first row whose entries begin at or after k/thread_num of all entries
+    row_partition_.resize(thread_num_+1);
+    unsigned long long entry_num = row_offset_.back();
+    for(unsigned int range = 0; range < thread_num_; ++range)
+    {
+        unsigned int first_entry = static_cast<unsigned int>(entry_num*range/thread_num_);
+        row_partition_[range] = static_cast<unsigned int>(std::lower_bound(row_offset_.begin(),row_offset_.end()-1,first_entry) - row_offset_.begin());
+    }
+    row_partition_[0] = 0;
+    row_partition_[thread_num_] = rows_;
+}
+
+//explicit instantiations
+template class CSRMatrix<unsigned char>;
+template class CSRMatrix<unsigned short>;
+template class CSRMatrix<unsigned int>;
+template class CSRMatrix<unsigned long>;
+template class CSRMatrix<unsigned long long>;
+template class CSRMatrix<signed char>;
+template class CSRMatrix<short>;
+template class CSRMatrix<int>;
+template class CSRMatrix<long>;
+template class CSRMatrix<long long>;
+template class CSRMatrix<float>;
+template class CSRMatrix<double>;
+template class CSRMatrix<long double>;
+
+}  //end of namespace Physika
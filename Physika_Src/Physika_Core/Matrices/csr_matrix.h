@@ -0,0 +1,99 @@
+/*
+ * @file csr_matrix.h
+ * @brief Sparse matrix in compressed sparse row (CSR) format for fast matrix-vector products.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_MATRICES_CSR_MATRIX_H_
+#define PHYSIKA_CORE_MATRICES_CSR_MATRIX_H_
+
+#include <vector>
+#include "Physika_Core/Utilities/parallel_utilities.h"
+#include "Physika_Core/Vectors/vector_Nd.h"
+#include "Physika_Core/Matrices/sparse_matrix.h"
+
+namespace Physika{
+
+/*
+ * CSRMatrix: read-only copy of a SparseMatrix in compressed sparse row format, for the matrix-vector
+ * products in iterative solvers where the same matrix is applied many times.
+ * For matrices with a fixed sparsity pattern and changing values, e.g., the stiffness matrices of FEM in
+ * consecutive Newton iterations, the pattern can be set once with setPattern() and the values refilled in place.
+ *
+ * The entries are stored in three separate arrays: the offset of each row, the column index and the value
+ * of each entry. Compared with the Trituple elements of SparseMatrix, a product streams 4+sizeof(Scalar)
+ * bytes per entry instead of sizeof(Trituple<Scalar>), which is the bound of sparse matrix-vector product.
+ *
+ * The products are parallelized with threadNum() threads:
+ * 1. multiply(): the rows are split into threadNum() ranges with about the same number of entries.
+ * 2. transposeMultiply(): each range of rows is scattered into a buffer of the thread, then the buffers are summed.
+ * 3. multiply() with several right-hand sides: the vectors are interleaved so that each entry of the matrix is
+ *    loaded once for all of them, and the innermost loop over the right-hand sides is contiguous for SIMD.
+ * The results don't depend on the thread number except transposeMultiply(), where the summation order of
+ * the buffers depends on the row ranges.
+ *
+ * Usage:
+ *     CSRMatrix<double> csr_matrix(sparse_matrix);
+ *     csr_matrix.multiply(x,result);  //result = A*x, result is resized if needed
+ */
+
+template <typename Scalar>
+class CSRMatrix
+{
+public:
+    explicit CSRMatrix(unsigned int thread_num = maxThreadNum());  //empty matrix
+    explicit CSRMatrix(const SparseMatrix<Scalar> &matrix, unsigned int thread_num = maxThreadNum());
+    ~CSRMatrix();
+    unsigned int rows() const;
+    unsigned int cols() const;
+    unsigned int nonZeros() const;  //number of stored entries, including explicit zeros
+    unsigned int threadNum() const;
+    void setThreadNum(unsigned int thread_num);
+    //replace the entries with the ones of a SparseMatrix in either compressed mode
+    void setFromSparseMatrix(const SparseMatrix<Scalar> &matrix);
+    //replace the entries with the given pattern, the column indices of each row must be sorted, the values are set to zero
+    void setPattern(unsigned int rows, unsigned int cols, const std::vector<unsigned int> &row_offsets, const std::vector<unsigned int> &col_indices);
+    //raw arrays: the entries of row i are [rowOffsets()[i], rowOffsets()[i+1]), sorted by column index
+    const std::vector<unsigned int>& rowOffsets() const;
+    const std::vector<unsigned int>& colIndices() const;
+    const std::vector<Scalar>& values() const;
+    std::vector<Scalar>& values();  //the values can be modified in place, the size must not change
+    VectorND<Scalar> diagonal() const;
+    //A*x
+    VectorND<Scalar> operator* (const VectorND<Scalar> &x) const;
+    void multiply(const VectorND<Scalar> &x, VectorND<Scalar> &result) const;
+    //A^T*x, equal to x*A
+    VectorND<Scalar> transposeMultiply(const VectorND<Scalar> &x) const;
+    void transposeMultiply(const VectorND<Scalar> &x, VectorND<Scalar> &result) const;
+    //A*x[i] for a few right-hand sides at once
+    void multiply(const std::vector<VectorND<Scalar> > &x, std::vector<VectorND<Scalar> > &result) const;
+protected:
+    void updateRowPartition();  //split rows into threadNum() ranges with balanced number of entries
+protected:
+    unsigned int rows_;
+    unsigned int cols_;
+    std::vector<unsigned int> row_offset_;  //size rows_+1
+    std::vector<unsigned int> col_index_;
+    std::vector<Scalar> values_;
+    unsigned int thread_num_;
+    std::vector<unsigned int> row_partition_;  //size thread_num_+1, first row of each range
+};
+
+//multiply a row vector with a CSR matrix
+template <typename Scalar>
+VectorND<Scalar> operator*(const VectorND<Scalar> &vec, const CSRMatrix<Scalar> &mat)
+{
+    return mat.transposeMultiply(vec);
+}
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_MATRICES_CSR_MATRIX_H_
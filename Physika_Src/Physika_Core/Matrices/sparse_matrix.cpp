@@ -14,12 +14,52 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <algorithm>
 #include "Physika_Core/Utilities/physika_assert.h"
 #include "Physika_Core/Utilities/math_utilities.h"
+#include "Physika_Core/Utilities/parallel_utilities.h"
 #include "Physika_Core/Matrices/sparse_matrix.h"
 
 namespace Physika{
 
+namespace SparseMatrixInternal{
+
+//order of the entries in a row (ROW_MAJOR) or a column (COL_MAJOR)
+template <typename Scalar>
+struct MinorIndexLess
+{
+    explicit MinorIndexLess(matrix_compressed_mode priority):priority_(priority){}
+    bool operator() (const Trituple<Scalar> &tri1, const Trituple<Scalar> &tri2) const
+    {
+        return priority_ == ROW_MAJOR ? tri1.col() < tri2.col() : tri1.row() < tri2.row();
+    }
+    matrix_compressed_mode priority_;
+};
+
+//index of the entry in its line: column for ROW_MAJOR and row for COL_MAJOR
+template <typename Scalar>
+inline unsigned int minorIndex(const Trituple<Scalar> &tri, matrix_compressed_mode priority)
+{
+    return priority == ROW_MAJOR ? tri.col() : tri.row();
+}
+
+//per-thread buffers of sparse matrix product: the dense accumulator of a line, the marker of the line
+//that last touched each minor index, and the minor indices of the entries in current line
+template <typename Scalar>
+struct SpGEMMWorkspace
+{
+    void resize(unsigned int minor_num)
+    {
+        accumulator_.assign(minor_num,0);
+        marker_.assign(minor_num,0xFFFFFFFF);
+    }
+    std::vector<Scalar> accumulator_;
+    std::vector<unsigned int> marker_;
+    std::vector<unsigned int> line_minors_;
+};
+
+}  //end of namespace SparseMatrixInternal
+
 template <typename Scalar>
 SparseMatrix<Scalar>::SparseMatrix(matrix_compressed_mode priority)
 {
@@ -308,6 +348,67 @@ void SparseMatrix<Scalar>::setEntry(unsigned int i,unsigned int j, Scalar value)
 #endif
 }
 
+template <typename Scalar>
+void SparseMatrix<Scalar>::setFromTriplets(const std::vector<Trituple<Scalar> > &triplets)
+{
+    setFromTripletBuffers(&triplets,1);
+}
+
+template <typename Scalar>
+void SparseMatrix<Scalar>::setFromTripletBuffers(const std::vector<Trituple<Scalar> > *buffers, unsigned int buffer_num)
+{
+#ifdef PHYSIKA_USE_BUILT_IN_SPARSE_MATRIX
+    unsigned int line_num = priority_ == ROW_MAJOR ? rows_ : cols_;
+    //counting sort of the triplets on the major index, triplets of the same line keep the order of buffers
+    line_index_.assign(line_num+1,0);
+    unsigned int triplet_num = 0;
+    for(unsigned int buffer_idx = 0; buffer_idx < buffer_num; ++buffer_idx)
+    {
+        const std::vector<Trituple<Scalar> > &buffer = buffers[buffer_idx];
+        for(unsigned int i = 0; i < buffer.size(); ++i)
+        {
+            PHYSIKA_ASSERT(buffer[i].row() < rows_ && buffer[i].col() < cols_);
+            ++line_index_[(priority_ == ROW_MAJOR ? buffer[i].row() : buffer[i].col())+1];
+        }
+        triplet_num += buffer.size();
+    }
+    for(unsigned int line = 0; line < line_num; ++line)
+        line_index_[line+1] += line_index_[line];
+    std::vector<unsigned int> line_end(line_index_.begin(),line_index_.end()-1);
+    elements_.resize(triplet_num);
+    for(unsigned int buffer_idx = 0; buffer_idx < buffer_num; ++buffer_idx)
+    {
+        const std::vector<Trituple<Scalar> > &buffer = buffers[buffer_idx];
+        for(unsigned int i = 0; i < buffer.size(); ++i)
+            elements_[line_end[priority_ == ROW_MAJOR ? buffer[i].row() : buffer[i].col()]++] = buffer[i];
+    }
+    //sort each line on the minor index and sum the duplicates, the entries are compacted in place
+    SparseMatrixInternal::MinorIndexLess<Scalar> minor_index_less(priority_);
+    unsigned int element_num = 0;
+    for(unsigned int line = 0; line < line_num; ++line)
+    {
+        unsigned int line_start = line_index_[line], line_stop = line_index_[line+1];
+        std::stable_sort(elements_.begin()+line_start,elements_.begin()+line_stop,minor_index_less);
+        line_index_[line] = element_num;
+        for(unsigned int i = line_start; i < line_stop; ++i)
+        {
+            if(element_num > line_index_[line] && !minor_index_less(elements_[element_num-1],elements_[i]))
+                elements_[element_num-1].setValue(elements_[element_num-1].value()+elements_[i].value());
+            else
+                elements_[element_num++] = elements_[i];
+        }
+    }
+    line_index_[line_num] = element_num;
+    elements_.resize(element_num);
+#elif defined(PHYSIKA_USE_EIGEN_SPARSE_MATRIX)
+    std::vector<Eigen::Triplet<Scalar> > eigen_triplets;
+    for(unsigned int buffer_idx = 0; buffer_idx < buffer_num; ++buffer_idx)
+        for(unsigned int i = 0; i < buffers[buffer_idx].size(); ++i)
+            eigen_triplets.push_back(Eigen::Triplet<Scalar>(buffers[buffer_idx][i].row(),buffers[buffer_idx][i].col(),buffers[buffer_idx][i].value()));
+    (*ptr_eigen_sparse_matrix_).setFromTriplets(eigen_triplets.begin(),eigen_triplets.end());
+#endif
+}
+
 template <typename Scalar>
 SparseMatrix<Scalar> SparseMatrix<Scalar>::operator+ (const SparseMatrix<Scalar> &mat2) const
 {
@@ -503,68 +604,108 @@ SparseMatrix<Scalar> SparseMatrix<Scalar>::operator* (Scalar scale) const
 
 template <typename Scalar>
 SparseMatrix<Scalar> SparseMatrix<Scalar>::operator* (const SparseMatrix<Scalar> &mat2) const
+{
+    return multiply(mat2,1);
+}
+
+template <typename Scalar>
+SparseMatrix<Scalar> SparseMatrix<Scalar>::multiply(const SparseMatrix<Scalar> &mat2, unsigned int thread_num) const
 {
     if(this->cols() != mat2.rows())
     {
         std::cerr<<"operator * between two SparseMatrixes failed because they don't match"<<std::endl;
         std::exit(EXIT_FAILURE);
     }
-#ifdef PHYSIKA_USE_BUILT_IN_SPARSE_MATRIX 
-    if (priority_ == ROW_MAJOR && mat2.priority_ == ROW_MAJOR)
-    {
-        SparseMatrix<Scalar> result(rows_,mat2.cols_,ROW_MAJOR);
-        //Scalar *vector_row = new Scalar[mat2.cols_+1];
-        for (unsigned int i = 0; i < rows_; ++i)
+#ifdef PHYSIKA_USE_BUILT_IN_SPARSE_MATRIX
+    if(thread_num == 0)
+    {
+        std::cerr<<"Warning: cannot multiply with 0 thread, 1 thread is used instead!\n";
+        thread_num = 1;
+    }
+    //the result is in the compressed mode of the left matrix, the other matrix is converted if needed
+    if(mat2.priority_ != priority_)
+    {
+        SparseMatrix<Scalar> converted_mat2(mat2.rows_,mat2.cols_,priority_);
+        converted_mat2.setFromTriplets(mat2.elements_);
+        return multiply(converted_mat2,thread_num);
+    }
+    //Gustavson's algorithm on lines: row i of A*B is the sum of A(i,k)*row k of B for ROW_MAJOR, and
+    //column j of A*B is the sum of B(k,j)*column k of A for COL_MAJOR; in both cases the "outer" matrix
+    //provides the scales and the "inner" matrix the lines, and k is the minor index of the outer entries
+    const SparseMatrix<Scalar> &outer = priority_ == ROW_MAJOR ? *this : mat2;
+    const SparseMatrix<Scalar> &inner = priority_ == ROW_MAJOR ? mat2 : *this;
+    SparseMatrix<Scalar> result(rows_,mat2.cols_,priority_);
+    unsigned int line_num = priority_ == ROW_MAJOR ? rows_ : mat2.cols_;
+    unsigned int minor_num = priority_ == ROW_MAJOR ? mat2.cols_ : rows_;
+    SparseMatrixInternal::SpGEMMWorkspace<Scalar> *workspaces = new SparseMatrixInternal::SpGEMMWorkspace<Scalar>[thread_num];
+    for(unsigned int i = 0; i < thread_num; ++i)
+        workspaces[i].resize(minor_num);
+    //symbolic pass: number of entries in each line of the result
+    std::vector<unsigned int> &line_index = result.line_index_;
+    line_index.assign(line_num+1,0);
+    int line_num_int = static_cast<int>(line_num);
+#pragma omp parallel for schedule(dynamic,64) num_threads(thread_num)
+    for(int line = 0; line < line_num_int; ++line)
+    {
+        SparseMatrixInternal::SpGEMMWorkspace<Scalar> &workspace = workspaces[threadIndex()];
+        unsigned int entry_num = 0;
+        for(unsigned int i = outer.line_index_[line]; i < outer.line_index_[line+1]; ++i)
         {
-            unsigned begin_left = line_index_[i], end_left = line_index_[i+1];        //postfix "left" means the multiplicand
-            for (unsigned int j = begin_left; j < end_left; ++j)
+            unsigned int k = SparseMatrixInternal::minorIndex(outer.elements_[i],priority_);
+            for(unsigned int j = inner.line_index_[k]; j < inner.line_index_[k+1]; ++j)
             {
-                unsigned int y_left = elements_[j].col();
-                Scalar v_left = elements_[j].value();
-                unsigned int begin_right = mat2.line_index_[y_left], end_right = mat2.line_index_[y_left + 1];
-                for (unsigned k = begin_right; k < end_right; ++k)
+                unsigned int minor = SparseMatrixInternal::minorIndex(inner.elements_[j],priority_);
+                if(workspace.marker_[minor] != static_cast<unsigned int>(line))
                 {
-                    unsigned int result_y = mat2.elements_[k].col();                     //mat2(y_left, result_y) = v_right
-                    Scalar v_right = mat2.elements_[k].value();                              //assume the average number of nonzeros in a row is SR
-                    result.setEntry(i, result_y, result(i, result_y) + v_left*v_right);           //time complexity O(SR*SR*rows) = O(matrix_left_nonzeros * SR)
+                    workspace.marker_[minor] = static_cast<unsigned int>(line);
+                    ++entry_num;
                 }
-            }		
+            }
         }
-        return result;
-    }
-    else if (priority_ == ROW_MAJOR && mat2.priority_ == COL_MAJOR)
-    {
-        SparseMatrix<Scalar> mat_temp = mat2;
-        return (*this)*mat_temp;
-    }
-    else if (priority_ == COL_MAJOR && mat2.priority_ == COL_MAJOR)
-    {
-        SparseMatrix<Scalar> result(rows_, mat2.cols_ ,COL_MAJOR);
-        for (unsigned int i = 0; i < mat2.cols_; ++i)
+        line_index[line+1] = entry_num;
+    }
+    for(unsigned int line = 0; line < line_num; ++line)
+        line_index[line+1] += line_index[line];
+    //numeric pass: accumulate each line in a dense accumulator, and write the entries in ascending minor index
+    result.elements_.resize(line_index[line_num]);
+    for(unsigned int i = 0; i < thread_num; ++i)
+        workspaces[i].resize(minor_num);
+#pragma omp parallel for schedule(dynamic,64) num_threads(thread_num)
+    for(int line = 0; line < line_num_int; ++line)
+    {
+        SparseMatrixInternal::SpGEMMWorkspace<Scalar> &workspace = workspaces[threadIndex()];
+        std::vector<unsigned int> &line_minors = workspace.line_minors_;
+        line_minors.clear();
+        for(unsigned int i = outer.line_index_[line]; i < outer.line_index_[line+1]; ++i)
         {
-            unsigned int begin_right = mat2.line_index_[i], end_right = mat2.line_index_[i + 1];
-            for (unsigned int j = begin_right; j < end_right; ++j)
+            unsigned int k = SparseMatrixInternal::minorIndex(outer.elements_[i],priority_);
+            Scalar outer_value = outer.elements_[i].value();
+            for(unsigned int j = inner.line_index_[k]; j < inner.line_index_[k+1]; ++j)
             {
-                unsigned x_right = mat2.elements_[j].row();
-                Scalar v_right = mat2.elements_[j].value();
-                unsigned int begin_left = line_index_[x_right], end_left = line_index_[x_right + 1];
-                for (unsigned int k = begin_left; k < end_left; ++k)
+                unsigned int minor = SparseMatrixInternal::minorIndex(inner.elements_[j],priority_);
+                if(workspace.marker_[minor] != static_cast<unsigned int>(line))
                 {
-                    unsigned int result_x = elements_[k].row();
-                    Scalar v_left = elements_[k].value();
-                    result.setEntry(result_x, i, result(result_x, i) + v_left*v_right);
+                    workspace.marker_[minor] = static_cast<unsigned int>(line);
+                    workspace.accumulator_[minor] = outer_value*inner.elements_[j].value();
+                    line_minors.push_back(minor);
                 }
+                else
+                    workspace.accumulator_[minor] += outer_value*inner.elements_[j].value();
             }
         }
-        return result;
-    }
-    else if (priority_ == COL_MAJOR && mat2.priority_ == ROW_MAJOR)
-    {
-        SparseMatrix<Scalar> mat_temp(0,0,COL_MAJOR);
-        return (*this)*mat_temp;
+        std::sort(line_minors.begin(),line_minors.end());
+        Trituple<Scalar> *line_elements = result.elements_.empty() ? NULL : &result.elements_[line_index[line]];
+        for(unsigned int i = 0; i < line_minors.size(); ++i)
+        {
+            unsigned int minor = line_minors[i];
+            if(priority_ == ROW_MAJOR)
+                line_elements[i] = Trituple<Scalar>(line,minor,workspace.accumulator_[minor]);
+            else
+                line_elements[i] = Trituple<Scalar>(minor,line,workspace.accumulator_[minor]);
+        }
     }
-    SparseMatrix<Scalar> default_return(0,0,ROW_MAJOR);
-    return default_return;
+    delete[] workspaces;
+    return result;
 #elif defined(PHYSIKA_USE_EIGEN_SPARSE_MATRIX)
     SparseMatrix<Scalar> result(this->rows(),mat2.cols());
     (*result.ptr_eigen_sparse_matrix_) = (*ptr_eigen_sparse_matrix_) * (*(mat2.ptr_eigen_sparse_matrix_));
@@ -30,6 +30,8 @@ namespace Physika{
  */
 
 template <typename Scalar> class SparseMatrixIterator;
+template <typename Scalar> class SparseMatrixBuilder;
+template <typename Scalar> class CSRMatrix;
 template <typename Scalar>
 class Trituple
 {
@@ -95,8 +97,8 @@ public:
 	SparseMatrix(unsigned int rows, unsigned int cols, matrix_compressed_mode priority = ROW_MAJOR);
     SparseMatrix(const SparseMatrix<Scalar> &);
     ~SparseMatrix();
-    inline unsigned int rows() const;
-    inline unsigned int cols() const;
+    unsigned int rows() const;
+    unsigned int cols() const;
     //return the number of nonZero node
     unsigned int nonZeros() const;                //itinerate the whole vector once to calculate the nonzeros
     // remove a node(i,j) and adjust the orthogonal list
@@ -109,7 +111,10 @@ public:
     //return value of matrix entry at index (i,j). Note: cannot be used as l-value!
     inline Scalar operator() (unsigned int i, unsigned int j) const;
     //insert matrix entry at index (i,j), if it already exits, replace it
+    //each insertion shifts the later entries, use setFromTriplets() or SparseMatrixBuilder to assemble many entries
     void setEntry(unsigned int i, unsigned int j, Scalar value);
+    //replace all entries with the triplets, entries with the same index are summed, the size of matrix is kept
+    void setFromTriplets(const std::vector<Trituple<Scalar> > &triplets);
     SparseMatrix<Scalar> operator+ (const SparseMatrix<Scalar> &) const;
     SparseMatrix<Scalar>& operator+= (const SparseMatrix<Scalar> &);
     SparseMatrix<Scalar> operator- (const SparseMatrix<Scalar> &) const;
@@ -118,14 +123,21 @@ public:
     bool operator== (const SparseMatrix<Scalar> &) const;
     bool operator!= (const SparseMatrix<Scalar> &) const;
     SparseMatrix<Scalar> operator* (Scalar) const;
-    SparseMatrix<Scalar> operator* (const SparseMatrix<Scalar> &) const;
-    VectorND<Scalar> operator* (const VectorND<Scalar> &) const;
+    SparseMatrix<Scalar> operator* (const SparseMatrix<Scalar> &) const;  //equivalent to multiply(mat2,1)
+    //product with Gustavson's algorithm: a symbolic pass counts the entries of each line of the result and a numeric pass
+    //accumulates each line in a dense accumulator, the lines are distributed among thread_num threads
+    //the result is in the compressed mode of this matrix, and doesn't depend on the thread number, thread_num 0 is treated as 1
+    SparseMatrix<Scalar> multiply(const SparseMatrix<Scalar> &mat2, unsigned int thread_num) const;
+    VectorND<Scalar> operator* (const VectorND<Scalar> &) const;  //use CSRMatrix for repeated products with the same matrix
     SparseMatrix<Scalar>& operator*= (Scalar);
     SparseMatrix<Scalar> operator/ (Scalar) const;
     SparseMatrix<Scalar>& operator/= (Scalar);
     VectorND<Scalar> leftMultiVec(const VectorND<Scalar> &) const;
 protected:
     void allocMemory(unsigned int rows, unsigned int cols, matrix_compressed_mode priority);
+    //replace all entries with the triplets in buffer_num buffers, a counting sort on the major index and a sort of
+    //each line on the minor index, duplicates are summed in the order of buffers
+    void setFromTripletBuffers(const std::vector<Trituple<Scalar> > *buffers, unsigned int buffer_num);
 protected:
 #ifdef PHYSIKA_USE_BUILT_IN_SPARSE_MATRIX
     //row-wise format or col-wise format
@@ -137,11 +149,15 @@ protected:
 	matrix_compressed_mode priority_;        //when priority is equal to 0, it means the elements_ is stored in a row-wise order.
                                              //if priority is equal to 1, the elements_ is stored in a col-wise order.
     friend class SparseMatrixIterator<Scalar>;  // declare friend class for iterator
+    friend class SparseMatrixBuilder<Scalar>;
+    friend class CSRMatrix<Scalar>;
 #elif defined(PHYSIKA_USE_EIGEN_SPARSE_MATRIX)
 	matrix_compressed_mode priority_;
     Eigen::SparseMatrix<Scalar> * ptr_eigen_sparse_matrix_ ;
     //typename typedef Eigen::SparseMatrix<Scalar>::InnerIterator SpareseIterator;
     friend class Physika::SparseMatrixIterator<Scalar>;
+    friend class Physika::SparseMatrixBuilder<Scalar>;
+    friend class Physika::CSRMatrix<Scalar>;
 #endif
 private:
     void compileTimeCheck()
@@ -0,0 +1,117 @@
+/*
+ * @file sparse_matrix_builder.cpp
+ * @brief Assemble sparse matrix from (row, col, value) triplets in bulk.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <iostream>
+#include "Physika_Core/Matrices/sparse_matrix_builder.h"
+
+namespace Physika{
+
+template <typename Scalar>
+SparseMatrixBuilder<Scalar>::SparseMatrixBuilder(unsigned int rows, unsigned int cols, unsigned int thread_num)
+    :rows_(rows),cols_(cols)
+{
+    setThreadNum(thread_num);
+}
+
+template <typename Scalar>
+SparseMatrixBuilder<Scalar>::~SparseMatrixBuilder()
+{
+}
+
+template <typename Scalar>
+unsigned int SparseMatrixBuilder<Scalar>::rows() const
+{
+    return rows_;
+}
+
+template <typename Scalar>
+unsigned int SparseMatrixBuilder<Scalar>::cols() const
+{
+    return cols_;
+}
+
+template <typename Scalar>
+unsigned int SparseMatrixBuilder<Scalar>::threadNum() const
+{
+    return static_cast<unsigned int>(thread_triplets_.size());
+}
+
+template <typename Scalar>
+void SparseMatrixBuilder<Scalar>::resize(unsigned int rows, unsigned int cols)
+{
+    rows_ = rows;
+    cols_ = cols;
+    clear();
+}
+
+template <typename Scalar>
+void SparseMatrixBuilder<Scalar>::setThreadNum(unsigned int thread_num)
+{
+    if(thread_num == 0)
+    {
+        std::cerr<<"Warning: cannot set thread number to 0, 1 thread is used instead!\n";
+        thread_num = 1;
+    }
+    thread_triplets_.clear();
+    thread_triplets_.resize(thread_num);
+}
+
+template <typename Scalar>
+void SparseMatrixBuilder<Scalar>::reserve(unsigned int triplet_num)
+{
+    unsigned int thread_num = threadNum();
+    for(unsigned int i = 0; i < thread_num; ++i)
+        thread_triplets_[i].reserve((triplet_num + thread_num - 1)/thread_num);
+}
+
+template <typename Scalar>
+void SparseMatrixBuilder<Scalar>::clear()
+{
+    for(unsigned int i = 0; i < thread_triplets_.size(); ++i)
+        thread_triplets_[i].clear();
+}
+
+template <typename Scalar>
+unsigned int SparseMatrixBuilder<Scalar>::tripletNum() const
+{
+    unsigned int triplet_num = 0;
+    for(unsigned int i = 0; i < thread_triplets_.size(); ++i)
+        triplet_num += thread_triplets_[i].size();
+    return triplet_num;
+}
+
+template <typename Scalar>
+void SparseMatrixBuilder<Scalar>::build(SparseMatrix<Scalar> &matrix) const
+{
+    if(matrix.rows() != rows_ || matrix.cols() != cols_)
+        matrix.resize(rows_,cols_);
+    matrix.setFromTripletBuffers(&thread_triplets_[0],threadNum());
+}
+
+//explicit instantiations
+template class SparseMatrixBuilder<unsigned char>;
+template class SparseMatrixBuilder<unsigned short>;
+template class SparseMatrixBuilder<unsigned int>;
+template class SparseMatrixBuilder<unsigned long>;
+template class SparseMatrixBuilder<unsigned long long>;
+template class SparseMatrixBuilder<signed char>;
+template class SparseMatrixBuilder<short>;
+template class SparseMatrixBuilder<int>;
+template class SparseMatrixBuilder<long>;
+template class SparseMatrixBuilder<long long>;
+template class SparseMatrixBuilder<float>;
+template class SparseMatrixBuilder<double>;
+template class SparseMatrixBuilder<long double>;
+
+}  //end of namespace Physika
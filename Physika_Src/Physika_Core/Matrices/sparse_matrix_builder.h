@@ -0,0 +1,76 @@
+/*
+ * @file sparse_matrix_builder.h
+ * @brief Assemble sparse matrix from (row, col, value) triplets in bulk.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_MATRICES_SPARSE_MATRIX_BUILDER_H_
+#define PHYSIKA_CORE_MATRICES_SPARSE_MATRIX_BUILDER_H_
+
+#include <vector>
+#include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Core/Utilities/parallel_utilities.h"
+#include "Physika_Core/Matrices/sparse_matrix.h"
+
+namespace Physika{
+
+/*
+ * SparseMatrixBuilder: collect the entries of a sparse matrix as triplets and build the matrix at once,
+ * e.g., the stiffness matrix of FEM where the entries of each element are added to the matrix.
+ *
+ * The triplets are collected in one buffer for each thread, addEntry() can be called in parallel regions
+ * with at most thread_num threads without locking. Entries added to the same index are summed.
+ * build() puts the triplets into the compressed layout of SparseMatrix with a counting sort on the major
+ * index and a sort of each line on the minor index. Hence building a matrix with nnz entries costs
+ * O(nnz*log(line length)), while inserting them one by one with SparseMatrix::setEntry() costs O(nnz^2).
+ * The summation order of duplicates is the order of thread buffers and then the order of addition,
+ * the result is deterministic if each thread adds a fixed set of entries.
+ *
+ * Usage:
+ *     SparseMatrixBuilder<double> builder(rows,cols,thread_num);
+ *     #pragma omp parallel for num_threads(thread_num)
+ *     for(int ele_idx = 0; ele_idx < ele_num; ++ele_idx)
+ *         builder.addEntry(i,j,value); //for entries of the element
+ *     builder.build(matrix);
+ */
+
+template <typename Scalar>
+class SparseMatrixBuilder
+{
+public:
+    explicit SparseMatrixBuilder(unsigned int rows = 0, unsigned int cols = 0, unsigned int thread_num = maxThreadNum());
+    ~SparseMatrixBuilder();
+    unsigned int rows() const;
+    unsigned int cols() const;
+    unsigned int threadNum() const;
+    void resize(unsigned int rows, unsigned int cols); //the triplets are cleared
+    void setThreadNum(unsigned int thread_num); //the triplets are cleared
+    void reserve(unsigned int triplet_num); //reserve memory for triplet_num triplets in total, evenly for the threads
+    void clear(); //clear the triplets, the memory is kept for reuse
+    unsigned int tripletNum() const;
+    //add value to entry (i,j), thread-safe for different threads
+    inline void addEntry(unsigned int i, unsigned int j, Scalar value)
+    {
+        PHYSIKA_ASSERT(i < rows_ && j < cols_);
+        PHYSIKA_ASSERT(threadIndex() < thread_triplets_.size());
+        thread_triplets_[threadIndex()].push_back(Trituple<Scalar>(i,j,value));
+    }
+    //replace the entries of matrix with the triplets, the matrix is resized to rows x cols and its compressed mode is kept
+    void build(SparseMatrix<Scalar> &matrix) const;
+protected:
+    unsigned int rows_;
+    unsigned int cols_;
+    std::vector<std::vector<Trituple<Scalar> > > thread_triplets_;
+};
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_MATRICES_SPARSE_MATRIX_BUILDER_H_
@@ -0,0 +1,157 @@
+/*
+ * @file binary_io.h
+ * @brief Read and write plain data as raw bytes in binary streams, e.g., for snapshots of simulation data.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_UTILITIES_FILE_UTILITIES_BINARY_IO_H_
+#define PHYSIKA_CORE_UTILITIES_FILE_UTILITIES_BINARY_IO_H_
+
+#include <vector>
+#include <iostream>
+#include "Physika_Core/Vectors/vector.h"
+#include "Physika_Core/Matrices/square_matrix.h"
+
+namespace Physika{
+
+namespace FileUtilities{
+
+/*
+ * The values are copied byte by byte between memory and stream without conversion,
+ * hence the element type must be plain data without virtual methods, e.g., scalars and enums.
+ * Vector<Scalar,Dim> and SquareMatrix<Scalar,Dim> are polymorphic, only their entries are copied.
+ * The data are only portable between builds with the same types and byte order.
+ * The read methods return false if the stream fails, e.g., the end of file is reached.
+ */
+
+//write/read count consecutive values
+template <typename ElementType>
+inline void writeBinary(std::ostream &output, const ElementType *values, unsigned int count)
+{
+    if(count > 0)
+        output.write(reinterpret_cast<const char*>(values),static_cast<std::streamsize>(sizeof(ElementType))*count);
+}
+
+template <typename ElementType>
+inline bool readBinary(std::istream &input, ElementType *values, unsigned int count)
+{
+    if(count > 0)
+        input.read(reinterpret_cast<char*>(values),static_cast<std::streamsize>(sizeof(ElementType))*count);
+    return static_cast<bool>(input);
+}
+
+//write/read count consecutive vectors/matrices, the entries are packed in chunks to save stream calls
+const unsigned int binary_io_chunk_size = 4096;
+
+template <typename Scalar, int Dim>
+inline void writeBinary(std::ostream &output, const Vector<Scalar,Dim> *values, unsigned int count)
+{
+    std::vector<Scalar> buffer;
+    buffer.reserve(binary_io_chunk_size*Dim);
+    for(unsigned int start = 0; start < count; start += binary_io_chunk_size)
+    {
+        unsigned int end = start + binary_io_chunk_size < count ? start + binary_io_chunk_size : count;
+        buffer.clear();
+        for(unsigned int i = start; i < end; ++i)
+            for(unsigned int j = 0; j < Dim; ++j)
+                buffer.push_back(values[i][j]);
+        writeBinary(output,&buffer[0],static_cast<unsigned int>(buffer.size()));
+    }
+}
+
+template <typename Scalar, int Dim>
+inline bool readBinary(std::istream &input, Vector<Scalar,Dim> *values, unsigned int count)
+{
+    std::vector<Scalar> buffer(binary_io_chunk_size*Dim);
+    for(unsigned int start = 0; start < count; start += binary_io_chunk_size)
+    {
+        unsigned int end = start + binary_io_chunk_size < count ? start + binary_io_chunk_size : count;
+        if(!readBinary(input,&buffer[0],(end-start)*Dim))
+            return false;
+        for(unsigned int i = start; i < end; ++i)
+            for(unsigned int j = 0; j < Dim; ++j)
+                values[i][j] = buffer[(i-start)*Dim+j];
+    }
+    return static_cast<bool>(input);
+}
+
+template <typename Scalar, int Dim>
+inline void writeBinary(std::ostream &output, const SquareMatrix<Scalar,Dim> *values, unsigned int count)
+{
+    std::vector<Scalar> buffer;
+    buffer.reserve(binary_io_chunk_size*Dim*Dim);
+    for(unsigned int start = 0; start < count; start += binary_io_chunk_size)
+    {
+        unsigned int end = start + binary_io_chunk_size < count ? start + binary_io_chunk_size : count;
+        buffer.clear();
+        for(unsigned int i = start; i < end; ++i)
+            for(unsigned int row = 0; row < Dim; ++row)
+                for(unsigned int col = 0; col < Dim; ++col)
+                    buffer.push_back(values[i](row,col));
+        writeBinary(output,&buffer[0],static_cast<unsigned int>(buffer.size()));
+    }
+}
+
+template <typename Scalar, int Dim>
+inline bool readBinary(std::istream &input, SquareMatrix<Scalar,Dim> *values, unsigned int count)
+{
+    std::vector<Scalar> buffer(binary_io_chunk_size*Dim*Dim);
+    for(unsigned int start = 0; start < count; start += binary_io_chunk_size)
+    {
+        unsigned int end = start + binary_io_chunk_size < count ? start + binary_io_chunk_size : count;
+        if(!readBinary(input,&buffer[0],(end-start)*Dim*Dim))
+            return false;
+        for(unsigned int i = start; i < end; ++i)
+            for(unsigned int row = 0; row < Dim; ++row)
+                for(unsigned int col = 0; col < Dim; ++col)
+                    values[i](row,col) = buffer[((i-start)*Dim+row)*Dim+col];
+    }
+    return static_cast<bool>(input);
+}
+
+//write/read single value
+template <typename ElementType>
+inline void writeBinary(std::ostream &output, const ElementType &value)
+{
+    writeBinary(output,&value,1);
+}
+
+template <typename ElementType>
+inline bool readBinary(std::istream &input, ElementType &value)
+{
+    return readBinary(input,&value,1);
+}
+
+//write/read vector: the element count followed by the elements, the vector is resized on read
+template <typename ElementType>
+inline void writeBinary(std::ostream &output, const std::vector<ElementType> &values)
+{
+    unsigned int count = static_cast<unsigned int>(values.size());
+    writeBinary(output,count);
+    if(count > 0)
+        writeBinary(output,&values[0],count);
+}
+
+template <typename ElementType>
+inline bool readBinary(std::istream &input, std::vector<ElementType> &values)
+{
+    unsigned int count = 0;
+    if(!readBinary(input,count))
+        return false;
+    values.resize(count);
+    return count > 0 ? readBinary(input,&values[0],count) : true;
+}
+
+} //end of namespace FileUtilities
+
+} //end of namespace Physika
+
+#endif //PHYSIKA_CORE_UTILITIES_FILE_UTILITIES_BINARY_IO_H_
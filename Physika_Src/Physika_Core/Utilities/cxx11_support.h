@@ -36,6 +36,12 @@
 #        define SUPPORT_STATIC_ASSERT
 #    endif
 
+//std::thread, std::mutex and std::condition_variable since g++ 4.4, only in c++0x mode
+#    if (__GNUC__>4 || (__GNUC__==4 && __GNUC_MINOR__>=4)) \
+     && (defined(__GXX_EXPERIMENTAL_CXX0X__) || __cplusplus>=201103L)
+#        define SUPPORT_STD_THREAD
+#    endif
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 #elif defined(_MSC_VER)
@@ -46,6 +52,11 @@
 #        define SUPPORT_STATIC_ASSERT
 #    endif
 
+//std::thread, std::mutex and std::condition_variable since msvc 11.0
+#    if _MSC_VER >= 1700
+#        define SUPPORT_STD_THREAD
+#    endif
+
 #endif 
 
 #endif //PHYSIKA_CORE_UTILITIES_CXX11_SUPPORT_H_
@@ -0,0 +1,52 @@
+/*
+ * @file parallel_utilities.h
+ * @brief utilities for multi-threading in Physika.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_CORE_UTILITIES_PARALLEL_UTILITIES_H_
+#define PHYSIKA_CORE_UTILITIES_PARALLEL_UTILITIES_H_
+
+/*
+ * Physika uses OpenMP for multi-threading: loops are parallelized with "#pragma omp" directives,
+ * and the threads are kept in the thread pool of OpenMP runtime across parallel regions.
+ * If the code is compiled without OpenMP support, the directives are ignored and everything runs serially.
+ */
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace Physika{
+
+//number of threads available on this machine, 1 if compiled without OpenMP
+inline unsigned int maxThreadNum()
+{
+#ifdef _OPENMP
+    return static_cast<unsigned int>(omp_get_num_procs());
+#else
+    return 1;
+#endif
+}
+
+//index of the calling thread in current parallel region, 0 if called outside parallel regions
+inline unsigned int threadIndex()
+{
+#ifdef _OPENMP
+    return static_cast<unsigned int>(omp_get_thread_num());
+#else
+    return 0;
+#endif
+}
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_CORE_UTILITIES_PARALLEL_UTILITIES_H_
@@ -20,6 +20,111 @@
 
 namespace Physika{
 
+//internal namespace, helpers of the batch methods of constitutive models
+namespace ConstitutiveModelInternal{
+
+//number of deformation gradients evaluated together in the batch methods, each step of the evaluation
+//is a loop over the lanes of a block (structure of arrays) that is vectorized by the compiler
+const unsigned int batch_lane_num = 8;
+
+//load a block of lane_num deformation gradients, the block is padded with identity matrices
+template <typename Scalar, int Dim>
+inline void loadMatrixBlock(const SquareMatrix<Scalar,Dim> *matrices, unsigned int lane_num, Scalar (&block)[Dim][Dim][batch_lane_num])
+{
+    for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                block[row][col][lane] = lane < lane_num ? matrices[lane](row,col) : (row == col ? 1 : 0);
+}
+
+//store the first lane_num matrices of a block, each scaled by the corresponding volume if volumes is not NULL
+template <typename Scalar, int Dim>
+inline void storeMatrixBlock(const Scalar (&block)[Dim][Dim][batch_lane_num], const Scalar *volumes, unsigned int lane_num, SquareMatrix<Scalar,Dim> *matrices)
+{
+    for(unsigned int lane = 0; lane < lane_num; ++lane)
+    {
+        Scalar scale = volumes ? volumes[lane] : 1;
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                matrices[lane](row,col) = scale*block[row][col][lane];
+    }
+}
+
+//cofactor matrices and determinants of a block, the inverse transpose of F is cofactor(F)/det(F)
+template <typename Scalar>
+inline void cofactorOfBlock(const Scalar (&F)[2][2][batch_lane_num], Scalar (&cofactor)[2][2][batch_lane_num], Scalar (&det)[batch_lane_num])
+{
+    for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+    {
+        cofactor[0][0][lane] = F[1][1][lane];
+        cofactor[0][1][lane] = -F[1][0][lane];
+        cofactor[1][0][lane] = -F[0][1][lane];
+        cofactor[1][1][lane] = F[0][0][lane];
+        det[lane] = F[0][0][lane]*F[1][1][lane] - F[0][1][lane]*F[1][0][lane];
+    }
+}
+
+template <typename Scalar>
+inline void cofactorOfBlock(const Scalar (&F)[3][3][batch_lane_num], Scalar (&cofactor)[3][3][batch_lane_num], Scalar (&det)[batch_lane_num])
+{
+    for(unsigned int row = 0; row < 3; ++row)
+        for(unsigned int col = 0; col < 3; ++col)
+        {
+            unsigned int row_1 = (row+1)%3, row_2 = (row+2)%3, col_1 = (col+1)%3, col_2 = (col+2)%3;
+            for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                cofactor[row][col][lane] = F[row_1][col_1][lane]*F[row_2][col_2][lane] - F[row_1][col_2][lane]*F[row_2][col_1][lane];
+        }
+    for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+        det[lane] = F[0][0][lane]*cofactor[0][0][lane] + F[0][1][lane]*cofactor[0][1][lane] + F[0][2][lane]*cofactor[0][2][lane];
+}
+
+//C = A*B^T for blocks of matrices
+template <typename Scalar, int Dim>
+inline void multiplyTransposeOfBlock(const Scalar (&A)[Dim][Dim][batch_lane_num], const Scalar (&B)[Dim][Dim][batch_lane_num], Scalar (&C)[Dim][Dim][batch_lane_num])
+{
+    for(unsigned int row = 0; row < Dim; ++row)
+        for(unsigned int col = 0; col < Dim; ++col)
+        {
+            for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                C[row][col][lane] = 0;
+            for(unsigned int k = 0; k < Dim; ++k)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                    C[row][col][lane] += A[row][k][lane]*B[col][k][lane];
+        }
+}
+
+//C = A^T*B for blocks of matrices
+template <typename Scalar, int Dim>
+inline void transposeMultiplyOfBlock(const Scalar (&A)[Dim][Dim][batch_lane_num], const Scalar (&B)[Dim][Dim][batch_lane_num], Scalar (&C)[Dim][Dim][batch_lane_num])
+{
+    for(unsigned int row = 0; row < Dim; ++row)
+        for(unsigned int col = 0; col < Dim; ++col)
+        {
+            for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                C[row][col][lane] = 0;
+            for(unsigned int k = 0; k < Dim; ++k)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                    C[row][col][lane] += A[k][row][lane]*B[k][col][lane];
+        }
+}
+
+//C = A*B for blocks of matrices
+template <typename Scalar, int Dim>
+inline void multiplyOfBlock(const Scalar (&A)[Dim][Dim][batch_lane_num], const Scalar (&B)[Dim][Dim][batch_lane_num], Scalar (&C)[Dim][Dim][batch_lane_num])
+{
+    for(unsigned int row = 0; row < Dim; ++row)
+        for(unsigned int col = 0; col < Dim; ++col)
+        {
+            for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                C[row][col][lane] = 0;
+            for(unsigned int k = 0; k < Dim; ++k)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                    C[row][col][lane] += A[row][k][lane]*B[k][col][lane];
+        }
+}
+
+}  //end of namespace ConstitutiveModelInternal
+
 template <typename Scalar, int Dim>
 class ConstitutiveModel
 {
@@ -32,6 +137,26 @@ public:
     virtual SquareMatrix<Scalar,Dim> firstPiolaKirchhoffStress(const SquareMatrix<Scalar,Dim> &F) const=0;
     virtual SquareMatrix<Scalar,Dim> secondPiolaKirchhoffStress(const SquareMatrix<Scalar,Dim> &F) const=0;
     virtual SquareMatrix<Scalar,Dim> cauchyStress(const SquareMatrix<Scalar,Dim> &F) const=0;
+    //differential of first Piola-Kirchhoff stress at F in direction dF, i.e., dP = (dP/dF):dF, needed by implicit integration
+    virtual SquareMatrix<Scalar,Dim> firstPiolaKirchhoffStressDifferential(const SquareMatrix<Scalar,Dim> &F, const SquareMatrix<Scalar,Dim> &dF) const=0;
+    //batch versions: evaluate for count deformation gradients in contiguous array with one call
+    //the stress of the i-th deformation gradient is scaled by volumes[i] if volumes is not NULL, e.g., the stress term of the particles in MPM
+    //the default implementations call the methods above, subclasses override them with vectorized implementations
+    virtual void batchEnergy(const SquareMatrix<Scalar,Dim> *F, unsigned int count, Scalar *energy) const
+    {
+        for(unsigned int i = 0; i < count; ++i)
+            energy[i] = this->energy(F[i]);
+    }
+    virtual void batchFirstPiolaKirchhoffStress(const SquareMatrix<Scalar,Dim> *F, const Scalar *volumes, unsigned int count, SquareMatrix<Scalar,Dim> *stress) const
+    {
+        for(unsigned int i = 0; i < count; ++i)
+            stress[i] = volumes ? volumes[i]*firstPiolaKirchhoffStress(F[i]) : firstPiolaKirchhoffStress(F[i]);
+    }
+    virtual void batchCauchyStress(const SquareMatrix<Scalar,Dim> *F, const Scalar *volumes, unsigned int count, SquareMatrix<Scalar,Dim> *stress) const
+    {
+        for(unsigned int i = 0; i < count; ++i)
+            stress[i] = volumes ? volumes[i]*cauchyStress(F[i]) : cauchyStress(F[i]);
+    }
 protected:
 };
 
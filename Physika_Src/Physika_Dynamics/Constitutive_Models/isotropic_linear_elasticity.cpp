@@ -102,6 +102,75 @@ SquareMatrix<Scalar,Dim> IsotropicLinearElasticity<Scalar,Dim>::cauchyStress(con
     return stress;
 }
 
+template <typename Scalar, int Dim>
+SquareMatrix<Scalar,Dim> IsotropicLinearElasticity<Scalar,Dim>::firstPiolaKirchhoffStressDifferential(const SquareMatrix<Scalar,Dim> &F, const SquareMatrix<Scalar,Dim> &dF) const
+{
+    //the stress is linear in F
+    SquareMatrix<Scalar,Dim> identity = SquareMatrix<Scalar,Dim>::identityMatrix();
+    SquareMatrix<Scalar,Dim> de = 0.5*(dF.transpose()+dF);
+    Scalar lambda = this->lambda_;
+    Scalar mu = this->mu_;
+    SquareMatrix<Scalar,Dim> dP = lambda*de.trace()*identity+2*mu*de;
+    return dP;
+}
+
+template <typename Scalar, int Dim>
+void IsotropicLinearElasticity<Scalar,Dim>::batchEnergy(const SquareMatrix<Scalar,Dim> *F, unsigned int count, Scalar *energy) const
+{
+    using namespace ConstitutiveModelInternal;
+    Scalar f[Dim][Dim][batch_lane_num], trace_e[batch_lane_num], e_contraction[batch_lane_num];
+    Scalar lambda = this->lambda_;
+    Scalar mu = this->mu_;
+    for(unsigned int start = 0; start < count; start += batch_lane_num)
+    {
+        unsigned int lane_num = count - start < batch_lane_num ? count - start : batch_lane_num;
+        loadMatrixBlock(F+start,lane_num,f);
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            trace_e[lane] = e_contraction[lane] = 0;
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                {
+                    Scalar e = static_cast<Scalar>(0.5)*(f[row][col][lane]+f[col][row][lane])-(row == col ? 1 : 0);
+                    trace_e[lane] += row == col ? e : 0;
+                    e_contraction[lane] += e*e;
+                }
+        for(unsigned int lane = 0; lane < lane_num; ++lane)
+            energy[start+lane] = static_cast<Scalar>(0.5)*lambda*trace_e[lane]*trace_e[lane]+mu*e_contraction[lane];
+    }
+}
+
+template <typename Scalar, int Dim>
+void IsotropicLinearElasticity<Scalar,Dim>::batchFirstPiolaKirchhoffStress(const SquareMatrix<Scalar,Dim> *F, const Scalar *volumes, unsigned int count, SquareMatrix<Scalar,Dim> *stress) const
+{
+    //for linear elastic materials all stress measures are identical because F ~= I
+    batchCauchyStress(F,volumes,count,stress);
+}
+
+template <typename Scalar, int Dim>
+void IsotropicLinearElasticity<Scalar,Dim>::batchCauchyStress(const SquareMatrix<Scalar,Dim> *F, const Scalar *volumes, unsigned int count, SquareMatrix<Scalar,Dim> *stress) const
+{
+    using namespace ConstitutiveModelInternal;
+    Scalar f[Dim][Dim][batch_lane_num], sigma[Dim][Dim][batch_lane_num], trace_e[batch_lane_num];
+    Scalar lambda = this->lambda_;
+    Scalar mu = this->mu_;
+    for(unsigned int start = 0; start < count; start += batch_lane_num)
+    {
+        unsigned int lane_num = count - start < batch_lane_num ? count - start : batch_lane_num;
+        loadMatrixBlock(F+start,lane_num,f);
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            trace_e[lane] = 0;
+        for(unsigned int i = 0; i < Dim; ++i)
+            for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                trace_e[lane] += f[i][i][lane]-1;
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                    sigma[row][col][lane] = mu*(f[row][col][lane]+f[col][row][lane]-(row == col ? 2 : 0))+(row == col ? lambda*trace_e[lane] : 0);
+        storeMatrixBlock(sigma,volumes?volumes+start:NULL,lane_num,stress+start);
+    }
+}
+
 //explicit instantiation of template so that it could be compiled into a lib
 template class IsotropicLinearElasticity<float,2>;
 template class IsotropicLinearElasticity<double,2>;
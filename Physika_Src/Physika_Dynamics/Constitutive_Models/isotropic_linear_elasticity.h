@@ -39,6 +39,11 @@ public:
     SquareMatrix<Scalar,Dim> firstPiolaKirchhoffStress(const SquareMatrix<Scalar,Dim> &F) const;
     SquareMatrix<Scalar,Dim> secondPiolaKirchhoffStress(const SquareMatrix<Scalar,Dim> &F) const;
     SquareMatrix<Scalar,Dim> cauchyStress(const SquareMatrix<Scalar,Dim> &F) const;
+    SquareMatrix<Scalar,Dim> firstPiolaKirchhoffStressDifferential(const SquareMatrix<Scalar,Dim> &F, const SquareMatrix<Scalar,Dim> &dF) const;
+    //vectorized batch versions
+    void batchEnergy(const SquareMatrix<Scalar,Dim> *F, unsigned int count, Scalar *energy) const;
+    void batchFirstPiolaKirchhoffStress(const SquareMatrix<Scalar,Dim> *F, const Scalar *volumes, unsigned int count, SquareMatrix<Scalar,Dim> *stress) const;
+    void batchCauchyStress(const SquareMatrix<Scalar,Dim> *F, const Scalar *volumes, unsigned int count, SquareMatrix<Scalar,Dim> *stress) const;
 
 protected:
 };
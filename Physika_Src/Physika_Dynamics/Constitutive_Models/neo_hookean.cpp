@@ -104,6 +104,94 @@ SquareMatrix<Scalar,Dim> NeoHookean<Scalar,Dim>::cauchyStress(const SquareMatrix
     return stress;
 }
 
+template <typename Scalar, int Dim>
+SquareMatrix<Scalar,Dim> NeoHookean<Scalar,Dim>::firstPiolaKirchhoffStressDifferential(const SquareMatrix<Scalar,Dim> &F, const SquareMatrix<Scalar,Dim> &dF) const
+{
+    //P = mu*(F-F^-T)+lambda*lnJ*F^-T
+    SquareMatrix<Scalar,Dim> inverse_F = F.inverse();
+    SquareMatrix<Scalar,Dim> inverse_F_trans = inverse_F.transpose();
+    Scalar lnJ = log(F.determinant());
+    Scalar mu = this->mu_;
+    Scalar lambda = this->lambda_;
+    SquareMatrix<Scalar,Dim> dP = mu*dF+(mu-lambda*lnJ)*inverse_F_trans*dF.transpose()*inverse_F_trans+lambda*(inverse_F*dF).trace()*inverse_F_trans;
+    return dP;
+}
+
+template <typename Scalar, int Dim>
+void NeoHookean<Scalar,Dim>::batchEnergy(const SquareMatrix<Scalar,Dim> *F, unsigned int count, Scalar *energy) const
+{
+    using namespace ConstitutiveModelInternal;
+    Scalar f[Dim][Dim][batch_lane_num], cofactor[Dim][Dim][batch_lane_num], J[batch_lane_num], trace_c[batch_lane_num];
+    Scalar mu = this->mu_;
+    Scalar lambda = this->lambda_;
+    for(unsigned int start = 0; start < count; start += batch_lane_num)
+    {
+        unsigned int lane_num = count - start < batch_lane_num ? count - start : batch_lane_num;
+        loadMatrixBlock(F+start,lane_num,f);
+        cofactorOfBlock(f,cofactor,J);
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            trace_c[lane] = 0;
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                    trace_c[lane] += f[row][col][lane]*f[row][col][lane];
+        for(unsigned int lane = 0; lane < lane_num; ++lane)
+        {
+            Scalar lnJ = log(J[lane]);
+            energy[start+lane] = mu/2*(trace_c[lane]-Dim)-mu*lnJ+lambda/2*lnJ*lnJ;
+        }
+    }
+}
+
+template <typename Scalar, int Dim>
+void NeoHookean<Scalar,Dim>::batchFirstPiolaKirchhoffStress(const SquareMatrix<Scalar,Dim> *F, const Scalar *volumes, unsigned int count, SquareMatrix<Scalar,Dim> *stress) const
+{
+    //P = mu*F+(lambda*lnJ-mu)*F^-T, where F^-T = cofactor(F)/J
+    using namespace ConstitutiveModelInternal;
+    Scalar f[Dim][Dim][batch_lane_num], cofactor[Dim][Dim][batch_lane_num], P[Dim][Dim][batch_lane_num], J[batch_lane_num], coef[batch_lane_num];
+    Scalar mu = this->mu_;
+    Scalar lambda = this->lambda_;
+    for(unsigned int start = 0; start < count; start += batch_lane_num)
+    {
+        unsigned int lane_num = count - start < batch_lane_num ? count - start : batch_lane_num;
+        loadMatrixBlock(F+start,lane_num,f);
+        cofactorOfBlock(f,cofactor,J);
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            coef[lane] = log(J[lane]);  //log is not vectorized, the other steps are
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            coef[lane] = (lambda*coef[lane]-mu)/J[lane];
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                    P[row][col][lane] = mu*f[row][col][lane]+coef[lane]*cofactor[row][col][lane];
+        storeMatrixBlock(P,volumes?volumes+start:NULL,lane_num,stress+start);
+    }
+}
+
+template <typename Scalar, int Dim>
+void NeoHookean<Scalar,Dim>::batchCauchyStress(const SquareMatrix<Scalar,Dim> *F, const Scalar *volumes, unsigned int count, SquareMatrix<Scalar,Dim> *stress) const
+{
+    //stress = 1/J*P*F^T = (mu*(F*F^T-I)+lambda*lnJ*I)/J
+    using namespace ConstitutiveModelInternal;
+    Scalar f[Dim][Dim][batch_lane_num], cofactor[Dim][Dim][batch_lane_num], b[Dim][Dim][batch_lane_num], J[batch_lane_num], lnJ[batch_lane_num];
+    Scalar mu = this->mu_;
+    Scalar lambda = this->lambda_;
+    for(unsigned int start = 0; start < count; start += batch_lane_num)
+    {
+        unsigned int lane_num = count - start < batch_lane_num ? count - start : batch_lane_num;
+        loadMatrixBlock(F+start,lane_num,f);
+        cofactorOfBlock(f,cofactor,J);
+        multiplyTransposeOfBlock(f,f,b);
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            lnJ[lane] = log(J[lane]);
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                    b[row][col][lane] = (mu*b[row][col][lane]+(row == col ? lambda*lnJ[lane]-mu : 0))/J[lane];
+        storeMatrixBlock(b,volumes?volumes+start:NULL,lane_num,stress+start);
+    }
+}
+
 //explicit instantiation of template so that it could be compiled into a lib
 template class NeoHookean<float,2>;
 template class NeoHookean<double,2>;
@@ -103,6 +103,104 @@ SquareMatrix<Scalar,Dim> StVK<Scalar,Dim>::cauchyStress(const SquareMatrix<Scala
     return stress;
 }
 
+template <typename Scalar, int Dim>
+SquareMatrix<Scalar,Dim> StVK<Scalar,Dim>::firstPiolaKirchhoffStressDifferential(const SquareMatrix<Scalar,Dim> &F, const SquareMatrix<Scalar,Dim> &dF) const
+{
+    //P = F*S, dP = dF*S+F*dS
+    SquareMatrix<Scalar,Dim> identity = SquareMatrix<Scalar,Dim>::identityMatrix();
+    SquareMatrix<Scalar,Dim> dE = (dF.transpose()*F+F.transpose()*dF)/2;
+    Scalar mu = this->mu_;
+    Scalar lambda = this->lambda_;
+    SquareMatrix<Scalar,Dim> dS = lambda*dE.trace()*identity+2*mu*dE;
+    SquareMatrix<Scalar,Dim> dP = dF*secondPiolaKirchhoffStress(F)+F*dS;
+    return dP;
+}
+
+template <typename Scalar, int Dim>
+void StVK<Scalar,Dim>::batchEnergy(const SquareMatrix<Scalar,Dim> *F, unsigned int count, Scalar *energy) const
+{
+    using namespace ConstitutiveModelInternal;
+    Scalar f[Dim][Dim][batch_lane_num], E[Dim][Dim][batch_lane_num], trace_E[batch_lane_num], E_contraction[batch_lane_num];
+    Scalar mu = this->mu_;
+    Scalar lambda = this->lambda_;
+    for(unsigned int start = 0; start < count; start += batch_lane_num)
+    {
+        unsigned int lane_num = count - start < batch_lane_num ? count - start : batch_lane_num;
+        loadMatrixBlock(F+start,lane_num,f);
+        transposeMultiplyOfBlock(f,f,E);
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            trace_E[lane] = E_contraction[lane] = 0;
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                {
+                    E[row][col][lane] = (E[row][col][lane]-(row == col ? 1 : 0))/2;
+                    trace_E[lane] += row == col ? E[row][col][lane] : 0;
+                    E_contraction[lane] += E[row][col][lane]*E[row][col][lane];
+                }
+        for(unsigned int lane = 0; lane < lane_num; ++lane)
+            energy[start+lane] = lambda/2*trace_E[lane]*trace_E[lane]+mu*E_contraction[lane];
+    }
+}
+
+//E = (F^T*F-I)/2, S = lambda*trace(E)*I+2*mu*E, P = F*S
+template <typename Scalar, int Dim>
+void StVK<Scalar,Dim>::batchFirstPiolaKirchhoffStress(const SquareMatrix<Scalar,Dim> *F, const Scalar *volumes, unsigned int count, SquareMatrix<Scalar,Dim> *stress) const
+{
+    using namespace ConstitutiveModelInternal;
+    Scalar f[Dim][Dim][batch_lane_num], S[Dim][Dim][batch_lane_num], P[Dim][Dim][batch_lane_num];
+    for(unsigned int start = 0; start < count; start += batch_lane_num)
+    {
+        unsigned int lane_num = count - start < batch_lane_num ? count - start : batch_lane_num;
+        loadMatrixBlock(F+start,lane_num,f);
+        secondPiolaKirchhoffStressOfBlock(f,S);
+        multiplyOfBlock(f,S,P);
+        storeMatrixBlock(P,volumes?volumes+start:NULL,lane_num,stress+start);
+    }
+}
+
+template <typename Scalar, int Dim>
+void StVK<Scalar,Dim>::batchCauchyStress(const SquareMatrix<Scalar,Dim> *F, const Scalar *volumes, unsigned int count, SquareMatrix<Scalar,Dim> *stress) const
+{
+    //stress = 1/J*P*F^T
+    using namespace ConstitutiveModelInternal;
+    Scalar f[Dim][Dim][batch_lane_num], S[Dim][Dim][batch_lane_num], P[Dim][Dim][batch_lane_num], J[batch_lane_num];
+    for(unsigned int start = 0; start < count; start += batch_lane_num)
+    {
+        unsigned int lane_num = count - start < batch_lane_num ? count - start : batch_lane_num;
+        loadMatrixBlock(F+start,lane_num,f);
+        secondPiolaKirchhoffStressOfBlock(f,S);
+        multiplyOfBlock(f,S,P);
+        multiplyTransposeOfBlock(P,f,S);
+        cofactorOfBlock(f,P,J);
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                    S[row][col][lane] /= J[lane];
+        storeMatrixBlock(S,volumes?volumes+start:NULL,lane_num,stress+start);
+    }
+}
+
+template <typename Scalar, int Dim>
+void StVK<Scalar,Dim>::secondPiolaKirchhoffStressOfBlock(const Scalar (&F)[Dim][Dim][ConstitutiveModelInternal::batch_lane_num],
+                                                         Scalar (&S)[Dim][Dim][ConstitutiveModelInternal::batch_lane_num]) const
+{
+    using namespace ConstitutiveModelInternal;
+    Scalar trace_E[batch_lane_num];
+    Scalar mu = this->mu_;
+    Scalar lambda = this->lambda_;
+    transposeMultiplyOfBlock(F,F,S);
+    for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+        trace_E[lane] = 0;
+    for(unsigned int i = 0; i < Dim; ++i)
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            trace_E[lane] += (S[i][i][lane]-1)/2;
+    for(unsigned int row = 0; row < Dim; ++row)
+        for(unsigned int col = 0; col < Dim; ++col)
+            for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                S[row][col][lane] = mu*(S[row][col][lane]-(row == col ? 1 : 0))+(row == col ? lambda*trace_E[lane] : 0);
+}
+
 //explicit instantiation of template so that it could be compiled into a lib
 template class StVK<float,2>;
 template class StVK<double,2>;
@@ -16,21 +16,22 @@
 #include <sstream>
 #include "Physika_Dynamics/Driver/driver_base.h"
 #include "Physika_Dynamics/Driver/driver_plugin_base.h"
+#include "Physika_Dynamics/Driver/driver_frame_writer.h"
 
 namespace Physika{
 
 template <typename Scalar>
 DriverBase<Scalar>::DriverBase()
-    :start_frame_(0),end_frame_(0),restart_frame_(0),frame_rate_(0),
-     max_dt_(0),dt_(0),write_to_file_(false),enable_timer_(true),
+    :start_frame_(0),end_frame_(0),restart_frame_(0),restart_(false),frame_rate_(0),
+     max_dt_(0),dt_(0),write_to_file_(false),enable_timer_(true),frame_writer_(NULL),
      total_simulation_time_(0),time_(0)
 {
 }
 
 template <typename Scalar>
 DriverBase<Scalar>::DriverBase(unsigned int start_frame, unsigned int end_frame, Scalar frame_rate, Scalar max_dt, bool write_to_file)
-    :start_frame_(start_frame),end_frame_(end_frame),restart_frame_(0),frame_rate_(frame_rate),
-     max_dt_(max_dt),dt_(max_dt),write_to_file_(write_to_file),enable_timer_(true),
+    :start_frame_(start_frame),end_frame_(end_frame),restart_frame_(0),restart_(false),frame_rate_(frame_rate),
+     max_dt_(max_dt),dt_(max_dt),write_to_file_(write_to_file),enable_timer_(true),frame_writer_(NULL),
      total_simulation_time_(0),time_(0)
 {
 }
@@ -39,14 +40,58 @@ DriverBase<Scalar>::DriverBase(unsigned int start_frame, unsigned int end_frame,
 template <typename Scalar>
 DriverBase<Scalar>::~DriverBase()
 {
+    if(frame_writer_)
+        delete frame_writer_; //pending frames are written in destructor of the writer
 }
 
 template <typename Scalar>
 void DriverBase<Scalar>::run()
 {
-    initSimulationData();
-    for(unsigned int frame=start_frame_;frame<=end_frame_;++frame)
+    initSimulationData(); //data of restart frame is loaded here if restart is enabled
+    unsigned int first_frame = restart_ ? restart_frame_+1 : start_frame_;
+    for(unsigned int frame=first_frame;frame<=end_frame_;++frame)
         advanceFrame(frame);
+    waitForAsyncWrite();
+}
+
+template <typename Scalar>
+bool DriverBase<Scalar>::writeToStream(std::ostream &output)
+{
+    return false;
+}
+
+template <typename Scalar>
+void DriverBase<Scalar>::enableAsyncWrite()
+{
+    if(frame_writer_ == NULL)
+        frame_writer_ = new DriverFrameWriter();
+}
+
+template <typename Scalar>
+void DriverBase<Scalar>::disableAsyncWrite()
+{
+    if(frame_writer_)
+    {
+        delete frame_writer_;
+        frame_writer_ = NULL;
+    }
+}
+
+template <typename Scalar>
+void DriverBase<Scalar>::waitForAsyncWrite()
+{
+    if(frame_writer_)
+        frame_writer_->waitForCompletion();
+}
+
+template <typename Scalar>
+std::string DriverBase<Scalar>::frameFileName(unsigned int frame)
+{
+    std::stringstream adaptor;
+    adaptor<<frame;
+    std::string frame_str;
+    adaptor>>frame_str;
+    return std::string("Frame ")+frame_str;
 }
 
 template <typename Scalar>
@@ -101,14 +146,7 @@ void DriverBase<Scalar>::advanceFrame(unsigned int frame)
     }
     //write to file
     if(write_to_file_)
-    {
-        std::stringstream adaptor;
-        adaptor<<frame;
-        std::string frame_str;
-        adaptor>>frame_str;
-        std::string file_name=std::string("Frame ")+frame_str;
-        write(file_name.c_str());
-    }
+        writeFrame(frame);
     //plugin
     for(unsigned int i = 0; i < plugin_num; ++i)
     {
@@ -118,6 +156,24 @@ void DriverBase<Scalar>::advanceFrame(unsigned int frame)
     }
 }
 
+template <typename Scalar>
+void DriverBase<Scalar>::writeFrame(unsigned int frame)
+{
+    std::string file_name = frameFileName(frame);
+    if(frame_writer_)
+    {
+        //the data is copied to memory here and written to file on the background thread
+        std::ostream &output = frame_writer_->beginFrame();
+        if(writeToStream(output))
+        {
+            frame_writer_->endFrame(file_name);
+            return;
+        }
+        frame_writer_->cancelFrame();
+    }
+    write(file_name);
+}
+
 //explicit instantiation
 template class DriverBase<float>;
 template class DriverBase<double>;
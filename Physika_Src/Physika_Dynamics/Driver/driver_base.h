@@ -17,6 +17,7 @@
 
 #include <string>
 #include <vector>
+#include <iosfwd>
 #include "Physika_Core/Timer/timer.h"
 #include "Physika_Core/Config_File/config_file.h"
 
@@ -49,10 +50,17 @@ namespace Physika{
  * 3. Be sure to return correct value in your withRestartSupport() method to inform the user whether restart
  *    is supported in your driver
  * 
- * For users of drivers: call setRestartFrame() before calling run()
+ * For users of drivers: call setRestartFrame() before calling run(), the simulation then continues from the frame
+ * after the restart frame. The simulation data of frame N is written to file named frameFileName(N).
+ *
+ * The frames can be written to file on a background thread while the simulation continues, call enableAsyncWrite()
+ * to turn it on. It requires writeToStream() be implemented in the subclass, otherwise write() is called as usual.
+ * The files of written frames are complete when run() returns, or after waitForAsyncWrite() if the simulation is
+ * advanced through advanceFrame(). Note the file of a frame may not be ready yet in onEndFrame() of plugins.
  */
 
 template <typename Scalar> class DriverPluginBase;
+class DriverFrameWriter;
 
 template <typename Scalar>
 class DriverBase
@@ -76,7 +84,12 @@ public:
     virtual bool withRestartSupport() const=0;//indicate whether restart is suported in current implementation
     virtual void write(const std::string &file_name)=0;//write simulation data of current status to file
     virtual void read(const std::string &file_name)=0;//read simulation data of current status from file
-    inline void setRestartFrame(unsigned int restart_frame){restart_frame_ = restart_frame;} //set the frame to restart from
+    virtual bool writeToStream(std::ostream &output);//write the same data as write() to stream, return false if not supported
+    inline void setRestartFrame(unsigned int restart_frame){restart_frame_ = restart_frame; restart_ = true;} //set the frame to restart from
+    inline void disableRestart(){restart_ = false;} //start the simulation from start frame (default)
+    inline bool isRestartEnabled() const {return restart_;}
+    inline unsigned int restartFrame() const {return restart_frame_;}
+    static std::string frameFileName(unsigned int frame); //name of the file where simulation data of the frame is written
 
     //setters && getters
     inline void setMaxDt(Scalar max_dt){max_dt_ = max_dt;}
@@ -90,21 +103,32 @@ public:
     inline void enableWriteToFile(){write_to_file_ = true;}
     inline void disableWriteToFile(){write_to_file_ = false;}
     inline bool isWriteToFileEnabled() const {return write_to_file_;}
+    void enableAsyncWrite(); //write frames to file on a background thread
+    void disableAsyncWrite(); //write frames to file on the simulation thread (default), the pending frames are written first
+    inline bool isAsyncWriteEnabled() const {return frame_writer_ != NULL;}
+    void waitForAsyncWrite(); //block until the pending frames are written to file
     inline void enableTimer(){enable_timer_=true;}
     inline void disableTimer(){enable_timer_=false;}
     inline bool isTimerEnabled() const {return enable_timer_;}
     inline Scalar currentTime() const {return time_;} //return current time point
 
+protected:
+    void writeFrame(unsigned int frame); //write simulation data of the frame to file, asynchronously if enabled
+private:
+    DriverBase(const DriverBase<Scalar>&);
+    DriverBase<Scalar>& operator= (const DriverBase<Scalar>&);
 protected:
     unsigned int start_frame_;
     unsigned int end_frame_;
     unsigned int restart_frame_;
+    bool restart_; //whether the simulation restarts from restart_frame_
     Scalar frame_rate_;
     Scalar max_dt_;
     Scalar dt_; //current dt
     bool write_to_file_;
     bool enable_timer_;
     Timer timer_;
+    DriverFrameWriter *frame_writer_; //writer of frames on background thread, NULL if asynchronous write is disabled
     Scalar total_simulation_time_; //the total time spent on simulation, for performance analysis
     Scalar time_;//current time point since simulation starts (from start frame)
     ConfigFile config_parser_; //parser of configuration file
@@ -0,0 +1,182 @@
+/*
+ * @file driver_frame_writer.cpp
+ * @brief Write the simulation data of frames to file on a background thread.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Dynamics/Driver/driver_frame_writer.h"
+
+namespace Physika{
+
+namespace DriverFrameWriterInternal{
+
+FrameBuffer::FrameBuffer()
+{
+}
+
+FrameBuffer::~FrameBuffer()
+{
+}
+
+void FrameBuffer::clear()
+{
+    data_.clear();
+    file_name_.clear();
+}
+
+const char* FrameBuffer::data() const
+{
+    return data_.empty() ? NULL : &data_[0];
+}
+
+std::streamsize FrameBuffer::size() const
+{
+    return static_cast<std::streamsize>(data_.size());
+}
+
+FrameBuffer::int_type FrameBuffer::overflow(int_type c)
+{
+    if(!traits_type::eq_int_type(c,traits_type::eof()))
+        data_.push_back(traits_type::to_char_type(c));
+    return traits_type::not_eof(c);
+}
+
+std::streamsize FrameBuffer::xsputn(const char *s, std::streamsize n)
+{
+    data_.insert(data_.end(),s,s+n);
+    return n;
+}
+
+}  //end of namespace DriverFrameWriterInternal
+
+DriverFrameWriter::DriverFrameWriter()
+    :current_buffer_(0),output_(&buffers_[0])
+#ifdef SUPPORT_STD_THREAD
+     ,stop_io_thread_(false)
+#endif
+{
+    buffer_in_use_[0] = buffer_in_use_[1] = false;
+#ifdef SUPPORT_STD_THREAD
+    io_thread_ = std::thread(&DriverFrameWriter::ioLoop,this);
+#endif
+}
+
+DriverFrameWriter::~DriverFrameWriter()
+{
+    waitForCompletion();
+#ifdef SUPPORT_STD_THREAD
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_io_thread_ = true;
+    }
+    condition_.notify_all();
+    io_thread_.join();
+#endif
+}
+
+std::ostream& DriverFrameWriter::beginFrame()
+{
+#ifdef SUPPORT_STD_THREAD
+    std::unique_lock<std::mutex> lock(mutex_);
+    //back-pressure: wait until the I/O thread releases one buffer
+    while(buffer_in_use_[0] && buffer_in_use_[1])
+        condition_.wait(lock);
+#endif
+    current_buffer_ = buffer_in_use_[0] ? 1 : 0;
+    buffer_in_use_[current_buffer_] = true;
+    buffers_[current_buffer_].clear();
+    output_.rdbuf(&buffers_[current_buffer_]);
+    output_.clear();
+    return output_;
+}
+
+void DriverFrameWriter::endFrame(const std::string &file_name)
+{
+    PHYSIKA_ASSERT(buffer_in_use_[current_buffer_]);
+    output_.flush();
+    buffers_[current_buffer_].file_name_ = file_name;
+#ifdef SUPPORT_STD_THREAD
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_queue_.push_back(current_buffer_);
+    }
+    condition_.notify_all();
+#else
+    writeBuffer(current_buffer_);
+    buffer_in_use_[current_buffer_] = false;
+#endif
+}
+
+void DriverFrameWriter::cancelFrame()
+{
+    PHYSIKA_ASSERT(buffer_in_use_[current_buffer_]);
+#ifdef SUPPORT_STD_THREAD
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer_in_use_[current_buffer_] = false;
+    }
+    condition_.notify_all();
+#else
+    buffer_in_use_[current_buffer_] = false;
+#endif
+}
+
+void DriverFrameWriter::waitForCompletion()
+{
+#ifdef SUPPORT_STD_THREAD
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(!write_queue_.empty())
+        condition_.wait(lock);
+#endif
+}
+
+void DriverFrameWriter::writeBuffer(unsigned int buffer_idx)
+{
+    const DriverFrameWriterInternal::FrameBuffer &buffer = buffers_[buffer_idx];
+    std::ofstream output(buffer.file_name_.c_str(),std::ios::out|std::ios::binary);
+    if(!output.is_open())
+    {
+        std::cerr<<"Warning: failed to open file "<<buffer.file_name_<<", operation ignored!\n";
+        return;
+    }
+    if(buffer.size() > 0)
+        output.write(buffer.data(),buffer.size());
+    output.close();
+    if(!output)
+        std::cerr<<"Warning: failed to write simulation data to file "<<buffer.file_name_<<"!\n";
+}
+
+void DriverFrameWriter::ioLoop()
+{
+#ifdef SUPPORT_STD_THREAD
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true)
+    {
+        while(write_queue_.empty() && !stop_io_thread_)
+            condition_.wait(lock);
+        if(write_queue_.empty())
+            break;
+        //the buffer in queue is not touched by the simulation thread until it's released
+        unsigned int buffer_idx = write_queue_.front();
+        lock.unlock();
+        writeBuffer(buffer_idx);
+        lock.lock();
+        write_queue_.pop_front();
+        buffer_in_use_[buffer_idx] = false;
+        condition_.notify_all();
+    }
+#endif
+}
+
+}  //end of namespace Physika
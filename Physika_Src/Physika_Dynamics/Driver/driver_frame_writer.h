@@ -0,0 +1,98 @@
+/*
+ * @file driver_frame_writer.h
+ * @brief Write the simulation data of frames to file on a background thread.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_DYNAMICS_DRIVER_DRIVER_FRAME_WRITER_H_
+#define PHYSIKA_DYNAMICS_DRIVER_DRIVER_FRAME_WRITER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <ostream>
+#include <streambuf>
+#include "Physika_Core/Utilities/cxx11_support.h"
+#ifdef SUPPORT_STD_THREAD
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+namespace Physika{
+
+namespace DriverFrameWriterInternal{
+
+//stream buffer that appends the written bytes to memory, the memory is kept for next frame when cleared
+class FrameBuffer: public std::streambuf
+{
+public:
+    FrameBuffer();
+    ~FrameBuffer();
+    void clear();
+    const char* data() const;
+    std::streamsize size() const;
+    std::string file_name_; //file the buffer is written to
+protected:
+    virtual int_type overflow(int_type c);
+    virtual std::streamsize xsputn(const char *s, std::streamsize n);
+protected:
+    std::vector<char> data_;
+};
+
+}  //end of namespace DriverFrameWriterInternal
+
+/*
+ * DriverFrameWriter writes the simulation data of frames to file on a background I/O thread,
+ * so that the simulation of frame N+1 overlaps with the output of frame N.
+ * The simulation data is written to one of the two memory buffers on the simulation thread, and
+ * the buffer is handed to the I/O thread. If both buffers are in use, i.e., the I/O thread lags
+ * behind by one frame, beginFrame() blocks until the older frame is written.
+ * The frames are written synchronously if std::thread is not supported by the compiler.
+ *
+ * Usage:
+ * std::ostream &output = writer.beginFrame();
+ * (write simulation data to output)
+ * writer.endFrame(file_name); //or writer.cancelFrame() if the data is not wanted
+ */
+
+class DriverFrameWriter
+{
+public:
+    DriverFrameWriter();
+    ~DriverFrameWriter(); //wait until all frames are written
+    std::ostream& beginFrame(); //return the stream to a free buffer, block if both buffers are in use
+    void endFrame(const std::string &file_name); //queue the data written since beginFrame() for writing to file
+    void cancelFrame(); //discard the data written since beginFrame()
+    void waitForCompletion(); //block until all queued frames are written
+protected:
+    void writeBuffer(unsigned int buffer_idx); //write buffer to its file, called on the I/O thread
+    void ioLoop(); //body of the I/O thread
+private:
+    DriverFrameWriter(const DriverFrameWriter&);
+    DriverFrameWriter& operator= (const DriverFrameWriter&);
+protected:
+    DriverFrameWriterInternal::FrameBuffer buffers_[2];
+    bool buffer_in_use_[2];
+    unsigned int current_buffer_; //the buffer between beginFrame() and endFrame()/cancelFrame()
+    std::ostream output_;
+    std::deque<unsigned int> write_queue_; //buffers to be written, in frame order
+#ifdef SUPPORT_STD_THREAD
+    bool stop_io_thread_;
+    std::mutex mutex_;
+    std::condition_variable condition_; //signaled when a frame is queued or written
+    std::thread io_thread_;
+#endif
+};
+
+}  //end of namespace Physika
+
+#endif  //PHYSIKA_DYNAMICS_DRIVER_DRIVER_FRAME_WRITER_H_
@@ -250,96 +250,52 @@ void FEMBase<Scalar,Dim>::resetVertexVelocity()
 template <typename Scalar, int Dim>
 void FEMBase<Scalar,Dim>::synchronizeDataWithSimulationMesh()
 {
-    vertex_displacements_.resize(simulation_mesh_->vertNum());
-    vertex_velocities_.resize(simulation_mesh_->vertNum());
-    computeReferenceShapeMatrixInverse();
+    vertex_displacements_.assign(simulation_mesh_->vertNum(),Vector<Scalar,Dim>(0));
+    vertex_velocities_.assign(simulation_mesh_->vertNum(),Vector<Scalar,Dim>(0));
+    computeReferenceElementData();
 }
 
 template <typename Scalar, int Dim>
 SquareMatrix<Scalar,Dim> FEMBase<Scalar,Dim>::deformationGradient(unsigned int ele_idx) const
 {
-//TO DO
     unsigned int ele_num = simulation_mesh_->eleNum();
     PHYSIKA_ASSERT(ele_idx<ele_num);
-    VolumetricMeshInternal::ElementType ele_type = simulation_mesh_->elementType();
-    switch(ele_type)
+    if(!isSimplexMesh())
     {
-    case VolumetricMeshInternal::TRI:
-        break;
-    case VolumetricMeshInternal::QUAD:
-        break;
-    case VolumetricMeshInternal::TET:
-        break;
-    case VolumetricMeshInternal::CUBIC:
-        break;
-    case VolumetricMeshInternal::NON_UNIFORM:
-        PHYSIKA_ERROR("Non-uniform element type not implemented yet.");
-        break;
-    default:
-        PHYSIKA_ERROR("Unknown element type.");
-        break;
+        //TO DO: deformation gradient at quadrature points of QUAD and CUBIC elements
+        PHYSIKA_ERROR("Deformation gradient of non-simplex elements not implemented yet.");
     }
-    return SquareMatrix<Scalar,Dim>();
+    //F = sum_i x_i*gradN_i^T with the current positions x_i
+    SquareMatrix<Scalar,Dim> F(0);
+    for(unsigned int local_idx = 0; local_idx < Dim+1; ++local_idx)
+    {
+        unsigned int vert_idx = element_vert_indices_[ele_idx*(Dim+1)+local_idx];
+        Vector<Scalar,Dim> vert_pos = simulation_mesh_->vertPos(vert_idx) + vertex_displacements_[vert_idx];
+        const Scalar *gradient = &shape_function_gradients_[(ele_idx*(Dim+1)+local_idx)*Dim];
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                F(row,col) += vert_pos[row]*gradient[col];
+    }
+    return F;
 }
 
 template <typename Scalar, int Dim>
-void FEMBase<Scalar,Dim>::computeReferenceShapeMatrixInverse()
+void FEMBase<Scalar,Dim>::computeReferenceElementData()
 {
+    element_vert_indices_.clear();
     reference_shape_matrix_inv_.clear();
+    reference_element_volume_.clear();
+    shape_function_gradients_.clear();
     VolumetricMeshInternal::ElementType ele_type = simulation_mesh_->elementType();
-    unsigned int ele_num = simulation_mesh_->eleNum();
     switch(ele_type)
     {
     case VolumetricMeshInternal::TRI:
-    {
-        std::vector<Vector<Scalar,2> > ele_vert_pos;
-        for(unsigned int i = 0; i < ele_num; ++i)
-        {
-            ele_vert_pos.clear();
-            TriMesh<Scalar> *tri_mesh = dynamic_cast<TriMesh<Scalar>*>(simulation_mesh_);
-            PHYSIKA_ASSERT(tri_mesh);
-            tri_mesh->eleVertPos(i,ele_vert_pos);
-            PHYSIKA_ASSERT(ele_vert_pos.size()==3);
-            Vector<Scalar,2> v1_minus_v3 = ele_vert_pos[0] - ele_vert_pos[2];
-            Vector<Scalar,2> v2_minus_v3 = ele_vert_pos[1] - ele_vert_pos[2];
-            SquareMatrix<Scalar,2> reference_shape_matrix(v1_minus_v3,v2_minus_v3);
-            reference_shape_matrix = reference_shape_matrix.transpose();
-            SquareMatrix<Scalar,2> inv = reference_shape_matrix.inverse();
-            SquareMatrix<Scalar,Dim> *mat_ptr = dynamic_cast<SquareMatrix<Scalar,Dim>*>(&inv);
-            PHYSIKA_ASSERT(mat_ptr);
-            reference_shape_matrix_inv_.push_back(*mat_ptr);
-        }
-        break;
-    }
-    case VolumetricMeshInternal::QUAD:
-    {
-        break;
-    }
     case VolumetricMeshInternal::TET:
-    {
-        std::vector<Vector<Scalar,3> > ele_vert_pos;
-        for(unsigned int i = 0; i < ele_num; ++i)
-        {
-            ele_vert_pos.clear();
-            TetMesh<Scalar> *tet_mesh = dynamic_cast<TetMesh<Scalar>*>(simulation_mesh_);
-            PHYSIKA_ASSERT(tet_mesh);
-            tet_mesh->eleVertPos(i,ele_vert_pos);
-            PHYSIKA_ASSERT(ele_vert_pos.size()==4);
-            Vector<Scalar,3> v1_minus_v4 = ele_vert_pos[0] - ele_vert_pos[3];
-            Vector<Scalar,3> v2_minus_v4 = ele_vert_pos[1] - ele_vert_pos[3];
-            Vector<Scalar,3> v3_minus_v4 = ele_vert_pos[2] - ele_vert_pos[3];
-            SquareMatrix<Scalar,3> reference_shape_matrix(v1_minus_v4,v2_minus_v4,v3_minus_v4);
-            SquareMatrix<Scalar,3> inv = reference_shape_matrix.inverse();
-            SquareMatrix<Scalar,Dim> *mat_ptr = dynamic_cast<SquareMatrix<Scalar,Dim>*>(&inv);
-            PHYSIKA_ASSERT(mat_ptr);
-            reference_shape_matrix_inv_.push_back(*mat_ptr);
-        }
         break;
-    }
+    case VolumetricMeshInternal::QUAD:
     case VolumetricMeshInternal::CUBIC:
-    {
-        break;
-    }
+        //TO DO: reference data at quadrature points of QUAD and CUBIC elements
+        return;
     case VolumetricMeshInternal::NON_UNIFORM:
         PHYSIKA_ERROR("Non-uniform element type not implemented yet.");
         break;
@@ -347,7 +303,55 @@ void FEMBase<Scalar,Dim>::computeReferenceShapeMatrixInverse()
         PHYSIKA_ERROR("Unknown element type.");
         break;
     }
-//TO DO
+    unsigned int ele_num = simulation_mesh_->eleNum();
+    element_vert_indices_.resize(ele_num*(Dim+1));
+    reference_shape_matrix_inv_.resize(ele_num);
+    reference_element_volume_.resize(ele_num);
+    shape_function_gradients_.resize(ele_num*(Dim+1)*Dim);
+    //volume of simplex is |det(Dm)|/Dim!
+    Scalar factorial = Dim == 2 ? 2 : 6;
+    for(unsigned int ele_idx = 0; ele_idx < ele_num; ++ele_idx)
+    {
+        unsigned int *vert_indices = &element_vert_indices_[ele_idx*(Dim+1)];
+        for(unsigned int local_idx = 0; local_idx < Dim+1; ++local_idx)
+            vert_indices[local_idx] = simulation_mesh_->eleVertIndex(ele_idx,local_idx);
+        Vector<Scalar,Dim> last_vert_pos = simulation_mesh_->vertPos(vert_indices[Dim]);
+        SquareMatrix<Scalar,Dim> reference_shape_matrix;
+        for(unsigned int col = 0; col < Dim; ++col)
+        {
+            Vector<Scalar,Dim> edge = simulation_mesh_->vertPos(vert_indices[col]) - last_vert_pos;
+            for(unsigned int row = 0; row < Dim; ++row)
+                reference_shape_matrix(row,col) = edge[row];
+        }
+        Scalar det = reference_shape_matrix.determinant();
+        if(det == 0)
+        {
+            std::cerr<<"Error: degenerate element "<<ele_idx<<" in simulation mesh, program abort!\n";
+            std::exit(EXIT_FAILURE);
+        }
+        SquareMatrix<Scalar,Dim> inv = reference_shape_matrix.inverse();
+        reference_shape_matrix_inv_[ele_idx] = inv;
+        reference_element_volume_[ele_idx] = (det > 0 ? det : -det)/factorial;
+        Scalar *gradients = &shape_function_gradients_[ele_idx*(Dim+1)*Dim];
+        for(unsigned int col = 0; col < Dim; ++col)
+        {
+            gradients[Dim*Dim+col] = 0;
+            for(unsigned int local_idx = 0; local_idx < Dim; ++local_idx)
+            {
+                gradients[local_idx*Dim+col] = inv(local_idx,col);
+                gradients[Dim*Dim+col] -= inv(local_idx,col);
+            }
+        }
+    }
+}
+
+template <typename Scalar, int Dim>
+bool FEMBase<Scalar,Dim>::isSimplexMesh() const
+{
+    if(simulation_mesh_ == NULL)
+        return false;
+    VolumetricMeshInternal::ElementType ele_type = simulation_mesh_->elementType();
+    return ele_type == VolumetricMeshInternal::TRI || ele_type == VolumetricMeshInternal::TET;
 }
 
 //explicit instantiations
@@ -32,6 +32,12 @@ template <typename Scalar, int Dim> class VolumetricMesh;
  * Two ways to set configurations before simulation:
  * 1. Various setters
  * 2. Load configuration from file
+ *
+ * The reference data of simplex elements (TRI in 2D, TET in 3D) are precomputed once the simulation mesh
+ * is set and stored in flat arrays indexed by element: the vertex indices, the inverse of the reference shape
+ * matrix Dm, the rest volume and the gradients of the linear shape functions. For the element with vertices
+ * X_0,...,X_Dim, the columns of Dm are X_i - X_Dim (i < Dim), the gradient of the shape function of vertex i
+ * is the i-th row of inv(Dm) and that of vertex Dim is minus their sum. Then F = sum_i x_i*gradN_i^T.
  */
 
 template <typename Scalar, int Dim>
@@ -76,13 +82,18 @@ public:
 protected:
     void synchronizeDataWithSimulationMesh();  //synchronize related data when simulation mesh is changed (dimension of displacement vector, etc.)
     SquareMatrix<Scalar,Dim> deformationGradient(unsigned int ele_idx) const;  //compute the deformation gradient of given element, constant strain element
-    void computeReferenceShapeMatrixInverse();  //compute the inverse of the reference shape matrix for each element, precomputation for deformation gradient
-                                                //called only once when simulation mesh is set
+    void computeReferenceElementData();  //precompute the reference data of each element for deformation gradient and force computation
+                                         //called only once when simulation mesh is set
+    bool isSimplexMesh() const; //whether the simulation mesh is made of simplex elements, i.e., TRI in 2D and TET in 3D
 protected:
     VolumetricMesh<Scalar,Dim> *simulation_mesh_;
     std::vector<Vector<Scalar,Dim> > vertex_displacements_;  //displacement of simulation mesh vertices
     std::vector<Vector<Scalar,Dim> > vertex_velocities_;  //velocities of simulation mesh vertices
+    //precomputed data of simplex elements, empty for other element types
+    std::vector<unsigned int> element_vert_indices_; //Dim+1 vertex indices per element
     std::vector<SquareMatrix<Scalar,Dim> > reference_shape_matrix_inv_; //store precomputed data (inverse of Dm) for deformation gradient computation: F = Ds*inv(Dm)
+    std::vector<Scalar> reference_element_volume_; //rest volume of each element
+    std::vector<Scalar> shape_function_gradients_; //(Dim+1)*Dim per element, gradients of the shape functions of the element vertices in order
     Scalar gravity_;
 };
 
@@ -12,32 +12,54 @@
  *
  */
 
+#include <cmath>
+#include <limits>
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Core/Vectors/vector_Nd.h"
+#include "Physika_Core/Linear_Solvers/block_jacobi_preconditioner.h"
 #include "Physika_Geometry/Volumetric_Meshes/volumetric_mesh.h"
 #include "Physika_Dynamics/Constitutive_Models/constitutive_model.h"
 #include "Physika_Dynamics/FEM/fem_solid.h"
 
 namespace Physika{
 
+namespace FEMSolidInternal{
+
+//number of consecutive elements processed together in the force computation, the stresses of the
+//elements sharing one material in the batch are evaluated with one batch call of the constitutive model
+const unsigned int element_batch_size = 256;
+
+//maximum number of times the unconverged solution of the linear system in a Newton iteration is halved
+const unsigned int max_step_halving_num = 8;
+
+}  //end of namespace FEMSolidInternal
+
 template <typename Scalar, int Dim>
 FEMSolid<Scalar,Dim>::FEMSolid()
-    :FEMBase<Scalar,Dim>()
+    :FEMBase<Scalar,Dim>(),integration_method_(FORWARD_EULER),density_(1000),cfl_num_(0.5),thread_num_(maxThreadNum()),
+     max_newton_iteration_num_(5),newton_tolerance_(static_cast<Scalar>(1.0e-3)),min_element_height_(0)
 {
+    initLinearSolver();
 }
 
 template <typename Scalar, int Dim>
 FEMSolid<Scalar,Dim>::FEMSolid(unsigned int start_frame, unsigned int end_frame, Scalar frame_rate, Scalar max_dt, bool write_to_file)
-    :FEMBase<Scalar,Dim>(start_frame,end_frame,frame_rate,max_dt,write_to_file)
+    :FEMBase<Scalar,Dim>(start_frame,end_frame,frame_rate,max_dt,write_to_file),integration_method_(FORWARD_EULER),density_(1000),cfl_num_(0.5),
+     thread_num_(maxThreadNum()),max_newton_iteration_num_(5),newton_tolerance_(static_cast<Scalar>(1.0e-3)),min_element_height_(0)
 {
+    initLinearSolver();
 }
 
 template <typename Scalar, int Dim>
 FEMSolid<Scalar,Dim>::FEMSolid(unsigned int start_frame, unsigned int end_frame, Scalar frame_rate, Scalar max_dt, bool write_to_file,
                                const VolumetricMesh<Scalar,Dim> &mesh)
-    :FEMBase<Scalar,Dim>(start_frame,end_frame,frame_rate,max_dt,write_to_file,mesh)
+    :FEMBase<Scalar,Dim>(start_frame,end_frame,frame_rate,max_dt,write_to_file,mesh),integration_method_(FORWARD_EULER),density_(1000),cfl_num_(0.5),
+     thread_num_(maxThreadNum()),max_newton_iteration_num_(5),newton_tolerance_(static_cast<Scalar>(1.0e-3)),min_element_height_(0)
 {
+    initLinearSolver();
 }
 
 template <typename Scalar, int Dim>
@@ -59,19 +81,183 @@ void FEMSolid<Scalar,Dim>::printConfigFileFormat()
 
 template <typename Scalar, int Dim>
 void FEMSolid<Scalar,Dim>::initSimulationData()
-{//TO DO
+{
+    if(this->simulation_mesh_ == NULL)
+    {
+        std::cerr<<"Error: simulation mesh of FEMSolid not set, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if(!this->isSimplexMesh())
+    {
+        std::cerr<<"Error: FEMSolid only supports simplex elements (TRI in 2D, TET in 3D), program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if(constitutive_model_.empty())
+    {
+        std::cerr<<"Error: material of FEMSolid not set, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    unsigned int vert_num = this->numSimVertices(), ele_num = this->numSimElements();
+    element_material_.resize(ele_num);
+    for(unsigned int ele_idx = 0; ele_idx < ele_num; ++ele_idx)
+    {
+        element_material_[ele_idx] = elementMaterial(ele_idx);
+        if(element_material_[ele_idx] == NULL)
+        {
+            std::cerr<<"Error: material of element "<<ele_idx<<" not set, program abort!\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    //lumped mass, vertex-element incidence and the minimum height of the elements
+    //the element arrays are empty for a mesh without elements
+    const unsigned int *ele_vert_indices = ele_num > 0 ? &(this->element_vert_indices_[0]) : NULL;
+    const Scalar *gradients = ele_num > 0 ? &(this->shape_function_gradients_[0]) : NULL;
+    vertex_mass_.assign(vert_num,0);
+    vert_ele_offset_.assign(vert_num+1,0);
+    min_element_height_ = (std::numeric_limits<Scalar>::max)();
+    for(unsigned int ele_idx = 0; ele_idx < ele_num; ++ele_idx)
+    {
+        Scalar vert_mass = density_*this->reference_element_volume_[ele_idx]/(Dim+1);
+        for(unsigned int local_idx = 0; local_idx < Dim+1; ++local_idx)
+        {
+            unsigned int vert_idx = ele_vert_indices[ele_idx*(Dim+1)+local_idx];
+            vertex_mass_[vert_idx] += vert_mass;
+            ++vert_ele_offset_[vert_idx+1];
+            //the height of the element on the opposite face of the vertex is 1/|gradN|
+            const Scalar *gradient = gradients + (ele_idx*(Dim+1)+local_idx)*Dim;
+            Scalar norm_sqr = 0;
+            for(unsigned int dim = 0; dim < Dim; ++dim)
+                norm_sqr += gradient[dim]*gradient[dim];
+            Scalar height = 1/std::sqrt(norm_sqr);
+            min_element_height_ = height < min_element_height_ ? height : min_element_height_;
+        }
+    }
+    for(unsigned int vert_idx = 0; vert_idx < vert_num; ++vert_idx)
+        vert_ele_offset_[vert_idx+1] += vert_ele_offset_[vert_idx];
+    vert_ele_.resize(vert_ele_offset_[vert_num]);
+    std::vector<unsigned int> insert_pos(vert_ele_offset_.begin(),vert_ele_offset_.end()-1);
+    for(unsigned int ele_idx = 0; ele_idx < ele_num; ++ele_idx)
+        for(unsigned int local_idx = 0; local_idx < Dim+1; ++local_idx)
+            vert_ele_[insert_pos[ele_vert_indices[ele_idx*(Dim+1)+local_idx]]++] = ele_idx*(Dim+1)+local_idx;
+    //pattern of the system matrix, the neighbors of a vertex are the vertices of its incident elements
+    std::vector<unsigned int> neighbor_offset(vert_num+1,0), neighbors;
+    for(unsigned int vert_idx = 0; vert_idx < vert_num; ++vert_idx)
+    {
+        size_t row_start = neighbors.size();
+        neighbors.push_back(vert_idx);
+        for(unsigned int i = vert_ele_offset_[vert_idx]; i < vert_ele_offset_[vert_idx+1]; ++i)
+        {
+            unsigned int ele_idx = vert_ele_[i]/(Dim+1);
+            for(unsigned int local_idx = 0; local_idx < Dim+1; ++local_idx)
+                neighbors.push_back(ele_vert_indices[ele_idx*(Dim+1)+local_idx]);
+        }
+        std::sort(neighbors.begin()+row_start,neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin()+row_start,neighbors.end()),neighbors.end());
+        neighbor_offset[vert_idx+1] = static_cast<unsigned int>(neighbors.size());
+    }
+    std::vector<unsigned int> row_offsets(1,0), col_indices;
+    row_offsets.reserve(vert_num*Dim+1);
+    col_indices.reserve(neighbors.size()*Dim*Dim);
+    vertex_diag_block_col_.resize(vert_num);
+    for(unsigned int vert_idx = 0; vert_idx < vert_num; ++vert_idx)
+    {
+        for(unsigned int row = 0; row < Dim; ++row)
+        {
+            for(unsigned int i = neighbor_offset[vert_idx]; i < neighbor_offset[vert_idx+1]; ++i)
+                for(unsigned int col = 0; col < Dim; ++col)
+                    col_indices.push_back(neighbors[i]*Dim+col);
+            row_offsets.push_back(static_cast<unsigned int>(col_indices.size()));
+        }
+        vertex_diag_block_col_[vert_idx] = static_cast<unsigned int>(std::lower_bound(neighbors.begin()+neighbor_offset[vert_idx],
+                                                                                      neighbors.begin()+neighbor_offset[vert_idx+1],vert_idx)
+                                                                     - (neighbors.begin()+neighbor_offset[vert_idx]));
+    }
+    system_matrix_.setThreadNum(thread_num_);
+    system_matrix_.setPattern(vert_num*Dim,vert_num*Dim,row_offsets,col_indices);
+    element_block_col_.resize(ele_num*(Dim+1)*(Dim+1));
+    for(unsigned int ele_idx = 0; ele_idx < ele_num; ++ele_idx)
+        for(unsigned int a = 0; a < Dim+1; ++a)
+        {
+            unsigned int vert_a = ele_vert_indices[ele_idx*(Dim+1)+a];
+            std::vector<unsigned int>::const_iterator row_begin = neighbors.begin()+neighbor_offset[vert_a];
+            std::vector<unsigned int>::const_iterator row_end = neighbors.begin()+neighbor_offset[vert_a+1];
+            for(unsigned int b = 0; b < Dim+1; ++b)
+                element_block_col_[(ele_idx*(Dim+1)+a)*(Dim+1)+b] = static_cast<unsigned int>(
+                    std::lower_bound(row_begin,row_end,ele_vert_indices[ele_idx*(Dim+1)+b]) - row_begin);
+        }
+    vertex_rest_pos_.resize(vert_num*Dim);
+    for(unsigned int vert_idx = 0; vert_idx < vert_num; ++vert_idx)
+    {
+        Vector<Scalar,Dim> rest_pos = this->simulation_mesh_->vertPos(vert_idx);
+        for(unsigned int dim = 0; dim < Dim; ++dim)
+            vertex_rest_pos_[vert_idx*Dim+dim] = rest_pos[dim];
+    }
+    is_dirichlet_vertex_.resize(vert_num,0);
+    element_deform_grad_.resize(ele_num);
+    element_stress_.resize(ele_num);
+    element_vert_forces_.resize(ele_num*(Dim+1)*Dim);
+    element_stiffness_.resize(ele_num*(Dim+1)*Dim*(Dim+1)*Dim);
+    vertex_pos_.resize(vert_num*Dim);
+    vertex_vel_.resize(vert_num*Dim);
+    vertex_force_.resize(vert_num*Dim);
 }
 
 template <typename Scalar, int Dim>
 void FEMSolid<Scalar,Dim>::advanceStep(Scalar dt)
-{//TO DO
+{
+    if(isSimulationDataOutOfDate())
+        initSimulationData();
+    //load the state of vertices into flat arrays
+    unsigned int vert_num = this->numSimVertices();
+    for(unsigned int vert_idx = 0; vert_idx < vert_num; ++vert_idx)
+        for(unsigned int dim = 0; dim < Dim; ++dim)
+        {
+            vertex_pos_[vert_idx*Dim+dim] = vertex_rest_pos_[vert_idx*Dim+dim] + this->vertex_displacements_[vert_idx][dim];
+            vertex_vel_[vert_idx*Dim+dim] = this->vertex_velocities_[vert_idx][dim];
+        }
+    switch(integration_method_)
+    {
+    case FORWARD_EULER:
+        advanceStepForwardEuler(dt);
+        break;
+    case BACKWARD_EULER:
+        advanceStepBackwardEuler(dt);
+        break;
+    default:
+        PHYSIKA_ERROR("Unknown time integration method.");
+        break;
+    }
+    for(unsigned int vert_idx = 0; vert_idx < vert_num; ++vert_idx)
+        for(unsigned int dim = 0; dim < Dim; ++dim)
+        {
+            this->vertex_displacements_[vert_idx][dim] = vertex_pos_[vert_idx*Dim+dim] - vertex_rest_pos_[vert_idx*Dim+dim];
+            this->vertex_velocities_[vert_idx][dim] = vertex_vel_[vert_idx*Dim+dim];
+        }
+    this->time_ += dt;
 }
 
 template <typename Scalar, int Dim>
 Scalar FEMSolid<Scalar,Dim>::computeTimeStep()
 {
-//TO DO
-    return 0;
+    if(isSimulationDataOutOfDate())
+        initSimulationData();
+    this->dt_ = this->max_dt_;
+    if(integration_method_ == FORWARD_EULER)
+    {
+        //CFL condition with the speed of pressure wave
+        Scalar wave_speed = maxPressureWaveSpeed();
+        if(wave_speed > std::numeric_limits<Scalar>::epsilon())
+            this->dt_ = (cfl_num_ * min_element_height_)/wave_speed;
+    }
+    else
+    {
+        //implicit integration is stable with large time step, the vertices are only required not to travel beyond the element size
+        Scalar max_vert_vel = maxVertexVelocityNorm();
+        if(max_vert_vel > std::numeric_limits<Scalar>::epsilon())
+            this->dt_ = (cfl_num_ * min_element_height_)/max_vert_vel;
+    }
+    this->dt_ = this->dt_ > this->max_dt_ ? this->max_dt_ : this->dt_;
+    return this->dt_;
 }
 
 template <typename Scalar, int Dim>
@@ -188,6 +374,162 @@ ConstitutiveModel<Scalar,Dim>* FEMSolid<Scalar,Dim>::elementMaterial(unsigned in
         PHYSIKA_ERROR("Invalid material number.");
 }
 
+template <typename Scalar, int Dim>
+Scalar FEMSolid<Scalar,Dim>::density() const
+{
+    return density_;
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::setDensity(Scalar density)
+{
+    if(density <= 0)
+    {
+        std::cerr<<"Warning: density of FEMSolid must be positive, operation ignored!\n";
+        return;
+    }
+    density_ = density;
+    vertex_mass_.clear(); //masses are updated in initSimulationData()
+}
+
+template <typename Scalar, int Dim>
+Scalar FEMSolid<Scalar,Dim>::cflConstant() const
+{
+    return cfl_num_;
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::setCFLConstant(Scalar cfl)
+{
+    if(cfl <= 0)
+    {
+        std::cerr<<"Warning: CFL constant must be positive, operation ignored!\n";
+        return;
+    }
+    cfl_num_ = cfl;
+}
+
+template <typename Scalar, int Dim>
+unsigned int FEMSolid<Scalar,Dim>::threadNum() const
+{
+    return thread_num_;
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::setThreadNum(unsigned int thread_num)
+{
+    if(thread_num == 0)
+    {
+        std::cerr<<"Warning: Invalid thread number specified, use 1 instead!\n";
+        thread_num_ = 1;
+    }
+    else
+        thread_num_ = thread_num;
+    linear_solver_.setThreadNum(thread_num_);
+    system_matrix_.setThreadNum(thread_num_);
+}
+
+template <typename Scalar, int Dim>
+unsigned int FEMSolid<Scalar,Dim>::maxNewtonIterationNum() const
+{
+    return max_newton_iteration_num_;
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::setMaxNewtonIterationNum(unsigned int iteration_num)
+{
+    if(iteration_num == 0)
+    {
+        std::cerr<<"Warning: at least one Newton iteration is needed, operation ignored!\n";
+        return;
+    }
+    max_newton_iteration_num_ = iteration_num;
+}
+
+template <typename Scalar, int Dim>
+Scalar FEMSolid<Scalar,Dim>::newtonTolerance() const
+{
+    return newton_tolerance_;
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::setNewtonTolerance(Scalar tolerance)
+{
+    if(tolerance < 0)
+    {
+        std::cerr<<"Warning: negative tolerance of Newton iterations, operation ignored!\n";
+        return;
+    }
+    newton_tolerance_ = tolerance;
+}
+
+template <typename Scalar, int Dim>
+ConjugateGradientSolver<Scalar>& FEMSolid<Scalar,Dim>::linearSolver()
+{
+    return linear_solver_;
+}
+
+template <typename Scalar, int Dim>
+const ConjugateGradientSolver<Scalar>& FEMSolid<Scalar,Dim>::linearSolver() const
+{
+    return linear_solver_;
+}
+
+template <typename Scalar, int Dim>
+Scalar FEMSolid<Scalar,Dim>::vertexMass(unsigned int vert_idx) const
+{
+    if(vert_idx >= vertex_mass_.size())
+    {
+        std::cerr<<"Vertex index out of range.\n";
+        std::exit(EXIT_FAILURE);
+    }
+    return vertex_mass_[vert_idx];
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::addDirichletVertex(unsigned int vert_idx)
+{
+    unsigned int vert_num = this->numSimVertices();
+    if(vert_idx >= vert_num)
+    {
+        std::cerr<<"Warning: vertex index out of range, operation ignored!\n";
+        return;
+    }
+    is_dirichlet_vertex_.resize(vert_num,0);
+    is_dirichlet_vertex_[vert_idx] = 1;
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::addDirichletVertices(const std::vector<unsigned int> &vert_idx)
+{
+    for(unsigned int i = 0; i < vert_idx.size(); ++i)
+        addDirichletVertex(vert_idx[i]);
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::clearDirichletVertices()
+{
+    is_dirichlet_vertex_.assign(is_dirichlet_vertex_.size(),0);
+}
+
+template <typename Scalar, int Dim>
+bool FEMSolid<Scalar,Dim>::isDirichletVertex(unsigned int vert_idx) const
+{
+    return vert_idx < is_dirichlet_vertex_.size() && is_dirichlet_vertex_[vert_idx];
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::setTimeIntegrationMethod(const IntegrationMethod &method)
+{
+    integration_method_ = method;
+}
+
+template <typename Scalar, int Dim>
+typename FEMSolid<Scalar,Dim>::IntegrationMethod FEMSolid<Scalar,Dim>::timeIntegrationMethod() const
+{
+    return integration_method_;
+}
+
 template <typename Scalar, int Dim>
 void FEMSolid<Scalar,Dim>::clearMaterial()
 {
@@ -195,6 +537,7 @@ void FEMSolid<Scalar,Dim>::clearMaterial()
         if(constitutive_model_[i])
             delete constitutive_model_[i];
     constitutive_model_.clear();
+    element_material_.clear(); //updated in initSimulationData()
 }
 
 template <typename Scalar, int Dim>
@@ -205,6 +548,351 @@ void FEMSolid<Scalar,Dim>::addMaterial(const ConstitutiveModel<Scalar,Dim> &mate
     constitutive_model_.push_back(single_material);
 }
 
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::initLinearSolver()
+{
+    //the inexact Newton steps only need moderate accuracy of the linear solves
+    linear_solver_.setThreadNum(thread_num_);
+    linear_solver_.setTolerance(static_cast<Scalar>(1.0e-4));
+    linear_solver_.setPreconditioner(BlockJacobiPreconditioner<Scalar>(Dim));
+}
+
+template <typename Scalar, int Dim>
+bool FEMSolid<Scalar,Dim>::isSimulationDataOutOfDate() const
+{
+    if(this->simulation_mesh_ == NULL)
+        return true;
+    unsigned int vert_num = this->simulation_mesh_->vertNum(), ele_num = this->simulation_mesh_->eleNum();
+    return vertex_mass_.size() != vert_num || element_material_.size() != ele_num || is_dirichlet_vertex_.size() != vert_num
+        || element_vert_forces_.size() != ele_num*(Dim+1)*Dim;
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::computeElasticForces(const std::vector<Scalar> &positions, std::vector<Scalar> &forces)
+{
+    int ele_num = static_cast<int>(this->numSimElements());
+    int vert_num = static_cast<int>(this->numSimVertices());
+    PHYSIKA_ASSERT(positions.size() == static_cast<size_t>(vert_num)*Dim);
+    forces.resize(vert_num*Dim);
+    if(ele_num == 0)
+    {
+        forces.assign(forces.size(),0);
+        return;
+    }
+    const Scalar *pos = &positions[0];
+    const unsigned int *ele_vert_indices = &(this->element_vert_indices_[0]);
+    const Scalar *gradients = &(this->shape_function_gradients_[0]);
+    const Scalar *volumes = &(this->reference_element_volume_[0]);
+    Scalar *ele_vert_forces = &element_vert_forces_[0];
+    //for each batch of elements: deformation gradients, stresses of the runs of elements with the same material,
+    //then the forces on element vertices f_i = -V*P*gradN_i
+    int batch_num = static_cast<int>((ele_num + FEMSolidInternal::element_batch_size - 1)/FEMSolidInternal::element_batch_size);
+#pragma omp parallel for num_threads(thread_num_)
+    for(int batch_idx = 0; batch_idx < batch_num; ++batch_idx)
+    {
+        unsigned int batch_start = batch_idx*FEMSolidInternal::element_batch_size;
+        unsigned int batch_end = std::min(batch_start + FEMSolidInternal::element_batch_size,static_cast<unsigned int>(ele_num));
+        for(unsigned int ele_idx = batch_start; ele_idx < batch_end; ++ele_idx)
+        {
+            Scalar F[Dim][Dim] = {{0}};
+            for(unsigned int local_idx = 0; local_idx < Dim+1; ++local_idx)
+            {
+                const Scalar *vert_pos = pos + ele_vert_indices[ele_idx*(Dim+1)+local_idx]*Dim;
+                const Scalar *gradient = gradients + (ele_idx*(Dim+1)+local_idx)*Dim;
+                for(unsigned int row = 0; row < Dim; ++row)
+                    for(unsigned int col = 0; col < Dim; ++col)
+                        F[row][col] += vert_pos[row]*gradient[col];
+            }
+            SquareMatrix<Scalar,Dim> &deform_grad = element_deform_grad_[ele_idx];
+            for(unsigned int row = 0; row < Dim; ++row)
+                for(unsigned int col = 0; col < Dim; ++col)
+                    deform_grad(row,col) = F[row][col];
+        }
+        unsigned int run_start = batch_start;
+        while(run_start < batch_end)
+        {
+            const ConstitutiveModel<Scalar,Dim> *material = element_material_[run_start];
+            unsigned int run_end = run_start + 1;
+            while(run_end < batch_end && element_material_[run_end] == material)
+                ++run_end;
+            material->batchFirstPiolaKirchhoffStress(&element_deform_grad_[run_start],volumes+run_start,run_end-run_start,&element_stress_[run_start]);
+            run_start = run_end;
+        }
+        for(unsigned int ele_idx = batch_start; ele_idx < batch_end; ++ele_idx)
+        {
+            Scalar P[Dim][Dim];
+            const SquareMatrix<Scalar,Dim> &stress = element_stress_[ele_idx];
+            for(unsigned int row = 0; row < Dim; ++row)
+                for(unsigned int col = 0; col < Dim; ++col)
+                    P[row][col] = stress(row,col);
+            for(unsigned int local_idx = 0; local_idx < Dim+1; ++local_idx)
+            {
+                const Scalar *gradient = gradients + (ele_idx*(Dim+1)+local_idx)*Dim;
+                Scalar *force = ele_vert_forces + (ele_idx*(Dim+1)+local_idx)*Dim;
+                for(unsigned int row = 0; row < Dim; ++row)
+                {
+                    Scalar sum = 0;
+                    for(unsigned int col = 0; col < Dim; ++col)
+                        sum += P[row][col]*gradient[col];
+                    force[row] = -sum;
+                }
+            }
+        }
+    }
+    //gather the forces of incident elements to vertices
+    const unsigned int *vert_ele_offset = &vert_ele_offset_[0];
+    const unsigned int *vert_ele = vert_ele_.empty() ? NULL : &vert_ele_[0];
+    Scalar *vert_forces = &forces[0];
+#pragma omp parallel for num_threads(thread_num_)
+    for(int vert_idx = 0; vert_idx < vert_num; ++vert_idx)
+    {
+        Scalar force[Dim] = {0};
+        for(unsigned int i = vert_ele_offset[vert_idx]; i < vert_ele_offset[vert_idx+1]; ++i)
+        {
+            const Scalar *ele_vert_force = ele_vert_forces + vert_ele[i]*Dim;
+            for(unsigned int dim = 0; dim < Dim; ++dim)
+                force[dim] += ele_vert_force[dim];
+        }
+        for(unsigned int dim = 0; dim < Dim; ++dim)
+            vert_forces[vert_idx*Dim+dim] = force[dim];
+    }
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::assembleSystemMatrix(Scalar dt)
+{
+    const unsigned int ele_dof_num = (Dim+1)*Dim;
+    int ele_num = static_cast<int>(this->numSimElements());
+    int vert_num = static_cast<int>(this->numSimVertices());
+    const unsigned int *ele_vert_indices = ele_num > 0 ? &(this->element_vert_indices_[0]) : NULL;
+    const Scalar *gradients = ele_num > 0 ? &(this->shape_function_gradients_[0]) : NULL;
+    Scalar *ele_stiffness = element_stiffness_.empty() ? NULL : &element_stiffness_[0];
+    Scalar dt_square = dt*dt;
+    //K = -df/dx of the element: K(a*Dim+i,b*Dim+j) = V*sum_{k,l} C(i,k,j,l)*gradN_a(k)*gradN_b(l),
+    //where C(i,k,j,l) = dP(F;e_j*e_l^T)(i,k) takes Dim*Dim stress differentials by linearity
+#pragma omp parallel for num_threads(thread_num_)
+    for(int ele_idx = 0; ele_idx < ele_num; ++ele_idx)
+    {
+        const ConstitutiveModel<Scalar,Dim> *material = element_material_[ele_idx];
+        const SquareMatrix<Scalar,Dim> &deform_grad = element_deform_grad_[ele_idx];
+        const Scalar *ele_gradients = gradients + ele_idx*ele_dof_num;
+        Scalar C[Dim][Dim][Dim][Dim];
+        for(unsigned int j = 0; j < Dim; ++j)
+            for(unsigned int l = 0; l < Dim; ++l)
+            {
+                SquareMatrix<Scalar,Dim> deform_grad_differential(0);
+                deform_grad_differential(j,l) = 1;
+                SquareMatrix<Scalar,Dim> stress_differential = material->firstPiolaKirchhoffStressDifferential(deform_grad,deform_grad_differential);
+                for(unsigned int i = 0; i < Dim; ++i)
+                    for(unsigned int k = 0; k < Dim; ++k)
+                        C[i][k][j][l] = stress_differential(i,k);
+            }
+        //G(i,j,l) = sum_k C(i,k,j,l)*gradN_a(k) for each vertex a, then contract with gradN_b
+        Scalar scale = dt_square*(this->reference_element_volume_[ele_idx]);
+        Scalar *stiffness = ele_stiffness + static_cast<size_t>(ele_idx)*ele_dof_num*ele_dof_num;
+        for(unsigned int a = 0; a < Dim+1; ++a)
+        {
+            Scalar G[Dim][Dim][Dim];
+            for(unsigned int i = 0; i < Dim; ++i)
+                for(unsigned int j = 0; j < Dim; ++j)
+                    for(unsigned int l = 0; l < Dim; ++l)
+                    {
+                        Scalar sum = 0;
+                        for(unsigned int k = 0; k < Dim; ++k)
+                            sum += C[i][k][j][l]*ele_gradients[a*Dim+k];
+                        G[i][j][l] = scale*sum;
+                    }
+            for(unsigned int i = 0; i < Dim; ++i)
+                for(unsigned int b = 0; b < Dim+1; ++b)
+                    for(unsigned int j = 0; j < Dim; ++j)
+                    {
+                        Scalar sum = 0;
+                        for(unsigned int l = 0; l < Dim; ++l)
+                            sum += G[i][j][l]*ele_gradients[b*Dim+l];
+                        stiffness[(a*Dim+i)*ele_dof_num+b*Dim+j] = sum;
+                    }
+        }
+    }
+    //each row gathers the element matrices of incident elements, lumped mass on the diagonal, identity at fixed vertices
+    const unsigned int *row_offsets = &(system_matrix_.rowOffsets()[0]);
+    const unsigned int *vert_ele_offset = &vert_ele_offset_[0];
+    const unsigned int *vert_ele = vert_ele_.empty() ? NULL : &vert_ele_[0];
+    const unsigned int *block_cols = element_block_col_.empty() ? NULL : &element_block_col_[0];
+    Scalar *values = &(system_matrix_.values()[0]);
+#pragma omp parallel for num_threads(thread_num_)
+    for(int vert_idx = 0; vert_idx < vert_num; ++vert_idx)
+    {
+        for(unsigned int i = row_offsets[vert_idx*Dim]; i < row_offsets[(vert_idx+1)*Dim]; ++i)
+            values[i] = 0;
+        unsigned int diag_block_col = vertex_diag_block_col_[vert_idx];
+        if(isFixedVertex(vert_idx))
+        {
+            for(unsigned int i = 0; i < Dim; ++i)
+                values[row_offsets[vert_idx*Dim+i]+diag_block_col*Dim+i] = 1;
+            continue;
+        }
+        for(unsigned int n = vert_ele_offset[vert_idx]; n < vert_ele_offset[vert_idx+1]; ++n)
+        {
+            unsigned int ele_idx = vert_ele[n]/(Dim+1), a = vert_ele[n]%(Dim+1);
+            const Scalar *stiffness = ele_stiffness + static_cast<size_t>(ele_idx)*ele_dof_num*ele_dof_num;
+            for(unsigned int b = 0; b < Dim+1; ++b)
+            {
+                if(isFixedVertex(ele_vert_indices[ele_idx*(Dim+1)+b]))
+                    continue;
+                unsigned int block_col = block_cols[vert_ele[n]*(Dim+1)+b];
+                for(unsigned int i = 0; i < Dim; ++i)
+                {
+                    Scalar *row_values = values + row_offsets[vert_idx*Dim+i] + block_col*Dim;
+                    const Scalar *ele_row = stiffness + (a*Dim+i)*ele_dof_num + b*Dim;
+                    for(unsigned int j = 0; j < Dim; ++j)
+                        row_values[j] += ele_row[j];
+                }
+            }
+        }
+        for(unsigned int i = 0; i < Dim; ++i)
+            values[row_offsets[vert_idx*Dim+i]+diag_block_col*Dim+i] += vertex_mass_[vert_idx];
+    }
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::advanceStepForwardEuler(Scalar dt)
+{
+    //symplectic Euler: v^{n+1} = v^n + dt*(f(x^n)/m + g), x^{n+1} = x^n + dt*v^{n+1}
+    computeElasticForces(vertex_pos_,vertex_force_);
+    int vert_num = static_cast<int>(this->numSimVertices());
+    Scalar gravity = this->gravity_;
+#pragma omp parallel for num_threads(thread_num_)
+    for(int vert_idx = 0; vert_idx < vert_num; ++vert_idx)
+    {
+        if(!isFixedVertex(vert_idx))
+        {
+            Scalar inv_mass = 1/vertex_mass_[vert_idx];
+            for(unsigned int dim = 0; dim < Dim; ++dim)
+                vertex_vel_[vert_idx*Dim+dim] += dt*inv_mass*vertex_force_[vert_idx*Dim+dim];
+            vertex_vel_[vert_idx*Dim+1] -= dt*gravity;
+        }
+        for(unsigned int dim = 0; dim < Dim; ++dim)
+            vertex_pos_[vert_idx*Dim+dim] += dt*vertex_vel_[vert_idx*Dim+dim];
+    }
+}
+
+template <typename Scalar, int Dim>
+void FEMSolid<Scalar,Dim>::advanceStepBackwardEuler(Scalar dt)
+{
+    //backward Euler in velocity: r(v) = M*(v - v^n) - dt*(f(x^n + dt*v) + M*g) = 0
+    //Newton iteration: (M + dt^2*K)*dv = -r, with K = -df/dx
+    unsigned int dof_num = this->numSimVertices()*Dim;
+    if(dof_num == 0)
+        return;
+    std::vector<Scalar> old_velocities(vertex_vel_), newton_velocities(dof_num), positions(dof_num);
+    VectorND<Scalar> residual(dof_num,0), velocity_change(dof_num,0);
+    Scalar residual_norm = backwardEulerResidual(dt,old_velocities,positions,residual);
+    Scalar initial_residual_norm = residual_norm;
+    for(unsigned int newton_iter = 0; newton_iter < max_newton_iteration_num_; ++newton_iter)
+    {
+        if(residual_norm == 0 || (newton_iter > 0 && residual_norm <= newton_tolerance_*initial_residual_norm))
+            break;
+        IterativeSolverInternal::scale(static_cast<Scalar>(-1),residual,thread_num_);
+        assembleSystemMatrix(dt);
+        linear_solver_.compute(system_matrix_);
+        bool converged = linear_solver_.solve(residual,velocity_change);
+        newton_velocities = vertex_vel_;
+        //an unconverged solution is halved until it reduces the residual, the Newton iteration stops if it never does
+        Scalar step = 1;
+        Scalar new_residual_norm = 0;
+        for(unsigned int halving = 0; ; ++halving)
+        {
+            const Scalar *velocity_change_data = &velocity_change[0];
+#pragma omp parallel for num_threads(thread_num_)
+            for(int i = 0; i < static_cast<int>(dof_num); ++i)
+                vertex_vel_[i] = newton_velocities[i] + step*velocity_change_data[i];
+            new_residual_norm = backwardEulerResidual(dt,old_velocities,positions,residual);
+            if(converged || new_residual_norm < residual_norm || halving == FEMSolidInternal::max_step_halving_num)
+                break;
+            step /= 2;
+        }
+        if(converged)
+        {
+            residual_norm = new_residual_norm;
+            continue;
+        }
+        if(new_residual_norm < residual_norm)
+        {
+            std::cerr<<"Warning: linear solve not converged in Newton iteration "<<newton_iter<<" of backward Euler (relative residual "
+                     <<linear_solver_.residual()<<"), solution scaled by "<<step<<" is used!\n";
+            residual_norm = new_residual_norm;
+            continue;
+        }
+        std::cerr<<"Warning: linear solve failed in Newton iteration "<<newton_iter<<" of backward Euler (relative residual "
+                 <<linear_solver_.residual()<<"), Newton iteration stopped!\n";
+        vertex_vel_ = newton_velocities;
+        break;
+    }
+#pragma omp parallel for num_threads(thread_num_)
+    for(int i = 0; i < static_cast<int>(dof_num); ++i)
+        vertex_pos_[i] += dt*vertex_vel_[i];
+}
+
+template <typename Scalar, int Dim>
+Scalar FEMSolid<Scalar,Dim>::backwardEulerResidual(Scalar dt, const std::vector<Scalar> &old_velocities, std::vector<Scalar> &positions, VectorND<Scalar> &residual)
+{
+    int vert_num = static_cast<int>(this->numSimVertices());
+    unsigned int dof_num = vert_num*Dim;
+#pragma omp parallel for num_threads(thread_num_)
+    for(int i = 0; i < static_cast<int>(dof_num); ++i)
+        positions[i] = vertex_pos_[i] + dt*vertex_vel_[i];
+    computeElasticForces(positions,vertex_force_);
+    Scalar *residual_data = &residual[0];
+    Scalar gravity = this->gravity_;
+#pragma omp parallel for num_threads(thread_num_)
+    for(int vert_idx = 0; vert_idx < vert_num; ++vert_idx)
+    {
+        Scalar mass = vertex_mass_[vert_idx];
+        bool fixed = isFixedVertex(vert_idx);
+        for(unsigned int dim = 0; dim < Dim; ++dim)
+        {
+            unsigned int i = vert_idx*Dim+dim;
+            Scalar external_force = dim == 1 ? -mass*gravity : 0;
+            residual_data[i] = fixed ? 0 : mass*(vertex_vel_[i]-old_velocities[i]) - dt*(vertex_force_[i]+external_force);
+        }
+    }
+    return std::sqrt(IterativeSolverInternal::dot(residual,residual,thread_num_));
+}
+
+template <typename Scalar, int Dim>
+bool FEMSolid<Scalar,Dim>::isFixedVertex(unsigned int vert_idx) const
+{
+    return is_dirichlet_vertex_[vert_idx] || vertex_mass_[vert_idx] == 0;
+}
+
+template <typename Scalar, int Dim>
+Scalar FEMSolid<Scalar,Dim>::maxPressureWaveSpeed() const
+{
+    //the P-wave modulus is lambda+2*mu for isotropic materials, i.e., dP(I;e_0*e_0^T)(0,0)
+    SquareMatrix<Scalar,Dim> identity = SquareMatrix<Scalar,Dim>::identityMatrix();
+    SquareMatrix<Scalar,Dim> deform_grad_differential(0);
+    deform_grad_differential(0,0) = 1;
+    Scalar max_modulus = 0;
+    for(unsigned int i = 0; i < constitutive_model_.size(); ++i)
+    {
+        Scalar modulus = constitutive_model_[i]->firstPiolaKirchhoffStressDifferential(identity,deform_grad_differential)(0,0);
+        max_modulus = modulus > max_modulus ? modulus : max_modulus;
+    }
+    return std::sqrt(max_modulus/density_);
+}
+
+template <typename Scalar, int Dim>
+Scalar FEMSolid<Scalar,Dim>::maxVertexVelocityNorm() const
+{
+    Scalar max_norm_sqr = 0;
+    for(unsigned int i = 0; i < this->vertex_velocities_.size(); ++i)
+    {
+        Scalar norm_sqr = (this->vertex_velocities_[i]).normSquared();
+        max_norm_sqr = norm_sqr > max_norm_sqr ? norm_sqr : max_norm_sqr;
+    }
+    return std::sqrt(max_norm_sqr);
+}
+
 //explicit instantiations
 template class FEMSolid<float,2>;
 template class FEMSolid<double,2>;
@@ -17,6 +17,8 @@
 
 #include <vector>
 #include <string>
+#include "Physika_Core/Matrices/csr_matrix.h"
+#include "Physika_Core/Linear_Solvers/conjugate_gradient_solver.h"
 #include "Physika_Dynamics/FEM/fem_base.h"
 
 namespace Physika{
@@ -31,6 +33,23 @@ template <typename Scalar, int Dim> class ConstitutiveModel;
  *    case the number of constitutive models equals the number of regions of the simulation mesh.
  * 3. Element-wise consitutive model is used.
  *
+ * Simulation meshes of simplex elements (TRI in 2D, TET in 3D) are supported. The mass is lumped to the
+ * vertices with uniform density. Two time integration methods are provided:
+ * 1. FORWARD_EULER: explicit symplectic Euler, the velocity is updated with the forces at the beginning of
+ *    the step and the positions are updated with the new velocity. The time step is limited by the CFL
+ *    condition with the speed of the pressure wave in the stiffest material.
+ * 2. BACKWARD_EULER: implicit backward Euler, the nonlinear system of the new velocity is solved with Newton
+ *    iterations, each linearized system (M + dt^2*K)*dv = -r is solved with preconditioned conjugate gradient.
+ *    If the solve doesn't converge, dv is halved until it reduces the residual, otherwise the Newton iteration stops.
+ *    The time step only requires that the vertices do not travel beyond the CFL number of the element size.
+ * The elastic forces are computed in parallel over elements and gathered to the vertices through the
+ * precomputed vertex-element incidence, which needs no locking and gives results independent of the thread number.
+ * The stiffness matrix is assembled the same way: the element matrices are computed in parallel, then each row of
+ * the matrix gathers them into a CSRMatrix whose pattern and entry positions are precomputed.
+ *
+ * Vertices can be set as Dirichlet boundary condition, their velocities are prescribed.
+ * initSimulationData() must be called after the simulation mesh and materials are set, it's called in run()
+ * and in advanceStep() if the data is out of date.
  */
 
 template <typename Scalar, int Dim>
@@ -61,11 +80,80 @@ public:
     void setElementWiseMaterial(const std::vector<ConstitutiveModel<Scalar,Dim>*> &materials);  //the number of materials must be no less than the number of simulation elements
     const ConstitutiveModel<Scalar,Dim>* elementMaterial(unsigned int ele_idx) const;  //return the material of specific simulation element, return NULL if not set
     ConstitutiveModel<Scalar,Dim>* elementMaterial(unsigned int ele_idx);
+
+    //simulation parameters
+    Scalar density() const;
+    void setDensity(Scalar density); //uniform density of the solid, the vertex masses are updated in initSimulationData()
+    Scalar cflConstant() const;
+    void setCFLConstant(Scalar cfl);
+    unsigned int threadNum() const;
+    void setThreadNum(unsigned int thread_num); //number of threads used in parallel loops, default is the number of processors
+    unsigned int maxNewtonIterationNum() const;
+    void setMaxNewtonIterationNum(unsigned int iteration_num); //number of Newton iterations per step of BACKWARD_EULER at most
+    Scalar newtonTolerance() const;
+    void setNewtonTolerance(Scalar tolerance); //Newton iterations stop if the residual is reduced by this factor
+    ConjugateGradientSolver<Scalar>& linearSolver(); //solver of the linearized systems in BACKWARD_EULER, for settings and statistics
+    const ConjugateGradientSolver<Scalar>& linearSolver() const;
+    Scalar vertexMass(unsigned int vert_idx) const; //lumped mass of vertex, valid after initSimulationData()
+
+    //vertices used as Dirichlet boundary condition, velocity is prescribed
+    void addDirichletVertex(unsigned int vert_idx);
+    void addDirichletVertices(const std::vector<unsigned int> &vert_idx);
+    void clearDirichletVertices();
+    bool isDirichletVertex(unsigned int vert_idx) const;
+
+    //different time integration methods
+    enum IntegrationMethod{
+        FORWARD_EULER,
+        BACKWARD_EULER
+    };
+    void setTimeIntegrationMethod(const IntegrationMethod &method);
+    IntegrationMethod timeIntegrationMethod() const;
 protected:
     void clearMaterial(); //clear current material
     void addMaterial(const ConstitutiveModel<Scalar,Dim> &material);
+    void initLinearSolver(); //default settings of the linear solver, called in constructors
+    bool isSimulationDataOutOfDate() const;
+    //substeps in one time step, positions and velocities are flat arrays of Dim entries per vertex
+    void computeElasticForces(const std::vector<Scalar> &positions, std::vector<Scalar> &forces); //the deformation gradients are updated as well
+    void assembleSystemMatrix(Scalar dt); //system_matrix_ = M + dt^2*K at current deformation gradients, identity at fixed vertices
+    void advanceStepForwardEuler(Scalar dt);
+    void advanceStepBackwardEuler(Scalar dt);
+    //residual of backward Euler at current velocities, positions are set to the end-of-step positions; return the norm
+    Scalar backwardEulerResidual(Scalar dt, const std::vector<Scalar> &old_velocities, std::vector<Scalar> &positions, VectorND<Scalar> &residual);
+    bool isFixedVertex(unsigned int vert_idx) const; //Dirichlet vertices and vertices without mass are not integrated
+    Scalar maxPressureWaveSpeed() const;
+    Scalar maxVertexVelocityNorm() const;
 protected:
     std::vector<ConstitutiveModel<Scalar,Dim> *> constitutive_model_;
+    IntegrationMethod integration_method_;
+    Scalar density_;
+    Scalar cfl_num_;
+    unsigned int thread_num_;
+    unsigned int max_newton_iteration_num_;
+    Scalar newton_tolerance_;
+    ConjugateGradientSolver<Scalar> linear_solver_;
+    std::vector<unsigned char> is_dirichlet_vertex_; //one byte per vertex to indicate whether it's set as Dirichlet boundary condition
+    //precomputed in initSimulationData()
+    std::vector<Scalar> vertex_mass_; //lumped mass of vertices
+    std::vector<Scalar> vertex_rest_pos_; //Dim entries per vertex
+    std::vector<unsigned int> vert_ele_offset_; //the incident elements of vertex i are vert_ele_[vert_ele_offset_[i]:vert_ele_offset_[i+1]]
+    std::vector<unsigned int> vert_ele_; //incident element stored as ele_idx*(Dim+1)+local_vert_idx
+    std::vector<const ConstitutiveModel<Scalar,Dim>*> element_material_;
+    Scalar min_element_height_; //minimum height of the elements, for dt computation
+    //pattern of the system matrix: the entries of vertex pair (i,j) are a Dim x Dim block, the blocks of row i are ordered by j
+    CSRMatrix<Scalar> system_matrix_;
+    std::vector<unsigned int> element_block_col_; //(Dim+1)^2 per element, index of the block of vertex pair (a,b) in the block row of a
+    std::vector<unsigned int> vertex_diag_block_col_; //index of the diagonal block in the block row of each vertex
+    //data of elements updated in each step
+    std::vector<SquareMatrix<Scalar,Dim> > element_deform_grad_;
+    std::vector<SquareMatrix<Scalar,Dim> > element_stress_; //first Piola-Kirchhoff stress scaled by rest volume
+    std::vector<Scalar> element_vert_forces_; //(Dim+1)*Dim per element, elastic forces on the element vertices
+    std::vector<Scalar> element_stiffness_; //((Dim+1)*Dim)^2 per element, -dt^2*df/dx of the element in row-major order
+    //data of vertices in time step, Dim entries per vertex
+    std::vector<Scalar> vertex_pos_;
+    std::vector<Scalar> vertex_vel_;
+    std::vector<Scalar> vertex_force_;
 };
 
 }  //end of namespace Physika
@@ -17,20 +17,129 @@
  */
 
 #include <limits>
-#include <map>
 #include "Physika_Core/Arrays/array_Nd.h"
 #include "Physika_Core/Grid_Weight_Functions/grid_weight_function.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_linear_weight_functions.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_quadratic_weight_functions.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_cubic_weight_functions.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_weight_function_kernel.h"
 #include "Physika_Core/Utilities/physika_assert.h"
 #include "Physika_Core/Utilities/math_utilities.h"
+#include "Physika_Core/Utilities/parallel_utilities.h"
 #include "Physika_Geometry/Cartesian_Grids/grid.h"
 #include "Physika_Geometry/Volumetric_Meshes/volumetric_mesh.h"
 #include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
+#include "Physika_Dynamics/MPM/mpm_particle_grid_stencil.h"
 #include "Physika_Dynamics/MPM/Weight_Function_Influence_Iterators/uniform_grid_weight_function_influence_iterator.h"
 #include "Physika_Dynamics/MPM/CPDI_mpm_solid.h"
 #include "Physika_Dynamics/MPM/CPDI_Update_Methods/CPDI2_update_method.h"
 
 namespace Physika{
 
+namespace CPDI2UpdateMethodInternal{
+
+//merge the nodes of current corner into the nodes of the particle, both sorted by flat node index
+//the values are summed for common nodes
+template <typename Scalar, int Dim>
+void mergeCornerNodesToParticleNodes(ParticleWeightScratch<Scalar,Dim> &scratch)
+{
+    const std::vector<NodeWeightGradientEntry<Scalar,Dim> > &particle_nodes = scratch.particle_nodes_;
+    const std::vector<NodeWeightGradientEntry<Scalar,Dim> > &corner_nodes = scratch.corner_nodes_;
+    std::vector<NodeWeightGradientEntry<Scalar,Dim> > &merged_nodes = scratch.merge_buffer_;
+    merged_nodes.clear();
+    unsigned int i = 0, j = 0;
+    while(i < particle_nodes.size() && j < corner_nodes.size())
+    {
+        if(particle_nodes[i].node_idx_1d_ < corner_nodes[j].node_idx_1d_)
+            merged_nodes.push_back(particle_nodes[i++]);
+        else if(corner_nodes[j].node_idx_1d_ < particle_nodes[i].node_idx_1d_)
+            merged_nodes.push_back(corner_nodes[j++]);
+        else
+        {
+            merged_nodes.push_back(particle_nodes[i++]);
+            merged_nodes.back().weight_value_ += corner_nodes[j].weight_value_;
+            merged_nodes.back().gradient_value_ += corner_nodes[j].gradient_value_;
+            ++j;
+        }
+    }
+    merged_nodes.insert(merged_nodes.end(),particle_nodes.begin()+i,particle_nodes.end());
+    merged_nodes.insert(merged_nodes.end(),corner_nodes.begin()+j,corner_nodes.end());
+    scratch.particle_nodes_.swap(scratch.merge_buffer_);
+}
+
+//store the particle nodes as the particle-grid pairs, nodes that have zero weight value are ignored, assume positive weight
+template <typename Scalar, int Dim>
+void storeParticleNodes(const std::vector<NodeWeightGradientEntry<Scalar,Dim> > &particle_nodes,
+                        std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > &particle_grid_weight_and_gradient,
+                        unsigned int &particle_grid_pair_num)
+{
+    particle_grid_pair_num = 0;
+    for(unsigned int i = 0; i < particle_nodes.size(); ++i)
+    {
+        if(particle_nodes[i].weight_value_ > std::numeric_limits<Scalar>::epsilon())
+        {
+            particle_grid_weight_and_gradient[particle_grid_pair_num].node_idx_ = particle_nodes[i].node_idx_;
+            particle_grid_weight_and_gradient[particle_grid_pair_num].weight_value_ = particle_nodes[i].weight_value_;
+            particle_grid_weight_and_gradient[particle_grid_pair_num].gradient_value_ = particle_nodes[i].gradient_value_;
+            ++particle_grid_pair_num;
+        }
+    }
+}
+
+//the 1D factors of the weight function at a domain corner, for all grid nodes in the influence range of the corner
+//the weight of a node is the product of its factors along each dimension
+template <typename Scalar, int Dim>
+struct CornerAxisWeights
+{
+    static const unsigned int MAX_AXIS_NODE_NUM = MPMParticleGridStencil<Scalar,Dim>::MAX_AXIS_NODE_NUM;
+    Vector<unsigned int,Dim> min_node_idx_;
+    Scalar weights_[Dim*MAX_AXIS_NODE_NUM];
+    Scalar gradients_[Dim*MAX_AXIS_NODE_NUM];
+    inline Scalar weight(const Vector<unsigned int,Dim> &node_idx) const
+    {
+        Scalar weight = 1;
+        for(unsigned int dim = 0; dim < Dim; ++dim)
+            weight *= weights_[dim*MAX_AXIS_NODE_NUM+node_idx[dim]-min_node_idx_[dim]];
+        return weight;
+    }
+};
+
+//evaluate the factors of all nodes in range of iter at once, instead of one virtual weight() call for each node
+//dispatch on the type of the weight function in the same way as MPMSolid::updateParticleInterpolationWeight()
+template <typename Scalar, int Dim>
+void evaluateCornerAxisWeights(const Grid<Scalar,Dim> &grid, const Vector<Scalar,Dim> &corner,
+                               const UniformGridWeightFunctionInfluenceIterator<Scalar,Dim> &iter,
+                               const GridWeightFunction<Scalar,Dim> &weight_function,
+                               CornerAxisWeights<Scalar,Dim> &axis_weights)
+{
+    const Vector<unsigned int,Dim> &axis_node_num = iter.nodeNum();
+    axis_weights.min_node_idx_ = iter.minNodeIndex();
+    Vector<Scalar,Dim> grid_dx = grid.dX();
+    Vector<Scalar,Dim> grid_min_corner = grid.minCorner();
+    unsigned int stride = CornerAxisWeights<Scalar,Dim>::MAX_AXIS_NODE_NUM;
+    Vector<Scalar,Dim> corner_to_first_node;
+    for(unsigned int dim = 0; dim < Dim; ++dim)
+    {
+        PHYSIKA_ASSERT(axis_node_num[dim] <= stride);
+        corner_to_first_node[dim] = (corner[dim] - grid_min_corner[dim])/grid_dx[dim] - axis_weights.min_node_idx_[dim];
+    }
+    if(GridWeightFunctionKernel<GridLinearWeightFunction<Scalar,Dim> >::isOfType(weight_function))
+        GridWeightFunctionKernel<GridLinearWeightFunction<Scalar,Dim> >::axisWeightsAndGradients(weight_function,corner_to_first_node,axis_node_num,stride,
+                                                                                                  axis_weights.weights_,axis_weights.gradients_);
+    else if(GridWeightFunctionKernel<GridQuadraticBSpline<Scalar,Dim> >::isOfType(weight_function))
+        GridWeightFunctionKernel<GridQuadraticBSpline<Scalar,Dim> >::axisWeightsAndGradients(weight_function,corner_to_first_node,axis_node_num,stride,
+                                                                                              axis_weights.weights_,axis_weights.gradients_);
+    else if(GridWeightFunctionKernel<GridPiecewiseCubicSpline<Scalar,Dim> >::isOfType(weight_function))
+        GridWeightFunctionKernel<GridPiecewiseCubicSpline<Scalar,Dim> >::axisWeightsAndGradients(weight_function,corner_to_first_node,axis_node_num,stride,
+                                                                                                  axis_weights.weights_,axis_weights.gradients_);
+    else
+        GridWeightFunctionKernel<GridWeightFunction<Scalar,Dim> >::axisWeightsAndGradients(weight_function,corner_to_first_node,axis_node_num,stride,
+                                                                                            axis_weights.weights_,axis_weights.gradients_);
+}
+
+}  //end of namespace CPDI2UpdateMethodInternal
+
 template <typename Scalar>
 CPDI2UpdateMethod<Scalar,2>::CPDI2UpdateMethod()
     :CPDIUpdateMethod<Scalar,2>()
@@ -51,10 +160,17 @@ void CPDI2UpdateMethod<Scalar,2>::updateParticleInterpolationWeight(const GridWe
                                   bool gradient_to_reference_coordinate)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
+    int thread_num = static_cast<int>(this->cpdi_driver_->threadNum());
+    if(thread_scratch_.size() < static_cast<unsigned int>(thread_num))
+        thread_scratch_.resize(thread_num);
     for(unsigned int i = 0; i < this->cpdi_driver_->objectNum(); ++i)
-        for(unsigned int j = 0; j < this->cpdi_driver_->particleNumOfObject(i); ++j)
+    {
+        int particle_num = static_cast<int>(this->cpdi_driver_->particleData(i).particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int j = 0; j < particle_num; ++j)
             updateParticleInterpolationWeight(i,j,weight_function,particle_grid_weight_and_gradient[i][j],particle_grid_pair_num[i][j],
                                               corner_grid_weight[i][j],corner_grid_pair_num[i][j],gradient_to_reference_coordinate);
+    }
 }
 
 template <typename Scalar>
@@ -68,12 +184,19 @@ void CPDI2UpdateMethod<Scalar,2>::updateParticleInterpolationWeightWithEnrichmen
                                   bool gradient_to_reference_coordinate)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
+    int thread_num = static_cast<int>(this->cpdi_driver_->threadNum());
+    if(thread_scratch_.size() < static_cast<unsigned int>(thread_num))
+        thread_scratch_.resize(thread_num);
     for(unsigned int i = 0; i < this->cpdi_driver_->objectNum(); ++i)
-        for(unsigned int j = 0; j < this->cpdi_driver_->particleNumOfObject(i); ++j)
+    {
+        int particle_num = static_cast<int>(this->cpdi_driver_->particleData(i).particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int j = 0; j < particle_num; ++j)
             updateParticleInterpolationWeightWithEnrichment(i,j,weight_function,particle_domain_mesh[i],is_enriched_domain_corner[i],
                                                              particle_grid_weight_and_gradient[i][j],particle_grid_pair_num[i][j],
                                                              corner_grid_weight[i][j],corner_grid_pair_num[i][j],
                                                              gradient_to_reference_coordinate);
+    }
 }
 
 template <typename Scalar>
@@ -85,8 +208,8 @@ void CPDI2UpdateMethod<Scalar,2>::updateParticleDomain(
     ArrayND<Vector<Scalar,2>,2> particle_domain;
     for(unsigned int obj_idx = 0; obj_idx < this->cpdi_driver_->objectNum(); ++obj_idx)
     {
-        const std::vector<SolidParticle<Scalar,2>*> &particles = this->cpdi_driver_->allParticlesOfObject(obj_idx);
-        for(unsigned int particle_idx = 0; particle_idx < particles.size(); ++particle_idx)
+        unsigned int particle_num = this->cpdi_driver_->particleData(obj_idx).particleNum();
+        for(unsigned int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
         {
             this->cpdi_driver_->currentParticleDomain(obj_idx,particle_idx,particle_domain);
             unsigned int corner_idx = 0;
@@ -110,20 +233,22 @@ template <typename Scalar>
 void CPDI2UpdateMethod<Scalar,2>::updateParticlePosition(Scalar dt, const std::vector<std::vector<unsigned char> > &is_dirichlet_particle)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
-    ArrayND<Vector<Scalar,2>,2> particle_domain;
-    std::vector<Vector<Scalar,2> > particle_domain_vec(4);
-    std::vector<Scalar> particle_corner_weight(4);
+    int thread_num = static_cast<int>(this->cpdi_driver_->threadNum());
     for(unsigned int obj_idx = 0; obj_idx < this->cpdi_driver_->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->cpdi_driver_->particleNumOfObject(obj_idx); ++particle_idx)
+        SolidParticleData<Scalar,2> &particle_data = this->cpdi_driver_->particleData(obj_idx);
+        int particle_num = static_cast<int>(particle_data.particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
         {
-            SolidParticle<Scalar,2> &particle = this->cpdi_driver_->particle(obj_idx,particle_idx);
             if(is_dirichlet_particle[obj_idx][particle_idx])  //update dirichlet particle's position with prescribed velocity
             {
-                Vector<Scalar,2> new_pos = particle.position() + particle.velocity()*dt;
-                particle.setPosition(new_pos);
+                particle_data.position(particle_idx) += particle_data.velocity(particle_idx)*dt;
                 continue;
             }
+            ArrayND<Vector<Scalar,2>,2> particle_domain;
+            std::vector<Vector<Scalar,2> > particle_domain_vec(4);
+            std::vector<Scalar> particle_corner_weight(4);
             computeParticleInterpolationWeightInParticleDomain(obj_idx,particle_idx,particle_corner_weight);
             this->cpdi_driver_->currentParticleDomain(obj_idx,particle_idx,particle_domain);
             unsigned int i = 0;
@@ -132,7 +257,7 @@ void CPDI2UpdateMethod<Scalar,2>::updateParticlePosition(Scalar dt, const std::v
             Vector<Scalar,2> new_pos(0);
             for(unsigned int flat_corner_idx = 0; flat_corner_idx < 4; ++flat_corner_idx)
                 new_pos += particle_corner_weight[flat_corner_idx]*particle_domain_vec[flat_corner_idx];
-            particle.setPosition(new_pos);
+            particle_data.position(particle_idx) = new_pos;
         }
     }    
 }
@@ -303,132 +428,58 @@ void CPDI2UpdateMethod<Scalar,2>::updateParticleInterpolationWeight(unsigned int
                                   bool gradient_to_reference_coordinate)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
-    ArrayND<Vector<Scalar,2>,2> particle_domain, initial_particle_domain;
-    this->cpdi_driver_->currentParticleDomain(object_idx,particle_idx,particle_domain);
-    this->cpdi_driver_->initialParticleDomain(object_idx,particle_idx,initial_particle_domain);
-    std::vector<Vector<Scalar,2> > particle_domain_vec(4), initial_particle_domain_vec(4);
-    unsigned int i = 0;
-    for(typename ArrayND<Vector<Scalar,2>,2>::Iterator corner_iter = particle_domain.begin(); corner_iter != particle_domain.end(); ++corner_iter,++i)
-        particle_domain_vec[i] = *corner_iter;
-    i = 0;
-    for(typename ArrayND<Vector<Scalar,2>,2>::Iterator corner_iter = initial_particle_domain.begin(); corner_iter != initial_particle_domain.end(); ++corner_iter,++i)
-        initial_particle_domain_vec[i] = *corner_iter;
-    std::map<unsigned int,Scalar> idx_weight_map;
-    std::map<unsigned int,Vector<Scalar,2> > idx_gradient_map;
+    CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,2> &scratch = loadParticleDomainToScratch(object_idx,particle_idx);
+    const ArrayND<Vector<Scalar,2>,2> &particle_domain = scratch.particle_domain_, &initial_particle_domain = scratch.initial_particle_domain_;
     const Grid<Scalar,2> &grid = this->cpdi_driver_->grid();
-    Vector<Scalar,2> grid_dx = grid.dX();
+    Vector<unsigned int,2> grid_node_num = grid.nodeNum();
     //coefficients
-    Scalar a = (initial_particle_domain_vec[2]-initial_particle_domain_vec[0]).cross(initial_particle_domain_vec[1]-initial_particle_domain_vec[0]);
-    Scalar b = (initial_particle_domain_vec[2]-initial_particle_domain_vec[0]).cross(initial_particle_domain_vec[3]-initial_particle_domain_vec[1]);
-    Scalar c = (initial_particle_domain_vec[3]-initial_particle_domain_vec[2]).cross(initial_particle_domain_vec[1]-initial_particle_domain_vec[0]);
+    Vector<Scalar,2> initial_corner_0 = initial_particle_domain(Vector<unsigned int,2>(0,0)), initial_corner_1 = initial_particle_domain(Vector<unsigned int,2>(0,1)),
+                     initial_corner_2 = initial_particle_domain(Vector<unsigned int,2>(1,0)), initial_corner_3 = initial_particle_domain(Vector<unsigned int,2>(1,1));
+    Scalar a = (initial_corner_2-initial_corner_0).cross(initial_corner_1-initial_corner_0);
+    Scalar b = (initial_corner_2-initial_corner_0).cross(initial_corner_3-initial_corner_1);
+    Scalar c = (initial_corner_3-initial_corner_2).cross(initial_corner_1-initial_corner_0);
     Scalar domain_volume = a + 0.5*(b+c);
+    gaussIntegrateShapeFunctionInParticleDomain(scratch,gradient_to_reference_coordinate);
+    Scalar particle_corner_weight[4];
+    particle_corner_weight[0] = 1.0/(24.0*domain_volume)*(6.0*domain_volume-b-c);
+    particle_corner_weight[1] = 1.0/(24.0*domain_volume)*(6.0*domain_volume-b+c);
+    particle_corner_weight[2] = 1.0/(24.0*domain_volume)*(6.0*domain_volume+b-c);
+    particle_corner_weight[3] = 1.0/(24.0*domain_volume)*(6.0*domain_volume+b+c);
     typedef UniformGridWeightFunctionInfluenceIterator<Scalar,2> InfluenceIterator;
     //first compute the weight and gradient with respect to each grid node in the influence range of the particle
     //node weight and gradient with respect to domain corners are stored as well
-    for(unsigned int flat_corner_idx = 0; flat_corner_idx < particle_domain_vec.size(); ++flat_corner_idx)
+    scratch.particle_nodes_.clear();
+    CPDI2UpdateMethodInternal::NodeWeightGradientEntry<Scalar,2> node_entry;
+    CPDI2UpdateMethodInternal::CornerAxisWeights<Scalar,2> corner_axis_weights;
+    for(unsigned int flat_corner_idx = 0; flat_corner_idx < 4; ++flat_corner_idx)
     {
         corner_grid_pair_num[flat_corner_idx] = 0;
         unsigned int node_num = 0;
         Vector<unsigned int,2> corner_idx(flat_corner_idx/2,flat_corner_idx%2);
-        Vector<Scalar,2> gradient_integral;
-        if(gradient_to_reference_coordinate)
-            gradient_integral = gaussIntegrateShapeFunctionGradientToReferenceCoordinateInParticleDomain(corner_idx, initial_particle_domain);
-        else
-            gradient_integral = gaussIntegrateShapeFunctionGradientToCurrentCoordinateInParticleDomain(corner_idx, particle_domain, initial_particle_domain);
-        for(InfluenceIterator iter(grid,particle_domain_vec[flat_corner_idx],weight_function); iter.valid(); ++node_num,++iter)
+        const Vector<Scalar,2> &corner = particle_domain(corner_idx);
+        Vector<Scalar,2> particle_corner_gradient = 1.0/domain_volume*scratch.corner_gradient_integral_[flat_corner_idx];
+        scratch.corner_nodes_.clear();
+        InfluenceIterator iter(grid,corner,weight_function);
+        CPDI2UpdateMethodInternal::evaluateCornerAxisWeights(grid,corner,iter,weight_function,corner_axis_weights);
+        for(; iter.valid(); ++node_num,++iter)
         {
             Vector<unsigned int,2> node_idx = iter.nodeIndex();
-            unsigned int node_idx_1d = this->flatIndex(node_idx,grid.nodeNum());
-            Vector<Scalar,2> corner_to_node = particle_domain_vec[flat_corner_idx] - grid.node(node_idx);
-            for(unsigned int dim = 0; dim < 2; ++dim)
-                corner_to_node[dim] /= grid_dx[dim];
-            Scalar corner_weight = weight_function.weight(corner_to_node);
+            Scalar corner_weight = corner_axis_weights.weight(node_idx);
             //weight correspond to this node for domain corners
             corner_grid_weight[flat_corner_idx][node_num].node_idx_ = node_idx;
             corner_grid_weight[flat_corner_idx][node_num].weight_value_ = corner_weight;
             ++corner_grid_pair_num[flat_corner_idx];
             //weight and gradient correspond to this node for particles
-            typename std::map<unsigned int,Scalar>::iterator weight_map_iter = idx_weight_map.find(node_idx_1d);
-            switch(flat_corner_idx)
-            {
-            case 0:
-            {
-                if(weight_map_iter != idx_weight_map.end())
-                {
-                    weight_map_iter->second += 1.0/(24.0*domain_volume)*(6.0*domain_volume-b-c)*corner_weight;
-                    idx_gradient_map[node_idx_1d] += 1.0/domain_volume*gradient_integral*corner_weight;
-                }
-                else
-                {
-                    idx_weight_map.insert(std::make_pair(node_idx_1d,1.0/(24.0*domain_volume)*(6.0*domain_volume-b-c)*corner_weight));
-					Vector<Scalar,2> gradient = 1.0/domain_volume*gradient_integral*corner_weight;
-					idx_gradient_map.insert(std::make_pair(node_idx_1d,gradient));
-                }
-                break;
-            }
-            case 1:
-            {
-                if(weight_map_iter != idx_weight_map.end())
-                {
-                    weight_map_iter->second += 1.0/(24.0*domain_volume)*(6.0*domain_volume-b+c)*corner_weight;
-                    idx_gradient_map[node_idx_1d] += 1.0/domain_volume*gradient_integral*corner_weight;
-                }
-                else
-                {
-                    idx_weight_map.insert(std::make_pair(node_idx_1d,1.0/(24.0*domain_volume)*(6.0*domain_volume-b+c)*corner_weight));
-					Vector<Scalar,2> gradient = 1.0/domain_volume*gradient_integral*corner_weight;
-					idx_gradient_map.insert(std::make_pair(node_idx_1d,gradient));
-                }
-                break;
-            }
-            case 2:
-            {
-                if(weight_map_iter != idx_weight_map.end())
-                {
-                    weight_map_iter->second += 1.0/(24.0*domain_volume)*(6.0*domain_volume+b-c)*corner_weight;
-                    idx_gradient_map[node_idx_1d] += 1.0/domain_volume*gradient_integral*corner_weight;
-                }
-                else
-                {
-                    idx_weight_map.insert(std::make_pair(node_idx_1d,1.0/(24.0*domain_volume)*(6.0*domain_volume+b-c)*corner_weight));
-					Vector<Scalar,2> gradient = 1.0/domain_volume*gradient_integral*corner_weight;
-					idx_gradient_map.insert(std::make_pair(node_idx_1d,gradient));
-                }
-                break;
-            }
-            case 3:
-            {
-                if(weight_map_iter != idx_weight_map.end())
-                {
-                    weight_map_iter->second += 1.0/(24.0*domain_volume)*(6.0*domain_volume+b+c)*corner_weight;
-                    idx_gradient_map[node_idx_1d] += 1.0/domain_volume*gradient_integral*corner_weight;
-                }
-                else
-                {
-                    idx_weight_map.insert(std::make_pair(node_idx_1d,1.0/(24.0*domain_volume)*(6.0*domain_volume+b+c)*corner_weight));
-					Vector<Scalar,2> gradient = 1.0/domain_volume*gradient_integral*corner_weight;
-					idx_gradient_map.insert(std::make_pair(node_idx_1d,gradient));
-					idx_gradient_map.insert(std::make_pair(node_idx_1d,gradient));
-                }
-                break;
-            }
-            default:
-                PHYSIKA_ERROR("Particle domain corner number should be 4 for Dim=2");
-            }
+            node_entry.node_idx_1d_ = this->flatIndex(node_idx,grid_node_num);
+            node_entry.node_idx_ = node_idx;
+            node_entry.weight_value_ = particle_corner_weight[flat_corner_idx]*corner_weight;
+            node_entry.gradient_value_ = particle_corner_gradient*corner_weight;
+            scratch.corner_nodes_.push_back(node_entry);
         }
+        CPDI2UpdateMethodInternal::mergeCornerNodesToParticleNodes(scratch);
     }
     //then store the data with respect to grid nodes
-    particle_grid_pair_num = 0;
-    for(typename std::map<unsigned int,Scalar>::iterator iter = idx_weight_map.begin(); iter != idx_weight_map.end(); ++iter)
-    {
-        if(iter->second > std::numeric_limits<Scalar>::epsilon()) //ignore nodes that have zero weight value, assume positive weight
-        {
-            particle_grid_weight_and_gradient[particle_grid_pair_num].node_idx_ = this->multiDimIndex(iter->first,grid.nodeNum());
-            particle_grid_weight_and_gradient[particle_grid_pair_num].weight_value_ = iter->second;
-            particle_grid_weight_and_gradient[particle_grid_pair_num].gradient_value_ = idx_gradient_map[iter->first];
-            ++particle_grid_pair_num;
-        }
-    }
+    CPDI2UpdateMethodInternal::storeParticleNodes(scratch.particle_nodes_,particle_grid_weight_and_gradient,particle_grid_pair_num);
 }
 
 template <typename Scalar>
@@ -443,60 +494,45 @@ void CPDI2UpdateMethod<Scalar,2>::updateParticleInterpolationWeightWithEnrichmen
                                   bool gradient_to_reference_coordinate)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
-    ArrayND<Vector<Scalar,2>,2> particle_domain, initial_particle_domain;
-    this->cpdi_driver_->currentParticleDomain(object_idx,particle_idx,particle_domain);
-    this->cpdi_driver_->initialParticleDomain(object_idx,particle_idx,initial_particle_domain);
-    std::vector<Vector<Scalar,2> > particle_domain_vec(4), initial_particle_domain_vec(4);
-    unsigned int i = 0;
-    for(typename ArrayND<Vector<Scalar,2>,2>::Iterator corner_iter = particle_domain.begin(); corner_iter != particle_domain.end(); ++corner_iter,++i)
-        particle_domain_vec[i] = *corner_iter;
-    i = 0;
-    for(typename ArrayND<Vector<Scalar,2>,2>::Iterator corner_iter = initial_particle_domain.begin(); corner_iter != initial_particle_domain.end(); ++corner_iter,++i)
-        initial_particle_domain_vec[i] = *corner_iter;
-    std::map<unsigned int,Scalar> idx_weight_map;
-    std::map<unsigned int,Vector<Scalar,2> > idx_gradient_map;
+    CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,2> &scratch = loadParticleDomainToScratch(object_idx,particle_idx);
+    const ArrayND<Vector<Scalar,2>,2> &particle_domain = scratch.particle_domain_, &initial_particle_domain = scratch.initial_particle_domain_;
     const Grid<Scalar,2> &grid = this->cpdi_driver_->grid();
-    Vector<Scalar,2> grid_dx = grid.dX();
+    Vector<unsigned int,2> grid_node_num = grid.nodeNum();
     //coefficients
-    Scalar a = (initial_particle_domain_vec[2]-initial_particle_domain_vec[0]).cross(initial_particle_domain_vec[1]-initial_particle_domain_vec[0]);
-    Scalar b = (initial_particle_domain_vec[2]-initial_particle_domain_vec[0]).cross(initial_particle_domain_vec[3]-initial_particle_domain_vec[1]);
-    Scalar c = (initial_particle_domain_vec[3]-initial_particle_domain_vec[2]).cross(initial_particle_domain_vec[1]-initial_particle_domain_vec[0]);
+    Vector<Scalar,2> initial_corner_0 = initial_particle_domain(Vector<unsigned int,2>(0,0)), initial_corner_1 = initial_particle_domain(Vector<unsigned int,2>(0,1)),
+                     initial_corner_2 = initial_particle_domain(Vector<unsigned int,2>(1,0)), initial_corner_3 = initial_particle_domain(Vector<unsigned int,2>(1,1));
+    Scalar a = (initial_corner_2-initial_corner_0).cross(initial_corner_1-initial_corner_0);
+    Scalar b = (initial_corner_2-initial_corner_0).cross(initial_corner_3-initial_corner_1);
+    Scalar c = (initial_corner_3-initial_corner_2).cross(initial_corner_1-initial_corner_0);
     Scalar domain_volume = a + 0.5*(b+c);
-    std::vector<Scalar> particle_corner_weight(4);
-    //the weight between particle and domain corners
-    computeParticleInterpolationWeightInParticleDomain(object_idx,particle_idx,particle_corner_weight);    
-    //determine the particle type
-    unsigned int enriched_corner_num = 0;
-    for(unsigned int corner_idx = 0; corner_idx < 4; ++corner_idx)
-    {
-        unsigned int global_corner_idx = particle_domain_mesh->eleVertIndex(particle_idx,corner_idx);
-        if(is_enriched_domain_corner[global_corner_idx])
-            ++enriched_corner_num;
-    }
-    
+    gaussIntegrateShapeFunctionInParticleDomain(scratch,gradient_to_reference_coordinate);
+    //the weight between particle and domain corners, same as computeParticleInterpolationWeightInParticleDomain()
+    Scalar particle_corner_weight[4];
+    particle_corner_weight[0] = 1.0/(24*domain_volume)*(6*domain_volume-b-c);
+    particle_corner_weight[1] = 1.0/(24*domain_volume)*(6*domain_volume-b+c);
+    particle_corner_weight[2] = 1.0/(24*domain_volume)*(6*domain_volume+b-c);
+    particle_corner_weight[3] = 1.0/(24*domain_volume)*(6*domain_volume+b+c);
     typedef UniformGridWeightFunctionInfluenceIterator<Scalar,2> InfluenceIterator;
     //first compute the weight and gradient with respect to each grid node in the influence range of the particle
     //node weight and gradient between domain corners and grid nodes are stored as well
-    for(unsigned int flat_corner_idx = 0; flat_corner_idx < particle_domain_vec.size(); ++flat_corner_idx)
+    scratch.particle_nodes_.clear();
+    CPDI2UpdateMethodInternal::NodeWeightGradientEntry<Scalar,2> node_entry;
+    CPDI2UpdateMethodInternal::CornerAxisWeights<Scalar,2> corner_axis_weights;
+    for(unsigned int flat_corner_idx = 0; flat_corner_idx < 4; ++flat_corner_idx)
     {
         corner_grid_pair_num[flat_corner_idx] = 0;
         unsigned int node_num = 0;
         unsigned int global_corner_idx = particle_domain_mesh->eleVertIndex(particle_idx,flat_corner_idx);
         Vector<unsigned int,2> multi_corner_idx = this->multiDimIndex(flat_corner_idx,Vector<unsigned int,2>(2));
-        Vector<Scalar,2> gradient_integral(0);
-        if(gradient_to_reference_coordinate)
-            gradient_integral = gaussIntegrateShapeFunctionGradientToReferenceCoordinateInParticleDomain(multi_corner_idx,initial_particle_domain);
-        else
-            gradient_integral = gaussIntegrateShapeFunctionGradientToCurrentCoordinateInParticleDomain(multi_corner_idx,particle_domain,initial_particle_domain);
-        Vector<Scalar,2> particle_corner_gradient = 1.0/domain_volume*gradient_integral;
-        for(InfluenceIterator iter(grid,particle_domain_vec[flat_corner_idx],weight_function); iter.valid(); ++node_num,++iter)
+        const Vector<Scalar,2> &corner = particle_domain(multi_corner_idx);
+        Vector<Scalar,2> particle_corner_gradient = 1.0/domain_volume*scratch.corner_gradient_integral_[flat_corner_idx];
+        scratch.corner_nodes_.clear();
+        InfluenceIterator iter(grid,corner,weight_function);
+        CPDI2UpdateMethodInternal::evaluateCornerAxisWeights(grid,corner,iter,weight_function,corner_axis_weights);
+        for(; iter.valid(); ++node_num,++iter)
         {
             Vector<unsigned int,2> node_idx = iter.nodeIndex();
-            unsigned int node_idx_1d = this->flatIndex(node_idx,grid.nodeNum());
-            Vector<Scalar,2> corner_to_node = particle_domain_vec[flat_corner_idx] - grid.node(node_idx);
-            for(unsigned int dim = 0; dim < 2; ++dim)
-                corner_to_node[dim] /= grid_dx[dim];
-            Scalar corner_weight = weight_function.weight(corner_to_node);
+            Scalar corner_weight = corner_axis_weights.weight(node_idx);
             //weight and gradient correspond to this node for domain corners
             corner_grid_weight[flat_corner_idx][node_num].node_idx_ = node_idx;
             corner_grid_weight[flat_corner_idx][node_num].weight_value_ = corner_weight;
@@ -504,31 +540,35 @@ void CPDI2UpdateMethod<Scalar,2>::updateParticleInterpolationWeightWithEnrichmen
             if(is_enriched_domain_corner[global_corner_idx])  //enriched domain corners do not contribute to grid
                 break;
             //weight and gradient correspond to this node for particles
-            typename std::map<unsigned int,Scalar>::iterator weight_map_iter = idx_weight_map.find(node_idx_1d);
-            if(weight_map_iter != idx_weight_map.end())
-            {
-                weight_map_iter->second += particle_corner_weight[flat_corner_idx]*corner_weight;
-                idx_gradient_map[node_idx_1d] += particle_corner_gradient*corner_weight;
-            }
-            else
-            {
-                idx_weight_map.insert(std::make_pair(node_idx_1d,particle_corner_weight[flat_corner_idx]*corner_weight));
-                idx_gradient_map.insert(std::make_pair(node_idx_1d,particle_corner_gradient*corner_weight));
-            }
+            node_entry.node_idx_1d_ = this->flatIndex(node_idx,grid_node_num);
+            node_entry.node_idx_ = node_idx;
+            node_entry.weight_value_ = particle_corner_weight[flat_corner_idx]*corner_weight;
+            node_entry.gradient_value_ = particle_corner_gradient*corner_weight;
+            scratch.corner_nodes_.push_back(node_entry);
         }
+        CPDI2UpdateMethodInternal::mergeCornerNodesToParticleNodes(scratch);
     }
     //then store the data with respect to grid nodes
-    particle_grid_pair_num = 0;
-    for(typename std::map<unsigned int,Scalar>::iterator iter = idx_weight_map.begin(); iter != idx_weight_map.end(); ++iter)
+    CPDI2UpdateMethodInternal::storeParticleNodes(scratch.particle_nodes_,particle_grid_weight_and_gradient,particle_grid_pair_num);
+}
+
+template <typename Scalar>
+CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,2>& CPDI2UpdateMethod<Scalar,2>::loadParticleDomainToScratch(unsigned int object_idx, unsigned int particle_idx)
+{
+    PHYSIKA_ASSERT(threadIndex() < thread_scratch_.size());
+    CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,2> &scratch = thread_scratch_[threadIndex()];
+    if(scratch.particle_domain_.totalElementCount() != 4)
     {
-        if(iter->second > std::numeric_limits<Scalar>::epsilon()) //ignore nodes that have zero weight value, assume positive weight
-        {
-            particle_grid_weight_and_gradient[particle_grid_pair_num].node_idx_ = this->multiDimIndex(iter->first,grid.nodeNum());
-            particle_grid_weight_and_gradient[particle_grid_pair_num].weight_value_ = iter->second;
-            particle_grid_weight_and_gradient[particle_grid_pair_num].gradient_value_ = idx_gradient_map[iter->first];
-            ++particle_grid_pair_num;
-        }
+        scratch.particle_domain_.resize(Vector<unsigned int,2>(2));
+        scratch.initial_particle_domain_.resize(Vector<unsigned int,2>(2));
     }
+    for(unsigned int flat_corner_idx = 0; flat_corner_idx < 4; ++flat_corner_idx)
+    {
+        Vector<unsigned int,2> multi_corner_idx = this->multiDimIndex(flat_corner_idx,Vector<unsigned int,2>(2));
+        scratch.particle_domain_(multi_corner_idx) = this->cpdi_driver_->currentParticleDomainCorner(object_idx,particle_idx,multi_corner_idx);
+        scratch.initial_particle_domain_(multi_corner_idx) = this->cpdi_driver_->initialParticleDomainCorner(object_idx,particle_idx,multi_corner_idx);
+    }
+    return scratch;
 }
 
 template <typename Scalar>
@@ -585,6 +625,39 @@ Vector<Scalar,2> CPDI2UpdateMethod<Scalar,2>::gaussIntegrateShapeFunctionGradien
     return result;
 }
     
+template <typename Scalar>
+void CPDI2UpdateMethod<Scalar,2>::gaussIntegrateShapeFunctionInParticleDomain(CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,2> &scratch,
+                                                                              bool gradient_to_reference_coordinate)
+{
+    for(unsigned int flat_corner_idx = 0; flat_corner_idx < 4; ++flat_corner_idx)
+        scratch.corner_gradient_integral_[flat_corner_idx] = Vector<Scalar,2>(0);
+    Vector<Scalar,2> gauss_point;
+    SquareMatrix<Scalar,2> jacobian_inv_trans, ref_jacobian;
+    Vector<Scalar,2> shape_function_derivative;
+    //2x2 gauss integration points
+    Scalar one_over_sqrt_3 = 1.0/sqrt(3.0);
+    for(unsigned int i = 0; i < 2; ++i)
+        for(unsigned int j = 0; j < 2; ++j)
+        {
+            gauss_point[0] = (2.0*i-1)*one_over_sqrt_3;
+            gauss_point[1] = (2.0*j-1)*one_over_sqrt_3;
+            ref_jacobian = particleDomainJacobian(gauss_point,scratch.initial_particle_domain_);
+            if(gradient_to_reference_coordinate)
+                jacobian_inv_trans = ref_jacobian.inverse().transpose();
+            else
+                jacobian_inv_trans = particleDomainJacobian(gauss_point,scratch.particle_domain_).inverse().transpose();
+            Scalar ref_jacobian_det = ref_jacobian.determinant();
+            //the corners share the jacobian, each corner accumulates the gauss points in the same order as the per-corner methods
+            for(unsigned int flat_corner_idx = 0; flat_corner_idx < 4; ++flat_corner_idx)
+            {
+                Vector<unsigned int,2> corner_idx(flat_corner_idx/2,flat_corner_idx%2);
+                shape_function_derivative[0] = 0.25*(2.0*corner_idx[0]-1)*(1+(2.0*corner_idx[1]-1)*gauss_point[1]);
+                shape_function_derivative[1] = 0.25*(1+(2.0*corner_idx[0]-1)*gauss_point[0])*(2.0*corner_idx[1]-1);
+                scratch.corner_gradient_integral_[flat_corner_idx] += jacobian_inv_trans*shape_function_derivative*ref_jacobian_det;
+            }
+        }
+}
+
 template <typename Scalar>
 SquareMatrix<Scalar,2> CPDI2UpdateMethod<Scalar,2>::particleDomainJacobian(const Vector<Scalar,2> &eval_point, const ArrayND<Vector<Scalar,2>,2> &particle_domain)
 {
@@ -628,10 +701,17 @@ void CPDI2UpdateMethod<Scalar,3>::updateParticleInterpolationWeight(const GridWe
                                  bool gradient_to_reference_coordinate)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
+    int thread_num = static_cast<int>(this->cpdi_driver_->threadNum());
+    if(thread_scratch_.size() < static_cast<unsigned int>(thread_num))
+        thread_scratch_.resize(thread_num);
     for(unsigned int i = 0; i < this->cpdi_driver_->objectNum(); ++i)
-        for(unsigned int j = 0; j < this->cpdi_driver_->particleNumOfObject(i); ++j)
+    {
+        int particle_num = static_cast<int>(this->cpdi_driver_->particleData(i).particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int j = 0; j < particle_num; ++j)
             updateParticleInterpolationWeight(i,j,weight_function,particle_grid_weight_and_gradient[i][j],particle_grid_pair_num[i][j],
                                               corner_grid_weight[i][j],corner_grid_pair_num[i][j],gradient_to_reference_coordinate);
+    }
 }
 
 template <typename Scalar>
@@ -645,12 +725,19 @@ void CPDI2UpdateMethod<Scalar,3>::updateParticleInterpolationWeightWithEnrichmen
                                   bool gradient_to_reference_coordinate)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
+    int thread_num = static_cast<int>(this->cpdi_driver_->threadNum());
+    if(thread_scratch_.size() < static_cast<unsigned int>(thread_num))
+        thread_scratch_.resize(thread_num);
     for(unsigned int i = 0; i < this->cpdi_driver_->objectNum(); ++i)
-        for(unsigned int j = 0; j < this->cpdi_driver_->particleNumOfObject(i); ++j)
+    {
+        int particle_num = static_cast<int>(this->cpdi_driver_->particleData(i).particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int j = 0; j < particle_num; ++j)
             updateParticleInterpolationWeightWithEnrichment(i,j,weight_function,particle_domain_mesh[i],is_enriched_domain_corner[i],
                                                              particle_grid_weight_and_gradient[i][j],particle_grid_pair_num[i][j],
                                                              corner_grid_weight[i][j],corner_grid_pair_num[i][j],
                                                              gradient_to_reference_coordinate);
+    }
 }
 
 template <typename Scalar>
@@ -686,20 +773,22 @@ template <typename Scalar>
 void CPDI2UpdateMethod<Scalar,3>::updateParticlePosition(Scalar dt, const std::vector<std::vector<unsigned char> > &is_dirichlet_particle)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
-    ArrayND<Vector<Scalar,3>,3> particle_domain;
-    std::vector<Vector<Scalar,3> > particle_domain_vec(8);
-    std::vector<Scalar> particle_corner_weight(8);
+    int thread_num = static_cast<int>(this->cpdi_driver_->threadNum());
     for(unsigned int obj_idx = 0; obj_idx < this->cpdi_driver_->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->cpdi_driver_->particleNumOfObject(obj_idx); ++particle_idx)
+        SolidParticleData<Scalar,3> &particle_data = this->cpdi_driver_->particleData(obj_idx);
+        int particle_num = static_cast<int>(particle_data.particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
         {
-            SolidParticle<Scalar,3> &particle = this->cpdi_driver_->particle(obj_idx,particle_idx);
             if(is_dirichlet_particle[obj_idx][particle_idx])  //update dirichlet particle's position with prescribed velocity
             {
-                Vector<Scalar,3> new_pos = particle.position() + particle.velocity()*dt;
-                particle.setPosition(new_pos);
+                particle_data.position(particle_idx) += particle_data.velocity(particle_idx)*dt;
                 continue;
             }
+            ArrayND<Vector<Scalar,3>,3> particle_domain;
+            std::vector<Vector<Scalar,3> > particle_domain_vec(8);
+            std::vector<Scalar> particle_corner_weight(8);
             this->cpdi_driver_->currentParticleDomain(obj_idx,particle_idx,particle_domain);
             unsigned int i = 0;
             for(typename ArrayND<Vector<Scalar,3>,3>::Iterator corner_iter = particle_domain.begin(); corner_iter != particle_domain.end(); ++i, ++corner_iter)
@@ -708,7 +797,7 @@ void CPDI2UpdateMethod<Scalar,3>::updateParticlePosition(Scalar dt, const std::v
             Vector<Scalar,3> new_pos(0);
             for(unsigned int flat_corner_idx = 0; flat_corner_idx < 8; ++flat_corner_idx)
                 new_pos += particle_corner_weight[flat_corner_idx]*particle_domain_vec[flat_corner_idx];
-            particle.setPosition(new_pos);
+            particle_data.position(particle_idx) = new_pos;
         }
     }
 }
@@ -872,70 +961,49 @@ void CPDI2UpdateMethod<Scalar,3>::updateParticleInterpolationWeight(unsigned int
                                                                     bool gradient_to_reference_coordinate)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
-    ArrayND<Vector<Scalar,3>,3> particle_domain,initial_particle_domain;
-    this->cpdi_driver_->currentParticleDomain(object_idx,particle_idx,particle_domain);
-    this->cpdi_driver_->initialParticleDomain(object_idx,particle_idx,initial_particle_domain);
-    std::vector<Vector<Scalar,3> > particle_domain_vec;
-    for(typename ArrayND<Vector<Scalar,3>,3>::Iterator corner_iter = particle_domain.begin(); corner_iter != particle_domain.end(); ++corner_iter)
-        particle_domain_vec.push_back(*corner_iter);
-    std::map<unsigned int,Scalar> idx_weight_map;
-    std::map<unsigned int,Vector<Scalar,3> > idx_gradient_map;
+    CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,3> &scratch = loadParticleDomainToScratch(object_idx,particle_idx);
+    const ArrayND<Vector<Scalar,3>,3> &particle_domain = scratch.particle_domain_, &initial_particle_domain = scratch.initial_particle_domain_;
     const Grid<Scalar,3> &grid = this->cpdi_driver_->grid();
-    Vector<Scalar,3> grid_dx = grid.dX();
+    Vector<unsigned int,3> grid_node_num = grid.nodeNum();
     Scalar domain_volume = particleDomainVolume(initial_particle_domain);
+    gaussIntegrateShapeFunctionInParticleDomain(scratch,gradient_to_reference_coordinate);
 
     typedef UniformGridWeightFunctionInfluenceIterator<Scalar,3> InfluenceIterator;
     //first compute the weight and gradient with respect to each grid node in the influence range of the particle
     //node weight and gradient with respect to domain corners are stored as well
-    for(unsigned int flat_corner_idx = 0; flat_corner_idx < particle_domain_vec.size(); ++flat_corner_idx)
+    scratch.particle_nodes_.clear();
+    CPDI2UpdateMethodInternal::NodeWeightGradientEntry<Scalar,3> node_entry;
+    CPDI2UpdateMethodInternal::CornerAxisWeights<Scalar,3> corner_axis_weights;
+    for(unsigned int flat_corner_idx = 0; flat_corner_idx < 8; ++flat_corner_idx)
     {
         corner_grid_pair_num[flat_corner_idx] = 0;
         unsigned int node_num = 0;
         Vector<unsigned int,3> multi_corner_idx = this->multiDimIndex(flat_corner_idx,Vector<unsigned int,3>(2));
-        Scalar approximate_integrate_shape_function_in_domain = gaussIntegrateShapeFunctionValueInParticleDomain(multi_corner_idx,initial_particle_domain);
-        Vector<Scalar,3> approximate_integrate_shape_function_gradient_in_domain;
-        if(gradient_to_reference_coordinate)
-            approximate_integrate_shape_function_gradient_in_domain = gaussIntegrateShapeFunctionGradientToReferenceCoordinateInParticleDomain(multi_corner_idx,initial_particle_domain);
-        else
-            approximate_integrate_shape_function_gradient_in_domain = gaussIntegrateShapeFunctionGradientToCurrentCoordinateInParticleDomain(multi_corner_idx,particle_domain,initial_particle_domain);
-        for(InfluenceIterator iter(grid,particle_domain_vec[flat_corner_idx],weight_function); iter.valid(); ++node_num,++iter)
+        const Vector<Scalar,3> &corner = particle_domain(multi_corner_idx);
+        Scalar particle_corner_weight = 1.0/domain_volume*scratch.corner_weight_integral_[flat_corner_idx];
+        Vector<Scalar,3> particle_corner_gradient = 1.0/domain_volume*scratch.corner_gradient_integral_[flat_corner_idx];
+        scratch.corner_nodes_.clear();
+        InfluenceIterator iter(grid,corner,weight_function);
+        CPDI2UpdateMethodInternal::evaluateCornerAxisWeights(grid,corner,iter,weight_function,corner_axis_weights);
+        for(; iter.valid(); ++node_num,++iter)
         {
             Vector<unsigned int,3> node_idx = iter.nodeIndex();
-            unsigned int node_idx_1d = this->flatIndex(node_idx,grid.nodeNum());
-            Vector<Scalar,3> corner_to_node = particle_domain_vec[flat_corner_idx] - grid.node(node_idx);
-            for(unsigned int dim = 0; dim < 3; ++dim)
-                corner_to_node[dim] /= grid_dx[dim];
-            Scalar corner_weight = weight_function.weight(corner_to_node);
+            Scalar corner_weight = corner_axis_weights.weight(node_idx);
             //weight correspond to this node for domain corners
             corner_grid_weight[flat_corner_idx][node_num].node_idx_ = node_idx;
             corner_grid_weight[flat_corner_idx][node_num].weight_value_ = corner_weight;
             ++corner_grid_pair_num[flat_corner_idx];
             //weight and gradient correspond to this node for particles
-            typename std::map<unsigned int,Scalar>::iterator weight_map_iter = idx_weight_map.find(node_idx_1d);
-            if(weight_map_iter != idx_weight_map.end())
-            {
-                weight_map_iter->second += 1.0/domain_volume*approximate_integrate_shape_function_in_domain*corner_weight;
-                idx_gradient_map[node_idx_1d] += 1.0/domain_volume*approximate_integrate_shape_function_gradient_in_domain*corner_weight;
-            }
-            else
-            {
-                idx_weight_map.insert(std::make_pair(node_idx_1d,1.0/domain_volume*approximate_integrate_shape_function_in_domain*corner_weight));
-                idx_gradient_map.insert(std::make_pair(node_idx_1d,1.0/domain_volume*approximate_integrate_shape_function_gradient_in_domain*corner_weight));
-            }
+            node_entry.node_idx_1d_ = this->flatIndex(node_idx,grid_node_num);
+            node_entry.node_idx_ = node_idx;
+            node_entry.weight_value_ = particle_corner_weight*corner_weight;
+            node_entry.gradient_value_ = particle_corner_gradient*corner_weight;
+            scratch.corner_nodes_.push_back(node_entry);
         }
+        CPDI2UpdateMethodInternal::mergeCornerNodesToParticleNodes(scratch);
     }
     //then store the data with respect to grid nodes
-    particle_grid_pair_num = 0;
-    for(typename std::map<unsigned int,Scalar>::iterator iter = idx_weight_map.begin(); iter != idx_weight_map.end(); ++iter)
-    {
-        if(iter->second > std::numeric_limits<Scalar>::epsilon()) //ignore nodes that have zero weight value, assume positive weight
-        {
-            particle_grid_weight_and_gradient[particle_grid_pair_num].node_idx_ = this->multiDimIndex(iter->first,grid.nodeNum());
-            particle_grid_weight_and_gradient[particle_grid_pair_num].weight_value_ = iter->second;
-            particle_grid_weight_and_gradient[particle_grid_pair_num].gradient_value_ = idx_gradient_map[iter->first];
-            ++particle_grid_pair_num;
-        }
-    }
+    CPDI2UpdateMethodInternal::storeParticleNodes(scratch.particle_nodes_,particle_grid_weight_and_gradient,particle_grid_pair_num);
 }
 
 template <typename Scalar>
@@ -950,58 +1018,36 @@ void CPDI2UpdateMethod<Scalar,3>::updateParticleInterpolationWeightWithEnrichmen
                                   bool gradient_to_reference_coordinate)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
-    ArrayND<Vector<Scalar,3>,3> particle_domain, initial_particle_domain;
-    this->cpdi_driver_->currentParticleDomain(object_idx,particle_idx,particle_domain);
-    this->cpdi_driver_->initialParticleDomain(object_idx,particle_idx,initial_particle_domain);
-    std::vector<Vector<Scalar,3> > particle_domain_vec;
-    for(typename ArrayND<Vector<Scalar,3>,3>::Iterator corner_iter = particle_domain.begin(); corner_iter != particle_domain.end(); ++corner_iter)
-        particle_domain_vec.push_back(*corner_iter);
-    std::map<unsigned int,Scalar> idx_weight_map;
-    std::map<unsigned int,Vector<Scalar,3> > idx_gradient_map;
+    CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,3> &scratch = loadParticleDomainToScratch(object_idx,particle_idx);
+    const ArrayND<Vector<Scalar,3>,3> &particle_domain = scratch.particle_domain_, &initial_particle_domain = scratch.initial_particle_domain_;
     const Grid<Scalar,3> &grid = this->cpdi_driver_->grid();
-    Vector<Scalar,3> grid_dx = grid.dX();
+    Vector<unsigned int,3> grid_node_num = grid.nodeNum();
     Scalar domain_volume = particleDomainVolume(initial_particle_domain);
-    //determine the particle type
-    unsigned int enriched_corner_num = 0;
-    for(unsigned int corner_idx = 0; corner_idx < 8; ++corner_idx)
-    {
-        unsigned int global_corner_idx = particle_domain_mesh->eleVertIndex(particle_idx,corner_idx);
-        if(is_enriched_domain_corner[global_corner_idx])
-            ++enriched_corner_num;
-    }
+    gaussIntegrateShapeFunctionInParticleDomain(scratch,gradient_to_reference_coordinate);
 
     typedef UniformGridWeightFunctionInfluenceIterator<Scalar,3> InfluenceIterator;
     //first compute the weight and gradient with respect to each grid node in the influence range of the particle
     //node weight and gradient with respect to domain corners are stored as well
-    for(unsigned int flat_corner_idx = 0; flat_corner_idx < particle_domain_vec.size(); ++flat_corner_idx)
+    scratch.particle_nodes_.clear();
+    CPDI2UpdateMethodInternal::NodeWeightGradientEntry<Scalar,3> node_entry;
+    CPDI2UpdateMethodInternal::CornerAxisWeights<Scalar,3> corner_axis_weights;
+    for(unsigned int flat_corner_idx = 0; flat_corner_idx < 8; ++flat_corner_idx)
     {
         corner_grid_pair_num[flat_corner_idx] = 0;
         unsigned int node_num = 0;
         unsigned int global_corner_idx = particle_domain_mesh->eleVertIndex(particle_idx,flat_corner_idx);
         Vector<unsigned int,3> multi_corner_idx = this->multiDimIndex(flat_corner_idx,Vector<unsigned int,3>(2));
-        Scalar approximate_integrate_shape_function_in_domain = gaussIntegrateShapeFunctionValueInParticleDomain(multi_corner_idx,initial_particle_domain);
-        Vector<Scalar,3> approximate_integrate_shape_function_gradient_in_domain(0);
-        if(gradient_to_reference_coordinate)
-        {                            
-            approximate_integrate_shape_function_gradient_in_domain =
-                gaussIntegrateShapeFunctionGradientToReferenceCoordinateInParticleDomain(multi_corner_idx,initial_particle_domain);
-        }
-        else
-        {                            
-            approximate_integrate_shape_function_gradient_in_domain =
-                gaussIntegrateShapeFunctionGradientToCurrentCoordinateInParticleDomain(multi_corner_idx,particle_domain,initial_particle_domain);
-        }
+        const Vector<Scalar,3> &corner = particle_domain(multi_corner_idx);
         //weight and gradient between particle and domain corners
-        Scalar particle_corner_weight = 1.0/domain_volume*approximate_integrate_shape_function_in_domain;
-        Vector<Scalar,3> particle_corner_gradient = 1.0/domain_volume*approximate_integrate_shape_function_gradient_in_domain;
-        for(InfluenceIterator iter(grid,particle_domain_vec[flat_corner_idx],weight_function); iter.valid(); ++node_num,++iter)
+        Scalar particle_corner_weight = 1.0/domain_volume*scratch.corner_weight_integral_[flat_corner_idx];
+        Vector<Scalar,3> particle_corner_gradient = 1.0/domain_volume*scratch.corner_gradient_integral_[flat_corner_idx];
+        scratch.corner_nodes_.clear();
+        InfluenceIterator iter(grid,corner,weight_function);
+        CPDI2UpdateMethodInternal::evaluateCornerAxisWeights(grid,corner,iter,weight_function,corner_axis_weights);
+        for(; iter.valid(); ++node_num,++iter)
         {
             Vector<unsigned int,3> node_idx = iter.nodeIndex();
-            unsigned int node_idx_1d = this->flatIndex(node_idx,grid.nodeNum());
-            Vector<Scalar,3> corner_to_node = particle_domain_vec[flat_corner_idx] - grid.node(node_idx);
-            for(unsigned int dim = 0; dim < 3; ++dim)
-                corner_to_node[dim] /= grid_dx[dim];
-            Scalar corner_weight = weight_function.weight(corner_to_node);
+            Scalar corner_weight = corner_axis_weights.weight(node_idx);
             //weight correspond to this node for domain corners
             corner_grid_weight[flat_corner_idx][node_num].node_idx_ = node_idx;
             corner_grid_weight[flat_corner_idx][node_num].weight_value_ = corner_weight;
@@ -1009,31 +1055,35 @@ void CPDI2UpdateMethod<Scalar,3>::updateParticleInterpolationWeightWithEnrichmen
             if(is_enriched_domain_corner[global_corner_idx])  //enriched domain corners do not contribute to grid
                 break;
             //weight and gradient correspond to this node for particles
-            typename std::map<unsigned int,Scalar>::iterator weight_map_iter = idx_weight_map.find(node_idx_1d);
-            if(weight_map_iter != idx_weight_map.end())
-            {
-                weight_map_iter->second += particle_corner_weight*corner_weight;
-                idx_gradient_map[node_idx_1d] += particle_corner_gradient*corner_weight;
-            }
-            else
-            {
-                idx_weight_map.insert(std::make_pair(node_idx_1d,particle_corner_weight*corner_weight));
-                idx_gradient_map.insert(std::make_pair(node_idx_1d,particle_corner_gradient*corner_weight));
-            }
+            node_entry.node_idx_1d_ = this->flatIndex(node_idx,grid_node_num);
+            node_entry.node_idx_ = node_idx;
+            node_entry.weight_value_ = particle_corner_weight*corner_weight;
+            node_entry.gradient_value_ = particle_corner_gradient*corner_weight;
+            scratch.corner_nodes_.push_back(node_entry);
         }
+        CPDI2UpdateMethodInternal::mergeCornerNodesToParticleNodes(scratch);
     }
     //then store the data with respect to grid nodes
-    particle_grid_pair_num = 0;
-    for(typename std::map<unsigned int,Scalar>::iterator iter = idx_weight_map.begin(); iter != idx_weight_map.end(); ++iter)
+    CPDI2UpdateMethodInternal::storeParticleNodes(scratch.particle_nodes_,particle_grid_weight_and_gradient,particle_grid_pair_num);
+}
+
+template <typename Scalar>
+CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,3>& CPDI2UpdateMethod<Scalar,3>::loadParticleDomainToScratch(unsigned int object_idx, unsigned int particle_idx)
+{
+    PHYSIKA_ASSERT(threadIndex() < thread_scratch_.size());
+    CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,3> &scratch = thread_scratch_[threadIndex()];
+    if(scratch.particle_domain_.totalElementCount() != 8)
     {
-        if(iter->second > std::numeric_limits<Scalar>::epsilon()) //ignore nodes that have zero weight value, assume positive weight
-        {
-            particle_grid_weight_and_gradient[particle_grid_pair_num].node_idx_ = this->multiDimIndex(iter->first,grid.nodeNum());
-            particle_grid_weight_and_gradient[particle_grid_pair_num].weight_value_ = iter->second;
-            particle_grid_weight_and_gradient[particle_grid_pair_num].gradient_value_ = idx_gradient_map[iter->first];
-            ++particle_grid_pair_num;
-        }
+        scratch.particle_domain_.resize(Vector<unsigned int,3>(2));
+        scratch.initial_particle_domain_.resize(Vector<unsigned int,3>(2));
     }
+    for(unsigned int flat_corner_idx = 0; flat_corner_idx < 8; ++flat_corner_idx)
+    {
+        Vector<unsigned int,3> multi_corner_idx = this->multiDimIndex(flat_corner_idx,Vector<unsigned int,3>(2));
+        scratch.particle_domain_(multi_corner_idx) = this->cpdi_driver_->currentParticleDomainCorner(object_idx,particle_idx,multi_corner_idx);
+        scratch.initial_particle_domain_(multi_corner_idx) = this->cpdi_driver_->initialParticleDomainCorner(object_idx,particle_idx,multi_corner_idx);
+    }
+    return scratch;
 }
 
 template <typename Scalar>
@@ -1114,6 +1164,46 @@ Vector<Scalar,3> CPDI2UpdateMethod<Scalar,3>::gaussIntegrateShapeFunctionGradien
     return result;
 }
 
+template <typename Scalar>
+void CPDI2UpdateMethod<Scalar,3>::gaussIntegrateShapeFunctionInParticleDomain(CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,3> &scratch,
+                                                                              bool gradient_to_reference_coordinate)
+{
+    for(unsigned int flat_corner_idx = 0; flat_corner_idx < 8; ++flat_corner_idx)
+    {
+        scratch.corner_weight_integral_[flat_corner_idx] = 0;
+        scratch.corner_gradient_integral_[flat_corner_idx] = Vector<Scalar,3>(0);
+    }
+    //2x2x2 gauss integration points
+    Scalar one_over_sqrt_3 = 1.0/sqrt(3.0);
+    SquareMatrix<Scalar,3> jacobian_inv_trans, ref_jacobian;
+    Vector<Scalar,3> gauss_point, shape_function_derivative;
+    for(unsigned int i = 0; i < 2; ++i)
+        for(unsigned int j = 0; j < 2; ++j)
+            for(unsigned int k = 0; k < 2; ++k)
+            {
+                gauss_point[0] = (2.0*i-1)*one_over_sqrt_3;
+                gauss_point[1] = (2.0*j-1)*one_over_sqrt_3;
+                gauss_point[2] = (2.0*k-1)*one_over_sqrt_3;
+                ref_jacobian = particleDomainJacobian(gauss_point,scratch.initial_particle_domain_);
+                if(gradient_to_reference_coordinate)
+                    jacobian_inv_trans = ref_jacobian.inverse().transpose();
+                else
+                    jacobian_inv_trans = particleDomainJacobian(gauss_point,scratch.particle_domain_).inverse().transpose();
+                Scalar ref_jacobian_det = ref_jacobian.determinant();
+                //the corners share the jacobian, each corner accumulates the gauss points in the same order as the per-corner methods
+                for(unsigned int flat_corner_idx = 0; flat_corner_idx < 8; ++flat_corner_idx)
+                {
+                    Vector<unsigned int,3> corner_idx = this->multiDimIndex(flat_corner_idx,Vector<unsigned int,3>(2));
+                    Scalar shape_function = 0.125*(1+(2.0*corner_idx[0]-1)*gauss_point[0])*(1+(2.0*corner_idx[1]-1)*gauss_point[1])*(1+(2.0*corner_idx[2]-1)*gauss_point[2]);
+                    scratch.corner_weight_integral_[flat_corner_idx] += shape_function*ref_jacobian_det;
+                    shape_function_derivative[0] = 0.125*(2.0*corner_idx[0]-1)*(1+(2.0*corner_idx[1]-1)*gauss_point[1])*(1+(2.0*corner_idx[2]-1)*gauss_point[2]);
+                    shape_function_derivative[1] = 0.125*(1+(2.0*corner_idx[0]-1)*gauss_point[0])*(2.0*corner_idx[1]-1)*(1+(2.0*corner_idx[2]-1)*gauss_point[2]);
+                    shape_function_derivative[2] = 0.125*(1+(2.0*corner_idx[0]-1)*gauss_point[0])*(1+(2.0*corner_idx[1]-1)*gauss_point[1])*(2.0*corner_idx[2]-1);
+                    scratch.corner_gradient_integral_[flat_corner_idx] += jacobian_inv_trans*shape_function_derivative*ref_jacobian_det;
+                }
+            }
+}
+
 template <typename Scalar>
 SquareMatrix<Scalar,3> CPDI2UpdateMethod<Scalar,3>::particleDomainJacobian(const Vector<Scalar,3> &eval_point, const ArrayND<Vector<Scalar,3>,3> &particle_domain)
 {
@@ -24,15 +24,52 @@
 #include "Physika_Core/Vectors/vector_3d.h"
 #include "Physika_Core/Matrices/matrix_2x2.h"
 #include "Physika_Core/Matrices/matrix_3x3.h"
+#include "Physika_Core/Arrays/array_Nd.h"
 #include "Physika_Dynamics/MPM/mpm_internal.h"
 #include "Physika_Dynamics/MPM/CPDI_Update_Methods/CPDI_update_method.h"
 
 namespace Physika{
 
 template <typename Scalar, int Dim> class GridWeightFunction;
-template <typename ElementType, int Dim> class ArrayND;
 template <typename Scalar, int Dim> class VolumetricMesh;
 
+namespace CPDI2UpdateMethodInternal{
+
+//weight and gradient of a grid node accumulated from the domain corners of a particle
+template <typename Scalar, int Dim>
+struct NodeWeightGradientEntry
+{
+    unsigned int node_idx_1d_;  //flat index of the node, the entries are sorted by it
+    Vector<unsigned int,Dim> node_idx_;
+    Scalar weight_value_;
+    Vector<Scalar,Dim> gradient_value_;
+};
+
+/*
+ * Scratch space of one thread to update the particle interpolation weight, reused across particles
+ * such that no memory is allocated per particle.
+ * The nodes influencing each domain corner come sorted by flat index from the influence iterator,
+ * and they're merged into the nodes of the particle corner by corner. The accumulation order is the
+ * same as the corner order, hence the result doesn't depend on the thread number.
+ */
+template <typename Scalar, int Dim>
+struct ParticleWeightScratch
+{
+    ParticleWeightScratch(){}
+    //the content is transient, copying a scratch (e.g., when the scratch vector is resized) yields an empty one
+    ParticleWeightScratch(const ParticleWeightScratch<Scalar,Dim>&){}
+    ParticleWeightScratch<Scalar,Dim>& operator= (const ParticleWeightScratch<Scalar,Dim>&){return *this;}
+    ArrayND<Vector<Scalar,Dim>,Dim> particle_domain_;
+    ArrayND<Vector<Scalar,Dim>,Dim> initial_particle_domain_;
+    Scalar corner_weight_integral_[1<<Dim];  //integral of corner shape function over particle domain
+    Vector<Scalar,Dim> corner_gradient_integral_[1<<Dim];  //integral of corner shape function gradient over particle domain
+    std::vector<NodeWeightGradientEntry<Scalar,Dim> > corner_nodes_;  //nodes influencing current corner
+    std::vector<NodeWeightGradientEntry<Scalar,Dim> > particle_nodes_;  //nodes merged from the corners so far
+    std::vector<NodeWeightGradientEntry<Scalar,Dim> > merge_buffer_;
+};
+
+}  //end of namespace CPDI2UpdateMethodInternal
+
 /*
  * Changes compared to conventional CPDI2 in the paper:
  * 1. integration over particle domain is conducted in initial particle domain
@@ -141,6 +178,14 @@ protected:
     //the jacobian matrix between particle domain expressed in cartesian coordinate and natural coordinate, evaluated at a point represented in natural coordinate
     //derivative with respect to vector is represented as row vector
     SquareMatrix<Scalar,2> particleDomainJacobian(const Vector<Scalar,2> &eval_point, const ArrayND<Vector<Scalar,2>,2> &particle_domain);
+    //integrate the shape function gradient of all domain corners in one pass, the jacobians are evaluated once at each Gauss point
+    //the integral of shape function value is not needed because it's computed analytically in 2D
+    //the results are the same as the per-corner methods above, and are stored in the scratch
+    void gaussIntegrateShapeFunctionInParticleDomain(CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,2> &scratch, bool gradient_to_reference_coordinate);
+    //scratch space of the calling thread with current and initial domain of the particle loaded
+    CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,2>& loadParticleDomainToScratch(unsigned int object_idx, unsigned int particle_idx);
+protected:
+    std::vector<CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,2> > thread_scratch_; //one for each thread, resized before parallel loops
 };
 
 template <typename Scalar>
@@ -225,6 +270,13 @@ protected:
     SquareMatrix<Scalar,3> particleDomainJacobian(const Vector<Scalar,3> &eval_point, const ArrayND<Vector<Scalar,3>,3> &particle_domain);
     //compute the volume of given particle domain
     Scalar particleDomainVolume(const ArrayND<Vector<Scalar,3>,3> &particle_domain);
+    //integrate the shape function and its gradient of all domain corners in one pass, the jacobians are evaluated once at each Gauss point
+    //the results are the same as the per-corner methods above, and are stored in the scratch
+    void gaussIntegrateShapeFunctionInParticleDomain(CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,3> &scratch, bool gradient_to_reference_coordinate);
+    //scratch space of the calling thread with current and initial domain of the particle loaded
+    CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,3>& loadParticleDomainToScratch(unsigned int object_idx, unsigned int particle_idx);
+protected:
+    std::vector<CPDI2UpdateMethodInternal::ParticleWeightScratch<Scalar,3> > thread_scratch_; //one for each thread, resized before parallel loops
 };
 
 }  //end of namespace Physika
@@ -26,6 +26,7 @@
 #include "Physika_Core/Utilities/physika_assert.h"
 #include "Physika_Geometry/Cartesian_Grids/grid.h"
 #include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
 #include "Physika_Dynamics/MPM/Weight_Function_Influence_Iterators/uniform_grid_weight_function_influence_iterator.h"
 #include "Physika_Dynamics/MPM/CPDI_mpm_solid.h"
 #include "Physika_Dynamics/MPM/CPDI_Update_Methods/CPDI_update_method.h"
@@ -49,9 +50,14 @@ void CPDIUpdateMethod<Scalar,2>::updateParticleInterpolationWeight(const GridWei
                                  std::vector<std::vector<unsigned int> > &particle_grid_pair_num)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
+    int thread_num = static_cast<int>(this->cpdi_driver_->threadNum());
     for(unsigned int i = 0; i < this->cpdi_driver_->objectNum(); ++i)
-        for(unsigned int j = 0; j < this->cpdi_driver_->particleNumOfObject(i); ++j)
+    {
+        int particle_num = static_cast<int>(this->cpdi_driver_->particleData(i).particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int j = 0; j < particle_num; ++j)
             updateParticleInterpolationWeight(i,j,weight_function,particle_grid_weight_and_gradient[i][j],particle_grid_pair_num[i][j]);
+    }
 }
 
 template <typename Scalar>
@@ -61,11 +67,12 @@ void CPDIUpdateMethod<Scalar,2>::updateParticleDomain()
     ArrayND<Vector<Scalar,2>,2> particle_domain;
     for(unsigned int obj_idx = 0; obj_idx < cpdi_driver_->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < cpdi_driver_->particleNumOfObject(obj_idx); ++particle_idx)
+        const SolidParticleData<Scalar,2> &particle_data = cpdi_driver_->particleData(obj_idx);
+        for(unsigned int particle_idx = 0; particle_idx < particle_data.particleNum(); ++particle_idx)
         {
-            SquareMatrix<Scalar,2> deform_grad = (cpdi_driver_->particle(obj_idx,particle_idx)).deformationGradient();
+            const SquareMatrix<Scalar,2> &deform_grad = particle_data.deformationGradient(particle_idx);
             cpdi_driver_->initialParticleDomain(obj_idx,particle_idx,particle_domain);
-            Vector<Scalar,2> particle_pos = (cpdi_driver_->particle(obj_idx,particle_idx)).position();
+            const Vector<Scalar,2> &particle_pos = particle_data.position(particle_idx);
             Vector<unsigned int,2> corner_idx(0);
             Vector<Scalar,2> min_corner = particle_domain(corner_idx);
             corner_idx[0] = 1;
@@ -109,7 +116,7 @@ void CPDIUpdateMethod<Scalar,2>::updateParticleInterpolationWeight(unsigned int
 {
     ArrayND<Vector<Scalar,2>,2> particle_domain;
     this->cpdi_driver_->currentParticleDomain(object_idx,particle_idx,particle_domain);
-    const SolidParticle<Scalar,2> &particle = this->cpdi_driver_->particle(object_idx,particle_idx);
+    Scalar particle_volume = this->cpdi_driver_->particleData(object_idx).volume(particle_idx);
     std::map<unsigned int,Scalar> idx_weight_map;
     std::map<unsigned int,Vector<Scalar,2> > idx_gradient_map;
     const Grid<Scalar,2> &grid = this->cpdi_driver_->grid();
@@ -132,7 +139,7 @@ void CPDIUpdateMethod<Scalar,2>::updateParticleInterpolationWeight(unsigned int
             Scalar corner_weight = weight_function.weight(corner_to_node);
             //weight and gradient correspond to this node
             typename std::map<unsigned int,Vector<Scalar,2> >::iterator gradient_map_iter = idx_gradient_map.find(node_idx_1d);
-            Scalar V_p = particle.volume();
+            Scalar V_p = particle_volume;
             switch(flat_corner_idx)
             {
             case 0:
@@ -274,9 +281,14 @@ void CPDIUpdateMethod<Scalar,3>::updateParticleInterpolationWeight(const GridWei
                                  std::vector<std::vector<unsigned int> > &particle_grid_pair_num)
 {
     PHYSIKA_ASSERT(this->cpdi_driver_);
+    int thread_num = static_cast<int>(this->cpdi_driver_->threadNum());
     for(unsigned int i = 0; i < this->cpdi_driver_->objectNum(); ++i)
-        for(unsigned int j = 0; j < this->cpdi_driver_->particleNumOfObject(i); ++j)
+    {
+        int particle_num = static_cast<int>(this->cpdi_driver_->particleData(i).particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int j = 0; j < particle_num; ++j)
             updateParticleInterpolationWeight(i,j,weight_function,particle_grid_weight_and_gradient[i][j],particle_grid_pair_num[i][j]);
+    }
 }
 
 template <typename Scalar>
@@ -286,11 +298,12 @@ void CPDIUpdateMethod<Scalar,3>::updateParticleDomain()
     ArrayND<Vector<Scalar,3>,3> particle_domain;
     for(unsigned int obj_idx = 0; obj_idx <cpdi_driver_->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < cpdi_driver_->particleNumOfObject(obj_idx); ++particle_idx)
+        const SolidParticleData<Scalar,3> &particle_data = cpdi_driver_->particleData(obj_idx);
+        for(unsigned int particle_idx = 0; particle_idx < particle_data.particleNum(); ++particle_idx)
         {
-            SquareMatrix<Scalar,3> deform_grad = (cpdi_driver_->particle(obj_idx,particle_idx)).deformationGradient();
+            const SquareMatrix<Scalar,3> &deform_grad = particle_data.deformationGradient(particle_idx);
             cpdi_driver_->initialParticleDomain(obj_idx,particle_idx,particle_domain);
-            Vector<Scalar,3> particle_pos = (cpdi_driver_->particle(obj_idx,particle_idx)).position();
+            const Vector<Scalar,3> &particle_pos = particle_data.position(particle_idx);
             Vector<unsigned int,3> corner_idx(0);
             Vector<Scalar,3> min_corner = particle_domain(corner_idx);
             corner_idx[0] = 1;
@@ -340,7 +353,7 @@ void CPDIUpdateMethod<Scalar,3>::updateParticleInterpolationWeight(unsigned int
 {
     ArrayND<Vector<Scalar,3>,3> particle_domain;
     this->cpdi_driver_->currentParticleDomain(object_idx,particle_idx,particle_domain);
-    const SolidParticle<Scalar,3> &particle = this->cpdi_driver_->particle(object_idx,particle_idx);
+    Scalar particle_volume = this->cpdi_driver_->particleData(object_idx).volume(particle_idx);
     std::map<unsigned int,Scalar> idx_weight_map;
     std::map<unsigned int,Vector<Scalar,3> > idx_gradient_map;
     const Grid<Scalar,3> &grid = this->cpdi_driver_->grid();
@@ -364,7 +377,7 @@ void CPDIUpdateMethod<Scalar,3>::updateParticleInterpolationWeight(unsigned int
             Scalar corner_weight = weight_function.weight(corner_to_node);
             //weight and gradient correspond to this node
             typename std::map<unsigned int,Vector<Scalar,3> >::iterator gradient_map_iter = idx_gradient_map.find(node_idx_1d);
-            Scalar V_p = particle.volume();
+            Scalar V_p = particle_volume;
             switch(flat_corner_idx)
             {
             case 0:
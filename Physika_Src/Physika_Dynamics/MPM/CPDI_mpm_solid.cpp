@@ -19,7 +19,9 @@
 #include <map>
 #include "Physika_Core/Utilities/math_utilities.h"
 #include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Core/Utilities/File_Utilities/binary_io.h"
 #include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
 #include "Physika_Dynamics/MPM/mpm_internal.h"
 #include "Physika_Dynamics/MPM/MPM_Plugins/mpm_solid_plugin_base.h"
 #include "Physika_Dynamics/MPM/CPDI_Update_Methods/CPDI2_update_method.h"
@@ -59,19 +61,7 @@ CPDIMPMSolid<Scalar,Dim>::~CPDIMPMSolid()
 template <typename Scalar, int Dim>
 bool CPDIMPMSolid<Scalar,Dim>::withRestartSupport() const
 {
-    return false;
-}
-
-template <typename Scalar, int Dim>
-void CPDIMPMSolid<Scalar,Dim>::write(const std::string &file_name)
-{
-//TO DO
-}
-
-template <typename Scalar, int Dim>
-void CPDIMPMSolid<Scalar,Dim>::read(const std::string &file_name)
-{
-//TO DO
+    return true;
 }
 
 template <typename Scalar, int Dim>
@@ -86,7 +76,7 @@ void CPDIMPMSolid<Scalar,Dim>::updateParticleInterpolationWeight()
             plugin->onUpdateParticleInterpolationWeight();
     }
 
-    PHYSIKA_ASSERT(this->particle_grid_weight_and_gradient_.size() == this->particles_.size());
+    PHYSIKA_ASSERT(this->particle_grid_weight_and_gradient_.size() == this->objectNum());
     PHYSIKA_ASSERT(cpdi_update_method_);
     PHYSIKA_ASSERT(this->weight_function_);
     const GridWeightFunction<Scalar,Dim> &weight_function = *(this->weight_function_);
@@ -350,11 +340,9 @@ void CPDIMPMSolid<Scalar,Dim>::appendAllParticleRelatedDataOfLastObject()
     unsigned int particle_num_of_last_object = this->particleNumOfObject(last_object_idx);
     std::vector<Vector<Scalar,Dim> > particle_domain_corners(corner_num);
     std::vector<std::vector<Vector<Scalar,Dim> > > all_particle_domain_corners(particle_num_of_last_object,particle_domain_corners);
+    const SolidParticleData<Scalar,Dim> &particle_data = this->particleData(last_object_idx);
     for(unsigned int i = 0; i < particle_num_of_last_object; ++i)
-    {
-        const SolidParticle<Scalar,Dim> &particle = this->particle(last_object_idx,i);
-        initParticleDomain(particle,all_particle_domain_corners[i]);
-    }
+        initParticleDomain(particle_data.position(i),particle_data.volume(i),all_particle_domain_corners[i]);
     particle_domain_corners_.push_back(all_particle_domain_corners);
     initial_particle_domain_corners_.push_back(all_particle_domain_corners);
     unsigned int max_num = 1;
@@ -382,10 +370,10 @@ void CPDIMPMSolid<Scalar,Dim>::appendLastParticleRelatedDataOfObject(unsigned in
 {
     MPMSolidBase<Scalar,Dim>::appendLastParticleRelatedDataOfObject(object_idx);
     unsigned int last_particle_idx = this->particleNumOfObject(object_idx) - 1;
-    const SolidParticle<Scalar,Dim> &last_particle = this->particle(object_idx,last_particle_idx);
+    const SolidParticleData<Scalar,Dim> &particle_data = this->particleData(object_idx);
     unsigned int corner_num = Dim==2 ? 4 : 8;
     std::vector<Vector<Scalar,Dim> > particle_domain_corners(corner_num);
-    initParticleDomain(last_particle,particle_domain_corners);
+    initParticleDomain(particle_data.position(last_particle_idx),particle_data.volume(last_particle_idx),particle_domain_corners);
     particle_domain_corners_[object_idx].push_back(particle_domain_corners);
     initial_particle_domain_corners_[object_idx].push_back(particle_domain_corners);
     unsigned int max_num = 1;
@@ -407,7 +395,11 @@ void CPDIMPMSolid<Scalar,Dim>::appendLastParticleRelatedDataOfObject(unsigned in
 template <typename Scalar, int Dim>
 void CPDIMPMSolid<Scalar,Dim>::deleteAllParticleRelatedDataOfObject(unsigned int object_idx)
 {
-    MPMSolid<Scalar,Dim>::deleteAllParticleRelatedDataOfObject(object_idx);
+    MPMSolidBase<Scalar,Dim>::deleteAllParticleRelatedDataOfObject(object_idx);
+    typename std::vector<std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > > >::iterator iter0 =
+        this->particle_grid_weight_and_gradient_.begin() + object_idx;
+    this->particle_grid_weight_and_gradient_.erase(iter0);
+    this->particle_grid_pair_num_.erase(this->particle_grid_pair_num_.begin() + object_idx);
     typename std::vector<std::vector<std::vector<Vector<Scalar,Dim> > > >::iterator iter1
         = particle_domain_corners_.begin() + object_idx;
     particle_domain_corners_.erase(iter1);
@@ -424,7 +416,11 @@ void CPDIMPMSolid<Scalar,Dim>::deleteAllParticleRelatedDataOfObject(unsigned int
 template <typename Scalar, int Dim>
 void CPDIMPMSolid<Scalar,Dim>::deleteOneParticleRelatedDataOfObject(unsigned int object_idx, unsigned int particle_idx)
 {
-    MPMSolid<Scalar,Dim>::deleteOneParticleRelatedDataOfObject(object_idx,particle_idx);
+    MPMSolidBase<Scalar,Dim>::deleteOneParticleRelatedDataOfObject(object_idx,particle_idx);
+    typename std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > >::iterator iter0 =
+        this->particle_grid_weight_and_gradient_[object_idx].begin() + particle_idx;
+    this->particle_grid_weight_and_gradient_[object_idx].erase(iter0);
+    this->particle_grid_pair_num_[object_idx].erase(this->particle_grid_pair_num_[object_idx].begin() + particle_idx);
     typename std::vector<std::vector<Vector<Scalar,Dim> > >::iterator iter1 = particle_domain_corners_[object_idx].begin() + particle_idx;
     particle_domain_corners_[object_idx].erase(iter1);
     typename std::vector<std::vector<Vector<Scalar,Dim> > >::iterator iter2 = initial_particle_domain_corners_[object_idx].begin() + particle_idx;
@@ -437,15 +433,67 @@ void CPDIMPMSolid<Scalar,Dim>::deleteOneParticleRelatedDataOfObject(unsigned int
 }
     
 template <typename Scalar, int Dim>
-void CPDIMPMSolid<Scalar,Dim>::initParticleDomain(const SolidParticle<Scalar,2> &particle,
+void CPDIMPMSolid<Scalar,Dim>::permutateParticleRelatedDataOfObject(unsigned int object_idx, const std::vector<unsigned int> &permutation)
+{
+    MPMSolidBase<Scalar,Dim>::permutateParticleRelatedDataOfObject(object_idx,permutation);
+    MPMInternal::permutateVector(this->particle_grid_weight_and_gradient_[object_idx],permutation);
+    MPMInternal::permutateVector(this->particle_grid_pair_num_[object_idx],permutation);
+    MPMInternal::permutateVector(particle_domain_corners_[object_idx],permutation);
+    MPMInternal::permutateVector(initial_particle_domain_corners_[object_idx],permutation);
+    MPMInternal::permutateVector(corner_grid_weight_[object_idx],permutation);
+    MPMInternal::permutateVector(corner_grid_pair_num_[object_idx],permutation);
+}
+    
+template <typename Scalar, int Dim>
+void CPDIMPMSolid<Scalar,Dim>::writeParticleRelatedDataOfObject(unsigned int object_idx, std::ostream &output) const
+{
+    MPMSolidBase<Scalar,Dim>::writeParticleRelatedDataOfObject(object_idx,output);
+    //current and initial domain corners of each particle, the grid weights are recomputed from the corners
+    unsigned int corner_num = Dim==2 ? 4 : 8;
+    for(unsigned int i = 0; i < particle_domain_corners_[object_idx].size(); ++i)
+        FileUtilities::writeBinary(output,&particle_domain_corners_[object_idx][i][0],corner_num);
+    for(unsigned int i = 0; i < initial_particle_domain_corners_[object_idx].size(); ++i)
+        FileUtilities::writeBinary(output,&initial_particle_domain_corners_[object_idx][i][0],corner_num);
+}
+
+template <typename Scalar, int Dim>
+bool CPDIMPMSolid<Scalar,Dim>::readParticleRelatedDataOfObject(unsigned int object_idx, std::istream &input)
+{
+    if(!MPMSolidBase<Scalar,Dim>::readParticleRelatedDataOfObject(object_idx,input))
+        return false;
+    //the corners are allocated in appendAllParticleRelatedDataOfLastObject()
+    unsigned int corner_num = Dim==2 ? 4 : 8;
+    for(unsigned int i = 0; i < particle_domain_corners_[object_idx].size(); ++i)
+        if(!FileUtilities::readBinary(input,&particle_domain_corners_[object_idx][i][0],corner_num))
+            return false;
+    for(unsigned int i = 0; i < initial_particle_domain_corners_[object_idx].size(); ++i)
+        if(!FileUtilities::readBinary(input,&initial_particle_domain_corners_[object_idx][i][0],corner_num))
+            return false;
+    return true;
+}
+
+template <typename Scalar, int Dim>
+const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim>* CPDIMPMSolid<Scalar,Dim>::particleGridPairs(unsigned int object_idx, unsigned int particle_idx,
+                                                                                                    MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pair_buffer,
+                                                                                                    unsigned int &pair_num) const
+{
+    //the pairs are stored explicitly, the buffer is not used
+    PHYSIKA_ASSERT(object_idx < particle_grid_weight_and_gradient_.size());
+    PHYSIKA_ASSERT(particle_idx < particle_grid_weight_and_gradient_[object_idx].size());
+    pair_num = particle_grid_pair_num_[object_idx][particle_idx];
+    return pair_num > 0 ? &particle_grid_weight_and_gradient_[object_idx][particle_idx][0] : pair_buffer;
+}
+
+template <typename Scalar, int Dim>
+void CPDIMPMSolid<Scalar,Dim>::initParticleDomain(const Vector<Scalar,2> &particle_pos, Scalar particle_volume,
                                                 std::vector<Vector<Scalar,2> > &domain_corner)
 {
     //determine the position of the corners via particle volume and position
     unsigned int corner_num = 4;
     domain_corner.resize(corner_num);
-    Scalar particle_radius = sqrt(particle.volume())/2.0;//assume the particle occupies rectangle space
+    Scalar particle_radius = sqrt(particle_volume)/2.0;//assume the particle occupies rectangle space
     PHYSIKA_ASSERT(Dim==2);
-    Vector<Scalar,2> min_corner = particle.position() - Vector<Scalar,2>(particle_radius);
+    Vector<Scalar,2> min_corner = particle_pos - Vector<Scalar,2>(particle_radius);
     Vector<Scalar,2> bias(0);
     domain_corner[0] = min_corner;
     bias[1] = 2*particle_radius;
@@ -458,15 +506,15 @@ void CPDIMPMSolid<Scalar,Dim>::initParticleDomain(const SolidParticle<Scalar,2>
 }
 
 template <typename Scalar, int Dim>
-void CPDIMPMSolid<Scalar,Dim>::initParticleDomain(const SolidParticle<Scalar,3> &particle,
+void CPDIMPMSolid<Scalar,Dim>::initParticleDomain(const Vector<Scalar,3> &particle_pos, Scalar particle_volume,
                                                 std::vector<Vector<Scalar,3> > &domain_corner)
 {
     //determine the position of the corners via particle volume and position
     unsigned int corner_num = 8;
     domain_corner.resize(corner_num);
-    Scalar particle_radius = pow(particle.volume(),static_cast<Scalar>(1.0/3.0))/2.0;//assume the particle occupies cubic space
+    Scalar particle_radius = pow(particle_volume,static_cast<Scalar>(1.0/3.0))/2.0;//assume the particle occupies cubic space
     PHYSIKA_ASSERT(Dim==3);
-    Vector<Scalar,3> min_corner = particle.position() - Vector<Scalar,3>(particle_radius);
+    Vector<Scalar,3> min_corner = particle_pos - Vector<Scalar,3>(particle_radius);
     Vector<Scalar,3> bias(0);
     for(unsigned int i = 0; i < 2; ++i)
         for(unsigned int j = 0; j < 2; ++j)
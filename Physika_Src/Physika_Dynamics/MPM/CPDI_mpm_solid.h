@@ -36,10 +36,8 @@ public:
     CPDIMPMSolid(unsigned int start_frame, unsigned int end_frame, Scalar frame_rate, Scalar max_dt, bool write_to_file, const Grid<Scalar,Dim> &grid);
     virtual ~CPDIMPMSolid();
     
-    //restart support
+    //restart support, the particle domains are written/read together with the particles, see MPMSolid::write()
     virtual bool withRestartSupport() const;
-    virtual void write(const std::string &file_name);
-    virtual void read(const std::string &file_name);
 
     //re-implemented methods compared to standard MPM
     virtual void updateParticleInterpolationWeight();  //compute the interpolation weight between particles and grid nodes
@@ -70,9 +68,16 @@ protected:
     virtual void appendLastParticleRelatedDataOfObject(unsigned int object_idx);
     virtual void deleteAllParticleRelatedDataOfObject(unsigned int object_idx);
     virtual void deleteOneParticleRelatedDataOfObject(unsigned int object_idx, unsigned int particle_idx);
+    virtual void permutateParticleRelatedDataOfObject(unsigned int object_idx, const std::vector<unsigned int> &permutation);
+    virtual void writeParticleRelatedDataOfObject(unsigned int object_idx, std::ostream &output) const;
+    virtual bool readParticleRelatedDataOfObject(unsigned int object_idx, std::istream &input);
+    //the particle-grid pairs are stored explicitly in CPDI
+    virtual const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim>* particleGridPairs(unsigned int object_idx, unsigned int particle_idx,
+                                                                                      MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pair_buffer,
+                                                                                      unsigned int &pair_num) const;
     //trait method to init particle domain
-    void initParticleDomain(const SolidParticle<Scalar,2> &particle, std::vector<Vector<Scalar,2> > &domain_corner);
-    void initParticleDomain(const SolidParticle<Scalar,3> &particle, std::vector<Vector<Scalar,3> > &domain_corner);
+    void initParticleDomain(const Vector<Scalar,2> &particle_pos, Scalar particle_volume, std::vector<Vector<Scalar,2> > &domain_corner);
+    void initParticleDomain(const Vector<Scalar,3> &particle_pos, Scalar particle_volume, std::vector<Vector<Scalar,3> > &domain_corner);
 protected:
     std::vector<std::vector<std::vector<Vector<Scalar,Dim> > > > particle_domain_corners_;  //current particle domain corners
     std::vector<std::vector<std::vector<Vector<Scalar,Dim> > > > initial_particle_domain_corners_; //initial particle domain corners
@@ -80,6 +85,10 @@ protected:
     //needed in CPDI2
     std::vector<std::vector<std::vector<std::vector<MPMInternal::NodeIndexWeightPair<Scalar,Dim> > > > > corner_grid_weight_;
     std::vector<std::vector<std::vector<unsigned int> > > corner_grid_pair_num_; //the number of pairs for each corner of each particle
+    //the grid nodes in range of a particle are those in range of its domain corners, which are not tensor-product stencils
+    //hence the weights and gradients are stored explicitly, for each particle of each object: [object_idx][particle_idx][pair_idx]
+    std::vector<std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > > > particle_grid_weight_and_gradient_;
+    std::vector<std::vector<unsigned int> > particle_grid_pair_num_; //the number of pairs in particle_grid_weight_and_gradient_
     CPDIUpdateMethod<Scalar,Dim> *cpdi_update_method_; //the cpdi method used to update particle domain
 };
 
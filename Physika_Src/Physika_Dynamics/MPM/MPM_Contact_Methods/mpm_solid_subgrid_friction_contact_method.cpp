@@ -21,6 +21,7 @@
 #include "Physika_Core/Utilities/math_utilities.h"
 #include "Physika_Geometry/Cartesian_Grids/grid.h"
 #include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
 #include "Physika_Dynamics/MPM/mpm_solid.h"
 #include "Physika_Dynamics/MPM/MPM_Contact_Methods/mpm_solid_subgrid_friction_contact_method.h"
 
@@ -212,10 +213,10 @@ void MPMSolidSubgridFrictionContactMethod<Scalar,Dim>::initParticleBucket(const
     for(std::set<unsigned int>::iterator iter = objects.begin(); iter != objects.end(); ++iter)
     {
         unsigned int obj_idx = *iter;
-        for(unsigned int particle_idx = 0; particle_idx < mpm_solid_driver->particleNumOfObject(obj_idx); ++particle_idx)
+        const SolidParticleData<Scalar,Dim> &particle_data = mpm_solid_driver->particleData(obj_idx);
+        for(unsigned int particle_idx = 0; particle_idx < particle_data.particleNum(); ++particle_idx)
         {
-            const SolidParticle<Scalar,Dim> &particle = mpm_solid_driver->particle(obj_idx,particle_idx);
-            Vector<Scalar,Dim> particle_pos = particle.position();
+            const Vector<Scalar,Dim> &particle_pos = particle_data.position(particle_idx);
             Vector<unsigned int,Dim>  bucket_idx;
             Vector<Scalar,Dim> bias_in_cell;
             grid.cellIndexAndBiasInCell(particle_pos,bucket_idx,bias_in_cell);
@@ -338,14 +339,16 @@ void MPMSolidSubgridFrictionContactMethod<Scalar,Dim>::resolveContactBetweenTwoO
             particles_obj2.insert(particles_obj2.end(),particles_in_cell_obj2.begin(),particles_in_cell_obj2.end());
         }
         Scalar min_dist = (std::numeric_limits<Scalar>::max)();
+        const SolidParticleData<Scalar,Dim> &particle_data1 = mpm_solid_driver->particleData(object_idx1);
+        const SolidParticleData<Scalar,Dim> &particle_data2 = mpm_solid_driver->particleData(object_idx2);
         for(unsigned int i = 0; i < particles_obj1.size(); ++i)
         {
-            const SolidParticle<Scalar,Dim> &particle1 = mpm_solid_driver->particle(object_idx1,particles_obj1[i]);
+            const Vector<Scalar,Dim> &particle1_pos = particle_data1.position(particles_obj1[i]);
             for(unsigned int j = 0; j < particles_obj2.size(); ++j)
             {
-                const SolidParticle<Scalar,Dim> &particle2 = mpm_solid_driver->particle(object_idx2,particles_obj2[j]);
-                //Scalar dist = (particle1.position() - particle2.position()).dot(obj1_normal);
-                Scalar dist = (particle1.position() - particle2.position()).norm();
+                const Vector<Scalar,Dim> &particle2_pos = particle_data2.position(particles_obj2[j]);
+                //Scalar dist = (particle1_pos - particle2_pos).dot(obj1_normal);
+                Scalar dist = (particle1_pos - particle2_pos).norm();
                 if(dist < 0)
                     dist = -dist;
                 if(dist < min_dist)
@@ -36,6 +36,8 @@ public:
     virtual void setDriver(DriverBase<Scalar>* driver);
 
     //MPM Solid driver specific virtual methods
+    //onSolveOnGrid() is called on the rasterized grid; if MPMSolid fuses rasterization and explicit solve (single object
+    //without contact method), the grid has mass but the velocity slots still hold the momentum when it's called
     virtual void onRasterize() = 0;
     virtual void onSolveOnGrid(Scalar dt) = 0;
     virtual void onResolveContactOnGrid(Scalar dt) = 0;
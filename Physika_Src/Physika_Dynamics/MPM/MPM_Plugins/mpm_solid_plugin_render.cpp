@@ -31,6 +31,7 @@
 #include "Physika_Render/Color/color.h"
 #include "Physika_Geometry/Cartesian_Grids/grid.h"
 #include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
 #include "Physika_Dynamics/MPM/CPDI_mpm_solid.h"
 #include "Physika_Dynamics/MPM/MPM_Plugins/mpm_solid_plugin_render.h"
 
@@ -340,9 +341,9 @@ void MPMSolidPluginRender<Scalar,Dim>::renderParticles()
     unsigned int total_particle_idx = 0;
     for(unsigned int obj_idx = 0; obj_idx < driver->objectNum(); ++obj_idx)
     {
-        const std::vector<SolidParticle<Scalar,Dim>*> &all_particles = driver->allParticlesOfObject(obj_idx);
-        for(unsigned int i = 0; i < all_particles.size(); ++i)
-            particle_pos[total_particle_idx++] = all_particles[i]->position();
+        const SolidParticleData<Scalar,Dim> &particle_data = driver->particleData(obj_idx);
+        for(unsigned int i = 0; i < particle_data.particleNum(); ++i)
+            particle_pos[total_particle_idx++] = particle_data.position(i);
     }
     PointRender<Scalar,Dim> point_render(particle_pos,total_particle_num);
     if(this->particle_render_mode_ == 0)
@@ -353,11 +354,14 @@ void MPMSolidPluginRender<Scalar,Dim>::renderParticles()
         //determine sphere size according to particle volume, assumes particle occupies rectangluar space
         total_particle_idx = 0;
         for(unsigned int obj_idx = 0; obj_idx < driver->objectNum(); ++obj_idx)
-            for(unsigned int particle_idx = 0; particle_idx < driver->particleNumOfObject(obj_idx); ++particle_idx)
+        {
+            const SolidParticleData<Scalar,Dim> &particle_data = driver->particleData(obj_idx);
+            for(unsigned int particle_idx = 0; particle_idx < particle_data.particleNum(); ++particle_idx)
             {
-                const SolidParticle<Scalar,Dim> &particle = driver->particle(obj_idx,particle_idx);
-                point_size[total_particle_idx++] = (Dim==2) ? sqrt(particle.volume())/2.0 : pow(particle.volume(),static_cast<Scalar>(1.0/3.0))/2.0;
+                Scalar particle_vol = particle_data.volume(particle_idx);
+                point_size[total_particle_idx++] = (Dim==2) ? sqrt(particle_vol)/2.0 : pow(particle_vol,static_cast<Scalar>(1.0/3.0))/2.0;
             }
+        }
         point_render.setPointSize(point_size);
         point_render.setRenderAsSphere();
     }
@@ -382,11 +386,11 @@ void MPMSolidPluginRender<Scalar,Dim>::renderParticleVelocity()
     glDisable(GL_LIGHTING);
     for(unsigned int obj_idx = 0; obj_idx < driver->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < driver->particleNumOfObject(obj_idx); ++particle_idx)
+        const SolidParticleData<Scalar,Dim> &particle_data = driver->particleData(obj_idx);
+        for(unsigned int particle_idx = 0; particle_idx < particle_data.particleNum(); ++particle_idx)
         {
-            const SolidParticle<Scalar,Dim>& particle = driver->particle(obj_idx,particle_idx);
-            Vector<Scalar,Dim> start = particle.position();
-            Vector<Scalar,Dim> end = start + (this->velocity_scale_)*particle.velocity();
+            Vector<Scalar,Dim> start = particle_data.position(particle_idx);
+            Vector<Scalar,Dim> end = start + (this->velocity_scale_)*particle_data.velocity(particle_idx);
             glBegin(GL_LINES);
             openGLVertex(start);
             openGLVertex(end);
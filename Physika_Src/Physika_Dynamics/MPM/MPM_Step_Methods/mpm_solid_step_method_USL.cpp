@@ -42,8 +42,7 @@ void MPMSolidStepMethodUSL<Scalar,Dim>::advanceStep(Scalar dt)
     }
     //now advance step, the constitutive model state 
     //of the particles are updated at the end of time step
-    mpm_solid_driver->rasterize();
-    mpm_solid_driver->solveOnGrid(dt);
+    mpm_solid_driver->rasterizeAndSolveOnGrid(dt);
     mpm_solid_driver->resolveContactOnGrid(dt);
     mpm_solid_driver->updateParticleVelocity();
     mpm_solid_driver->applyExternalForceOnParticles(dt);
@@ -15,7 +15,6 @@
 #include <limits>
 #include "Physika_Core/Vectors/vector_2d.h"
 #include "Physika_Core/Vectors/vector_3d.h"
-#include "Physika_Core/Range/range.h"
 #include "Physika_Core/Grid_Weight_Functions/grid_weight_function.h"
 #include "Physika_Dynamics/MPM/Weight_Function_Influence_Iterators/uniform_grid_weight_function_influence_iterator.h"
 
@@ -27,14 +26,14 @@ UniformGridWeightFunctionInfluenceIterator(const Grid<Scalar,Dim> &grid, const V
                                            const GridWeightFunction<Scalar,Dim> &weight_function)
  :grid_(&grid)
 {
-    initNodeIdxGrid(influence_center,weight_function.supportRadius());
-    node_iter_ = node_idx_grid_.nodeBegin();
+    initNodeRange(influence_center,weight_function.supportRadius());
+    node_idx_ = min_node_idx_;
 }
 
 template <typename Scalar, int Dim>
 UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::
 UniformGridWeightFunctionInfluenceIterator(const UniformGridWeightFunctionInfluenceIterator<Scalar,Dim> &iterator)
-    :grid_(iterator.grid_),node_idx_grid_(iterator.node_idx_grid_),node_iter_(iterator.node_iter_)
+    :grid_(iterator.grid_),min_node_idx_(iterator.min_node_idx_),node_num_(iterator.node_num_),node_idx_(iterator.node_idx_)
 {
 }
 
@@ -49,56 +48,43 @@ UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>& UniformGridWeightFunctio
 operator= (const UniformGridWeightFunctionInfluenceIterator<Scalar,Dim> &iterator)
 {
     grid_ = iterator.grid_;
-    node_idx_grid_ = iterator.node_idx_grid_;
-    node_iter_ = iterator.node_iter_;
+    min_node_idx_ = iterator.min_node_idx_;
+    node_num_ = iterator.node_num_;
+    node_idx_ = iterator.node_idx_;
     return *this;
 }
 
-template <typename Scalar, int Dim>
-bool UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::valid() const
-{
-    bool status = (node_iter_ != node_idx_grid_.nodeEnd());
-    return status;
-}
-
 template <typename Scalar, int Dim>
 UniformGridWeightFunctionInfluenceIterator<Scalar,Dim> UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::next() const
 {
     UniformGridWeightFunctionInfluenceIterator<Scalar,Dim> result(*this);
-    ++(result.node_iter_);
+    ++result;
     return result;
 }
 
-template <typename Scalar, int Dim>
-UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>& UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::
-operator++ ()
-{
-    ++node_iter_;
-    return *this;
-}
-
 template <typename Scalar, int Dim>
 UniformGridWeightFunctionInfluenceIterator<Scalar,Dim> UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::
 operator++ (int)
 {
     UniformGridWeightFunctionInfluenceIterator<Scalar,Dim> result(*this);
-    ++node_iter_;
+    ++(*this);
     return result;
 }
 
 template <typename Scalar, int Dim>
-Vector<unsigned int,Dim> UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::nodeIndex() const
+const Vector<unsigned int,Dim>& UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::minNodeIndex() const
 {
-    if(this->valid()==false)
-    {
-        std::cerr<<"Error: invalid UniformGridWeightFunctionInfluenceIterator, program abort!\n";
-        std::exit(EXIT_FAILURE);
-    }
-    return node_idx_grid_.node(node_iter_.nodeIndex());
+    return min_node_idx_;
+}
+
+template <typename Scalar, int Dim>
+const Vector<unsigned int,Dim>& UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::nodeNum() const
+{
+    return node_num_;
 }
 
 template <typename Scalar, int Dim>
-void UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::initNodeIdxGrid(const Vector<Scalar,Dim> &influence_center, Scalar influence_radius_scale)
+void UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::initNodeRange(const Vector<Scalar,Dim> &influence_center, Scalar influence_radius_scale)
 {
     Vector<Scalar,Dim> influence_radius, cell_dx = grid_->dX();
     for(unsigned int i = 0; i < Dim; ++i)
@@ -117,19 +103,17 @@ void UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::initNodeIdxGrid(con
     }
     Vector<unsigned int,Dim> cell_idx;
     Vector<Scalar,Dim> weight;
-    Range<unsigned int,Dim> node_idx_range;
     grid_->cellIndexAndBiasInCell(influence_domain_min_corner,cell_idx,weight);
     for(unsigned int i = 0; i < Dim; ++i)
         if(weight[i] > std::numeric_limits<Scalar>::epsilon())
             ++cell_idx[i];
-    node_idx_range.setMinCorner(cell_idx);
+    min_node_idx_ = cell_idx;
     grid_->cellIndexAndBiasInCell(influence_domain_max_corner,cell_idx,weight);
     for(unsigned int i = 0; i < Dim; ++i)
         if(weight[i] > 1.0 - std::numeric_limits<Scalar>::epsilon())
             ++cell_idx[i];
-    node_idx_range.setMaxCorner(cell_idx);
-    node_idx_grid_.setDomain(node_idx_range);
-    node_idx_grid_.setCellNum(node_idx_range.edgeLengths());
+    for(unsigned int i = 0; i < Dim; ++i)
+        node_num_[i] = cell_idx[i] - min_node_idx_[i] + 1;
 }
 
 //explicit instantiations
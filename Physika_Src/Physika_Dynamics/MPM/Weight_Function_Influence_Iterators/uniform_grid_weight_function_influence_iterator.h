@@ -15,12 +15,14 @@
 #ifndef PHYSIKA_DYNAMICS_MPM_WEIGHT_FUNCTION_INFLUENCE_ITERATORS_UNIFORM_GRID_WEIGHT_FUNCTION_INFLUENCE_ITERATOR_H_
 #define PHYSIKA_DYNAMICS_MPM_WEIGHT_FUNCTION_INFLUENCE_ITERATORS_UNIFORM_GRID_WEIGHT_FUNCTION_INFLUENCE_ITERATOR_H_
 
+#include <cstdlib>
+#include <iostream>
+#include "Physika_Core/Vectors/vector_2d.h"
+#include "Physika_Core/Vectors/vector_3d.h"
 #include "Physika_Geometry/Cartesian_Grids/grid.h"
 
 namespace Physika{
 
-template <typename Scalar, int Dim> class Vector;
-template <typename Scalar, int Dim> class Range;
 template <typename Scalar, int Dim> class GridWeightFunction;
 
 /*
@@ -45,7 +47,10 @@ template <typename Scalar, int Dim> class GridWeightFunction;
  *    }   
  *
  * Note: 
- *      next() method could be replaced with ++ operator
+ *      1. next() method could be replaced with ++ operator
+ *      2. the nodes in range form a box [minNodeIndex(), minNodeIndex() + nodeNum()), which is clamped to the grid.
+ *         The nodes are visited in the same order as GridNodeIterator, i.e., the last dimension varies fastest
+ *      3. the iterator is lightweight, no memory allocation or grid construction is involved
  */
 
 template <typename Scalar, int Dim>
@@ -63,16 +68,52 @@ public:
     UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>& operator++ ();
     UniformGridWeightFunctionInfluenceIterator<Scalar,Dim> operator++ (int);
     Vector<unsigned int,Dim> nodeIndex() const;
+    const Vector<unsigned int,Dim>& minNodeIndex() const; //the first node in range
+    const Vector<unsigned int,Dim>& nodeNum() const; //number of nodes in range along each dimension
 protected:
-    void initNodeIdxGrid(const Vector<Scalar,Dim> &influence_center, Scalar influence_radius_scale);
+    void initNodeRange(const Vector<Scalar,Dim> &influence_center, Scalar influence_radius_scale);
 protected:
     const Grid<Scalar,Dim> *grid_;  //reference to grid
-    Grid<unsigned int,Dim> node_idx_grid_; //grid whose node is position is the valid grid node index
-    typename Grid<unsigned int,Dim>::NodeIterator node_iter_; //current node iterator in the node index grid
+    Vector<unsigned int,Dim> min_node_idx_;  //the box of nodes in range
+    Vector<unsigned int,Dim> node_num_;
+    Vector<unsigned int,Dim> node_idx_; //current node, node_idx_[0] == min_node_idx_[0] + node_num_[0] if the iterator is at end
     //prohibit default constructor
     UniformGridWeightFunctionInfluenceIterator();
 };
 
+//the methods called for each node are inlined
+
+template <typename Scalar, int Dim>
+inline bool UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::valid() const
+{
+    return node_idx_[0] < min_node_idx_[0] + node_num_[0];
+}
+
+template <typename Scalar, int Dim>
+inline UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>& UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::operator++ ()
+{
+    //the last dimension varies fastest
+    for(int i = Dim - 1; i > 0; --i)
+    {
+        if(++node_idx_[i] < min_node_idx_[i] + node_num_[i])
+            return *this;
+        node_idx_[i] = min_node_idx_[i];
+    }
+    ++node_idx_[0];
+    return *this;
+}
+
+template <typename Scalar, int Dim>
+inline Vector<unsigned int,Dim> UniformGridWeightFunctionInfluenceIterator<Scalar,Dim>::nodeIndex() const
+{
+    if(this->valid()==false)
+    {
+        std::cerr<<"Error: invalid UniformGridWeightFunctionInfluenceIterator, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    return node_idx_;
+}
+
 }  //end of namespace Physika
 
 #endif //PHYSIKA_DYNAMICS_MPM_WEIGHT_FUNCTION_INFLUENCE_ITERATORS_UNIFORM_GRID_WEIGHT_FUNCTION_INFLUENCE_ITERATOR_H_
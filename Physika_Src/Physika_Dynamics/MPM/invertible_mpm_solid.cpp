@@ -22,9 +22,12 @@
 #include "Physika_Core/Arrays/array_Nd.h"
 #include "Physika_Core/Utilities/physika_assert.h"
 #include "Physika_Core/Utilities/math_utilities.h"
+#include "Physika_Core/Utilities/File_Utilities/binary_io.h"
 #include "Physika_Geometry/Volumetric_Meshes/quad_mesh.h"
 #include "Physika_Geometry/Volumetric_Meshes/cubic_mesh.h"
 #include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
+#include "Physika_Dynamics/Constitutive_Models/constitutive_model.h"
 #include "Physika_Dynamics/MPM/CPDI_Update_Methods/CPDI2_update_method.h"
 #include "Physika_Dynamics/MPM/Weight_Function_Influence_Iterators/uniform_grid_weight_function_influence_iterator.h"
 #include "Physika_Dynamics/MPM/MPM_Plugins/mpm_solid_plugin_base.h"
@@ -68,28 +71,26 @@ InvertibleMPMSolid<Scalar,Dim>::~InvertibleMPMSolid()
 template <typename Scalar, int Dim>
 bool InvertibleMPMSolid<Scalar,Dim>::withRestartSupport() const
 {
-    return false;
-}
-
-template <typename Scalar, int Dim>
-void InvertibleMPMSolid<Scalar,Dim>::write(const std::string &file_name)
-{
-    //TO DO
-}
-
-template <typename Scalar, int Dim>
-void InvertibleMPMSolid<Scalar,Dim>::read(const std::string &file_name)
-{
-    //TO DO
+    return true;
 }
 
 template <typename Scalar, int Dim>
 void InvertibleMPMSolid<Scalar,Dim>::initSimulationData()
 {
-    constructParticleDomainMesh();
-    resetParticleDomainData();
+    //on restart, the particle domain mesh is loaded with the particles unless it's not constructed when written
+    if(this->restart_)
+        this->read(this->frameFileName(this->restart_frame_));
+    bool with_particle_domain_mesh = this->restart_ && particle_domain_mesh_.size() == this->objectNum();
+    for(unsigned int obj_idx = 0; with_particle_domain_mesh && obj_idx < particle_domain_mesh_.size(); ++obj_idx)
+        with_particle_domain_mesh = particle_domain_mesh_[obj_idx] != NULL;
+    if(!with_particle_domain_mesh)
+    {
+        constructParticleDomainMesh();
+        resetParticleDomainData();
+    }
     computeParticleInterpolationWeightAndGradientInInitialDomain(); //precomputation, in reference configuration
-    MPMSolid<Scalar,Dim>::initSimulationData();
+    this->resetGridData();
+    this->updateParticleInterpolationWeight();
 }
 
 template <typename Scalar, int Dim>
@@ -110,11 +111,13 @@ void InvertibleMPMSolid<Scalar,Dim>::rasterize()
     resetParticleDomainData();
     updateParticleDomainEnrichState();  //set the particle domain as enriched or not according to some criteria
 
+    //ordinary particle && transient particle get influence from grid, see isParticleRasterizedToGrid()
+    this->rasterizeMassAndMomentum();
     for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        const SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        for(unsigned int particle_idx = 0; particle_idx < particle_data.particleNum(); ++particle_idx)
         {
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
             //determine particle type:
             //ordinary: rasterize to grid
             //transient: rasterize to grid and the enriched domain corners
@@ -127,28 +130,6 @@ void InvertibleMPMSolid<Scalar,Dim>::rasterize()
                 if(is_enriched_domain_corner_[obj_idx][global_corner_idx])
                     ++enriched_corner_num;
             }
-            if(enriched_corner_num < corner_num) //ordinary particle && transient particle get influence from grid
-            {
-                //rasterize to grid
-                for(unsigned int i = 0; i < this->particle_grid_pair_num_[obj_idx][particle_idx]; ++i)
-                {
-                    const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> &pair = this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i];
-                    Scalar weight = pair.weight_value_;
-                    PHYSIKA_ASSERT(weight > std::numeric_limits<Scalar>::epsilon());
-                    typename std::map<unsigned int,Scalar>::iterator iter = this->grid_mass_(pair.node_idx_).find(obj_idx);
-                    if(iter != this->grid_mass_(pair.node_idx_).end())
-                        this->grid_mass_(pair.node_idx_)[obj_idx] += weight*particle->mass();
-                    else
-                        this->grid_mass_(pair.node_idx_).insert(std::make_pair(obj_idx,weight*particle->mass()));
-                    if(this->is_dirichlet_grid_node_(pair.node_idx_).count(obj_idx) > 0) //skip the velocity update of boundary nodes
-                        continue;
-                    typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator iter2 = this->grid_velocity_(pair.node_idx_).find(obj_idx);
-                    if(iter2 != this->grid_velocity_(pair.node_idx_).end())
-                        this->grid_velocity_(pair.node_idx_)[obj_idx] += weight*(particle->mass()*particle->velocity());
-                    else
-                        this->grid_velocity_(pair.node_idx_).insert(std::make_pair(obj_idx,weight*(particle->mass()*particle->velocity())));
-                }
-            }
             //transient/enriched particle needs to rasterize to enriched corners as well
             if(enriched_corner_num > 0)
             {
@@ -158,8 +139,8 @@ void InvertibleMPMSolid<Scalar,Dim>::rasterize()
                     if(is_enriched_domain_corner_[obj_idx][global_corner_idx])
                     {
                         Scalar weight = particle_corner_weight_[obj_idx][particle_idx][corner_idx];
-                        domain_corner_mass_[obj_idx][global_corner_idx] += weight*particle->mass();
-                        domain_corner_velocity_[obj_idx][global_corner_idx] += weight*(particle->mass()*particle->velocity());
+                        domain_corner_mass_[obj_idx][global_corner_idx] += weight*particle_data.mass(particle_idx);
+                        domain_corner_velocity_[obj_idx][global_corner_idx] += weight*(particle_data.mass(particle_idx)*particle_data.velocity(particle_idx));
                     }
                 } 
             }
@@ -172,74 +153,14 @@ void InvertibleMPMSolid<Scalar,Dim>::rasterize()
                 domain_corner_velocity_before_[obj_idx][corner_idx] = domain_corner_velocity_[obj_idx][corner_idx];
             }
     }    
-    //determine active grid nodes according to the grid mass of each object
-    Vector<unsigned int,Dim> grid_node_num = this->grid_.nodeNum();
-    std::map<unsigned int,Vector<unsigned int,Dim> > active_node_idx_1d_nd_map;
-    for(typename ArrayND<std::map<unsigned int,Scalar>,Dim>::Iterator iter = this->grid_mass_.begin(); iter != this->grid_mass_.end(); ++iter)
-    {
-        Vector<unsigned int,Dim> node_idx = iter.elementIndex();
-        for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
-        {
-            if(this->gridMass(obj_idx,node_idx)>std::numeric_limits<Scalar>::epsilon())
-            {
-                unsigned int node_idx_1d = this->flatIndex(node_idx,grid_node_num);
-                this->active_grid_node_.insert(std::make_pair(node_idx_1d,obj_idx));
-                active_node_idx_1d_nd_map.insert(std::make_pair(node_idx_1d,node_idx));
-            }
-        }
-    }
-    //compute grid's velocity, divide momentum by mass
-    for(typename std::multimap<unsigned int,unsigned int>::iterator iter = this->active_grid_node_.begin(); iter != this->active_grid_node_.end(); ++iter)
-    {
-        unsigned int node_idx_1d = iter->first, object_idx = iter->second;
-        Vector<unsigned int,Dim> node_idx = active_node_idx_1d_nd_map[node_idx_1d];
-        if(this->is_dirichlet_grid_node_(node_idx).count(object_idx) == 0) //skip grid nodes that are boundary condition
-            this->grid_velocity_(node_idx)[object_idx] /= this->grid_mass_(node_idx)[object_idx];
-        this->grid_velocity_before_(node_idx)[object_idx] = this->grid_velocity_(node_idx)[object_idx];  //buffer the grid velocity before any update
-    }
-    //if no special contact algorithm is used, multi-value at a grid node must be converted to single value for all involved objects
-    if(this->contact_method_==NULL)
-    {
-        for(typename std::map<unsigned int,Vector<unsigned int,Dim> >::iterator iter = active_node_idx_1d_nd_map.begin();
-            iter != active_node_idx_1d_nd_map.end(); ++iter)
-        {
-            unsigned int node_idx_1d = iter->first;
-            Vector<unsigned int,Dim> node_idx = iter->second;
-            if(this->active_grid_node_.count(node_idx_1d) == 1) //skip single-valued node
-                continue;
-            std::multimap<unsigned int,unsigned int>::iterator beg = this->active_grid_node_.lower_bound(node_idx_1d),
-                end = this->active_grid_node_.upper_bound(node_idx_1d);
-            std::multimap<unsigned int,unsigned int>::iterator cur = beg;
-            Scalar mass_at_node = 0;
-            Vector<Scalar,Dim> momentum_at_node(0);
-            //accummulate values of all involved objects at this node
-            while(cur != end)
-            {
-                mass_at_node += this->grid_mass_(node_idx)[cur->second];
-                momentum_at_node += this->grid_mass_(node_idx)[cur->second] * this->grid_velocity_(node_idx)[cur->second];
-                ++cur;
-            }
-            momentum_at_node /= mass_at_node;//velocity at node
-            //set all involved objects to uniform value at this node
-            for(typename std::map<unsigned int,Scalar>::iterator mass_iter = this->grid_mass_(node_idx).begin(); mass_iter != this->grid_mass_(node_idx).end(); ++mass_iter)
-                mass_iter->second = mass_at_node;
-            //if for any involved object, this node is set as dirichlet, then the node is dirichlet for all objects
-            for(typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator vel_iter = this->grid_velocity_(node_idx).begin();
-                vel_iter != this->grid_velocity_(node_idx).end(); ++vel_iter)
-                if(this->is_dirichlet_grid_node_(node_idx).count(vel_iter->first))
-                {
-                    momentum_at_node = vel_iter->second;
-                    break;
-                }
-            //set the velocity
-            for(typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator vel_iter = this->grid_velocity_(node_idx).begin();
-                vel_iter != this->grid_velocity_(node_idx).end(); ++vel_iter)
-            {
-                vel_iter->second = momentum_at_node;
-                this->grid_velocity_before_(node_idx)[vel_iter->first] = vel_iter->second; //buffer the grid velocity before any update
-            }
-        }
-    }
+    //compute grid's velocity
+    this->computeGridVelocity();
+}
+
+template <typename Scalar, int Dim>
+void InvertibleMPMSolid<Scalar,Dim>::rasterizeAndSolveOnGrid(Scalar dt)
+{
+    MPMSolidBase<Scalar,Dim>::rasterizeAndSolveOnGrid(dt);
 }
 
 template <typename Scalar, int Dim>
@@ -269,10 +190,10 @@ void InvertibleMPMSolid<Scalar,Dim>::resolveContactOnParticles(Scalar dt)
     typedef UniformGridWeightFunctionInfluenceIterator<Scalar,Dim> InfluenceIterator;
     for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        const SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        for(unsigned int particle_idx = 0; particle_idx < particle_data.particleNum(); ++particle_idx)
         {
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
-            Vector<Scalar,Dim> particle_pos = particle->position();
+            const Vector<Scalar,Dim> &particle_pos = particle_data.position(particle_idx);
             for(InfluenceIterator iter(this->grid_,particle_pos,*(this->weight_function_)); iter.valid(); ++iter)
             {
                 Vector<unsigned int,Dim> node_idx = iter.nodeIndex();
@@ -286,9 +207,9 @@ void InvertibleMPMSolid<Scalar,Dim>::resolveContactOnParticles(Scalar dt)
                     Vector<Scalar,Dim> weight_gradient = this->weight_function_->gradient(particle_to_node);
                     typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator normal_iter = grid_normal(node_idx).find(obj_idx);
                     if(normal_iter != grid_normal(node_idx).end())
-                        grid_normal(node_idx)[obj_idx] += weight_gradient*particle->mass();
+                        grid_normal(node_idx)[obj_idx] += weight_gradient*particle_data.mass(particle_idx);
                     else
-                        grid_normal(node_idx).insert(std::make_pair(obj_idx,weight_gradient*particle->mass()));
+                        grid_normal(node_idx).insert(std::make_pair(obj_idx,weight_gradient*particle_data.mass(particle_idx)));
                 }
             }
         }
@@ -303,8 +224,7 @@ void InvertibleMPMSolid<Scalar,Dim>::resolveContactOnParticles(Scalar dt)
         for(unsigned int enriched_idx = 0; enriched_idx < enriched_particles_[obj_idx].size(); ++enriched_idx)
         {
             unsigned int particle_idx = enriched_particles_[obj_idx][enriched_idx];
-            const SolidParticle<Scalar,Dim> &particle = this->particle(obj_idx,particle_idx);
-            Vector<Scalar,Dim> particle_pos = particle.position();
+            Vector<Scalar,Dim> particle_pos = this->particleData(obj_idx).position(particle_idx);
             Vector<unsigned int,Dim>  cell_idx;
             Vector<Scalar,Dim> bias_in_cell;
             (this->grid_).cellIndexAndBiasInCell(particle_pos,cell_idx,bias_in_cell);
@@ -366,10 +286,10 @@ void InvertibleMPMSolid<Scalar,Dim>::resolveContactOnParticles(Scalar dt)
                 for(unsigned int k = 0; k < obj1_particles.size(); ++k)
                 {
                     unsigned int particle_idx1 = obj1_particles[k];
-                    SolidParticle<Scalar,Dim> &obj1_particle = this->particle(obj_idx1,particle_idx1);
-                    Vector<Scalar,Dim> particle1_pos = obj1_particle.position();
-                    Vector<Scalar,Dim> particle1_vel = obj1_particle.velocity();
-                    Scalar particle1_mass = obj1_particle.mass();
+                    SolidParticleData<Scalar,Dim> &obj1_particle_data = this->particleData(obj_idx1);
+                    Vector<Scalar,Dim> particle1_pos = obj1_particle_data.position(particle_idx1);
+                    Vector<Scalar,Dim> particle1_vel = obj1_particle_data.velocity(particle_idx1);
+                    Scalar particle1_mass = obj1_particle_data.mass(particle_idx1);
                     Vector<Scalar,Dim> particle1_normal(0);
                     //interpolate particle normal from the cell nodes
                     if(Dim == 2)
@@ -407,10 +327,10 @@ void InvertibleMPMSolid<Scalar,Dim>::resolveContactOnParticles(Scalar dt)
                     for(unsigned int  m = 0; m < obj2_particles.size(); ++m)
                     {
                         unsigned int particle_idx2 = obj2_particles[m];
-                        SolidParticle<Scalar,Dim> &obj2_particle = this->particle(obj_idx2,particle_idx2);
-                        Vector<Scalar,Dim> particle2_pos = obj2_particle.position();
-                        Vector<Scalar,Dim> particle2_vel = obj2_particle.velocity();
-                        Scalar particle2_mass = obj2_particle.mass();
+                        SolidParticleData<Scalar,Dim> &obj2_particle_data = this->particleData(obj_idx2);
+                        Vector<Scalar,Dim> particle2_pos = obj2_particle_data.position(particle_idx2);
+                        Vector<Scalar,Dim> particle2_vel = obj2_particle_data.velocity(particle_idx2);
+                        Scalar particle2_mass = obj2_particle_data.mass(particle_idx2);
                         Vector<Scalar,Dim> particle2_normal;
                         //interpolate particle normal from the cell nodes
                         if(Dim == 2)
@@ -455,8 +375,8 @@ void InvertibleMPMSolid<Scalar,Dim>::resolveContactOnParticles(Scalar dt)
                         {
                             //simple contact model: two particles have the same new velocity
                             Vector<Scalar,Dim> new_vel = (particle1_mass*particle1_vel+particle2_mass*particle2_vel)/(particle1_mass+particle2_mass);
-                            obj1_particle.setVelocity(new_vel);
-                            obj2_particle.setVelocity(new_vel);
+                            obj1_particle_data.velocity(particle_idx1) = new_vel;
+                            obj2_particle_data.velocity(particle_idx2) = new_vel;
                         }
                     }
                 }
@@ -477,7 +397,7 @@ void InvertibleMPMSolid<Scalar,Dim>::updateParticleInterpolationWeight()
             plugin->onUpdateParticleInterpolationWeight();
     }
 
-    PHYSIKA_ASSERT(this->particle_grid_weight_and_gradient_.size() == this->particles_.size());
+    PHYSIKA_ASSERT(this->particle_grid_weight_and_gradient_.size() == this->objectNum());
     PHYSIKA_ASSERT(this->cpdi_update_method_);
     PHYSIKA_ASSERT(this->weight_function_);
     const GridWeightFunction<Scalar,Dim> &weight_function = *(this->weight_function_);
@@ -509,9 +429,13 @@ void InvertibleMPMSolid<Scalar,Dim>::updateParticleConstitutiveModelState(Scalar
     //update the deformation gradient with the velocity gradient from domain corners
     //the velocity of ordinary domain corners are mapped from the grid node
     unsigned int corner_num = (Dim == 2) ? 4 : 8;
+    int thread_num = static_cast<int>(this->thread_num_);
     for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        int particle_num = static_cast<int>(particle_data.particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
         {
             //determine particle type
             unsigned int enriched_corner_num = 0;
@@ -521,8 +445,7 @@ void InvertibleMPMSolid<Scalar,Dim>::updateParticleConstitutiveModelState(Scalar
                 if(is_enriched_domain_corner_[obj_idx][global_corner_idx])
                     ++enriched_corner_num;
             }
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
-            SquareMatrix<Scalar,Dim> particle_deform_grad = particle->deformationGradient(); //deformation gradient before update
+            SquareMatrix<Scalar,Dim> &particle_deform_grad = particle_data.deformationGradient(particle_idx); //deformation gradient before update
             if(enriched_corner_num > 0) //transient/enriched particle compute deformation gradient directly from domain shape (like in FEM)
                 particle_deform_grad = update_method->computeParticleDeformationGradientFromDomainShape(obj_idx,particle_idx);
             else //ordinary particle update deformation gradient as: F^(n+1) = F^n + dt*(partial_vel_partial_X)
@@ -536,9 +459,9 @@ void InvertibleMPMSolid<Scalar,Dim>::updateParticleConstitutiveModelState(Scalar
                 }
                 particle_deform_grad += dt*particle_vel_grad;
             }
-            particle->setDeformationGradient(particle_deform_grad);  //update deformation gradient (this deformation gradient might be inverted)
-            Scalar particle_vol = (particle_deform_grad.determinant())*(this->particle_initial_volume_[obj_idx][particle_idx]);
-            particle->setVolume(particle_vol);  //update particle volume
+            //the updated deformation gradient might be inverted
+            //update particle volume
+            particle_data.volume(particle_idx) = (particle_deform_grad.determinant())*(this->particle_initial_volume_[obj_idx][particle_idx]);
         }
     }
 }
@@ -557,9 +480,13 @@ void InvertibleMPMSolid<Scalar,Dim>::updateParticleVelocity()
     //interpolate delta of grid/corner velocity to particle
     //some are interpolated from grid, some are from domain corner
     unsigned int corner_num = (Dim == 2) ? 4 : 8;
+    int thread_num = static_cast<int>(this->thread_num_);
     for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        int particle_num = static_cast<int>(particle_data.particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
         {
             if(this->is_dirichlet_particle_[obj_idx][particle_idx])
                 continue;//skip boundary particles
@@ -571,26 +498,17 @@ void InvertibleMPMSolid<Scalar,Dim>::updateParticleVelocity()
                 if(is_enriched_domain_corner_[obj_idx][global_corner_idx])
                     ++enriched_corner_num;
             }
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
-            Vector<Scalar,Dim> new_vel = particle->velocity();
+            Vector<Scalar,Dim> &new_vel = particle_data.velocity(particle_idx);
             if(enriched_corner_num < corner_num) //ordinary particle && transient particle get influence from grid
             {
                 for(unsigned int i = 0; i < this->particle_grid_pair_num_[obj_idx][particle_idx]; ++i)
                 {
                     Vector<unsigned int,Dim> node_idx = (this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i].node_idx_);
-                    if(this->gridMass(obj_idx,node_idx) <= std::numeric_limits<Scalar>::epsilon())
+                    unsigned int slot_idx = this->grid_data_.slot(node_idx,obj_idx);
+                    if(slot_idx == this->grid_data_.INVALID_SLOT || this->grid_data_.mass(slot_idx) <= std::numeric_limits<Scalar>::epsilon())
                         continue;
                     Scalar weight = this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i].weight_value_;
-                    Vector<Scalar,Dim> cur_grid_vel(0),grid_vel_before(0);
-                    if(this->grid_velocity_(node_idx).find(obj_idx) != this->grid_velocity_(node_idx).end())
-                        cur_grid_vel = this->grid_velocity_(node_idx)[obj_idx];
-                    else
-                        PHYSIKA_ERROR("Error in updateParticleVelocity!");
-                    if(this->grid_velocity_before_(node_idx).find(obj_idx) != this->grid_velocity_before_(node_idx).end())
-                        grid_vel_before = this->grid_velocity_before_(node_idx)[obj_idx];
-                    else
-                        PHYSIKA_ERROR("Error in updateParticleVelocity!");
-                    new_vel += weight*(cur_grid_vel-grid_vel_before);
+                    new_vel += weight*(this->grid_data_.velocity(slot_idx)-this->grid_data_.velocityBefore(slot_idx));
                 }
             }
             if(enriched_corner_num > 0) //transient/enriched particle get influence from domain corner as well
@@ -605,7 +523,6 @@ void InvertibleMPMSolid<Scalar,Dim>::updateParticleVelocity()
                     }
                 }
             }
-            particle->setVelocity(new_vel);
         }
     }
 }
@@ -705,11 +622,17 @@ void InvertibleMPMSolid<Scalar,Dim>::solveOnGridForwardEuler(Scalar dt)
     //explicit integration
     //integration on grid and domain corner
     unsigned int corner_num = (Dim == 2) ? 4 : 8;
+    std::vector<unsigned int> particle_enriched_corner_num;
+    std::vector<SquareMatrix<Scalar,Dim> > deform_grads, left_rotations, diag_deform_grads, right_rotations;
+    std::vector<SquareMatrix<Scalar,Dim> > first_PiolaKirchoff_stresses;
     for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        const SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        //determine particle type, and diagonalize the deformation gradients of transient/enriched particles in one batch
+        particle_enriched_corner_num.resize(particle_data.particleNum());
+        deform_grads.clear();
+        for(unsigned int particle_idx = 0; particle_idx < particle_data.particleNum(); ++particle_idx)
         {
-            //determine particle type
             unsigned int enriched_corner_num = 0;
             for(unsigned int corner_idx = 0; corner_idx < corner_num; ++corner_idx)
             {
@@ -717,36 +640,56 @@ void InvertibleMPMSolid<Scalar,Dim>::solveOnGridForwardEuler(Scalar dt)
                 if(is_enriched_domain_corner_[obj_idx][global_corner_idx])
                     ++enriched_corner_num;
             }
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
+            particle_enriched_corner_num[particle_idx] = enriched_corner_num;
+            if(enriched_corner_num > 0)
+                deform_grads.push_back(particle_data.deformationGradient(particle_idx));
+        }
+        left_rotations.resize(deform_grads.size());
+        diag_deform_grads.resize(deform_grads.size());
+        right_rotations.resize(deform_grads.size());
+        if(!deform_grads.empty())
+            deform_grad_diagonalizer_.diagonalizeDeformationGradient(&deform_grads[0],deform_grads.size(),&left_rotations[0],&diag_deform_grads[0],&right_rotations[0]);
+        //stress of the ordinary particles, evaluated for the whole object in one batch
+        first_PiolaKirchoff_stresses.resize(particle_data.particleNum());
+        if(particle_data.particleNum() > 0)
+            particle_data.firstPiolaKirchhoffStress(0,particle_data.particleNum(),&first_PiolaKirchoff_stresses[0]);
+        unsigned int enriched_idx = 0;
+        for(unsigned int particle_idx = 0; particle_idx < particle_data.particleNum(); ++particle_idx)
+        {
+            unsigned int enriched_corner_num = particle_enriched_corner_num[particle_idx];
             if(enriched_corner_num == 0) //ordinary particle solve only on the grid
             {
+                const SquareMatrix<Scalar,Dim> &first_PiolaKirchoff_stress = first_PiolaKirchoff_stresses[particle_idx];
                 for(unsigned int i = 0; i < this->particle_grid_pair_num_[obj_idx][particle_idx]; ++i)
                 {
                     const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> &pair = this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i];
-                    if(this->is_dirichlet_grid_node_(pair.node_idx_).count(obj_idx) > 0)
+                    unsigned int slot_idx = this->grid_data_.slot(pair.node_idx_,obj_idx);
+                    if(slot_idx == this->grid_data_.INVALID_SLOT)
+                        continue; //skip grid nodes with zero mass
+                    if(this->grid_data_.isDirichletSlot(slot_idx))
                         continue; //skip grid nodes that are boundary condition
                     Vector<Scalar,Dim> weight_gradient = pair.gradient_value_; //gradient is to reference configuration
-                    SquareMatrix<Scalar,Dim> first_PiolaKirchoff_stress = particle->firstPiolaKirchhoffStress();
                     Scalar particle_initial_volume = this->particle_initial_volume_[obj_idx][particle_idx];
-                    if(this->grid_mass_(pair.node_idx_)[obj_idx] <= std::numeric_limits<Scalar>::epsilon())
+                    if(this->grid_data_.mass(slot_idx) <= std::numeric_limits<Scalar>::epsilon())
                         continue; //skip grid nodes with near zero mass
                     if(this->contact_method_)  //if contact method other than the inherent one is employed, update the grid velocity of each object independently
-                        this->grid_velocity_(pair.node_idx_)[obj_idx] += dt*(-1)*particle_initial_volume*first_PiolaKirchoff_stress*weight_gradient/this->grid_mass_(pair.node_idx_)[obj_idx];
+                        this->grid_data_.velocity(slot_idx) += dt*(-1)*particle_initial_volume*first_PiolaKirchoff_stress*weight_gradient/this->grid_data_.mass(slot_idx);
                     else  //otherwise, grid velocity of all objects that ocuppy the node get updated
                     {
-                        if(this->is_dirichlet_grid_node_(pair.node_idx_).size() > 0)
+                        if(this->grid_data_.isDirichletNode(pair.node_idx_))
                             continue;  //if for any involved object, this node is set as dirichlet, then the node is dirichlet for all objects
-                        for(typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator vel_iter = this->grid_velocity_(pair.node_idx_).begin();
-                            vel_iter != this->grid_velocity_(pair.node_idx_).end(); ++vel_iter)
-                            if(this->gridMass(vel_iter->first,pair.node_idx_) > std::numeric_limits<Scalar>::epsilon())
-                                vel_iter->second += dt*(-1)*particle_initial_volume*first_PiolaKirchoff_stress*weight_gradient/this->grid_mass_(pair.node_idx_)[obj_idx];
+                        for(unsigned int node_slot = this->grid_data_.firstSlot(pair.node_idx_); node_slot != this->grid_data_.INVALID_SLOT; node_slot = this->grid_data_.nextSlot(node_slot))
+                            if(this->grid_data_.mass(node_slot) > std::numeric_limits<Scalar>::epsilon())
+                                this->grid_data_.velocity(node_slot) += dt*(-1)*particle_initial_volume*first_PiolaKirchoff_stress*weight_gradient/this->grid_data_.mass(slot_idx);
                     }
                 }
             }
             else //transient/enriched particle solve on domain corners
             {
                 //solveForParticleWithEnrichmentForwardEulerViaQuadraturePoints(obj_idx,particle_idx,enriched_corner_num,dt); //compute the internal force on domain corner (and later map to grid) via quadrature points
-                solveForParticleWithEnrichmentForwardEulerViaParticle(obj_idx,particle_idx,enriched_corner_num,dt); //compute the internal force on domain corner (and later map to grid) via particle
+                solveForParticleWithEnrichmentForwardEulerViaParticle(obj_idx,particle_idx,enriched_corner_num,left_rotations[enriched_idx],
+                                                                      diag_deform_grads[enriched_idx],right_rotations[enriched_idx],dt); //compute the internal force on domain corner (and later map to grid) via particle
+                ++enriched_idx;
             }
         }
     }
@@ -798,6 +741,17 @@ void InvertibleMPMSolid<Scalar,Dim>::deleteAllParticleRelatedDataOfObject(unsign
     particle_corner_gradient_.erase(iter2);
     std::vector<std::vector<unsigned int> >::iterator iter3 = enriched_particles_.begin() + object_idx;
     enriched_particles_.erase(iter3);
+    //the particle domain mesh is constructed in initSimulationData()
+    if(object_idx < particle_domain_mesh_.size())
+    {
+        if(particle_domain_mesh_[object_idx])
+            delete particle_domain_mesh_[object_idx];
+        particle_domain_mesh_.erase(particle_domain_mesh_.begin() + object_idx);
+        is_enriched_domain_corner_.erase(is_enriched_domain_corner_.begin() + object_idx);
+        domain_corner_mass_.erase(domain_corner_mass_.begin() + object_idx);
+        domain_corner_velocity_.erase(domain_corner_velocity_.begin() + object_idx);
+        domain_corner_velocity_before_.erase(domain_corner_velocity_before_.begin() + object_idx);
+    }
 }
  
 template <typename Scalar, int Dim>
@@ -810,6 +764,114 @@ void InvertibleMPMSolid<Scalar,Dim>::deleteOneParticleRelatedDataOfObject(unsign
     particle_corner_gradient_[object_idx].erase(iter2);
 }
     
+template <typename Scalar, int Dim>
+void InvertibleMPMSolid<Scalar,Dim>::permutateParticleRelatedDataOfObject(unsigned int object_idx, const std::vector<unsigned int> &permutation)
+{
+    CPDIMPMSolid<Scalar,Dim>::permutateParticleRelatedDataOfObject(object_idx,permutation);
+    MPMInternal::permutateVector(particle_corner_weight_[object_idx],permutation);
+    MPMInternal::permutateVector(particle_corner_gradient_[object_idx],permutation);
+    unsigned int particle_num = permutation.size();
+    std::vector<unsigned int> new_particle_idx(particle_num);
+    for(unsigned int i = 0; i < particle_num; ++i)
+        new_particle_idx[permutation[i]] = i;
+    for(unsigned int i = 0; i < enriched_particles_[object_idx].size(); ++i)
+        enriched_particles_[object_idx][i] = new_particle_idx[enriched_particles_[object_idx][i]];
+    //the particle domain mesh is constructed in initSimulationData()
+    if(object_idx >= particle_domain_mesh_.size() || particle_domain_mesh_[object_idx] == NULL)
+        return;
+    //reorder the elements of particle domain mesh, the domain corners(vertices) are not changed
+    VolumetricMesh<Scalar,Dim> *old_mesh = particle_domain_mesh_[object_idx];
+    PHYSIKA_ASSERT(old_mesh->eleNum() == particle_num);
+    unsigned int vert_num = old_mesh->vertNum();
+    unsigned int corner_num = (Dim==2)?4:8;
+    Scalar *vertices = new Scalar[vert_num*Dim];
+    for(unsigned int i = 0; i < vert_num; ++i)
+    {
+        Vector<Scalar,Dim> vert_pos = old_mesh->vertPos(i);
+        for(unsigned int j = 0; j < Dim; ++j)
+            vertices[i*Dim+j] = vert_pos[j];
+    }
+    unsigned int *domains = new unsigned int[particle_num*corner_num];
+    for(unsigned int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
+        for(unsigned int corner_idx = 0; corner_idx < corner_num; ++corner_idx)
+            domains[particle_idx*corner_num+corner_idx] = old_mesh->eleVertIndex(permutation[particle_idx],corner_idx);
+    if(Dim == 2)
+        particle_domain_mesh_[object_idx] = dynamic_cast<VolumetricMesh<Scalar,Dim>*>(new QuadMesh<Scalar>(vert_num,vertices,particle_num,domains));
+    else
+        particle_domain_mesh_[object_idx] = dynamic_cast<VolumetricMesh<Scalar,Dim>*>(new CubicMesh<Scalar>(vert_num,vertices,particle_num,domains));
+    delete old_mesh;
+    delete[] domains;
+    delete[] vertices;
+}
+
+template <typename Scalar, int Dim>
+void InvertibleMPMSolid<Scalar,Dim>::writeParticleRelatedDataOfObject(unsigned int object_idx, std::ostream &output) const
+{
+    CPDIMPMSolid<Scalar,Dim>::writeParticleRelatedDataOfObject(object_idx,output);
+    //the particle domain mesh: vertex positions and the vertex indices of each domain, followed by the enrich state
+    unsigned char with_mesh = (object_idx < particle_domain_mesh_.size() && particle_domain_mesh_[object_idx]) ? 0x01 : 0x00;
+    FileUtilities::writeBinary(output,with_mesh);
+    if(with_mesh == 0x00)
+        return;
+    const VolumetricMesh<Scalar,Dim> &mesh = *particle_domain_mesh_[object_idx];
+    unsigned int vert_num = mesh.vertNum(), ele_num = mesh.eleNum();
+    unsigned int corner_num = (Dim==2)?4:8;
+    FileUtilities::writeBinary(output,vert_num);
+    for(unsigned int i = 0; i < vert_num; ++i)
+        FileUtilities::writeBinary(output,mesh.vertPos(i));
+    FileUtilities::writeBinary(output,ele_num);
+    for(unsigned int i = 0; i < ele_num; ++i)
+        for(unsigned int j = 0; j < corner_num; ++j)
+            FileUtilities::writeBinary(output,mesh.eleVertIndex(i,j));
+    FileUtilities::writeBinary(output,is_enriched_domain_corner_[object_idx]);
+    FileUtilities::writeBinary(output,enriched_particles_[object_idx]);
+}
+
+template <typename Scalar, int Dim>
+bool InvertibleMPMSolid<Scalar,Dim>::readParticleRelatedDataOfObject(unsigned int object_idx, std::istream &input)
+{
+    if(!CPDIMPMSolid<Scalar,Dim>::readParticleRelatedDataOfObject(object_idx,input))
+        return false;
+    unsigned char with_mesh = 0x00;
+    if(!FileUtilities::readBinary(input,with_mesh))
+        return false;
+    //the objects are read in order, and the mesh data of the replaced objects are deleted
+    particle_domain_mesh_.resize(object_idx+1,NULL);
+    is_enriched_domain_corner_.resize(object_idx+1);
+    domain_corner_mass_.resize(object_idx+1);
+    domain_corner_velocity_.resize(object_idx+1);
+    domain_corner_velocity_before_.resize(object_idx+1);
+    if(with_mesh == 0x00)
+        return true;
+    unsigned int vert_num = 0, ele_num = 0;
+    unsigned int corner_num = (Dim==2)?4:8;
+    if(!FileUtilities::readBinary(input,vert_num))
+        return false;
+    std::vector<Scalar> vertices(vert_num*Dim);
+    if(!FileUtilities::readBinary(input,vertices.data(),vert_num*Dim))
+        return false;
+    if(!FileUtilities::readBinary(input,ele_num) || ele_num != this->particleNumOfObject(object_idx))
+        return false;
+    std::vector<unsigned int> domains(ele_num*corner_num);
+    if(!FileUtilities::readBinary(input,domains.data(),ele_num*corner_num))
+        return false;
+    for(unsigned int i = 0; i < domains.size(); ++i)
+        if(domains[i] >= vert_num)
+            return false;
+    if(!FileUtilities::readBinary(input,is_enriched_domain_corner_[object_idx]) || is_enriched_domain_corner_[object_idx].size() != vert_num)
+        return false;
+    if(!FileUtilities::readBinary(input,enriched_particles_[object_idx]))
+        return false;
+    if(Dim == 2)
+        particle_domain_mesh_[object_idx] = dynamic_cast<VolumetricMesh<Scalar,Dim>*>(new QuadMesh<Scalar>(vert_num,vertices.data(),ele_num,domains.data()));
+    else
+        particle_domain_mesh_[object_idx] = dynamic_cast<VolumetricMesh<Scalar,Dim>*>(new CubicMesh<Scalar>(vert_num,vertices.data(),ele_num,domains.data()));
+    domain_corner_mass_[object_idx].resize(vert_num);
+    domain_corner_velocity_[object_idx].resize(vert_num);
+    domain_corner_velocity_before_[object_idx].resize(vert_num);
+    return true;
+}
+
 template <typename Scalar, int Dim>
 void InvertibleMPMSolid<Scalar,Dim>::resetParticleDomainData()
 {
@@ -828,6 +890,20 @@ void InvertibleMPMSolid<Scalar,Dim>::resetParticleDomainData()
     }
 }
 
+template <typename Scalar, int Dim>
+bool InvertibleMPMSolid<Scalar,Dim>::isParticleRasterizedToGrid(unsigned int obj_idx, unsigned int particle_idx) const
+{
+    //enriched particles are rasterized only to domain corners
+    unsigned int corner_num = (Dim==2) ? 4 : 8;
+    for(unsigned int corner_idx = 0; corner_idx < corner_num; ++corner_idx)
+    {
+        unsigned int global_corner_idx = particle_domain_mesh_[obj_idx]->eleVertIndex(particle_idx,corner_idx);
+        if(is_enriched_domain_corner_[obj_idx][global_corner_idx] == 0x00)
+            return true;
+    }
+    return false;
+}
+
 template <typename Scalar, int Dim>
 void InvertibleMPMSolid<Scalar,Dim>::constructParticleDomainMesh()
 {
@@ -904,12 +980,12 @@ bool InvertibleMPMSolid<Scalar,Dim>::isEnrichCriteriaSatisfied(unsigned int obj_
     for(unsigned int i = 0; i < this->particle_grid_pair_num_[obj_idx][particle_idx]; ++i)
     {
         Vector<unsigned int,Dim> node_idx = this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i].node_idx_;
-        if(this->is_dirichlet_grid_node_(node_idx).count(obj_idx) > 0)
+        if(this->grid_data_.isDirichletNode(node_idx,obj_idx))
             return false;
     }
     //rule two: only enrich while compression
     Scalar compression_threshold = 0.5;
-    if(this->particles_[obj_idx][particle_idx]->volume() <compression_threshold * this->particle_initial_volume_[obj_idx][particle_idx])
+    if(this->particle_data_[obj_idx]->volume(particle_idx) <compression_threshold * this->particle_initial_volume_[obj_idx][particle_idx])
         return true;
     return false;
     //TO DO
@@ -966,7 +1042,8 @@ void InvertibleMPMSolid<Scalar,Dim>::solveForParticleWithEnrichmentForwardEulerV
     if(update_method == NULL)
         PHYSIKA_ERROR("Invertible MPM only supports CPDI2!");
     //we assume the particle has enriched domain corners
-    SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
+    const ConstitutiveModel<Scalar,Dim> *constitutive_model = this->particle_data_[obj_idx]->constitutiveModel(particle_idx);
+    PHYSIKA_ASSERT(constitutive_model);
     unsigned int corner_num = (Dim == 2) ? 4 : 8;
     //2x2(2D),2x2x2(3D) quadrature points per domain are used to evaluate the internal force on the domain corners 
     //first get the quadrature points (different number for different dimension)
@@ -996,27 +1073,29 @@ void InvertibleMPMSolid<Scalar,Dim>::solveForParticleWithEnrichmentForwardEulerV
     }
     else
         PHYSIKA_ERROR("Wrong dimension specified!");
+    //diagonalize the deformation gradients at all quadrature points in one batch
+    std::vector<SquareMatrix<Scalar,Dim> > deform_grads(gauss_points.size()), left_rotations(gauss_points.size()),
+        diag_deform_grads(gauss_points.size()), right_rotations(gauss_points.size());
+    for(unsigned int gauss_idx = 0; gauss_idx < gauss_points.size(); ++gauss_idx)
+        deform_grads[gauss_idx] = update_method->computeDeformationGradientAtPointInParticleDomain(obj_idx,particle_idx,gauss_points[gauss_idx]);
+    deform_grad_diagonalizer_.diagonalizeDeformationGradient(&deform_grads[0],deform_grads.size(),&left_rotations[0],&diag_deform_grads[0],&right_rotations[0]);
     //now quadrature
-    SquareMatrix<Scalar,Dim> deform_grad, left_rotation, diag_deform_grad, right_rotation,
-        diag_first_PiolaKirchoff_stress, first_PiolaKirchoff_stress, particle_domain_jacobian_ref;
+    SquareMatrix<Scalar,Dim> diag_deform_grad, diag_first_PiolaKirchoff_stress, first_PiolaKirchoff_stress, particle_domain_jacobian_ref;
     Vector<Scalar,Dim> gauss_point, domain_shape_function_gradient_to_ref;
     Vector<unsigned int,Dim> corner_idx_nd, corner_dim(2);
     for(unsigned int gauss_idx = 0; gauss_idx < gauss_points.size(); ++gauss_idx)
     {
         gauss_point = gauss_points[gauss_idx];
-        deform_grad = update_method->computeDeformationGradientAtPointInParticleDomain(obj_idx,particle_idx,gauss_point);
-        deform_grad_diagonalizer_.diagonalizeDeformationGradient(deform_grad,left_rotation,diag_deform_grad,right_rotation);
+        const SquareMatrix<Scalar,Dim> &left_rotation = left_rotations[gauss_idx], &right_rotation = right_rotations[gauss_idx];
+        diag_deform_grad = diag_deform_grads[gauss_idx];
         //clamp the principal stretch to the threshold if it's compressed too severely
         for(unsigned int row = 0; row < Dim; ++row)
             if(diag_deform_grad(row,row) < principal_stretch_threshold_)
                 diag_deform_grad(row,row) = principal_stretch_threshold_;
-        //temporarily set the deformation gradient of the particle to the diagonalized one to compute the unrotated stress
-        particle->setDeformationGradient(diag_deform_grad);
+        //compute the unrotated stress with the diagonalized deformation gradient
         // P = U*P^*V^T
-        diag_first_PiolaKirchoff_stress = particle->firstPiolaKirchhoffStress();
+        diag_first_PiolaKirchoff_stress = constitutive_model->firstPiolaKirchhoffStress(diag_deform_grad);
         first_PiolaKirchoff_stress = left_rotation*diag_first_PiolaKirchoff_stress*(right_rotation.transpose());
-        //recover the deformation gradient of the particle
-        particle->setDeformationGradient(deform_grad);
         //the jacobian matrix between the reference particle domain and primitive shape
         particle_domain_jacobian_ref = update_method->computeJacobianBetweenReferenceAndPrimitiveParticleDomain(obj_idx,particle_idx,gauss_point);
         Scalar jacobian_det = particle_domain_jacobian_ref.determinant();
@@ -1037,21 +1116,23 @@ void InvertibleMPMSolid<Scalar,Dim>::solveForParticleWithEnrichmentForwardEulerV
                 for(unsigned int i = 0; i < this->corner_grid_pair_num_[obj_idx][particle_idx][corner_idx]; ++i)
                 {
                     const MPMInternal::NodeIndexWeightPair<Scalar,Dim> &pair = this->corner_grid_weight_[obj_idx][particle_idx][corner_idx][i];
-                    if(this->is_dirichlet_grid_node_(pair.node_idx_).count(obj_idx) > 0)
+                    unsigned int slot_idx = this->grid_data_.slot(pair.node_idx_,obj_idx);
+                    if(slot_idx == this->grid_data_.INVALID_SLOT)
+                        continue; //skip grid nodes with zero mass
+                    if(this->grid_data_.isDirichletSlot(slot_idx))
                         continue; //skip grid nodes that are boundary condition
                     Scalar corner_grid_weight = pair.weight_value_;
-                    if(this->grid_mass_(pair.node_idx_)[obj_idx] <= std::numeric_limits<Scalar>::epsilon())
+                    if(this->grid_data_.mass(slot_idx) <= std::numeric_limits<Scalar>::epsilon())
                         continue; //skip grid nodes with near zero mass
                     if(this->contact_method_)  //if contact method other than the inherent one is employed, update the grid velocity of each object independently
-                        this->grid_velocity_(pair.node_idx_)[obj_idx] += dt*(-1)*first_PiolaKirchoff_stress*corner_grid_weight*domain_shape_function_gradient_to_ref*jacobian_det/this->grid_mass_(pair.node_idx_)[obj_idx];
+                        this->grid_data_.velocity(slot_idx) += dt*(-1)*first_PiolaKirchoff_stress*corner_grid_weight*domain_shape_function_gradient_to_ref*jacobian_det/this->grid_data_.mass(slot_idx);
                     else  //otherwise, grid velocity of all objects that ocuppy the node get updated
                     {
-                        if(this->is_dirichlet_grid_node_(pair.node_idx_).size() > 0)
+                        if(this->grid_data_.isDirichletNode(pair.node_idx_))
                             continue;  //if for any involved object, this node is set as dirichlet, then the node is dirichlet for all objects
-                        for(typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator vel_iter = this->grid_velocity_(pair.node_idx_).begin();
-                            vel_iter != this->grid_velocity_(pair.node_idx_).end(); ++vel_iter)
-                            if(this->gridMass(vel_iter->first,pair.node_idx_) > std::numeric_limits<Scalar>::epsilon())
-                                vel_iter->second += dt*(-1)*first_PiolaKirchoff_stress*corner_grid_weight*domain_shape_function_gradient_to_ref*jacobian_det/this->grid_mass_(pair.node_idx_)[obj_idx];
+                        for(unsigned int node_slot = this->grid_data_.firstSlot(pair.node_idx_); node_slot != this->grid_data_.INVALID_SLOT; node_slot = this->grid_data_.nextSlot(node_slot))
+                            if(this->grid_data_.mass(node_slot) > std::numeric_limits<Scalar>::epsilon())
+                                this->grid_data_.velocity(node_slot) += dt*(-1)*first_PiolaKirchoff_stress*corner_grid_weight*domain_shape_function_gradient_to_ref*jacobian_det/this->grid_data_.mass(slot_idx);
                     }
                 }
             }
@@ -1060,33 +1141,28 @@ void InvertibleMPMSolid<Scalar,Dim>::solveForParticleWithEnrichmentForwardEulerV
 }
 
 template <typename Scalar, int Dim>
-void InvertibleMPMSolid<Scalar,Dim>::solveForParticleWithEnrichmentForwardEulerViaParticle(unsigned int obj_idx, unsigned int particle_idx, 
-                                                                                           unsigned int enriched_corner_num, Scalar dt)
+void InvertibleMPMSolid<Scalar,Dim>::solveForParticleWithEnrichmentForwardEulerViaParticle(unsigned int obj_idx, unsigned int particle_idx, unsigned int enriched_corner_num,
+                                                                                           const SquareMatrix<Scalar,Dim> &left_rotation, const SquareMatrix<Scalar,Dim> &particle_diag_deform_grad,
+                                                                                           const SquareMatrix<Scalar,Dim> &right_rotation, Scalar dt)
 {
     CPDI2UpdateMethod<Scalar,Dim> *update_method = dynamic_cast<CPDI2UpdateMethod<Scalar,Dim>*>(this->cpdi_update_method_);
     if(update_method == NULL)
         PHYSIKA_ERROR("Invertible MPM only supports CPDI2!");
     //we assume the particle has enriched domain corners
-    SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
+    const ConstitutiveModel<Scalar,Dim> *constitutive_model = this->particle_data_[obj_idx]->constitutiveModel(particle_idx);
+    PHYSIKA_ASSERT(constitutive_model);
     unsigned int corner_num = (Dim == 2) ? 4 : 8;
     //map internal force from particle to domain corner (then to grid node)
-    SquareMatrix<Scalar,Dim> deform_grad, left_rotation, diag_deform_grad, right_rotation,
-        diag_first_PiolaKirchoff_stress, first_PiolaKirchoff_stress, particle_domain_jacobian_ref;
-    Vector<Scalar,Dim> gauss_point, domain_shape_function_gradient_to_ref;
+    SquareMatrix<Scalar,Dim> diag_deform_grad = particle_diag_deform_grad, diag_first_PiolaKirchoff_stress, first_PiolaKirchoff_stress;
     Vector<unsigned int,Dim> corner_idx_nd, corner_dim(2);
-    deform_grad = particle->deformationGradient();
-    deform_grad_diagonalizer_.diagonalizeDeformationGradient(deform_grad,left_rotation,diag_deform_grad,right_rotation);
     //clamp the principal stretch to the threshold if it's compressed too severely
     for(unsigned int row = 0; row < Dim; ++row)
         if(diag_deform_grad(row,row) < principal_stretch_threshold_)
             diag_deform_grad(row,row) = principal_stretch_threshold_;
-    //temporarily set the deformation gradient of the particle to the diagonalized one to compute the unrotated stress
-    particle->setDeformationGradient(diag_deform_grad);
+    //compute the unrotated stress with the diagonalized deformation gradient
     // P = U*P^*V^T
-    diag_first_PiolaKirchoff_stress = particle->firstPiolaKirchhoffStress();
+    diag_first_PiolaKirchoff_stress = constitutive_model->firstPiolaKirchhoffStress(diag_deform_grad);
     first_PiolaKirchoff_stress = left_rotation*diag_first_PiolaKirchoff_stress*(right_rotation.transpose());
-    //recover the deformation gradient of the particle
-    particle->setDeformationGradient(deform_grad);
     Scalar particle_initial_volume = this->particle_initial_volume_[obj_idx][particle_idx];
     for(unsigned int corner_idx = 0; corner_idx < corner_num; ++corner_idx)
     {
@@ -1105,25 +1181,27 @@ void InvertibleMPMSolid<Scalar,Dim>::solveForParticleWithEnrichmentForwardEulerV
             for(unsigned int i = 0; i < this->corner_grid_pair_num_[obj_idx][particle_idx][corner_idx]; ++i)
             {
                 const MPMInternal::NodeIndexWeightPair<Scalar,Dim> &pair = this->corner_grid_weight_[obj_idx][particle_idx][corner_idx][i];
-                if(this->is_dirichlet_grid_node_(pair.node_idx_).count(obj_idx) > 0)
+                unsigned int slot_idx = this->grid_data_.slot(pair.node_idx_,obj_idx);
+                if(slot_idx == this->grid_data_.INVALID_SLOT)
+                    continue; //skip grid nodes with zero mass
+                if(this->grid_data_.isDirichletSlot(slot_idx))
                     continue; //skip grid nodes that are boundary condition
                 Scalar corner_grid_weight = pair.weight_value_;
-                if(this->grid_mass_(pair.node_idx_)[obj_idx] <= std::numeric_limits<Scalar>::epsilon())
+                if(this->grid_data_.mass(slot_idx) <= std::numeric_limits<Scalar>::epsilon())
                     continue; //skip grid nodes with near zero mass
                 if(this->contact_method_)  //if contact method other than the inherent one is employed, update the grid velocity of each object independently
                 {
-                    this->grid_velocity_(pair.node_idx_)[obj_idx] +=
-                        dt*(-1)*particle_initial_volume*first_PiolaKirchoff_stress*corner_grid_weight*particle_corner_gradient_[obj_idx][particle_idx][corner_idx]/this->grid_mass_(pair.node_idx_)[obj_idx];
+                    this->grid_data_.velocity(slot_idx) +=
+                        dt*(-1)*particle_initial_volume*first_PiolaKirchoff_stress*corner_grid_weight*particle_corner_gradient_[obj_idx][particle_idx][corner_idx]/this->grid_data_.mass(slot_idx);
                 }
                 else  //otherwise, grid velocity of all objects that ocuppy the node get updated
                 {
-                    if(this->is_dirichlet_grid_node_(pair.node_idx_).size() > 0)
+                    if(this->grid_data_.isDirichletNode(pair.node_idx_))
                         continue;  //if for any involved object, this node is set as dirichlet, then the node is dirichlet for all objects
-                    for(typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator vel_iter = this->grid_velocity_(pair.node_idx_).begin();
-                        vel_iter != this->grid_velocity_(pair.node_idx_).end(); ++vel_iter)
-                        if(this->gridMass(vel_iter->first,pair.node_idx_) > std::numeric_limits<Scalar>::epsilon())
-                            vel_iter->second += 
-                                dt*(-1)*particle_initial_volume*first_PiolaKirchoff_stress*corner_grid_weight*particle_corner_gradient_[obj_idx][particle_idx][corner_idx]/this->grid_mass_(pair.node_idx_)[obj_idx];
+                    for(unsigned int node_slot = this->grid_data_.firstSlot(pair.node_idx_); node_slot != this->grid_data_.INVALID_SLOT; node_slot = this->grid_data_.nextSlot(node_slot))
+                        if(this->grid_data_.mass(node_slot) > std::numeric_limits<Scalar>::epsilon())
+                            this->grid_data_.velocity(node_slot) += 
+                                dt*(-1)*particle_initial_volume*first_PiolaKirchoff_stress*corner_grid_weight*particle_corner_gradient_[obj_idx][particle_idx][corner_idx]/this->grid_data_.mass(slot_idx);
                 }
             }
         }
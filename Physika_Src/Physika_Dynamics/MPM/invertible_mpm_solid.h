@@ -44,14 +44,13 @@ public:
                        const Grid<Scalar,Dim> &grid);
     virtual ~InvertibleMPMSolid();
     
-    //restart support
+    //restart support, the particle domain mesh and the enrich state of domain corners are written/read together with the particles
     virtual bool withRestartSupport() const;
-    virtual void write(const std::string &file_name);
-    virtual void read(const std::string &file_name);
 
     //virtual methods
     virtual void initSimulationData();  //the topology of the particle domains will be initiated before simulation starts
     virtual void rasterize(); //according to the particle type, some data are rasterized to grid, others to domain corners
+    virtual void rasterizeAndSolveOnGrid(Scalar dt); //the substeps are not fused because of the enriched domains
     virtual void resolveContactOnParticles(Scalar dt); //the contact between enriched domains are resolved on particle level
     virtual void updateParticleInterpolationWeight();  //interpolation weight between particle and domain corners need to be updated as well
     virtual void updateParticleConstitutiveModelState(Scalar dt);
@@ -70,7 +69,11 @@ protected:
     virtual void appendLastParticleRelatedDataOfObject(unsigned int object_idx);
     virtual void deleteAllParticleRelatedDataOfObject(unsigned int object_idx);
     virtual void deleteOneParticleRelatedDataOfObject(unsigned int object_idx, unsigned int particle_idx);
+    virtual void permutateParticleRelatedDataOfObject(unsigned int object_idx, const std::vector<unsigned int> &permutation);
+    virtual void writeParticleRelatedDataOfObject(unsigned int object_idx, std::ostream &output) const;
+    virtual bool readParticleRelatedDataOfObject(unsigned int object_idx, std::istream &input);
     virtual void resetParticleDomainData(); //needed before rasterization
+    virtual bool isParticleRasterizedToGrid(unsigned int obj_idx, unsigned int particle_idx) const; //enriched particles are not rasterized to grid
     void constructParticleDomainMesh(); //construct particle domain topology from the particle domain positions
     void clearParticleDomainMesh();  //clear memory of particle domain mesh
     bool isEnrichCriteriaSatisfied(unsigned int obj_idx, unsigned int particle_idx) const;  //determine if the particle needs enrichment
@@ -84,8 +87,10 @@ protected:
     //we experimented with the two strategies for comparison
     void solveForParticleWithEnrichmentForwardEulerViaQuadraturePoints(unsigned int obj_idx, unsigned int particle_idx,
                                                                                                                 unsigned int enriched_corner_num, Scalar dt);
-    void solveForParticleWithEnrichmentForwardEulerViaParticle(unsigned int obj_idx, unsigned int particle_idx,
-                                                                                                unsigned int enriched_corner_num,  Scalar dt);
+    //the diagonalized deformation gradient of the particle is passed in such that the particles can be diagonalized in batch
+    void solveForParticleWithEnrichmentForwardEulerViaParticle(unsigned int obj_idx, unsigned int particle_idx, unsigned int enriched_corner_num,
+                                                               const SquareMatrix<Scalar,Dim> &left_rotation, const SquareMatrix<Scalar,Dim> &diag_deform_grad,
+                                                               const SquareMatrix<Scalar,Dim> &right_rotation, Scalar dt);
 protected:
     //for each object, store one volumetric mesh to represent the topology of particle domains
     //each element corresponds to one particle domain
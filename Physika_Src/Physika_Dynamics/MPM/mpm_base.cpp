@@ -14,6 +14,7 @@
 
 #include <iostream>
 #include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Core/Utilities/parallel_utilities.h"
 #include "Physika_Core/Grid_Weight_Functions/grid_linear_weight_functions.h"
 #include "Physika_Dynamics/MPM/MPM_Plugins/mpm_plugin_base.h"
 #include "Physika_Dynamics/MPM/mpm_base.h"
@@ -23,7 +24,7 @@ namespace Physika{
 template <typename Scalar, int Dim>
 MPMBase<Scalar,Dim>::MPMBase()
     :DriverBase<Scalar>(), weight_function_(NULL), step_method_(NULL),
-     cfl_num_(0.5),sound_speed_(340.0),gravity_(9.8)
+     cfl_num_(0.5),sound_speed_(340.0),gravity_(9.8),thread_num_(maxThreadNum())
 {
     //default weight function is linear with support domain of 1 cell
     weight_function_ = GridWeightFunctionCreator<GridLinearWeightFunction<Scalar,Dim> >::createGridWeightFunction();
@@ -32,7 +33,7 @@ MPMBase<Scalar,Dim>::MPMBase()
 template <typename Scalar, int Dim>
 MPMBase<Scalar,Dim>::MPMBase(unsigned int start_frame, unsigned int end_frame, Scalar frame_rate, Scalar max_dt, bool write_to_file)
     :DriverBase<Scalar>(start_frame,end_frame,frame_rate,max_dt,write_to_file), weight_function_(NULL),
-     step_method_(NULL), cfl_num_(0.5),sound_speed_(340.0),gravity_(9.8)
+     step_method_(NULL), cfl_num_(0.5),sound_speed_(340.0),gravity_(9.8),thread_num_(maxThreadNum())
 {
     //default weight function is linear with support domain of 1 cell
     weight_function_ = GridWeightFunctionCreator<GridLinearWeightFunction<Scalar,Dim> >::createGridWeightFunction();
@@ -118,6 +119,24 @@ void MPMBase<Scalar,Dim>::setSoundSpeed(Scalar sound_speed)
         sound_speed_ = sound_speed;
 }
 
+template <typename Scalar, int Dim>
+unsigned int MPMBase<Scalar,Dim>::threadNum() const
+{
+    return thread_num_;
+}
+
+template <typename Scalar, int Dim>
+void MPMBase<Scalar,Dim>::setThreadNum(unsigned int thread_num)
+{
+    if(thread_num == 0)
+    {
+        std::cerr<<"Warning: Invalid thread number specified, use 1 instead!\n";
+        thread_num_ = 1;
+    }
+    else
+        thread_num_ = thread_num;
+}
+
 template <typename Scalar, int Dim>
 Scalar MPMBase<Scalar,Dim>::gravity() const
 {
@@ -56,6 +56,8 @@ public:
     void setSoundSpeed(Scalar sound_speed);
     Scalar gravity() const;
     void setGravity(Scalar gravity);
+    unsigned int threadNum() const;
+    void setThreadNum(unsigned int thread_num); //number of threads used in parallel loops, default is the number of processors
 
     //set the type of weight function with weight function type as template
     template <typename GridWeightFunctionType>
@@ -78,6 +80,7 @@ protected:
     Scalar sound_speed_; //the sound speed in material
     //gravity: along negative y direction
     Scalar gravity_;
+    unsigned int thread_num_;
 };
 
 template <typename Scalar, int Dim>
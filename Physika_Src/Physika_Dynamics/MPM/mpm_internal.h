@@ -15,6 +15,8 @@
 #ifndef PHYSIKA_DYNAMICS_MPM_MPM_INTERNAL_H_
 #define PHYSIKA_DYNAMICS_MPM_MPM_INTERNAL_H_
 
+#include <vector>
+#include <algorithm>
 #include "Physika_Core/Vectors/vector_2d.h"
 #include "Physika_Core/Vectors/vector_3d.h"
 
@@ -49,6 +51,47 @@ struct NodeIndexWeightPair
     Scalar weight_value_;
 };
 
+/*
+ * mortonCode:
+ * Morton (Z-order) code of a grid cell, computed by interleaving the bits of the cell index
+ * cells close in space have close codes, used to sort particles for memory locality
+ * the lower 32 bits (2D) or 21 bits (3D) of each index are used
+ */
+
+inline unsigned long long mortonCode(const Vector<unsigned int,2> &cell_idx)
+{
+    unsigned long long code = 0;
+    for(unsigned int bit = 0; bit < 32; ++bit)
+        for(unsigned int i = 0; i < 2; ++i)
+            code |= static_cast<unsigned long long>((cell_idx[i]>>bit)&1u)<<(2*bit+i);
+    return code;
+}
+
+inline unsigned long long mortonCode(const Vector<unsigned int,3> &cell_idx)
+{
+    unsigned long long code = 0;
+    for(unsigned int bit = 0; bit < 21; ++bit)
+        for(unsigned int i = 0; i < 3; ++i)
+            code |= static_cast<unsigned long long>((cell_idx[i]>>bit)&1u)<<(3*bit+i);
+    return code;
+}
+
+/*
+ * permutateVector:
+ * reorder the elements of a vector: the i-th element after permutation is the permutation[i]-th element before
+ * elements are swapped instead of copied, cheap for vectors of vectors
+ */
+
+template <typename ElementType>
+void permutateVector(std::vector<ElementType> &vec, const std::vector<unsigned int> &permutation)
+{
+    std::vector<ElementType> old_vec;
+    old_vec.swap(vec);
+    vec.resize(permutation.size());
+    for(unsigned int i = 0; i < permutation.size(); ++i)
+        std::swap(vec[i],old_vec[permutation[i]]);
+}
+
 }  //end of namespace MPMInternal
 
 }  //end of namespace Physika
@@ -0,0 +1,150 @@
+/*
+ * @file mpm_particle_grid_stencil.cpp
+ * @Brief interpolation weights between particles and grid nodes, stored compactly as tensor-product stencils.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <limits>
+#include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Dynamics/MPM/mpm_particle_grid_stencil.h"
+
+namespace Physika{
+
+namespace MPMParticleGridStencilInternal{
+
+//reorder blocks of block_size consecutive elements
+template <typename ElementType>
+void permutateBlocks(std::vector<ElementType> &vec, const std::vector<unsigned int> &permutation, unsigned int block_size)
+{
+    std::vector<ElementType> old_vec(vec);
+    for(unsigned int i = 0; i < permutation.size(); ++i)
+        for(unsigned int j = 0; j < block_size; ++j)
+            vec[i*block_size+j] = old_vec[permutation[i]*block_size+j];
+}
+
+}  //end of namespace MPMParticleGridStencilInternal
+
+template <typename Scalar, int Dim>
+MPMParticleGridStencil<Scalar,Dim>::MPMParticleGridStencil()
+{
+}
+
+template <typename Scalar, int Dim>
+MPMParticleGridStencil<Scalar,Dim>::~MPMParticleGridStencil()
+{
+}
+
+template <typename Scalar, int Dim>
+unsigned int MPMParticleGridStencil<Scalar,Dim>::particleNum() const
+{
+    return base_node_.size();
+}
+
+template <typename Scalar, int Dim>
+void MPMParticleGridStencil<Scalar,Dim>::resize(unsigned int particle_num)
+{
+    base_node_.resize(particle_num,Vector<unsigned int,Dim>(0));
+    axis_node_num_.resize(particle_num*Dim,0);
+    axis_weight_.resize(particle_num*Dim*MAX_AXIS_NODE_NUM,0);
+    axis_gradient_.resize(particle_num*Dim*MAX_AXIS_NODE_NUM,0);
+}
+
+template <typename Scalar, int Dim>
+void MPMParticleGridStencil<Scalar,Dim>::removeParticle(unsigned int particle_idx)
+{
+    PHYSIKA_ASSERT(particle_idx < particleNum());
+    base_node_.erase(base_node_.begin()+particle_idx);
+    axis_node_num_.erase(axis_node_num_.begin()+particle_idx*Dim,axis_node_num_.begin()+(particle_idx+1)*Dim);
+    unsigned int factor_num = Dim*MAX_AXIS_NODE_NUM;
+    axis_weight_.erase(axis_weight_.begin()+particle_idx*factor_num,axis_weight_.begin()+(particle_idx+1)*factor_num);
+    axis_gradient_.erase(axis_gradient_.begin()+particle_idx*factor_num,axis_gradient_.begin()+(particle_idx+1)*factor_num);
+}
+
+template <typename Scalar, int Dim>
+void MPMParticleGridStencil<Scalar,Dim>::permutate(const std::vector<unsigned int> &permutation)
+{
+    PHYSIKA_ASSERT(permutation.size() == particleNum());
+    MPMInternal::permutateVector(base_node_,permutation);
+    MPMParticleGridStencilInternal::permutateBlocks(axis_node_num_,permutation,Dim);
+    MPMParticleGridStencilInternal::permutateBlocks(axis_weight_,permutation,Dim*MAX_AXIS_NODE_NUM);
+    MPMParticleGridStencilInternal::permutateBlocks(axis_gradient_,permutation,Dim*MAX_AXIS_NODE_NUM);
+}
+
+template <typename Scalar, int Dim>
+void MPMParticleGridStencil<Scalar,Dim>::setNodeRange(unsigned int particle_idx, const Vector<unsigned int,Dim> &base_node,
+                                                      const Vector<unsigned int,Dim> &axis_node_num)
+{
+    PHYSIKA_ASSERT(particle_idx < particleNum());
+    base_node_[particle_idx] = base_node;
+    for(unsigned int i = 0; i < Dim; ++i)
+    {
+        PHYSIKA_ASSERT(axis_node_num[i] <= MAX_AXIS_NODE_NUM);
+        axis_node_num_[particle_idx*Dim+i] = static_cast<unsigned char>(axis_node_num[i]);
+    }
+}
+
+template <typename Scalar, int Dim>
+unsigned int MPMParticleGridStencil<Scalar,Dim>::gridPairs(unsigned int particle_idx, MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pairs) const
+{
+    PHYSIKA_ASSERT(particle_idx < particleNum());
+    const unsigned char *node_num = &axis_node_num_[particle_idx*Dim];
+    for(unsigned int i = 0; i < Dim; ++i)
+        if(node_num[i] == 0)
+            return 0;
+    const Scalar *weight_factors[Dim], *gradient_factors[Dim];
+    for(unsigned int i = 0; i < Dim; ++i)
+    {
+        weight_factors[i] = &axis_weight_[(particle_idx*Dim+i)*MAX_AXIS_NODE_NUM];
+        gradient_factors[i] = &axis_gradient_[(particle_idx*Dim+i)*MAX_AXIS_NODE_NUM];
+    }
+    const Vector<unsigned int,Dim> &base_node = base_node_[particle_idx];
+    unsigned int local_idx[Dim] = {0};
+    unsigned int pair_num = 0;
+    while(true)
+    {
+        //the products are evaluated in the same order as GridWeightFunction::weight() and gradient()
+        Scalar weight = 1.0;
+        for(unsigned int i = 0; i < Dim; ++i)
+            weight *= weight_factors[i][local_idx[i]];
+        if(weight > std::numeric_limits<Scalar>::epsilon()) //ignore nodes that has zero weight value, assume positve weight value
+        {
+            MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> &pair = pairs[pair_num++];
+            for(unsigned int i = 0; i < Dim; ++i)
+            {
+                pair.node_idx_[i] = base_node[i] + local_idx[i];
+                Scalar gradient = 1.0;
+                for(unsigned int j = 0; j < Dim; ++j)
+                    gradient *= (j == i) ? gradient_factors[j][local_idx[j]] : weight_factors[j][local_idx[j]];
+                pair.gradient_value_[i] = gradient;
+            }
+            pair.weight_value_ = weight;
+        }
+        //next node, the last dimension varies fastest
+        int dim = Dim - 1;
+        for(; dim >= 0; --dim)
+        {
+            if(++local_idx[dim] < node_num[dim])
+                break;
+            local_idx[dim] = 0;
+        }
+        if(dim < 0)
+            break;
+    }
+    return pair_num;
+}
+
+//explicit instantiations
+template class MPMParticleGridStencil<float,2>;
+template class MPMParticleGridStencil<float,3>;
+template class MPMParticleGridStencil<double,2>;
+template class MPMParticleGridStencil<double,3>;
+
+}  //end of namespace Physika
@@ -0,0 +1,73 @@
+/*
+ * @file mpm_particle_grid_stencil.h
+ * @Brief interpolation weights between particles and grid nodes, stored compactly as tensor-product stencils.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_DYNAMICS_MPM_MPM_PARTICLE_GRID_STENCIL_H_
+#define PHYSIKA_DYNAMICS_MPM_MPM_PARTICLE_GRID_STENCIL_H_
+
+#include <vector>
+#include "Physika_Core/Vectors/vector_2d.h"
+#include "Physika_Core/Vectors/vector_3d.h"
+#include "Physika_Dynamics/MPM/mpm_internal.h"
+
+namespace Physika{
+
+/*
+ * MPMParticleGridStencil: interpolation weights/gradients between the particles of one object and grid nodes
+ *
+ * The weight functions on uniform grid are dyadic products of 1D functions (see GridWeightFunction), hence
+ * the weights of a particle are determined by the first grid node in its influence range, the number of nodes
+ * along each dimension, and the 1D factors of weight and gradient at these nodes along each dimension.
+ * Only these data are stored, in flat arrays for all particles. The node-weight-gradient pairs are
+ * reconstructed on the fly with gridPairs().
+ *
+ * Usage:
+ * 1. setNodeRange() of the particle
+ * 2. write the 1D factors to axisWeights() and axisGradients() along each dimension
+ * 3. call gridPairs() whenever the pairs are needed
+ */
+
+template <typename Scalar, int Dim>
+class MPMParticleGridStencil
+{
+public:
+    MPMParticleGridStencil();
+    ~MPMParticleGridStencil();
+    unsigned int particleNum() const;
+    void resize(unsigned int particle_num); //stencils of the first min(old_num, particle_num) particles are kept, new stencils are empty
+    void removeParticle(unsigned int particle_idx);
+    void permutate(const std::vector<unsigned int> &permutation); //the i-th particle after permutation is the permutation[i]-th particle before
+
+    //the grid nodes in range of the particle are [base_node, base_node + axis_node_num)
+    void setNodeRange(unsigned int particle_idx, const Vector<unsigned int,Dim> &base_node, const Vector<unsigned int,Dim> &axis_node_num);
+    //1D factors of weight/gradient of the nodes along one dimension, no range check
+    //the factors of dimension dim+1 follow those of dimension dim with stride MAX_AXIS_NODE_NUM
+    inline Scalar* axisWeights(unsigned int particle_idx, unsigned int dim) { return &axis_weight_[(particle_idx*Dim+dim)*MAX_AXIS_NODE_NUM]; }
+    inline Scalar* axisGradients(unsigned int particle_idx, unsigned int dim) { return &axis_gradient_[(particle_idx*Dim+dim)*MAX_AXIS_NODE_NUM]; }
+    //reconstruct the node-weight-gradient pairs of the particle, nodes with weight below epsilon are skipped
+    //the nodes are visited in the same order as GridNodeIterator, pairs must be able to hold MAX_NODE_NUM pairs
+    //return the number of pairs
+    unsigned int gridPairs(unsigned int particle_idx, MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pairs) const;
+
+    static const unsigned int MAX_AXIS_NODE_NUM = 5;  //enough for weight functions with support radius up to 2 cells
+    static const unsigned int MAX_NODE_NUM = Dim==2 ? 25 : 125;
+protected:
+    std::vector<Vector<unsigned int,Dim> > base_node_;
+    std::vector<unsigned char> axis_node_num_;  //Dim entries for each particle
+    std::vector<Scalar> axis_weight_;  //Dim*MAX_AXIS_NODE_NUM entries for each particle
+    std::vector<Scalar> axis_gradient_;
+};
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_DYNAMICS_MPM_MPM_PARTICLE_GRID_STENCIL_H_
@@ -13,15 +13,26 @@
  *
  */
 
+#include <cmath>
 #include <cstdlib>
 #include <limits>
 #include <iostream>
+#include <fstream>
+#include <cstring>
+#include <utility>
 #include <algorithm>
 #include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Core/Utilities/parallel_utilities.h"
+#include "Physika_Core/Utilities/File_Utilities/binary_io.h"
 #include "Physika_Core/Matrices/matrix_2x2.h"
 #include "Physika_Core/Matrices/matrix_3x3.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_linear_weight_functions.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_quadratic_weight_functions.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_cubic_weight_functions.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_weight_function_kernel.h"
 #include "Physika_Dynamics/Driver/driver_plugin_base.h"
 #include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
 #include "Physika_Dynamics/MPM/MPM_Step_Methods/mpm_step_method.h"
 #include "Physika_Dynamics/MPM/Weight_Function_Influence_Iterators/uniform_grid_weight_function_influence_iterator.h"
 #include "Physika_Dynamics/MPM/MPM_Plugins/mpm_solid_plugin_base.h"
@@ -30,22 +41,55 @@
 
 namespace Physika{
 
+namespace MPMInternal{
+
+//binary snapshot written by MPMSolid::write() starts with the identifier, the version, the dimension and size of scalar
+const char SNAPSHOT_IDENTIFIER[16] = "PhysikaMPMSolid";
+const unsigned int SNAPSHOT_VERSION = 1;
+
+//default number of particle ranges in the particle-to-node accumulations of the backward Euler solver,
+//at most this number of threads are used in the accumulations, see MPMSolid::setBackwardEulerRangeNum()
+const unsigned int BACKWARD_EULER_RANGE_NUM = 64;
+
+//node_term = sum of the node terms of the ranges, in range order
+template <typename Scalar, int Dim>
+void sumRangeNodeTerms(const std::vector<std::vector<Vector<Scalar,Dim> > > &range_node_term, std::vector<Vector<Scalar,Dim> > &node_term, int thread_num)
+{
+    int node_num = static_cast<int>(node_term.size());
+#pragma omp parallel for num_threads(thread_num)
+    for(int i = 0; i < node_num; ++i)
+    {
+        Vector<Scalar,Dim> sum = range_node_term[0][i];
+        for(unsigned int range_idx = 1; range_idx < range_node_term.size(); ++range_idx)
+            sum += range_node_term[range_idx][i];
+        node_term[i] = sum;
+    }
+}
+
+}  //end of namespace MPMInternal
+
 template <typename Scalar, int Dim>
 MPMSolid<Scalar,Dim>::MPMSolid()
-    :MPMSolidBase<Scalar,Dim>(), contact_method_(NULL)
+    :MPMSolidBase<Scalar,Dim>(), contact_method_(NULL),
+     backward_euler_max_newton_iteration_(3), backward_euler_max_cg_iteration_(100), backward_euler_tolerance_(1.0e-4),
+     backward_euler_range_num_(MPMInternal::BACKWARD_EULER_RANGE_NUM)
 {
 }
 
 template <typename Scalar, int Dim>
 MPMSolid<Scalar,Dim>::MPMSolid(unsigned int start_frame, unsigned int end_frame, Scalar frame_rate, Scalar max_dt, bool write_to_file)
-    :MPMSolidBase<Scalar,Dim>(start_frame,end_frame,frame_rate,max_dt,write_to_file), contact_method_(NULL)
+    :MPMSolidBase<Scalar,Dim>(start_frame,end_frame,frame_rate,max_dt,write_to_file), contact_method_(NULL),
+     backward_euler_max_newton_iteration_(3), backward_euler_max_cg_iteration_(100), backward_euler_tolerance_(1.0e-4),
+     backward_euler_range_num_(MPMInternal::BACKWARD_EULER_RANGE_NUM)
 {
 }
 
 template <typename Scalar, int Dim>
 MPMSolid<Scalar,Dim>::MPMSolid(unsigned int start_frame, unsigned int end_frame, Scalar frame_rate, Scalar max_dt, bool write_to_file,
                                const Grid<Scalar,Dim> &grid)
-    :MPMSolidBase<Scalar,Dim>(start_frame,end_frame,frame_rate,max_dt,write_to_file),grid_(grid), contact_method_(NULL)
+    :MPMSolidBase<Scalar,Dim>(start_frame,end_frame,frame_rate,max_dt,write_to_file),grid_(grid), contact_method_(NULL),
+     backward_euler_max_newton_iteration_(3), backward_euler_max_cg_iteration_(100), backward_euler_tolerance_(1.0e-4),
+     backward_euler_range_num_(MPMInternal::BACKWARD_EULER_RANGE_NUM)
 {
     synchronizeGridData();
 }
@@ -72,6 +116,8 @@ void MPMSolid<Scalar,Dim>::printConfigFileFormat()
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::initSimulationData()
 {
+    if(this->restart_)
+        read(this->frameFileName(this->restart_frame_));
     resetGridData();
     updateParticleInterpolationWeight();//initialize the interpolation weight before simulation
 }
@@ -97,19 +143,104 @@ void MPMSolid<Scalar,Dim>::addPlugin(DriverPluginBase<Scalar> *plugin)
 template <typename Scalar, int Dim>
 bool MPMSolid<Scalar,Dim>::withRestartSupport() const
 {
-    return false;
+    return true;
 }
 
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::write(const std::string &file_name)
 {
-//TO DO
+    std::ofstream output(file_name.c_str(),std::ios::out|std::ios::binary);
+    if(!output.is_open())
+    {
+        std::cerr<<"Warning: failed to open file "<<file_name<<", operation ignored!\n";
+        return;
+    }
+    writeToStream(output);
+    output.close();
+    if(!output)
+        std::cerr<<"Warning: failed to write simulation data to file "<<file_name<<"!\n";
+}
+
+template <typename Scalar, int Dim>
+bool MPMSolid<Scalar,Dim>::writeToStream(std::ostream &output)
+{
+    unsigned int dim = Dim, scalar_size = sizeof(Scalar);
+    FileUtilities::writeBinary(output,MPMInternal::SNAPSHOT_IDENTIFIER,sizeof(MPMInternal::SNAPSHOT_IDENTIFIER));
+    FileUtilities::writeBinary(output,MPMInternal::SNAPSHOT_VERSION);
+    FileUtilities::writeBinary(output,dim);
+    FileUtilities::writeBinary(output,scalar_size);
+    FileUtilities::writeBinary(output,this->time_);
+    FileUtilities::writeBinary(output,this->step_num_since_reorder_);
+    this->writeObjects(output);
+    //dirichlet grid nodes with their prescribed velocity, in slot order such that the slots are restored in the same order
+    unsigned int dirichlet_slot_num = 0;
+    for(unsigned int slot_idx = 0; slot_idx < grid_data_.slotNum(); ++slot_idx)
+        if(grid_data_.isDirichletSlot(slot_idx))
+            ++dirichlet_slot_num;
+    FileUtilities::writeBinary(output,grid_data_.nodeNum());
+    FileUtilities::writeBinary(output,dirichlet_slot_num);
+    for(unsigned int slot_idx = 0; slot_idx < grid_data_.slotNum(); ++slot_idx)
+        if(grid_data_.isDirichletSlot(slot_idx))
+        {
+            unsigned int object_idx = grid_data_.slotObject(slot_idx);
+            FileUtilities::writeBinary(output,grid_data_.slotNode(slot_idx));
+            FileUtilities::writeBinary(output,object_idx);
+            FileUtilities::writeBinary(output,grid_data_.velocity(slot_idx));
+            FileUtilities::writeBinary(output,grid_data_.velocityBefore(slot_idx));
+        }
+    return true;
 }
 
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::read(const std::string &file_name)
 {
-//TO DO
+    std::ifstream input(file_name.c_str(),std::ios::in|std::ios::binary);
+    if(!input.is_open())
+    {
+        std::cerr<<"Error: failed to open file "<<file_name<<", program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    char identifier[sizeof(MPMInternal::SNAPSHOT_IDENTIFIER)];
+    unsigned int version = 0, dim = 0, scalar_size = 0;
+    bool success = FileUtilities::readBinary(input,identifier,sizeof(identifier)) && FileUtilities::readBinary(input,version)
+                   && FileUtilities::readBinary(input,dim) && FileUtilities::readBinary(input,scalar_size);
+    if(!success || std::memcmp(identifier,MPMInternal::SNAPSHOT_IDENTIFIER,sizeof(identifier)) != 0
+       || version != MPMInternal::SNAPSHOT_VERSION || dim != Dim || scalar_size != sizeof(Scalar))
+    {
+        std::cerr<<"Error: "<<file_name<<" is not simulation data of MPMSolid<"<<(sizeof(Scalar)==sizeof(float)?"float":"double")
+                 <<","<<Dim<<">, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    success = FileUtilities::readBinary(input,this->time_) && FileUtilities::readBinary(input,this->step_num_since_reorder_)
+              && this->readObjects(input);
+    //the dirichlet grid nodes replace the existing ones
+    Vector<unsigned int,Dim> node_num(0);
+    unsigned int dirichlet_slot_num = 0;
+    success = success && FileUtilities::readBinary(input,node_num) && node_num == grid_data_.nodeNum()
+              && FileUtilities::readBinary(input,dirichlet_slot_num);
+    synchronizeGridData();
+    for(unsigned int i = 0; success && i < dirichlet_slot_num; ++i)
+    {
+        Vector<unsigned int,Dim> node_idx;
+        unsigned int object_idx = 0;
+        Vector<Scalar,Dim> velocity, velocity_before;
+        success = FileUtilities::readBinary(input,node_idx) && FileUtilities::readBinary(input,object_idx)
+                  && FileUtilities::readBinary(input,velocity) && FileUtilities::readBinary(input,velocity_before)
+                  && object_idx < this->objectNum() && isValidGridNodeIndex(node_idx);
+        if(success)
+        {
+            grid_data_.addDirichletNode(node_idx,object_idx);
+            unsigned int slot_idx = grid_data_.slot(node_idx,object_idx);
+            grid_data_.velocity(slot_idx) = velocity;
+            grid_data_.velocityBefore(slot_idx) = velocity_before;
+        }
+    }
+    //all data must be consumed, otherwise the file is written by a different driver
+    if(!success || input.peek() != std::char_traits<char>::eof())
+    {
+        std::cerr<<"Error: failed to read simulation data from file "<<file_name<<", program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
 }
 
 template <typename Scalar, int Dim>
@@ -139,9 +270,9 @@ Scalar MPMSolid<Scalar,Dim>::gridMass(unsigned int object_idx, const Vector<unsi
         std::cerr<<"Error: invalid node index, program abort!\n";
         std::exit(EXIT_FAILURE);
     }
-    typename std::map<unsigned int,Scalar>::const_iterator mass_map_iter = grid_mass_(node_idx).find(object_idx);
-    if(mass_map_iter != grid_mass_(node_idx).end())
-        return mass_map_iter->second;
+    unsigned int slot_idx = grid_data_.slot(node_idx,object_idx);
+    if(slot_idx != grid_data_.INVALID_SLOT)
+        return grid_data_.mass(slot_idx);
     else
         return 0;
 }
@@ -160,9 +291,9 @@ Vector<Scalar,Dim> MPMSolid<Scalar,Dim>::gridVelocity(unsigned int object_idx, c
         std::cerr<<"Error: invalid node index, program abort!\n";
         std::exit(EXIT_FAILURE);
     }
-    typename std::map<unsigned int,Vector<Scalar,Dim> >::const_iterator vel_map_iter = grid_velocity_(node_idx).find(object_idx);
-    if(vel_map_iter != grid_velocity_(node_idx).end())
-        return vel_map_iter->second;
+    unsigned int slot_idx = grid_data_.slot(node_idx,object_idx);
+    if(slot_idx != grid_data_.INVALID_SLOT)
+        return grid_data_.velocity(slot_idx);
     else
         return Vector<Scalar,Dim>(0);
 }
@@ -181,11 +312,8 @@ void MPMSolid<Scalar,Dim>::setGridVelocity(unsigned int object_idx, const Vector
         std::cerr<<"Warning: invalid node index, operation ignored!\n";
         return;
     }
-    typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator vel_map_iter = grid_velocity_(node_idx).find(object_idx);
-    if(vel_map_iter == grid_velocity_(node_idx).end())
-        grid_velocity_(node_idx).insert(std::make_pair(object_idx,node_velocity));
-    else
-        grid_velocity_(node_idx)[object_idx] = node_velocity;
+    unsigned int slot_idx = grid_data_.insertSlot(node_idx,object_idx);
+    grid_data_.velocity(slot_idx) = node_velocity;
 }
 
 template <typename Scalar, int Dim>
@@ -202,7 +330,7 @@ void MPMSolid<Scalar,Dim>::addDirichletGridNode(unsigned int object_idx, const V
         std::cerr<<"Warning: invalid node index, operation ignored!\n";
         return;
     }
-    is_dirichlet_grid_node_(node_idx).insert(object_idx);
+    grid_data_.addDirichletNode(node_idx,object_idx);
     //the dirichlet node is set fixed if not otherwise specified
     setGridVelocity(object_idx, node_idx, Vector<Scalar,Dim>(0));
 }
@@ -231,6 +359,36 @@ void MPMSolid<Scalar,Dim>::resetContactMethod()
     contact_method_ = NULL;
 }
 
+template <typename Scalar, int Dim>
+void MPMSolid<Scalar,Dim>::setBackwardEulerSolverParameters(unsigned int max_newton_iteration, unsigned int max_cg_iteration, Scalar tolerance)
+{
+    if(max_newton_iteration == 0 || max_cg_iteration == 0 || tolerance <= 0)
+    {
+        std::cerr<<"Warning: invalid parameters for backward euler solver, operation ignored!\n";
+        return;
+    }
+    backward_euler_max_newton_iteration_ = max_newton_iteration;
+    backward_euler_max_cg_iteration_ = max_cg_iteration;
+    backward_euler_tolerance_ = tolerance;
+}
+
+template <typename Scalar, int Dim>
+unsigned int MPMSolid<Scalar,Dim>::backwardEulerRangeNum() const
+{
+    return backward_euler_range_num_;
+}
+
+template <typename Scalar, int Dim>
+void MPMSolid<Scalar,Dim>::setBackwardEulerRangeNum(unsigned int range_num)
+{
+    if(range_num == 0)
+    {
+        std::cerr<<"Warning: at least one particle range is needed, operation ignored!\n";
+        return;
+    }
+    backward_euler_range_num_ = range_num;
+}
+
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::rasterize()
 {
@@ -245,99 +403,8 @@ void MPMSolid<Scalar,Dim>::rasterize()
 
     //rasterize mass and momentum of each object independently to grid
     resetGridData();
-    for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
-    {
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
-        {
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
-            for(unsigned int i = 0; i < this->particle_grid_pair_num_[obj_idx][particle_idx]; ++i)
-            {
-                const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> &pair = this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i];
-                Scalar weight = pair.weight_value_;
-                PHYSIKA_ASSERT(weight > std::numeric_limits<Scalar>::epsilon());
-                typename std::map<unsigned int,Scalar>::iterator iter = grid_mass_(pair.node_idx_).find(obj_idx);
-                if(iter != grid_mass_(pair.node_idx_).end())
-                    grid_mass_(pair.node_idx_)[obj_idx] += weight*particle->mass();
-                else
-                    grid_mass_(pair.node_idx_).insert(std::make_pair(obj_idx,weight*particle->mass()));
-                if(is_dirichlet_grid_node_(pair.node_idx_).count(obj_idx) > 0) //skip the velocity update of boundary nodes
-                    continue;
-                typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator iter2 = grid_velocity_(pair.node_idx_).find(obj_idx);
-                if(iter2 != grid_velocity_(pair.node_idx_).end())
-                    grid_velocity_(pair.node_idx_)[obj_idx] += weight*(particle->mass()*particle->velocity());
-                else
-                    grid_velocity_(pair.node_idx_).insert(std::make_pair(obj_idx,weight*(particle->mass()*particle->velocity())));
-            }
-        }
-    }
-    //determine active grid nodes according to the grid mass of each object
-    Vector<unsigned int,Dim> grid_node_num = grid_.nodeNum();
-    std::map<unsigned int,Vector<unsigned int,Dim> > active_node_idx_1d_nd_map;
-    for(typename ArrayND<std::map<unsigned int,Scalar>,Dim>::Iterator iter = grid_mass_.begin(); iter != grid_mass_.end(); ++iter)
-    {
-        Vector<unsigned int,Dim> node_idx = iter.elementIndex();
-        for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
-        {
-            if(gridMass(obj_idx,node_idx)>std::numeric_limits<Scalar>::epsilon())
-            {
-                unsigned int node_idx_1d = flatIndex(node_idx,grid_node_num);
-                active_grid_node_.insert(std::make_pair(node_idx_1d,obj_idx));
-                active_node_idx_1d_nd_map.insert(std::make_pair(node_idx_1d,node_idx));
-            }
-        }
-    }
-    //compute grid's velocity, divide momentum by mass
-    for(typename std::multimap<unsigned int,unsigned int>::iterator iter = active_grid_node_.begin(); iter != active_grid_node_.end(); ++iter)
-    {
-        unsigned int node_idx_1d = iter->first, object_idx = iter->second;
-        Vector<unsigned int,Dim> node_idx = active_node_idx_1d_nd_map[node_idx_1d];
-        if(is_dirichlet_grid_node_(node_idx).count(object_idx) == 0) //skip grid nodes that are boundary condition
-            grid_velocity_(node_idx)[object_idx] /= grid_mass_(node_idx)[object_idx];
-        grid_velocity_before_(node_idx)[object_idx] = grid_velocity_(node_idx)[object_idx];  //buffer the grid velocity before any update
-    }
-    //if no special contact algorithm is used, multi-value at a grid node must be converted to single value for all involved objects
-    if(this->contact_method_==NULL)
-    {
-        for(typename std::map<unsigned int,Vector<unsigned int,Dim> >::iterator iter = active_node_idx_1d_nd_map.begin();
-            iter != active_node_idx_1d_nd_map.end(); ++iter)
-        {
-            unsigned int node_idx_1d = iter->first;
-            Vector<unsigned int,Dim> node_idx = iter->second;
-            if(active_grid_node_.count(node_idx_1d) == 1) //skip single-valued node
-                continue;
-            std::multimap<unsigned int,unsigned int>::iterator beg = active_grid_node_.lower_bound(node_idx_1d),
-                end = active_grid_node_.upper_bound(node_idx_1d);
-            std::multimap<unsigned int,unsigned int>::iterator cur = beg;
-            Scalar mass_at_node = 0;
-            Vector<Scalar,Dim> momentum_at_node(0);
-            //accummulate values of all involved objects at this node
-            while(cur != end)
-            {
-                mass_at_node += grid_mass_(node_idx)[cur->second];
-                momentum_at_node += grid_mass_(node_idx)[cur->second] * grid_velocity_(node_idx)[cur->second];
-                ++cur;
-            }
-            momentum_at_node /= mass_at_node;//velocity at node
-            //set all involved objects to uniform value at this node
-            for(typename std::map<unsigned int,Scalar>::iterator mass_iter = grid_mass_(node_idx).begin(); mass_iter != grid_mass_(node_idx).end(); ++mass_iter)
-                mass_iter->second = mass_at_node;
-            //if for any involved object, this node is set as dirichlet, then the node is dirichlet for all objects
-            for(typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator vel_iter = grid_velocity_(node_idx).begin();
-                vel_iter != grid_velocity_(node_idx).end(); ++vel_iter)
-                if(is_dirichlet_grid_node_(node_idx).count(vel_iter->first))
-                {
-                    momentum_at_node = vel_iter->second;
-                    break;
-                }
-            //set the velocity
-            for(typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator vel_iter = grid_velocity_(node_idx).begin();
-                vel_iter != grid_velocity_(node_idx).end(); ++vel_iter)
-            {
-                vel_iter->second = momentum_at_node;
-                grid_velocity_before_(node_idx)[vel_iter->first] = vel_iter->second; //buffer the grid velocity before any update
-            }
-        }
-    }
+    rasterizeMassAndMomentum();
+    computeGridVelocity();
 }
 
 template <typename Scalar, int Dim>
@@ -367,6 +434,37 @@ void MPMSolid<Scalar,Dim>::solveOnGrid(Scalar dt)
     applyGravityOnGrid(dt);
 }
 
+template <typename Scalar, int Dim>
+void MPMSolid<Scalar,Dim>::rasterizeAndSolveOnGrid(Scalar dt)
+{
+    //the fused passes are only valid if the grid velocity is single-valued and updated explicitly
+    if(this->objectNum() != 1 || contact_method_ != NULL || this->integration_method_ != MPMSolidBase<Scalar,Dim>::FORWARD_EULER)
+    {
+        MPMSolidBase<Scalar,Dim>::rasterizeAndSolveOnGrid(dt);
+        return;
+    }
+    //plugin operation, as in the separate substeps onRasterize() is called before rasterization
+    //and onSolveOnGrid() on the rasterized grid
+    MPMSolidPluginBase<Scalar,Dim> *plugin = NULL;
+    for(unsigned int i = 0; i < this->plugins_.size(); ++i)
+    {
+        plugin = dynamic_cast<MPMSolidPluginBase<Scalar,Dim>*>(this->plugins_[i]);
+        if(plugin)
+            plugin->onRasterize();
+    }
+
+    //one pass over particles for mass, momentum and internal force, one pass over grid nodes for velocity and gravity
+    resetGridData();
+    rasterizeMassAndMomentum(true,dt);
+    for(unsigned int i = 0; i < this->plugins_.size(); ++i)
+    {
+        plugin = dynamic_cast<MPMSolidPluginBase<Scalar,Dim>*>(this->plugins_[i]);
+        if(plugin)
+            plugin->onSolveOnGrid(dt);
+    }
+    computeGridVelocityWithInternalForceAndGravity(dt);
+}
+
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::resolveContactOnGrid(Scalar dt)
 {
@@ -380,83 +478,35 @@ void MPMSolid<Scalar,Dim>::resolveContactOnGrid(Scalar dt)
     }
 
     //resolve contact on grid with specific contact method
+    //the potential contact nodes are collected in computeGridVelocity(), and the normals are the mass gradients rasterized
+    //together with mass, hence the cost scales with the number of nodes at the contact interface
     if(contact_method_)
     {
-        std::vector<Vector<unsigned int,Dim> > potential_collide_nodes;
-        std::vector<std::vector<unsigned int> > objects_at_node;
-        std::vector<std::vector<unsigned char> > is_dirichlet_at_node;
-        std::set<unsigned int> involved_objects; //the set of objects involved in potential contact
-        Vector<unsigned int,Dim> grid_node_num = grid_.nodeNum();
-        std::multimap<unsigned int,unsigned int>::iterator iter = active_grid_node_.begin();
-        while(iter != active_grid_node_.end())
+        unsigned int contact_node_num = static_cast<unsigned int>(contact_node_entry_.size());
+        unsigned int active_num = static_cast<unsigned int>(active_node_idx_.size());
+        contact_node_idx_.resize(contact_node_num);
+        contact_node_objects_.resize(contact_node_num);
+        contact_node_normals_.resize(contact_node_num);
+        contact_node_dirichlet_.resize(contact_node_num);
+        for(unsigned int i = 0; i < contact_node_num; ++i)
         {
-            unsigned int node_idx_1d = iter->first;
-            unsigned int object_count = active_grid_node_.count(node_idx_1d);
-            if(object_count > 1) //multiple objects at the node
+            //entries of the same node are consecutive
+            unsigned int node_start = contact_node_entry_[i];
+            contact_node_idx_[i] = active_node_idx_[node_start];
+            contact_node_objects_[i].clear();
+            contact_node_normals_[i].clear();
+            contact_node_dirichlet_[i].clear();
+            for(unsigned int entry = node_start; entry < active_num && active_node_idx_[entry] == active_node_idx_[node_start]; ++entry)
             {
-                Vector<unsigned int,Dim> node_idx = multiDimIndex(node_idx_1d,grid_node_num);
-                std::vector<unsigned int> objects_at_this_node;
-                std::vector<unsigned char> is_dirichlet_at_this_node;
-                while(object_count != 0) //element with equal key are stored in sequence in multimap
-                {
-                    objects_at_this_node.push_back(iter->second);
-                    involved_objects.insert(iter->second);
-                    if(is_dirichlet_grid_node_(node_idx).count(iter->second) > 0)
-                        is_dirichlet_at_this_node.push_back(0x01);
-                    else
-                        is_dirichlet_at_this_node.push_back(0x00);
-                    ++iter;
-                    --object_count;
-                }
-                if(objects_at_this_node.size() > 0)
-                {
-                    potential_collide_nodes.push_back(node_idx);
-                    objects_at_node.push_back(objects_at_this_node);
-                    is_dirichlet_at_node.push_back(is_dirichlet_at_this_node);
-                }
-            }
-            else //no object or single object
-                ++iter;
-        }
-        //compute the normal of the involved objects at the potential contact nodes
-        std::vector<std::vector<Vector<Scalar,Dim> > > normal_at_node(potential_collide_nodes.size());
-        for(unsigned int i = 0; i < normal_at_node.size(); ++i)
-            normal_at_node[i].resize(objects_at_node[i].size());
-        ArrayND<std::map<unsigned int,Vector<Scalar,Dim> >,Dim> grid_normal(grid_node_num);
-        for(std::set<unsigned int>::iterator obj_iter = involved_objects.begin(); obj_iter != involved_objects.end(); ++obj_iter)
-        {
-            unsigned int obj_idx = *obj_iter;
-            for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
-            {
-                SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
-                for(unsigned int i = 0; i < this->particle_grid_pair_num_[obj_idx][particle_idx]; ++i)
-                {
-                    const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> &pair = this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i];
-                    Vector<Scalar,Dim> weight_gradient = pair.gradient_value_;
-                    typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator normal_iter = grid_normal(pair.node_idx_).find(obj_idx);
-                    if(normal_iter != grid_normal(pair.node_idx_).end())
-                        grid_normal(pair.node_idx_)[obj_idx] += weight_gradient*particle->mass();
-                    else
-                        grid_normal(pair.node_idx_).insert(std::make_pair(obj_idx,weight_gradient*particle->mass()));
-                }
-            }
-        }
-        for(unsigned int i = 0; i < potential_collide_nodes.size(); ++i)
-        {
-            Vector<unsigned int,Dim> node_idx = potential_collide_nodes[i];
-            for(unsigned int j = 0; j < objects_at_node[i].size(); ++j)
-            {
-                unsigned int obj_idx = objects_at_node[i][j];
-                //normalize normal
-                typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator normal_iter = grid_normal(node_idx).find(obj_idx);
-                if(normal_iter != grid_normal(node_idx).end())
-                    normal_at_node[i][j] = grid_normal(node_idx)[obj_idx].normalize();
-                else
-                    PHYSIKA_ERROR("Error in computing grid normal!");
+                unsigned int slot_idx = active_node_slot_[entry];
+                Vector<Scalar,Dim> normal = grid_data_.massGradient(slot_idx);
+                contact_node_objects_[i].push_back(active_node_object_[entry]);
+                contact_node_normals_[i].push_back(normal.normalize());
+                contact_node_dirichlet_[i].push_back(grid_data_.isDirichletSlot(slot_idx) ? 0x01 : 0x00);
             }
         }
         //resolve contact
-        contact_method_->resolveContact(potential_collide_nodes,objects_at_node,normal_at_node,is_dirichlet_at_node,dt);
+        contact_method_->resolveContact(contact_node_idx_,contact_node_objects_,contact_node_normals_,contact_node_dirichlet_,dt);
     }
 }
 
@@ -487,32 +537,48 @@ void MPMSolid<Scalar,Dim>::updateParticleInterpolationWeight()
     }
     
     //precompute the interpolation weights and gradients
+    //dispatch on the type of the weight function once, such that the weight function is inlined in the loop
+    const GridWeightFunction<Scalar,Dim> &weight_function = *(this->weight_function_);
+    if(GridWeightFunctionKernel<GridLinearWeightFunction<Scalar,Dim> >::isOfType(weight_function))
+        updateParticleGridStencil<GridLinearWeightFunction<Scalar,Dim> >();
+    else if(GridWeightFunctionKernel<GridQuadraticBSpline<Scalar,Dim> >::isOfType(weight_function))
+        updateParticleGridStencil<GridQuadraticBSpline<Scalar,Dim> >();
+    else if(GridWeightFunctionKernel<GridPiecewiseCubicSpline<Scalar,Dim> >::isOfType(weight_function))
+        updateParticleGridStencil<GridPiecewiseCubicSpline<Scalar,Dim> >();
+    else
+        updateParticleGridStencil<GridWeightFunction<Scalar,Dim> >();
+}
+
+template <typename Scalar, int Dim>
+template <typename GridWeightFunctionType>
+void MPMSolid<Scalar,Dim>::updateParticleGridStencil()
+{
+    //only the 1D factors of the weight function along each dimension are evaluated and stored
     typedef UniformGridWeightFunctionInfluenceIterator<Scalar,Dim> InfluenceIterator;
+    const GridWeightFunction<Scalar,Dim> &weight_function = *(this->weight_function_);
     Vector<Scalar,Dim> grid_dx = (this->grid_).dX();
+    Vector<Scalar,Dim> grid_min_corner = (this->grid_).minCorner();
+    int thread_num = static_cast<int>(this->thread_num_);
     for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        MPMParticleGridStencil<Scalar,Dim> &stencil = particle_grid_stencil_[obj_idx];
+        int particle_num = static_cast<int>(particle_data.particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
         {
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
-            Vector<Scalar,Dim> particle_pos = particle->position();
-            this->particle_grid_pair_num_[obj_idx][particle_idx] = 0;
-            for(InfluenceIterator iter(this->grid_,particle_pos,*(this->weight_function_)); iter.valid(); ++iter)
-            {
-                Vector<unsigned int,Dim> node_idx = iter.nodeIndex();
-                Vector<Scalar,Dim> particle_to_node = particle_pos - (this->grid_).node(node_idx);
-                for(unsigned int dim = 0; dim < Dim; ++dim)
-                    particle_to_node[dim] /= grid_dx[dim];
-                Scalar weight = this->weight_function_->weight(particle_to_node);
-                 //ignore nodes that has zero weight value, assume positve weight value
-                if(weight > std::numeric_limits<Scalar>::epsilon()) 
-                {
-                    Vector<Scalar,Dim> weight_gradient = this->weight_function_->gradient(particle_to_node);
-                    unsigned int i = this->particle_grid_pair_num_[obj_idx][particle_idx]++;
-                    (this->particle_grid_weight_and_gradient_)[obj_idx][particle_idx][i].node_idx_ = node_idx;
-                    (this->particle_grid_weight_and_gradient_)[obj_idx][particle_idx][i].weight_value_ = weight;
-                    (this->particle_grid_weight_and_gradient_)[obj_idx][particle_idx][i].gradient_value_ = weight_gradient;
-                }
-            }
+            const Vector<Scalar,Dim> &particle_pos = particle_data.position(particle_idx);
+            InfluenceIterator iter(this->grid_,particle_pos,weight_function);
+            const Vector<unsigned int,Dim> &min_node_idx = iter.minNodeIndex();
+            const Vector<unsigned int,Dim> &axis_node_num = iter.nodeNum();
+            stencil.setNodeRange(particle_idx,min_node_idx,axis_node_num);
+            Vector<Scalar,Dim> particle_to_first_node;
+            for(unsigned int dim = 0; dim < Dim; ++dim)
+                particle_to_first_node[dim] = (particle_pos[dim] - grid_min_corner[dim])/grid_dx[dim] - min_node_idx[dim];
+            //the factors of all dimensions are stored consecutively in the stencil
+            GridWeightFunctionKernel<GridWeightFunctionType>::axisWeightsAndGradients(weight_function,particle_to_first_node,axis_node_num,
+                                                                                      MPMParticleGridStencil<Scalar,Dim>::MAX_AXIS_NODE_NUM,
+                                                                                      stencil.axisWeights(particle_idx,0),stencil.axisGradients(particle_idx,0));
         }
     }
 }
@@ -529,19 +595,29 @@ void MPMSolid<Scalar,Dim>::updateParticleConstitutiveModelState(Scalar dt)
             plugin->onUpdateParticleConstitutiveModelState(dt);
     }
 
+    int thread_num = static_cast<int>(this->thread_num_);
+    //buffers for the particle-grid pairs reconstructed from the stencils, one for each thread
+    std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > > pair_buffer(thread_num,
+        std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> >(MPMParticleGridStencil<Scalar,Dim>::MAX_NODE_NUM));
     for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        int particle_num = static_cast<int>(particle_data.particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
         {
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
             SquareMatrix<Scalar,Dim> particle_vel_grad(0);
-            for(unsigned int i = 0; i < this->particle_grid_pair_num_[obj_idx][particle_idx]; ++i)
+            unsigned int pair_num = 0;
+            const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pairs = particleGridPairs(obj_idx,particle_idx,&pair_buffer[threadIndex()][0],pair_num);
+            for(unsigned int i = 0; i < pair_num; ++i)
             {
-                Vector<unsigned int,Dim> node_idx = (this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i].node_idx_);
-                Vector<Scalar,Dim> weight_gradient = (this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i].gradient_value_);
-                particle_vel_grad += gridVelocity(obj_idx,node_idx).outerProduct(weight_gradient);
+                //the node of the pair is always valid, nodes without data of the object have zero velocity
+                unsigned int slot_idx = grid_data_.slot(pairs[i].node_idx_,obj_idx);
+                if(slot_idx == grid_data_.INVALID_SLOT)
+                    continue;
+                particle_vel_grad += grid_data_.velocity(slot_idx).outerProduct(pairs[i].gradient_value_);
             }
-            SquareMatrix<Scalar,Dim> particle_deform_grad = particle->deformationGradient();
+            SquareMatrix<Scalar,Dim> &particle_deform_grad = particle_data.deformationGradient(particle_idx);
             //use the remedy in <Augmented MPM for phase-change and varied materials> to prevent |F| < 0
             SquareMatrix<Scalar,Dim> identity = SquareMatrix<Scalar,Dim>::identityMatrix(); 
             if((identity + dt*particle_vel_grad).determinant() > 0) //normal update
@@ -549,9 +625,8 @@ void MPMSolid<Scalar,Dim>::updateParticleConstitutiveModelState(Scalar dt)
             else //the remedy
                 particle_deform_grad += (dt*particle_vel_grad + 0.25*dt*dt*particle_vel_grad*particle_vel_grad)*particle_deform_grad;
             PHYSIKA_ASSERT(particle_deform_grad.determinant() > 0);
-            particle->setDeformationGradient(particle_deform_grad);  //update deformation gradient
-            Scalar particle_vol = (particle_deform_grad.determinant())*(this->particle_initial_volume_[obj_idx][particle_idx]);
-            particle->setVolume(particle_vol);  //update particle volume
+            //update particle volume
+            particle_data.volume(particle_idx) = (particle_deform_grad.determinant())*(this->particle_initial_volume_[obj_idx][particle_idx]);
         }
     }
 }
@@ -569,32 +644,31 @@ void MPMSolid<Scalar,Dim>::updateParticleVelocity()
     }
 
     //interpolate delta of grid velocity to particle
+    int thread_num = static_cast<int>(this->thread_num_);
+    //buffers for the particle-grid pairs reconstructed from the stencils, one for each thread
+    std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > > pair_buffer(thread_num,
+        std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> >(MPMParticleGridStencil<Scalar,Dim>::MAX_NODE_NUM));
     for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {  
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        int particle_num = static_cast<int>(particle_data.particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
         {
             if(this->is_dirichlet_particle_[obj_idx][particle_idx])
                 continue;//skip boundary particles
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
-            Vector<Scalar,Dim> new_vel = particle->velocity();
-            for(unsigned int i = 0; i < this->particle_grid_pair_num_[obj_idx][particle_idx]; ++i)
+            Vector<Scalar,Dim> &new_vel = particle_data.velocity(particle_idx);
+            unsigned int pair_num = 0;
+            const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pairs = particleGridPairs(obj_idx,particle_idx,&pair_buffer[threadIndex()][0],pair_num);
+            for(unsigned int i = 0; i < pair_num; ++i)
             {
-                Vector<unsigned int,Dim> node_idx = this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i].node_idx_;
-                if(gridMass(obj_idx,node_idx) <= std::numeric_limits<Scalar>::epsilon())
+                Vector<unsigned int,Dim> node_idx = pairs[i].node_idx_;
+                unsigned int slot_idx = grid_data_.slot(node_idx,obj_idx);
+                if(slot_idx == grid_data_.INVALID_SLOT || grid_data_.mass(slot_idx) <= std::numeric_limits<Scalar>::epsilon())
                     continue;
-                Scalar weight = this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i].weight_value_;
-                Vector<Scalar,Dim> cur_grid_vel(0),grid_vel_before(0);
-                if(grid_velocity_(node_idx).find(obj_idx) != grid_velocity_(node_idx).end())
-                    cur_grid_vel = grid_velocity_(node_idx)[obj_idx];
-                else
-                    PHYSIKA_ERROR("Error in updateParticleVelocity!");
-                if(grid_velocity_before_(node_idx).find(obj_idx) != grid_velocity_before_(node_idx).end())
-                    grid_vel_before = grid_velocity_before_(node_idx)[obj_idx];
-                else
-                    PHYSIKA_ERROR("Error in updateParticleVelocity!");
-                new_vel += weight*(cur_grid_vel-grid_vel_before);
+                Scalar weight = pairs[i].weight_value_;
+                new_vel += weight*(grid_data_.velocity(slot_idx)-grid_data_.velocityBefore(slot_idx));
             }
-            particle->setVelocity(new_vel);
         }
     }
 }
@@ -611,18 +685,19 @@ void MPMSolid<Scalar,Dim>::applyExternalForceOnParticles(Scalar dt)
             plugin->onApplyExternalForceOnParticles(dt);
     }
 
+    int thread_num = static_cast<int>(this->thread_num_);
     for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        int particle_num = static_cast<int>(particle_data.particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
         {
             if(this->is_dirichlet_particle_[obj_idx][particle_idx])
                 continue;//skip boundary particles
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
-            Vector<Scalar,Dim> new_vel = particle->velocity();
-            Scalar mass = particle->mass();
+            Scalar mass = particle_data.mass(particle_idx);
             PHYSIKA_ASSERT(mass > std::numeric_limits<Scalar>::epsilon());
-            new_vel += this->particle_external_force_[obj_idx][particle_idx]/mass*dt;
-            particle->setVelocity(new_vel);
+            particle_data.velocity(particle_idx) += this->particle_external_force_[obj_idx][particle_idx]/mass*dt;
         }
     }
 }
@@ -640,62 +715,96 @@ void MPMSolid<Scalar,Dim>::updateParticlePosition(Scalar dt)
     }
 
     //update particle's position with the new grid velocity
+    int thread_num = static_cast<int>(this->thread_num_);
+    //buffers for the particle-grid pairs reconstructed from the stencils, one for each thread
+    std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > > pair_buffer(thread_num,
+        std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> >(MPMParticleGridStencil<Scalar,Dim>::MAX_NODE_NUM));
     for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        int particle_num = static_cast<int>(particle_data.particleNum());
+#pragma omp parallel for num_threads(thread_num)
+        for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
         {
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
-            Vector<Scalar,Dim> new_pos = particle->position();
+            Vector<Scalar,Dim> &new_pos = particle_data.position(particle_idx);
             if(this->is_dirichlet_particle_[obj_idx][particle_idx]) //for dirichlet particles, update position with prescribed velocity
-                new_pos += this->particles_[obj_idx][particle_idx]->velocity()*dt;
+                new_pos += particle_data.velocity(particle_idx)*dt;
             else
             {
-                for(unsigned int i = 0; i < this->particle_grid_pair_num_[obj_idx][particle_idx]; ++i)
+                unsigned int pair_num = 0;
+                const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pairs = particleGridPairs(obj_idx,particle_idx,&pair_buffer[threadIndex()][0],pair_num);
+                for(unsigned int i = 0; i < pair_num; ++i)
                 {
-                    Vector<unsigned int,Dim> node_idx = this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i].node_idx_;
-                    Scalar weight = this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i].weight_value_;
-                    new_pos += weight*gridVelocity(obj_idx,node_idx)*dt;
+                    unsigned int slot_idx = grid_data_.slot(pairs[i].node_idx_,obj_idx);
+                    if(slot_idx == grid_data_.INVALID_SLOT)
+                        continue;
+                    new_pos += pairs[i].weight_value_*grid_data_.velocity(slot_idx)*dt;
                 }
             }
-            particle->setPosition(new_pos);
         }
     }
 }
 
 template <typename Scalar, int Dim>
-void MPMSolid<Scalar,Dim>::synchronizeGridData()
+void MPMSolid<Scalar,Dim>::reorderParticles()
 {
-    Vector<unsigned int,Dim> node_num = grid_.nodeNum();
-    for(unsigned int i = 0; i < Dim; ++i)
+    Vector<Scalar,Dim> grid_min = (this->grid_).minCorner();
+    Vector<Scalar,Dim> grid_dx = (this->grid_).dX();
+    Vector<unsigned int,Dim> cell_num = (this->grid_).cellNum();
+    int thread_num = static_cast<int>(this->thread_num_);
+    //key of particle: (material index, Morton code), particle index
+    std::vector<std::pair<std::pair<unsigned int,unsigned long long>,unsigned int> > particle_keys;
+    std::vector<unsigned int> permutation;
+    for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {
-        is_dirichlet_grid_node_.resize(node_num[i],i);
-        grid_mass_.resize(node_num[i],i);
-        grid_velocity_.resize(node_num[i],i);
-        grid_velocity_before_.resize(node_num[i],i);
+        const SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        int particle_num = static_cast<int>(particle_data.particleNum());
+        particle_keys.resize(particle_num);
+#pragma omp parallel for num_threads(thread_num)
+        for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
+        {
+            //cell index of the particle, clamped to the grid
+            Vector<Scalar,Dim> particle_pos = particle_data.position(particle_idx);
+            Vector<unsigned int,Dim> cell_idx;
+            for(unsigned int dim = 0; dim < Dim; ++dim)
+            {
+                Scalar bias = (particle_pos[dim] - grid_min[dim])/grid_dx[dim];
+                cell_idx[dim] = bias > 0 ? static_cast<unsigned int>(bias) : 0;
+                cell_idx[dim] = cell_idx[dim] < cell_num[dim] ? cell_idx[dim] : cell_num[dim] - 1;
+            }
+            particle_keys[particle_idx] = std::make_pair(std::make_pair(particle_data.materialIndex(particle_idx),MPMInternal::mortonCode(cell_idx)),
+                                                         static_cast<unsigned int>(particle_idx));
+        }
+        //particles of the same material in the same cell keep their relative order
+        std::sort(particle_keys.begin(),particle_keys.end());
+        permutation.resize(particle_num);
+        bool is_identity = true;
+        for(int i = 0; i < particle_num; ++i)
+        {
+            permutation[i] = particle_keys[i].second;
+            if(permutation[i] != static_cast<unsigned int>(i))
+                is_identity = false;
+        }
+        if(!is_identity)
+            permutateParticleRelatedDataOfObject(obj_idx,permutation);
     }
 }
 
+template <typename Scalar, int Dim>
+void MPMSolid<Scalar,Dim>::synchronizeGridData()
+{
+    grid_data_.resize(grid_.nodeNum());
+}
+
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::resetGridData()
 {
-    active_grid_node_.clear();
-    for(typename Grid<Scalar,Dim>::NodeIterator iter = grid_.nodeBegin(); iter != grid_.nodeEnd(); ++iter)
-    {
-        Vector<unsigned int,Dim> node_idx = iter.nodeIndex();
-        grid_mass_(node_idx).clear();
-        for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
-        {
-            if(is_dirichlet_grid_node_(node_idx).count(obj_idx) > 0)
-                continue; //skip grid nodes that are boundary condition
-            //reset the velocity of object at the node
-            typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator iter1 = grid_velocity_(node_idx).find(obj_idx);
-            if(iter1 != grid_velocity_(node_idx).end())
-                grid_velocity_(node_idx).erase(iter1);
-            typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator iter2 = grid_velocity_before_(node_idx).find(obj_idx);
-            if(iter2 != grid_velocity_before_(node_idx).end())
-                grid_velocity_before_(node_idx).erase(iter2);
-        }
-    }
+    active_node_idx_.clear();
+    active_node_object_.clear();
+    active_node_slot_.clear();
+    contact_node_entry_.clear();
+    grid_data_.clearData(); //the velocity of grid nodes that are boundary condition is kept
+
 }
 
 template <typename Scalar, int Dim>
@@ -708,32 +817,314 @@ template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::applyGravityOnGrid(Scalar dt)
 {
     //apply gravity on active grid node
-    Vector<unsigned int,Dim> grid_node_num = this->grid_.nodeNum();
     Vector<Scalar,Dim> gravity_vec(0);
     gravity_vec[1] = (-1)*(this->gravity_);
-    for(std::multimap<unsigned int,unsigned int>::iterator iter = active_grid_node_.begin(); iter != active_grid_node_.end(); ++iter)
+    for(unsigned int i = 0; i < active_node_slot_.size(); ++i)
     {
-        Vector<unsigned int,Dim> node_idx = multiDimIndex(iter->first,grid_node_num);
-        unsigned int obj_idx = iter->second;
-        if(is_dirichlet_grid_node_(node_idx).count(obj_idx) > 0)
+        unsigned int slot_idx = active_node_slot_[i];
+        if(grid_data_.isDirichletSlot(slot_idx))
             continue; //skip grid nodes that are boundary condition
-        if(contact_method_==NULL && is_dirichlet_grid_node_(node_idx).size() >0)
+        if(contact_method_==NULL && grid_data_.isDirichletNode(active_node_idx_[i]))
             continue; //if the inherent contact method is used, then the node is dirichlet for all objects once it's set for one
-        grid_velocity_(node_idx)[obj_idx] += gravity_vec*dt;
+        grid_data_.velocity(slot_idx) += gravity_vec*dt;
+    }
+}
+
+template <typename Scalar, int Dim>
+void MPMSolid<Scalar,Dim>::rasterizeMassAndMomentum(bool with_internal_force, Scalar dt)
+{
+    //the particles are put into bins of the grid block where their influence range starts,
+    //the bins are colored such that the influence ranges of particles in different bins of the same color never share a block
+    //the bins of one color are rasterized in parallel, and the colors are processed one after another
+    //hence the order of accumulation at each node doesn't depend on the thread number, and the result is deterministic
+    const unsigned int block_edge_bits = MPMSolidGridData<Scalar,Dim>::BLOCK_EDGE_BITS;
+    const unsigned int invalid_idx = MPMSolidGridData<Scalar,Dim>::INVALID_SLOT;
+    int thread_num = static_cast<int>(this->thread_num_);
+    //buffers for the particle-grid pairs reconstructed from the stencils, one for each thread
+    std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > > pair_buffer(thread_num,
+        std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> >(MPMParticleGridStencil<Scalar,Dim>::MAX_NODE_NUM));
+    //flatten the particles of all objects
+    std::vector<unsigned int> particle_object;
+    std::vector<unsigned int> particle_local_idx;
+    std::vector<const SolidParticleData<Scalar,Dim>*> object_particle_data(this->objectNum());
+    for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
+    {
+        object_particle_data[obj_idx] = &(this->particleData(obj_idx));
+        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        {
+            particle_object.push_back(obj_idx);
+            particle_local_idx.push_back(particle_idx);
+        }
+    }
+    int total_particle_num = static_cast<int>(particle_object.size());
+    if(with_internal_force)
+        computeParticleWeightedStress();
+    bool with_mass_gradient = contact_method_ != NULL && this->objectNum() > 1;
+    if(with_mass_gradient && !grid_data_.isMassGradientEnabled())
+        grid_data_.enableMassGradient();
+    else if(!with_mass_gradient && grid_data_.isMassGradientEnabled())
+        grid_data_.disableMassGradient();
+    //influence range of each particle on grid
+    std::vector<Vector<unsigned int,Dim> > particle_min_node(total_particle_num,Vector<unsigned int,Dim>(invalid_idx));
+    std::vector<Vector<unsigned int,Dim> > particle_max_node(total_particle_num,Vector<unsigned int,Dim>(0));
+#pragma omp parallel for num_threads(thread_num)
+    for(int i = 0; i < total_particle_num; ++i)
+    {
+        unsigned int obj_idx = particle_object[i], particle_idx = particle_local_idx[i];
+        if(!isParticleRasterizedToGrid(obj_idx,particle_idx))
+            continue;
+        unsigned int pair_num = 0;
+        const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pairs = particleGridPairs(obj_idx,particle_idx,&pair_buffer[threadIndex()][0],pair_num);
+        for(unsigned int j = 0; j < pair_num; ++j)
+        {
+            const Vector<unsigned int,Dim> &node_idx = pairs[j].node_idx_;
+            for(unsigned int k = 0; k < Dim; ++k)
+            {
+                particle_min_node[i][k] = std::min(particle_min_node[i][k],node_idx[k]);
+                particle_max_node[i][k] = std::max(particle_max_node[i][k],node_idx[k]);
+            }
+        }
+    }
+    //allocate the blocks in advance, and compute the maximum span of influence range in blocks
+    unsigned int max_block_span = 0;
+    Vector<unsigned int,Dim> last_min_block(invalid_idx), last_max_block(invalid_idx);
+    unsigned int last_obj_idx = invalid_idx;
+    for(int i = 0; i < total_particle_num; ++i)
+    {
+        if(particle_min_node[i][0] == invalid_idx)
+            continue;
+        Vector<unsigned int,Dim> min_block, max_block;
+        for(unsigned int k = 0; k < Dim; ++k)
+        {
+            min_block[k] = particle_min_node[i][k]>>block_edge_bits;
+            max_block[k] = particle_max_node[i][k]>>block_edge_bits;
+            max_block_span = std::max(max_block_span,max_block[k] - min_block[k]);
+        }
+        if(particle_object[i] == last_obj_idx && min_block == last_min_block && max_block == last_max_block)
+            continue;
+        grid_data_.reserveBlocks(particle_min_node[i],particle_max_node[i],particle_object[i]);
+        last_obj_idx = particle_object[i];
+        last_min_block = min_block;
+        last_max_block = max_block;
+    }
+    //put the particles into bins with counting sort, particles in each bin are in the original order
+    unsigned int block_num = grid_data_.allocatedBlockNum();
+    std::vector<unsigned int> bin_start(block_num+1,0);
+    for(int i = 0; i < total_particle_num; ++i)
+        if(particle_min_node[i][0] != invalid_idx)
+            ++bin_start[grid_data_.allocatedBlockId(particle_min_node[i])+1];
+    for(unsigned int block_id = 0; block_id < block_num; ++block_id)
+        bin_start[block_id+1] += bin_start[block_id];
+    std::vector<unsigned int> bin_particle(bin_start[block_num]);
+    std::vector<unsigned int> bin_end(bin_start.begin(),bin_start.end()-1);
+    for(int i = 0; i < total_particle_num; ++i)
+        if(particle_min_node[i][0] != invalid_idx)
+            bin_particle[bin_end[grid_data_.allocatedBlockId(particle_min_node[i])]++] = i;
+    //color the bins, bins of the same color are at least (max_block_span+1) blocks away along some direction
+    unsigned int color_period = max_block_span + 1;
+    unsigned int color_num = 1;
+    for(unsigned int k = 0; k < Dim; ++k)
+        color_num *= color_period;
+    std::vector<unsigned int> block_color(block_num);
+    std::vector<unsigned int> color_start(color_num+1,0);
+    for(unsigned int block_id = 0; block_id < block_num; ++block_id)
+    {
+        const Vector<unsigned int,Dim> &block_origin = grid_data_.allocatedBlockOrigin(block_id);
+        unsigned int color = 0;
+        for(unsigned int k = 0; k < Dim; ++k)
+            color = color*color_period + (block_origin[k]>>block_edge_bits)%color_period;
+        block_color[block_id] = color;
+        if(bin_start[block_id+1] > bin_start[block_id])
+            ++color_start[color+1];
+    }
+    for(unsigned int color = 0; color < color_num; ++color)
+        color_start[color+1] += color_start[color];
+    std::vector<unsigned int> color_bin(color_start[color_num]);
+    std::vector<unsigned int> color_end(color_start.begin(),color_start.end()-1);
+    for(unsigned int block_id = 0; block_id < block_num; ++block_id)
+        if(bin_start[block_id+1] > bin_start[block_id])
+            color_bin[color_end[block_color[block_id]]++] = block_id;
+    //rasterize
+    for(unsigned int color = 0; color < color_num; ++color)
+    {
+        int bin_num = static_cast<int>(color_start[color+1] - color_start[color]);
+#pragma omp parallel for schedule(dynamic) num_threads(thread_num)
+        for(int bin_idx = 0; bin_idx < bin_num; ++bin_idx)
+        {
+            unsigned int block_id = color_bin[color_start[color]+bin_idx];
+            for(unsigned int i = bin_start[block_id]; i < bin_start[block_id+1]; ++i)
+            {
+                unsigned int obj_idx = particle_object[bin_particle[i]], particle_idx = particle_local_idx[bin_particle[i]];
+                const SolidParticleData<Scalar,Dim> &particle_data = *object_particle_data[obj_idx];
+                Scalar particle_mass = particle_data.mass(particle_idx);
+                Vector<Scalar,Dim> particle_momentum = particle_mass*particle_data.velocity(particle_idx);
+                unsigned int pair_num = 0;
+                const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pairs = particleGridPairs(obj_idx,particle_idx,&pair_buffer[threadIndex()][0],pair_num);
+                if(with_internal_force)
+                {
+                    //momentum change of the node in dt: -dt*vol*cauchy_stress*weight_gradient
+                    SquareMatrix<Scalar,Dim> particle_stress_term = (-dt)*particle_weighted_stress_[obj_idx][particle_idx];
+                    for(unsigned int j = 0; j < pair_num; ++j)
+                    {
+                        const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> &pair = pairs[j];
+                        Scalar weight = pair.weight_value_;
+                        PHYSIKA_ASSERT(weight > std::numeric_limits<Scalar>::epsilon());
+                        grid_data_.accumulateMassAndMomentum(pair.node_idx_,obj_idx,weight*particle_mass,weight*particle_momentum,
+                                                             particle_stress_term*pair.gradient_value_);
+                    }
+                    continue;
+                }
+                for(unsigned int j = 0; j < pair_num; ++j)
+                {
+                    const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> &pair = pairs[j];
+                    Scalar weight = pair.weight_value_;
+                    PHYSIKA_ASSERT(weight > std::numeric_limits<Scalar>::epsilon());
+                    //the velocity update of boundary nodes is skipped
+                    unsigned int slot_idx = grid_data_.accumulateMassAndMomentum(pair.node_idx_,obj_idx,
+                                                                                 weight*particle_mass,weight*particle_momentum);
+                    if(with_mass_gradient)
+                        grid_data_.massGradient(slot_idx) += particle_mass*pair.gradient_value_;
+                }
+            }
+        }
+    }
+}
+
+template <typename Scalar, int Dim>
+void MPMSolid<Scalar,Dim>::computeParticleWeightedStress()
+{
+    //chunks of consecutive particles such that each batch evaluation is long enough to be vectorized
+    const unsigned int chunk_size = 256;
+    int thread_num = static_cast<int>(this->thread_num_);
+    particle_weighted_stress_.resize(this->objectNum());
+    for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
+    {
+        const SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        unsigned int particle_num = particle_data.particleNum();
+        particle_weighted_stress_[obj_idx].resize(particle_num);
+        if(particle_num == 0)
+            continue;
+        SquareMatrix<Scalar,Dim> *stress = &particle_weighted_stress_[obj_idx][0];
+        int chunk_num = static_cast<int>((particle_num + chunk_size - 1)/chunk_size);
+#pragma omp parallel for num_threads(thread_num)
+        for(int chunk_idx = 0; chunk_idx < chunk_num; ++chunk_idx)
+        {
+            unsigned int start = chunk_idx*chunk_size;
+            unsigned int count = std::min(chunk_size,particle_num - start);
+            particle_data.cauchyStress(start,count,stress+start,true);
+        }
+    }
+}
+
+template <typename Scalar, int Dim>
+bool MPMSolid<Scalar,Dim>::isParticleRasterizedToGrid(unsigned int object_idx, unsigned int particle_idx) const
+{
+    return true;
+}
+
+template <typename Scalar, int Dim>
+void MPMSolid<Scalar,Dim>::computeGridVelocity()
+{
+    //determine active grid nodes according to the grid mass of each object
+    //only the occupied grid nodes are visited, in ascending order of the flat index
+    grid_data_.collectOccupiedNodes();
+    for(unsigned int i = 0; i < grid_data_.occupiedNodeNum(); ++i)
+    {
+        unsigned int node_slot = grid_data_.occupiedNodeFirstSlot(i);
+        unsigned int active_object_num = 0;
+        for(unsigned int slot_idx = node_slot; slot_idx != grid_data_.INVALID_SLOT; slot_idx = grid_data_.nextSlot(slot_idx))
+        {
+            if(grid_data_.mass(slot_idx) > std::numeric_limits<Scalar>::epsilon())
+            {
+                if(active_object_num == 0)
+                    active_node_idx_.push_back(grid_data_.occupiedNode(i));
+                else
+                    active_node_idx_.push_back(active_node_idx_.back());
+                active_node_object_.push_back(grid_data_.slotObject(slot_idx));
+                active_node_slot_.push_back(slot_idx);
+                ++active_object_num;
+                if(active_object_num == 2 && this->contact_method_ != NULL)
+                    contact_node_entry_.push_back(static_cast<unsigned int>(active_node_idx_.size()) - 2);
+                //compute grid's velocity, divide momentum by mass
+                if(!grid_data_.isDirichletSlot(slot_idx)) //skip grid nodes that are boundary condition
+                    grid_data_.velocity(slot_idx) /= grid_data_.mass(slot_idx);
+                grid_data_.velocityBefore(slot_idx) = grid_data_.velocity(slot_idx);  //buffer the grid velocity before any update
+            }
+        }
+        //if no special contact algorithm is used, multi-value at a grid node must be converted to single value for all involved objects
+        if(this->contact_method_ != NULL || active_object_num <= 1) //skip single-valued node
+            continue;
+        Scalar mass_at_node = 0;
+        Vector<Scalar,Dim> momentum_at_node(0);
+        //accummulate values of all involved objects at this node
+        for(unsigned int slot_idx = node_slot; slot_idx != grid_data_.INVALID_SLOT; slot_idx = grid_data_.nextSlot(slot_idx))
+            if(grid_data_.mass(slot_idx) > std::numeric_limits<Scalar>::epsilon())
+            {
+                mass_at_node += grid_data_.mass(slot_idx);
+                momentum_at_node += grid_data_.mass(slot_idx) * grid_data_.velocity(slot_idx);
+            }
+        momentum_at_node /= mass_at_node;//velocity at node
+        //if for any involved object, this node is set as dirichlet, then the node is dirichlet for all objects
+        for(unsigned int slot_idx = node_slot; slot_idx != grid_data_.INVALID_SLOT; slot_idx = grid_data_.nextSlot(slot_idx))
+            if(grid_data_.isDirichletSlot(slot_idx))
+            {
+                momentum_at_node = grid_data_.velocity(slot_idx);
+                break;
+            }
+        //set all involved objects to uniform value at this node
+        for(unsigned int slot_idx = node_slot; slot_idx != grid_data_.INVALID_SLOT; slot_idx = grid_data_.nextSlot(slot_idx))
+        {
+            if(grid_data_.mass(slot_idx) > 0) //objects that have no mass at the node, e.g., dirichlet node without particles, keep zero mass
+                grid_data_.mass(slot_idx) = mass_at_node;
+            grid_data_.velocity(slot_idx) = momentum_at_node;
+            grid_data_.velocityBefore(slot_idx) = momentum_at_node; //buffer the grid velocity before any update
+        }
+    }
+}
+
+template <typename Scalar, int Dim>
+void MPMSolid<Scalar,Dim>::computeGridVelocityWithInternalForceAndGravity(Scalar dt)
+{
+    //the velocity before solve holds the momentum, and the velocity holds the momentum after internal force is applied
+    //the result equals that of computeGridVelocity(), solveOnGridForwardEuler() and applyGravityOnGrid() up to round-off
+    Vector<Scalar,Dim> gravity_vec(0);
+    gravity_vec[1] = (-1)*(this->gravity_);
+    grid_data_.collectOccupiedNodes();
+    for(unsigned int i = 0; i < grid_data_.occupiedNodeNum(); ++i)
+    {
+        unsigned int slot_idx = grid_data_.occupiedNodeFirstSlot(i);
+        PHYSIKA_ASSERT(grid_data_.nextSlot(slot_idx) == grid_data_.INVALID_SLOT); //single object
+        Scalar node_mass = grid_data_.mass(slot_idx);
+        if(node_mass <= std::numeric_limits<Scalar>::epsilon())
+        {
+            if(!grid_data_.isDirichletSlot(slot_idx))
+                grid_data_.velocity(slot_idx) = grid_data_.velocityBefore(slot_idx); //inactive node, the internal force is discarded
+            continue;
+        }
+        active_node_idx_.push_back(grid_data_.occupiedNode(i));
+        active_node_object_.push_back(grid_data_.slotObject(slot_idx));
+        active_node_slot_.push_back(slot_idx);
+        if(grid_data_.isDirichletSlot(slot_idx)) //grid nodes that are boundary condition keep the prescribed velocity
+        {
+            grid_data_.velocityBefore(slot_idx) = grid_data_.velocity(slot_idx);
+            continue;
+        }
+        grid_data_.velocityBefore(slot_idx) /= node_mass;
+        grid_data_.velocity(slot_idx) /= node_mass;
+        grid_data_.velocity(slot_idx) += gravity_vec*dt;
     }
 }
 
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::synchronizeWithInfluenceRangeChange()
 {
-    //for each particle, preallocate space that can store weight/gradient of maximum
-    //number of nodes in range
-    unsigned int max_num = 1;
-    for(unsigned int i = 0; i < Dim; ++i)
-        max_num *= (this->weight_function_->supportRadius())*2+1;
-    for(unsigned int i = 0; i < particle_grid_weight_and_gradient_.size(); ++i)
-        for(unsigned int j = 0; j < particle_grid_weight_and_gradient_[i].size(); ++j)
-            particle_grid_weight_and_gradient_[i][j].resize(max_num);
+    //the stencils are stored with fixed size, check if it's enough for the number of nodes in range
+    unsigned int max_axis_node_num = static_cast<unsigned int>((this->weight_function_->supportRadius())*2+1);
+    if(max_axis_node_num > MPMParticleGridStencil<Scalar,Dim>::MAX_AXIS_NODE_NUM)
+    {
+        std::cerr<<"Error: support radius of the weight function is larger than the maximum supported by MPMSolid, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
 }
 
 template <typename Scalar, int Dim>
@@ -746,87 +1137,89 @@ bool MPMSolid<Scalar,Dim>::isValidGridNodeIndex(const Vector<unsigned int,Dim> &
     return true;
 }
 
+template <typename Scalar, int Dim>
+const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim>* MPMSolid<Scalar,Dim>::particleGridPairs(unsigned int object_idx, unsigned int particle_idx,
+                                                                                                MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pair_buffer,
+                                                                                                unsigned int &pair_num) const
+{
+    PHYSIKA_ASSERT(object_idx < particle_grid_stencil_.size());
+    pair_num = particle_grid_stencil_[object_idx].gridPairs(particle_idx,pair_buffer);
+    return pair_buffer;
+}
+
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::appendAllParticleRelatedDataOfLastObject()
 {
     MPMSolidBase<Scalar,Dim>::appendAllParticleRelatedDataOfLastObject();
     unsigned int last_object_idx = this->objectNum() - 1;
     unsigned int particle_num_of_last_object = this->particleNumOfObject(last_object_idx);
-    //for each particle, preallocate space that can store weight/gradient of maximum
-    //number of nodes in range
-    unsigned int max_num = 1;
-    for(unsigned int i = 0; i < Dim; ++i)
-        max_num *= (this->weight_function_->supportRadius())*2+1;
-    std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > particle_max_num_weight_and_gradient_vec(max_num);
-    std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > >
-        object_max_num_weight_and_gradient_vec(particle_num_of_last_object,particle_max_num_weight_and_gradient_vec);
-    particle_grid_weight_and_gradient_.push_back(object_max_num_weight_and_gradient_vec);
-    std::vector<unsigned int> particle_grid_pair_num_vec(particle_num_of_last_object,0);
-    particle_grid_pair_num_.push_back(particle_grid_pair_num_vec);
+    particle_grid_stencil_.push_back(MPMParticleGridStencil<Scalar,Dim>());
+    particle_grid_stencil_.back().resize(particle_num_of_last_object);
 }
     
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::appendLastParticleRelatedDataOfObject(unsigned int object_idx)
 {
     MPMSolidBase<Scalar,Dim>::appendLastParticleRelatedDataOfObject(object_idx);
-    unsigned int max_num = 1;
-    for(unsigned int i = 0; i < Dim; ++i)
-        max_num *= (this->weight_function_->supportRadius())*2+1;
-    std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > particle_max_num_weight_and_gradient_vec(max_num);
-    particle_grid_weight_and_gradient_[object_idx].push_back(particle_max_num_weight_and_gradient_vec);
-    particle_grid_pair_num_[object_idx].push_back(0);
+    particle_grid_stencil_[object_idx].resize(this->particleNumOfObject(object_idx));
 }
     
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::deleteAllParticleRelatedDataOfObject(unsigned int object_idx)
 {
     MPMSolidBase<Scalar,Dim>::deleteAllParticleRelatedDataOfObject(object_idx);
-    typename std::vector<std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > > >::iterator iter1 =
-        particle_grid_weight_and_gradient_.begin() + object_idx;
-    particle_grid_weight_and_gradient_.erase(iter1);
-    std::vector<std::vector<unsigned int> >::iterator iter2 = particle_grid_pair_num_.begin() + object_idx;
-    particle_grid_pair_num_.erase(iter2);
+    typename std::vector<MPMParticleGridStencil<Scalar,Dim> >::iterator iter = particle_grid_stencil_.begin() + object_idx;
+    particle_grid_stencil_.erase(iter);
 }
     
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::deleteOneParticleRelatedDataOfObject(unsigned int object_idx, unsigned int particle_idx)
 {
     MPMSolidBase<Scalar,Dim>::deleteOneParticleRelatedDataOfObject(object_idx,particle_idx);
-    typename std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > >::iterator iter1 =
-        particle_grid_weight_and_gradient_[object_idx].begin() + particle_idx;
-    particle_grid_weight_and_gradient_[object_idx].erase(iter1);
-    std::vector<unsigned int>::iterator iter2 = particle_grid_pair_num_[object_idx].begin() + particle_idx;
-    particle_grid_pair_num_[object_idx].erase(iter2);
+    particle_grid_stencil_[object_idx].removeParticle(particle_idx);
+}
+
+template <typename Scalar, int Dim>
+void MPMSolid<Scalar,Dim>::permutateParticleRelatedDataOfObject(unsigned int object_idx, const std::vector<unsigned int> &permutation)
+{
+    MPMSolidBase<Scalar,Dim>::permutateParticleRelatedDataOfObject(object_idx,permutation);
+    particle_grid_stencil_[object_idx].permutate(permutation);
 }
 
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::solveOnGridForwardEuler(Scalar dt)
 {
     //explicit integration
+    std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > pair_buffer(MPMParticleGridStencil<Scalar,Dim>::MAX_NODE_NUM);
+    computeParticleWeightedStress();
     for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
     {
-        for(unsigned int particle_idx = 0; particle_idx < this->particleNumOfObject(obj_idx); ++particle_idx)
+        const SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+        for(unsigned int particle_idx = 0; particle_idx < particle_data.particleNum(); ++particle_idx)
         {
-            SolidParticle<Scalar,Dim> *particle = this->particles_[obj_idx][particle_idx];
-            for(unsigned int i = 0; i < this->particle_grid_pair_num_[obj_idx][particle_idx]; ++i)
+            const SquareMatrix<Scalar,Dim> &weighted_stress = particle_weighted_stress_[obj_idx][particle_idx];
+            unsigned int pair_num = 0;
+            const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pairs = particleGridPairs(obj_idx,particle_idx,&pair_buffer[0],pair_num);
+            for(unsigned int i = 0; i < pair_num; ++i)
             {
-                const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> &pair = this->particle_grid_weight_and_gradient_[obj_idx][particle_idx][i];
-                if(is_dirichlet_grid_node_(pair.node_idx_).count(obj_idx) > 0)
+                const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> &pair = pairs[i];
+                unsigned int slot_idx = grid_data_.slot(pair.node_idx_,obj_idx);
+                PHYSIKA_ASSERT(slot_idx != grid_data_.INVALID_SLOT);
+                if(grid_data_.isDirichletSlot(slot_idx))
                     continue; //skip grid nodes that are boundary condition
                 Vector<Scalar,Dim> weight_gradient = pair.gradient_value_;
-                SquareMatrix<Scalar,Dim> cauchy_stress = particle->cauchyStress();
-                if(grid_mass_(pair.node_idx_)[obj_idx] <= std::numeric_limits<Scalar>::epsilon())
+                Scalar node_mass = grid_data_.mass(slot_idx);
+                if(node_mass <= std::numeric_limits<Scalar>::epsilon())
                     continue; //skip grid nodes with near zero mass
                 if(contact_method_)  //if contact method other than the inherent one is employed, update the grid velocity of each object independently
-                    grid_velocity_(pair.node_idx_)[obj_idx] += dt*(-1)*(particle->volume())*cauchy_stress*weight_gradient/grid_mass_(pair.node_idx_)[obj_idx];
+                    grid_data_.velocity(slot_idx) += dt*(-1)*weighted_stress*weight_gradient/node_mass;
                 else  //otherwise, grid velocity of all objects that ocuppy the node get updated
                 {
-                    if(is_dirichlet_grid_node_(pair.node_idx_).size() > 0)
+                    if(grid_data_.isDirichletNode(pair.node_idx_))
                         continue;  //if for any involved object, this node is set as dirichlet, then the node is dirichlet for all objects
-                    for(typename std::map<unsigned int,Vector<Scalar,Dim> >::iterator vel_iter = grid_velocity_(pair.node_idx_).begin();
-                        vel_iter != grid_velocity_(pair.node_idx_).end(); ++vel_iter)
-                        if(gridMass(vel_iter->first,pair.node_idx_) > std::numeric_limits<Scalar>::epsilon())
-                            vel_iter->second += dt*(-1)*(particle->volume())*cauchy_stress*weight_gradient/grid_mass_(pair.node_idx_)[obj_idx];
+                    for(unsigned int node_slot = grid_data_.firstSlot(pair.node_idx_); node_slot != grid_data_.INVALID_SLOT; node_slot = grid_data_.nextSlot(node_slot))
+                        if(grid_data_.mass(node_slot) > std::numeric_limits<Scalar>::epsilon())
+                            grid_data_.velocity(node_slot) += dt*(-1)*weighted_stress*weight_gradient/node_mass;
                 }
             }
         }
@@ -836,7 +1229,261 @@ void MPMSolid<Scalar,Dim>::solveOnGridForwardEuler(Scalar dt)
 template <typename Scalar, int Dim>
 void MPMSolid<Scalar,Dim>::solveOnGridBackwardEuler(Scalar dt)
 {
-//TO DO
+    //implicit integration: solve m*(v-v_n) = dt*f(v) for the grid velocity v, where the internal force f is evaluated
+    //with the deformation gradient at the end of the step, F(v) = (I+dt*grad(v))*F_n
+    //each Newton iteration solves (m-dt*df/dv)*dv = m*(v_n-v)+dt*f(v) with Jacobi preconditioned CG, where the action of
+    //df/dv is computed from the stress differentials of the particles and the matrix is never assembled
+    const unsigned int invalid_idx = MPMSolidGridData<Scalar,Dim>::INVALID_SLOT;
+    //the unknowns are the velocities of active slots that are not boundary condition
+    //if the inherent contact method is used, all objects at a node share one unknown because their velocities are uniform
+    std::vector<unsigned int> slot_unknown(grid_data_.slotNum(),invalid_idx);
+    std::vector<Scalar> unknown_mass;
+    std::vector<Vector<Scalar,Dim> > unknown_velocity;
+    for(unsigned int i = 0; i < active_node_slot_.size(); ++i)
+    {
+        unsigned int slot_idx = active_node_slot_[i];
+        if(grid_data_.isDirichletSlot(slot_idx))
+            continue; //skip grid nodes that are boundary condition
+        if(contact_method_ == NULL && grid_data_.isDirichletNode(active_node_idx_[i]))
+            continue; //if the inherent contact method is used, then the node is dirichlet for all objects once it's set for one
+        if(contact_method_ == NULL && i > 0 && active_node_idx_[i] == active_node_idx_[i-1] && slot_unknown[active_node_slot_[i-1]] != invalid_idx)
+            slot_unknown[slot_idx] = slot_unknown[active_node_slot_[i-1]]; //entries of the same node are consecutive
+        else
+        {
+            slot_unknown[slot_idx] = static_cast<unsigned int>(unknown_mass.size());
+            unknown_mass.push_back(grid_data_.mass(slot_idx));
+            unknown_velocity.push_back(grid_data_.velocity(slot_idx));
+        }
+    }
+    unsigned int unknown_num = static_cast<unsigned int>(unknown_mass.size());
+    if(unknown_num == 0)
+        return;
+
+    int thread_num = static_cast<int>(this->thread_num_);
+    //buffers for the particle-grid pairs reconstructed from the stencils, one for each thread
+    std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > > pair_buffer(thread_num,
+        std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> >(MPMParticleGridStencil<Scalar,Dim>::MAX_NODE_NUM));
+    //deformation gradient at the end of step with current velocity, and the per-particle terms gathered to grid
+    std::vector<std::vector<SquareMatrix<Scalar,Dim> > > trial_deform_grad(this->objectNum());
+    std::vector<std::vector<SquareMatrix<Scalar,Dim> > > particle_term(this->objectNum());
+    for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
+    {
+        trial_deform_grad[obj_idx].resize(this->particleNumOfObject(obj_idx));
+        particle_term[obj_idx].resize(this->particleNumOfObject(obj_idx));
+    }
+    std::vector<Vector<Scalar,Dim> > initial_velocity(unknown_velocity);
+    std::vector<Vector<Scalar,Dim> > residual(unknown_num), diagonal(unknown_num), delta_velocity(unknown_num);
+    std::vector<Vector<Scalar,Dim> > direction(unknown_num), preconditioned_residual(unknown_num), product(unknown_num);
+    std::vector<std::vector<Vector<Scalar,Dim> > > range_node_term(backward_euler_range_num_,std::vector<Vector<Scalar,Dim> >(unknown_num));
+    SquareMatrix<Scalar,Dim> identity = SquareMatrix<Scalar,Dim>::identityMatrix();
+    Scalar initial_residual_norm = 0;
+    for(unsigned int newton_iter = 0; newton_iter < backward_euler_max_newton_iteration_; ++newton_iter)
+    {
+        //evaluate the stress with the deformation gradient at the end of step
+        for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
+        {
+            const SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+            int particle_num = static_cast<int>(particle_data.particleNum());
+#pragma omp parallel for num_threads(thread_num)
+            for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
+            {
+                SquareMatrix<Scalar,Dim> particle_vel_grad = backwardEulerVelocityGradient(obj_idx,particle_idx,slot_unknown,unknown_velocity,true,
+                                                                                           &pair_buffer[threadIndex()][0]);
+                const SquareMatrix<Scalar,Dim> &particle_deform_grad = particle_data.deformationGradient(particle_idx);
+                SquareMatrix<Scalar,Dim> &trial_grad = trial_deform_grad[obj_idx][particle_idx];
+                //the same remedy as updateParticleConstitutiveModelState() to prevent |F| < 0
+                if((identity + dt*particle_vel_grad).determinant() > 0)
+                    trial_grad = particle_deform_grad + dt*particle_vel_grad*particle_deform_grad;
+                else
+                    trial_grad = particle_deform_grad + (dt*particle_vel_grad + 0.25*dt*dt*particle_vel_grad*particle_vel_grad)*particle_deform_grad;
+                particle_term[obj_idx][particle_idx] = (this->particle_initial_volume_[obj_idx][particle_idx])*
+                    particle_data.firstPiolaKirchhoffStress(particle_idx,trial_grad)*particle_deform_grad.transpose();
+            }
+        }
+        //the residual, the gathered term is the negative internal force
+        backwardEulerGatherToNodes(slot_unknown,particle_term,residual,range_node_term,pair_buffer);
+        Scalar residual_norm_sqr = 0;
+        for(unsigned int i = 0; i < unknown_num; ++i)
+        {
+            residual[i] = unknown_mass[i]*(initial_velocity[i] - unknown_velocity[i]) - dt*residual[i];
+            residual_norm_sqr += residual[i].normSquared();
+        }
+        Scalar residual_norm = sqrt(residual_norm_sqr);
+        if(newton_iter == 0)
+            initial_residual_norm = residual_norm;
+        if(residual_norm <= backward_euler_tolerance_*initial_residual_norm || residual_norm <= std::numeric_limits<Scalar>::epsilon())
+            break;
+        //diagonal of the system matrix as the Jacobi preconditioner, the stress differential is evaluated for each
+        //dimension of each node in range of the particle
+        int range_num = static_cast<int>(range_node_term.size());
+#pragma omp parallel for num_threads(thread_num)
+        for(int range_idx = 0; range_idx < range_num; ++range_idx)
+        {
+            std::vector<Vector<Scalar,Dim> > &range_diagonal = range_node_term[range_idx];
+            std::fill(range_diagonal.begin(),range_diagonal.end(),Vector<Scalar,Dim>(0));
+            MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *thread_pair_buffer = &pair_buffer[threadIndex()][0];
+            for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
+            {
+                const SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+                unsigned int particle_num = particle_data.particleNum();
+                unsigned int range_end = static_cast<unsigned int>(static_cast<unsigned long long>(particle_num)*(range_idx+1)/range_num);
+                for(unsigned int particle_idx = static_cast<unsigned int>(static_cast<unsigned long long>(particle_num)*range_idx/range_num);
+                    particle_idx < range_end; ++particle_idx)
+                {
+                    const SquareMatrix<Scalar,Dim> &particle_deform_grad = particle_data.deformationGradient(particle_idx);
+                    Scalar particle_initial_vol = this->particle_initial_volume_[obj_idx][particle_idx];
+                    unsigned int pair_num = 0;
+                    const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pairs = particleGridPairs(obj_idx,particle_idx,thread_pair_buffer,pair_num);
+                    for(unsigned int i = 0; i < pair_num; ++i)
+                    {
+                        unsigned int slot_idx = grid_data_.slot(pairs[i].node_idx_,obj_idx);
+                        if(slot_idx == invalid_idx || slot_unknown[slot_idx] == invalid_idx)
+                            continue;
+                        Vector<Scalar,Dim> material_gradient = particle_deform_grad.transpose()*pairs[i].gradient_value_;
+                        for(unsigned int dim = 0; dim < Dim; ++dim)
+                        {
+                            SquareMatrix<Scalar,Dim> deform_grad_differential(0);
+                            for(unsigned int k = 0; k < Dim; ++k)
+                                deform_grad_differential(dim,k) = dt*material_gradient[k];
+                            SquareMatrix<Scalar,Dim> stress_differential = particle_data.firstPiolaKirchhoffStressDifferential(particle_idx,
+                                                                               trial_deform_grad[obj_idx][particle_idx],deform_grad_differential);
+                            range_diagonal[slot_unknown[slot_idx]][dim] += dt*particle_initial_vol*(stress_differential*material_gradient)[dim];
+                        }
+                    }
+                }
+            }
+        }
+        MPMInternal::sumRangeNodeTerms(range_node_term,diagonal,thread_num);
+        for(unsigned int i = 0; i < unknown_num; ++i)
+            diagonal[i] += Vector<Scalar,Dim>(unknown_mass[i]);
+        //the stiffness may be indefinite, fall back to the mass in that case
+        for(unsigned int i = 0; i < unknown_num; ++i)
+            for(unsigned int dim = 0; dim < Dim; ++dim)
+                if(diagonal[i][dim] <= std::numeric_limits<Scalar>::epsilon())
+                    diagonal[i][dim] = unknown_mass[i];
+        //solve for the velocity increment with preconditioned CG, starting from zero
+        Scalar residual_dot_preconditioned = 0;
+        for(unsigned int i = 0; i < unknown_num; ++i)
+        {
+            delta_velocity[i] = Vector<Scalar,Dim>(0);
+            for(unsigned int dim = 0; dim < Dim; ++dim)
+                preconditioned_residual[i][dim] = residual[i][dim]/diagonal[i][dim];
+            direction[i] = preconditioned_residual[i];
+            residual_dot_preconditioned += residual[i].dot(preconditioned_residual[i]);
+        }
+        Scalar cg_tolerance_sqr = backward_euler_tolerance_*backward_euler_tolerance_*residual_norm_sqr;
+        Scalar cg_residual_norm_sqr = residual_norm_sqr;
+        unsigned int cg_iter = 0;
+        for(; cg_iter < backward_euler_max_cg_iteration_ && cg_residual_norm_sqr > cg_tolerance_sqr; ++cg_iter)
+        {
+            //product of the system matrix and the search direction: m*d + dt*sum(V0*dP(F,dt*grad(d)*F_n)*F_n^T*grad(w))
+            for(unsigned int obj_idx = 0; obj_idx < this->objectNum(); ++obj_idx)
+            {
+                const SolidParticleData<Scalar,Dim> &particle_data = this->particleData(obj_idx);
+                int particle_num = static_cast<int>(particle_data.particleNum());
+#pragma omp parallel for num_threads(thread_num)
+                for(int particle_idx = 0; particle_idx < particle_num; ++particle_idx)
+                {
+                    SquareMatrix<Scalar,Dim> direction_grad = backwardEulerVelocityGradient(obj_idx,particle_idx,slot_unknown,direction,false,
+                                                                                            &pair_buffer[threadIndex()][0]);
+                    const SquareMatrix<Scalar,Dim> &particle_deform_grad = particle_data.deformationGradient(particle_idx);
+                    SquareMatrix<Scalar,Dim> deform_grad_differential = dt*direction_grad*particle_deform_grad;
+                    particle_term[obj_idx][particle_idx] = (this->particle_initial_volume_[obj_idx][particle_idx])*
+                        particle_data.firstPiolaKirchhoffStressDifferential(particle_idx,trial_deform_grad[obj_idx][particle_idx],deform_grad_differential)*
+                        particle_deform_grad.transpose();
+                }
+            }
+            backwardEulerGatherToNodes(slot_unknown,particle_term,product,range_node_term,pair_buffer);
+            Scalar curvature = 0;
+            for(unsigned int i = 0; i < unknown_num; ++i)
+            {
+                product[i] = unknown_mass[i]*direction[i] + dt*product[i];
+                curvature += direction[i].dot(product[i]);
+            }
+            if(curvature <= 0)
+                break; //the system is not positive definite along the direction, keep the increment so far
+            Scalar alpha = residual_dot_preconditioned/curvature;
+            Scalar new_residual_dot_preconditioned = 0;
+            cg_residual_norm_sqr = 0;
+            for(unsigned int i = 0; i < unknown_num; ++i)
+            {
+                delta_velocity[i] += alpha*direction[i];
+                residual[i] -= alpha*product[i];
+                for(unsigned int dim = 0; dim < Dim; ++dim)
+                    preconditioned_residual[i][dim] = residual[i][dim]/diagonal[i][dim];
+                new_residual_dot_preconditioned += residual[i].dot(preconditioned_residual[i]);
+                cg_residual_norm_sqr += residual[i].normSquared();
+            }
+            Scalar beta = new_residual_dot_preconditioned/residual_dot_preconditioned;
+            residual_dot_preconditioned = new_residual_dot_preconditioned;
+            for(unsigned int i = 0; i < unknown_num; ++i)
+                direction[i] = preconditioned_residual[i] + beta*direction[i];
+        }
+        if(cg_iter == 0)
+            break; //no progress can be made
+        for(unsigned int i = 0; i < unknown_num; ++i)
+            unknown_velocity[i] += delta_velocity[i];
+    }
+    //write the solution back to grid
+    for(unsigned int slot_idx = 0; slot_idx < slot_unknown.size(); ++slot_idx)
+        if(slot_unknown[slot_idx] != invalid_idx)
+            grid_data_.velocity(slot_idx) = unknown_velocity[slot_unknown[slot_idx]];
+}
+
+template <typename Scalar, int Dim>
+SquareMatrix<Scalar,Dim> MPMSolid<Scalar,Dim>::backwardEulerVelocityGradient(unsigned int object_idx, unsigned int particle_idx, const std::vector<unsigned int> &slot_unknown,
+                                                                             const std::vector<Vector<Scalar,Dim> > &unknown_velocity, bool with_known_nodes,
+                                                                             MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pair_buffer) const
+{
+    SquareMatrix<Scalar,Dim> particle_vel_grad(0);
+    unsigned int pair_num = 0;
+    const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pairs = particleGridPairs(object_idx,particle_idx,pair_buffer,pair_num);
+    for(unsigned int i = 0; i < pair_num; ++i)
+    {
+        unsigned int slot_idx = grid_data_.slot(pairs[i].node_idx_,object_idx);
+        if(slot_idx == grid_data_.INVALID_SLOT)
+            continue;
+        if(slot_unknown[slot_idx] != grid_data_.INVALID_SLOT)
+            particle_vel_grad += unknown_velocity[slot_unknown[slot_idx]].outerProduct(pairs[i].gradient_value_);
+        else if(with_known_nodes)
+            particle_vel_grad += grid_data_.velocity(slot_idx).outerProduct(pairs[i].gradient_value_);
+    }
+    return particle_vel_grad;
+}
+
+template <typename Scalar, int Dim>
+void MPMSolid<Scalar,Dim>::backwardEulerGatherToNodes(const std::vector<unsigned int> &slot_unknown, const std::vector<std::vector<SquareMatrix<Scalar,Dim> > > &particle_term,
+                                                      std::vector<Vector<Scalar,Dim> > &node_term, std::vector<std::vector<Vector<Scalar,Dim> > > &range_node_term,
+                                                      std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > > &pair_buffer) const
+{
+    int thread_num = static_cast<int>(this->thread_num_);
+    int range_num = static_cast<int>(range_node_term.size());
+#pragma omp parallel for num_threads(thread_num)
+    for(int range_idx = 0; range_idx < range_num; ++range_idx)
+    {
+        std::vector<Vector<Scalar,Dim> > &range_term = range_node_term[range_idx];
+        std::fill(range_term.begin(),range_term.end(),Vector<Scalar,Dim>(0));
+        MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *thread_pair_buffer = &pair_buffer[threadIndex()][0];
+        for(unsigned int obj_idx = 0; obj_idx < particle_term.size(); ++obj_idx)
+        {
+            unsigned int particle_num = static_cast<unsigned int>(particle_term[obj_idx].size());
+            unsigned int range_end = static_cast<unsigned int>(static_cast<unsigned long long>(particle_num)*(range_idx+1)/range_num);
+            for(unsigned int particle_idx = static_cast<unsigned int>(static_cast<unsigned long long>(particle_num)*range_idx/range_num);
+                particle_idx < range_end; ++particle_idx)
+            {
+                unsigned int pair_num = 0;
+                const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pairs = particleGridPairs(obj_idx,particle_idx,thread_pair_buffer,pair_num);
+                for(unsigned int i = 0; i < pair_num; ++i)
+                {
+                    unsigned int slot_idx = grid_data_.slot(pairs[i].node_idx_,obj_idx);
+                    if(slot_idx == grid_data_.INVALID_SLOT || slot_unknown[slot_idx] == grid_data_.INVALID_SLOT)
+                        continue;
+                    range_term[slot_unknown[slot_idx]] += particle_term[obj_idx][particle_idx]*pairs[i].gradient_value_;
+                }
+            }
+        }
+    }
+    MPMInternal::sumRangeNodeTerms(range_node_term,node_term,thread_num);
 }
 
 template <typename Scalar, int Dim>
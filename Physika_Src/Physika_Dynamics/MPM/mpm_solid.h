@@ -24,6 +24,8 @@
 #include "Physika_Core/Vectors/vector_3d.h"
 #include "Physika_Geometry/Cartesian_Grids/grid.h"
 #include "Physika_Dynamics/MPM/mpm_solid_base.h"
+#include "Physika_Dynamics/MPM/mpm_solid_grid_data.h"
+#include "Physika_Dynamics/MPM/mpm_particle_grid_stencil.h"
 
 namespace Physika{
 
@@ -37,6 +39,11 @@ template<typename Scalar,int Dim> class MPMSolidContactMethod;
  * 
  * Single-valued variable is stored on the grid if no specific contact algorithm is employed
  * Otherwise, multi-valued variable maybe attached to a grid node
+ * Grid data are stored in sparse blocks of flat arrays, see MPMSolidGridData
+ * The interpolation weights between particles and grid are stored as tensor-product stencils, see MPMParticleGridStencil
+ *
+ * With BACKWARD_EULER, the grid velocities are solved with Newton's method where the internal force is evaluated at
+ * the end of the time step, the system matrix is applied matrix-free via the stress differentials of the particles
  */
 
 template <typename Scalar, int Dim>
@@ -56,6 +63,7 @@ public:
     virtual bool withRestartSupport() const;
     virtual void write(const std::string &file_name);
     virtual void read(const std::string &file_name);
+    virtual bool writeToStream(std::ostream &output);
     
     //setters&&getters
     const Grid<Scalar,Dim>& grid() const;
@@ -70,6 +78,15 @@ public:
     //set contact method
     void setContactMethod(const MPMSolidContactMethod<Scalar,Dim> &contact_method);
     void resetContactMethod();  //reset the contact method to the one inherent in mpm
+    //parameters of the implicit solve on grid if BACKWARD_EULER is used: maximum number of Newton iterations,
+    //maximum number of CG iterations in each Newton iteration, and the tolerance of residual relative to the initial one
+    void setBackwardEulerSolverParameters(unsigned int max_newton_iteration, unsigned int max_cg_iteration, Scalar tolerance);
+    //the particle-to-node accumulations of the implicit solve split the particles of each object into range_num ranges (64 by default),
+    //each range accumulates to its own copy of the node terms in parallel and the copies are summed in range order, hence the
+    //result doesn't depend on the thread number; at most range_num threads are used in the accumulations, and the copies take
+    //range_num*(number of unknown grid velocities)*Dim scalars, e.g., 150MB for 100k unknowns in 3D with double precision
+    unsigned int backwardEulerRangeNum() const;
+    void setBackwardEulerRangeNum(unsigned int range_num);
 
     //substeps in one time step
     virtual void rasterize();
@@ -81,39 +98,89 @@ public:
     virtual void updateParticleVelocity();
     virtual void applyExternalForceOnParticles(Scalar dt);
     virtual void updateParticlePosition(Scalar dt);
+    //for single object with the inherent contact method and FORWARD_EULER, the internal force is rasterized together with
+    //mass and momentum, and gravity is applied in the same pass over grid nodes as the velocity computation
+    virtual void rasterizeAndSolveOnGrid(Scalar dt);
+    virtual void reorderParticles(); //sort the particles of each object by material, and then by Morton code of the grid cell they're in
     
 protected:
     virtual void synchronizeGridData(); //synchronize grid data as grid changes, e.g., size of grid_mass_
     virtual void resetGridData();  //reset grid data to zero, needed before rasterize operation
     virtual Scalar minCellEdgeLength() const;
     virtual void applyGravityOnGrid(Scalar dt);
+    //rasterize mass and momentum of the particles to grid in parallel, the result doesn't depend on the thread number
+    //if with_internal_force is true, the momentum change due to internal force in dt is rasterized as well, see computeGridVelocity()
+    //if a contact method is set for multiple objects, the mass gradient is rasterized for the normals used in contact
+    void rasterizeMassAndMomentum(bool with_internal_force = false, Scalar dt = 0);
+    virtual bool isParticleRasterizedToGrid(unsigned int object_idx, unsigned int particle_idx) const; //called in parallel, return true by default
+    //evaluate the volume weighted cauchy stress of all particles into particle_weighted_stress_, in parallel chunks of particles
+    //with the batch methods of the constitutive models
+    void computeParticleWeightedStress();
+    //determine active grid nodes and compute grid velocity from the rasterized momentum, called at the end of rasterize()
+    //the nodes occupied by multiple objects are collected as potential contact nodes if a contact method is set
+    void computeGridVelocity();
+    //the same for single object, where the internal force is rasterized as well, and gravity is applied
+    void computeGridVelocityWithInternalForceAndGravity(Scalar dt);
     virtual void synchronizeWithInfluenceRangeChange(); //synchronize data when the influence range of weight function changes
     bool isValidGridNodeIndex(const Vector<unsigned int,Dim> &node_idx) const;  //helper method, determine if input grid node index is valid
+    //compute particle_grid_stencil_ with the weight function evaluated via GridWeightFunctionKernel<GridWeightFunctionType>
+    template <typename GridWeightFunctionType>
+    void updateParticleGridStencil();
+    //node-weight-gradient pairs of the grid nodes in range of the particle, can be called in parallel
+    //the pairs are reconstructed into pair_buffer if they're not stored explicitly, hence the buffer must be able to hold
+    //MPMParticleGridStencil<Scalar,Dim>::MAX_NODE_NUM pairs; return pointer to the pairs
+    virtual const MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim>* particleGridPairs(unsigned int object_idx, unsigned int particle_idx,
+                                                                                      MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pair_buffer,
+                                                                                      unsigned int &pair_num) const;
     //manage data attached to particles to stay up-to-date with the particles
     virtual void appendAllParticleRelatedDataOfLastObject();
     virtual void appendLastParticleRelatedDataOfObject(unsigned int object_idx);
     virtual void deleteAllParticleRelatedDataOfObject(unsigned int object_idx);
     virtual void deleteOneParticleRelatedDataOfObject(unsigned int object_idx, unsigned int particle_idx);
+    virtual void permutateParticleRelatedDataOfObject(unsigned int object_idx, const std::vector<unsigned int> &permutation);
     //solve on grid with different integration methods, called in solveOnGrid()
     virtual void solveOnGridForwardEuler(Scalar dt);
     virtual void solveOnGridBackwardEuler(Scalar dt);
+    //helper methods of solveOnGridBackwardEuler(), slot_unknown maps the slot to index of the unknown, INVALID_SLOT if not an unknown
+    //velocity gradient at the particle, the velocity of the other nodes is taken from grid if with_known_nodes is true, and zero otherwise
+    SquareMatrix<Scalar,Dim> backwardEulerVelocityGradient(unsigned int object_idx, unsigned int particle_idx, const std::vector<unsigned int> &slot_unknown,
+                                                          const std::vector<Vector<Scalar,Dim> > &unknown_velocity, bool with_known_nodes,
+                                                          MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> *pair_buffer) const;
+    //node_term[unknown] = sum of particle_term*weight_gradient of the particles in range, the particles are gathered in parallel to
+    //range_node_term in fixed ranges which are then summed in range order, pair_buffer has one buffer for each thread
+    void backwardEulerGatherToNodes(const std::vector<unsigned int> &slot_unknown, const std::vector<std::vector<SquareMatrix<Scalar,Dim> > > &particle_term,
+                                    std::vector<Vector<Scalar,Dim> > &node_term, std::vector<std::vector<Vector<Scalar,Dim> > > &range_node_term,
+                                    std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > > &pair_buffer) const;
     //helper method: conversion between a multi-dimensional grid index and its flat version
     unsigned int flatIndex(const Vector<unsigned int,Dim> &index, const Vector<unsigned int,Dim> &dimension) const;
     Vector<unsigned int,Dim> multiDimIndex(unsigned int flat_index, const Vector<unsigned int,Dim> &dimension) const;
 protected:
     Grid<Scalar,Dim> grid_;
     MPMSolidContactMethod<Scalar,Dim> *contact_method_;
-    //grid data stored on grid nodes
-    //data at each node is a map whose element is the [object_idx, value] pair corresponding to the objects that occupy the node
-    ArrayND<std::set<unsigned int>,Dim> is_dirichlet_grid_node_;  //for each grid node, store the object id if it's set as boundary condition for the object
-    ArrayND<std::map<unsigned int,Scalar>,Dim> grid_mass_;
-    ArrayND<std::map<unsigned int,Vector<Scalar,Dim> >,Dim> grid_velocity_; //current grid velocity
-    ArrayND<std::map<unsigned int,Vector<Scalar,Dim> >,Dim> grid_velocity_before_; //grid velocity before any solve update
-    std::multimap<unsigned int,unsigned int> active_grid_node_; //the key is the flattened node index, the value is the object id
-    //precomputed weights and gradients for grid nodes that is within range of each particle
-    //for each particle of each object, store the node-value pair: [object_idx][particle_idx][pair_idx]
-    std::vector<std::vector<std::vector<MPMInternal::NodeIndexWeightGradientPair<Scalar,Dim> > > > particle_grid_weight_and_gradient_;
-    std::vector<std::vector<unsigned int> > particle_grid_pair_num_; //the number of pairs in particle_grid_weight_and_gradient_ 
+    //grid data stored on grid nodes, allocated in blocks for the occupied region of the grid
+    //mass, current velocity, velocity before any solve update and dirichlet flag of each object that occupies the node
+    MPMSolidGridData<Scalar,Dim> grid_data_;
+    //active grid nodes of each object, stored in parallel arrays sorted by the flat node index and then the object index
+    //hence the entries of one node are consecutive, rebuilt in computeGridVelocity() with a linear pass over the occupied nodes
+    std::vector<Vector<unsigned int,Dim> > active_node_idx_;
+    std::vector<unsigned int> active_node_object_;
+    std::vector<unsigned int> active_node_slot_;
+    //potential contact nodes: index of the first entry of each node with multiple active objects in the arrays above
+    std::vector<unsigned int> contact_node_entry_;
+    //buffers for the contact method, filled only at the potential contact nodes and reused across time steps
+    std::vector<Vector<unsigned int,Dim> > contact_node_idx_;
+    std::vector<std::vector<unsigned int> > contact_node_objects_;
+    std::vector<std::vector<Vector<Scalar,Dim> > > contact_node_normals_;
+    std::vector<std::vector<unsigned char> > contact_node_dirichlet_;
+    //precomputed weights and gradients for grid nodes that is within range of each particle, one stencil for each object
+    std::vector<MPMParticleGridStencil<Scalar,Dim> > particle_grid_stencil_;
+    //vol*cauchy_stress of each particle for the explicit solve, recomputed every time step
+    std::vector<std::vector<SquareMatrix<Scalar,Dim> > > particle_weighted_stress_;
+    //parameters of the implicit solve
+    unsigned int backward_euler_max_newton_iteration_;
+    unsigned int backward_euler_max_cg_iteration_;
+    Scalar backward_euler_tolerance_;
+    unsigned int backward_euler_range_num_;
 };
 
 }  //end of namespace Physika
@@ -13,13 +13,17 @@
  */
 
 #include <cstdlib>
+#include <limits>
 #include <iostream>
 #include <algorithm>
 #include "Physika_Core/Utilities/physika_assert.h"
 #include "Physika_Core/Utilities/math_utilities.h"
+#include "Physika_Core/Utilities/File_Utilities/binary_io.h"
 #include "Physika_Core/Vectors/vector_2d.h"
 #include "Physika_Core/Vectors/vector_3d.h"
 #include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
+#include "Physika_Dynamics/MPM/mpm_internal.h"
 #include "Physika_Dynamics/MPM/mpm_solid_base.h"
 #include "Physika_Dynamics/MPM/MPM_Step_Methods/mpm_solid_step_method_USL.h"
 
@@ -27,14 +31,15 @@ namespace Physika{
 
 template <typename Scalar, int Dim>
 MPMSolidBase<Scalar,Dim>::MPMSolidBase()
-    :MPMBase<Scalar,Dim>(),integration_method_(FORWARD_EULER)
+    :MPMBase<Scalar,Dim>(),integration_method_(FORWARD_EULER),particle_reorder_interval_(0),step_num_since_reorder_(0)
 {
     this->template setStepMethod<MPMSolidStepMethodUSL<Scalar,Dim> >(); //default step method is USL
 }
 
 template <typename Scalar, int Dim>
 MPMSolidBase<Scalar,Dim>::MPMSolidBase(unsigned int start_frame, unsigned int end_frame, Scalar frame_rate, Scalar max_dt, bool write_to_file)
-    :MPMBase<Scalar,Dim>(start_frame,end_frame,frame_rate,max_dt,write_to_file),integration_method_(FORWARD_EULER)
+    :MPMBase<Scalar,Dim>(start_frame,end_frame,frame_rate,max_dt,write_to_file),integration_method_(FORWARD_EULER),
+     particle_reorder_interval_(0),step_num_since_reorder_(0)
 {
     this->template setStepMethod<MPMSolidStepMethodUSL<Scalar,Dim> >(); //default step method is USL
 }
@@ -42,10 +47,27 @@ MPMSolidBase<Scalar,Dim>::MPMSolidBase(unsigned int start_frame, unsigned int en
 template <typename Scalar, int Dim>
 MPMSolidBase<Scalar,Dim>::~MPMSolidBase()
 {
-    for(unsigned int i = 0; i < particles_.size(); ++i)
-        for(unsigned int j = 0; j < particles_[i].size(); ++j)
-            if(particles_[i][j])
-                delete particles_[i][j];
+    for(unsigned int i = 0; i < particle_views_.size(); ++i)
+        releaseParticleViewsOfObject(i);
+    for(unsigned int i = 0; i < particle_data_.size(); ++i)
+        if(particle_data_[i])
+            delete particle_data_[i];
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidBase<Scalar,Dim>::advanceStep(Scalar dt)
+{
+    //the particles are reordered at the first step and every particle_reorder_interval_ steps after
+    if(particle_reorder_interval_ > 0)
+    {
+        if(step_num_since_reorder_ % particle_reorder_interval_ == 0)
+        {
+            reorderParticles();
+            step_num_since_reorder_ = 0;
+        }
+        ++step_num_since_reorder_;
+    }
+    MPMBase<Scalar,Dim>::advanceStep(dt);
 }
 
 template <typename Scalar, int Dim>
@@ -65,24 +87,22 @@ unsigned int MPMSolidBase<Scalar,Dim>::particleNumOfObject(unsigned int object_i
         std::cerr<<"Error: object index out of range, program abort!\n";
         std::exit(EXIT_FAILURE);
     }
-    return particles_[object_idx].size();
+    return particle_data_[object_idx]->particleNum();
 }
  
 template <typename Scalar, int Dim>
 unsigned int MPMSolidBase<Scalar,Dim>::objectNum() const
 {
-    return particles_.size();
+    return particle_data_.size();
 }
  
 template <typename Scalar, int Dim>
 void MPMSolidBase<Scalar,Dim>::addObject(const std::vector<SolidParticle<Scalar,Dim>*> &particles_of_object)
 {
-    std::vector<SolidParticle<Scalar,Dim>*> new_object;
-    particles_.push_back(new_object);
-    unsigned int new_object_idx = particles_.size() - 1;
-    particles_[new_object_idx].resize(particles_of_object.size());
-    for(unsigned int i = 0; i < particles_of_object.size(); ++i)
-        particles_[new_object_idx][i] = particles_of_object[i]->clone();
+    applyParticleViewChanges();
+    particle_data_.push_back(new SolidParticleData<Scalar,Dim>());
+    particle_data_.back()->addParticles(particles_of_object);
+    particle_views_.push_back(std::vector<SolidParticle<Scalar,Dim>*>()); //views are created on access
     //allocate space and initialize data attached to each particle
     appendAllParticleRelatedDataOfLastObject();
 }
@@ -95,13 +115,14 @@ void MPMSolidBase<Scalar,Dim>::removeObject(unsigned int object_idx)
         std::cerr<<"Warning: object index out of range, operation ignored!\n";
         return;
     }
-    for(unsigned int i = 0; i < particles_[object_idx].size(); ++i)
-        if(particles_[object_idx][i])
-            delete particles_[object_idx][i];
-    typename std::vector<std::vector<SolidParticle<Scalar,Dim>*> >::iterator iter = particles_.begin() + object_idx;
-    particles_.erase(iter);
-    //delete other data related to the object
+    applyParticleViewChanges();
+    //delete other data related to the object, while the object is still there
     deleteAllParticleRelatedDataOfObject(object_idx);
+    delete particle_data_[object_idx];
+    particle_data_.erase(particle_data_.begin() + object_idx);
+    releaseParticleViewsOfObject(object_idx);
+    typename std::vector<std::vector<SolidParticle<Scalar,Dim>*> >::iterator iter = particle_views_.begin() + object_idx;
+    particle_views_.erase(iter);
 }
      
 template <typename Scalar, int Dim>
@@ -112,8 +133,10 @@ void MPMSolidBase<Scalar,Dim>::addParticle(unsigned int object_idx, const SolidP
         std::cerr<<"Warning: object index out of range, operation ignored!\n";
         return;
     }
-    SolidParticle<Scalar,Dim> *new_particle = particle.clone();
-    particles_[object_idx].push_back(new_particle);
+    applyParticleViewChanges();
+    particle_data_[object_idx]->addParticle(particle);
+    if(!particle_views_[object_idx].empty())
+        particle_views_[object_idx].push_back(NULL);
     //append space and initialize data related to the newly added particle
     appendLastParticleRelatedDataOfObject(object_idx);
 }
@@ -131,12 +154,17 @@ void MPMSolidBase<Scalar,Dim>::removeParticle(unsigned int object_idx, unsigned
         std::cerr<<"Warning: particle index out of range, operation ignored!\n";
         return;
     }
-    if(particles_[object_idx][particle_idx])
-        delete particles_[object_idx][particle_idx];
-    typename std::vector<SolidParticle<Scalar,Dim>*>::iterator iter = particles_[object_idx].begin() + particle_idx;
-    particles_[object_idx].erase(iter);
-    //delete other related data
+    applyParticleViewChanges();
+    //delete other related data, while the particle is still there
     deleteOneParticleRelatedDataOfObject(object_idx,particle_idx);
+    particle_data_[object_idx]->removeParticle(particle_idx);
+    std::vector<SolidParticle<Scalar,Dim>*> &views = particle_views_[object_idx];
+    if(!views.empty())
+    {
+        if(views[particle_idx])
+            delete views[particle_idx];
+        views.erase(views.begin() + particle_idx);
+    }
 }
  
 template <typename Scalar, int Dim>
@@ -152,7 +180,8 @@ const SolidParticle<Scalar,Dim>& MPMSolidBase<Scalar,Dim>::particle(unsigned int
         std::cerr<<"Error: particle index out of range, program abort!\n";
         std::exit(EXIT_FAILURE);
     }
-    return *particles_[object_idx][particle_idx];
+    applyParticleViewChanges();
+    return updatedParticleView(object_idx,particle_idx);
 }
 
 template <typename Scalar, int Dim>
@@ -168,7 +197,10 @@ SolidParticle<Scalar,Dim>& MPMSolidBase<Scalar,Dim>::particle(unsigned int objec
         std::cerr<<"Error: particle index out of range, program abort!\n";
         std::exit(EXIT_FAILURE);
     }
-    return *particles_[object_idx][particle_idx];
+    applyParticleViewChanges();
+    SolidParticle<Scalar,Dim> &view = updatedParticleView(object_idx,particle_idx);
+    modified_particle_views_.push_back(std::make_pair(object_idx,particle_idx));
+    return view;
 }
 
 template <typename Scalar, int Dim>
@@ -179,7 +211,35 @@ const std::vector<SolidParticle<Scalar,Dim>*>& MPMSolidBase<Scalar,Dim>::allPart
         std::cerr<<"Error: object index out of range, program abort!\n";
         std::exit(EXIT_FAILURE);
     }
-    return particles_[object_idx];
+    applyParticleViewChanges();
+    unsigned int particle_num = particleNumOfObject(object_idx);
+    for(unsigned int i = 0; i < particle_num; ++i)
+        updatedParticleView(object_idx,i);
+    return particle_views_[object_idx];
+}
+
+template <typename Scalar, int Dim>
+const SolidParticleData<Scalar,Dim>& MPMSolidBase<Scalar,Dim>::particleData(unsigned int object_idx) const
+{
+    if(object_idx>=objectNum())
+    {
+        std::cerr<<"Error: object index out of range, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    applyParticleViewChanges();
+    return *particle_data_[object_idx];
+}
+
+template <typename Scalar, int Dim>
+SolidParticleData<Scalar,Dim>& MPMSolidBase<Scalar,Dim>::particleData(unsigned int object_idx)
+{
+    if(object_idx>=objectNum())
+    {
+        std::cerr<<"Error: object index out of range, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    applyParticleViewChanges();
+    return *particle_data_[object_idx];
 }
     
 template <typename Scalar, int Dim>
@@ -250,41 +310,179 @@ void MPMSolidBase<Scalar,Dim>::addDirichletParticles(unsigned int object_idx, co
         std::cerr<<"Warning: "<<invalid_particle<<" invalid particle index are ignored!\n";
 }
     
+template <typename Scalar, int Dim>
+unsigned int MPMSolidBase<Scalar,Dim>::particleReorderInterval() const
+{
+    return particle_reorder_interval_;
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidBase<Scalar,Dim>::setParticleReorderInterval(unsigned int interval)
+{
+    particle_reorder_interval_ = interval;
+    step_num_since_reorder_ = 0;
+}
+
 template <typename Scalar, int Dim>
 void MPMSolidBase<Scalar,Dim>::setTimeIntegrationMethod(const IntegrationMethod &method)
 {
     integration_method_ = method;
 }
 
+template <typename Scalar, int Dim>
+Scalar MPMSolidBase<Scalar,Dim>::computeTimeStep()
+{
+    if(integration_method_ != BACKWARD_EULER)
+        return MPMBase<Scalar,Dim>::computeTimeStep();
+    //implicit integration is stable with large time step, the particles are only required not to travel beyond one cell
+    Scalar min_cell_size = this->minCellEdgeLength();
+    Scalar max_particle_vel = this->maxParticleVelocityNorm();
+    this->dt_ = this->max_dt_;
+    if(max_particle_vel > std::numeric_limits<Scalar>::epsilon())
+        this->dt_ = (this->cfl_num_ * min_cell_size)/max_particle_vel;
+    this->dt_ = this->dt_ > this->max_dt_ ? this->max_dt_ : this->dt_;
+    return this->dt_;
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidBase<Scalar,Dim>::rasterizeAndSolveOnGrid(Scalar dt)
+{
+    rasterize();
+    solveOnGrid(dt);
+}
+
 template <typename Scalar, int Dim>
 Scalar MPMSolidBase<Scalar,Dim>::maxParticleVelocityNorm() const
 {
-    if(particles_.empty())
+    if(particle_data_.empty())
         return 0;
-    Scalar min_vel = (std::numeric_limits<Scalar>::max)();
-    for(unsigned int i = 0; i < particles_.size(); ++i)
+    Scalar max_vel = 0;
+    for(unsigned int i = 0; i < particle_data_.size(); ++i)
     {
-        for(unsigned int j = 0; j < particles_[i].size(); ++j)
+        const SolidParticleData<Scalar,Dim> &particle_data = particleData(i);
+        for(unsigned int j = 0; j < particle_data.particleNum(); ++j)
         {
-            Scalar norm_sqr = (particles_[i][j]->velocity()).normSquared();
-            min_vel = norm_sqr < min_vel ? norm_sqr : min_vel;
+            Scalar norm_sqr = (particle_data.velocity(j)).normSquared();
+            max_vel = norm_sqr > max_vel ? norm_sqr : max_vel;
         }
     }
-    return sqrt(min_vel);
+    return sqrt(max_vel);
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidBase<Scalar,Dim>::applyParticleViewChanges() const
+{
+    if(modified_particle_views_.empty()) //nothing is written, such that particleData() can be called in parallel after the changes are applied
+        return;
+    for(unsigned int i = 0; i < modified_particle_views_.size(); ++i)
+    {
+        unsigned int object_idx = modified_particle_views_[i].first, particle_idx = modified_particle_views_[i].second;
+        particle_data_[object_idx]->copyFromParticle(particle_idx,*particle_views_[object_idx][particle_idx]);
+    }
+    modified_particle_views_.clear();
+}
+
+template <typename Scalar, int Dim>
+SolidParticle<Scalar,Dim>& MPMSolidBase<Scalar,Dim>::updatedParticleView(unsigned int object_idx, unsigned int particle_idx) const
+{
+    PHYSIKA_ASSERT(object_idx < objectNum());
+    PHYSIKA_ASSERT(particle_idx < particleNumOfObject(object_idx));
+    std::vector<SolidParticle<Scalar,Dim>*> &views = particle_views_[object_idx];
+    if(views.empty())
+        views.resize(particle_data_[object_idx]->particleNum(),NULL);
+    if(views[particle_idx] == NULL)
+        views[particle_idx] = new SolidParticle<Scalar,Dim>();
+    SolidParticle<Scalar,Dim> &view = *views[particle_idx];
+    //the view refers to the material shared in particle data instead of a copy
+    particle_data_[object_idx]->copyToParticle(particle_idx,view);
+    view.setConstitutiveModelReference(particle_data_[object_idx]->constitutiveModel(particle_idx));
+    return view;
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidBase<Scalar,Dim>::releaseParticleViewsOfObject(unsigned int object_idx) const
+{
+    PHYSIKA_ASSERT(object_idx < particle_views_.size());
+    std::vector<SolidParticle<Scalar,Dim>*> &views = particle_views_[object_idx];
+    for(unsigned int i = 0; i < views.size(); ++i)
+        if(views[i])
+            delete views[i];
+    views.clear();
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidBase<Scalar,Dim>::writeObjects(std::ostream &output) const
+{
+    applyParticleViewChanges();
+    unsigned int object_num = objectNum();
+    FileUtilities::writeBinary(output,object_num);
+    for(unsigned int i = 0; i < object_num; ++i)
+    {
+        if(!particle_data_[i]->write(output))
+        {
+            output.setstate(std::ios::failbit);
+            return;
+        }
+        writeParticleRelatedDataOfObject(i,output);
+    }
+}
+
+template <typename Scalar, int Dim>
+bool MPMSolidBase<Scalar,Dim>::readObjects(std::istream &input)
+{
+    while(objectNum() > 0)
+        removeObject(objectNum()-1);
+    unsigned int object_num = 0;
+    if(!FileUtilities::readBinary(input,object_num))
+        return false;
+    for(unsigned int i = 0; i < object_num; ++i)
+    {
+        SolidParticleData<Scalar,Dim> *particle_data = new SolidParticleData<Scalar,Dim>();
+        if(!particle_data->read(input))
+        {
+            delete particle_data;
+            return false;
+        }
+        particle_data_.push_back(particle_data);
+        particle_views_.push_back(std::vector<SolidParticle<Scalar,Dim>*>());
+        appendAllParticleRelatedDataOfLastObject();
+        if(!readParticleRelatedDataOfObject(i,input))
+            return false;
+    }
+    return true;
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidBase<Scalar,Dim>::writeParticleRelatedDataOfObject(unsigned int object_idx, std::ostream &output) const
+{
+    PHYSIKA_ASSERT(object_idx < objectNum());
+    FileUtilities::writeBinary(output,is_dirichlet_particle_[object_idx]);
+    FileUtilities::writeBinary(output,particle_initial_volume_[object_idx]);
+    FileUtilities::writeBinary(output,particle_external_force_[object_idx]);
+}
+
+template <typename Scalar, int Dim>
+bool MPMSolidBase<Scalar,Dim>::readParticleRelatedDataOfObject(unsigned int object_idx, std::istream &input)
+{
+    PHYSIKA_ASSERT(object_idx < objectNum());
+    unsigned int particle_num = particleNumOfObject(object_idx);
+    return FileUtilities::readBinary(input,is_dirichlet_particle_[object_idx]) && is_dirichlet_particle_[object_idx].size() == particle_num
+           && FileUtilities::readBinary(input,particle_initial_volume_[object_idx]) && particle_initial_volume_[object_idx].size() == particle_num
+           && FileUtilities::readBinary(input,particle_external_force_[object_idx]) && particle_external_force_[object_idx].size() == particle_num;
 }
 
 template <typename Scalar, int Dim>
 void MPMSolidBase<Scalar,Dim>::appendAllParticleRelatedDataOfLastObject()
 {
-    unsigned int last_object_idx = particles_.size() - 1;
-    unsigned int particle_num_of_last_object = particles_[last_object_idx].size();
+    unsigned int last_object_idx = objectNum() - 1;
+    unsigned int particle_num_of_last_object = particleNumOfObject(last_object_idx);
     is_dirichlet_particle_.push_back(std::vector<unsigned char>(particle_num_of_last_object));
     particle_initial_volume_.push_back(std::vector<Scalar>(particle_num_of_last_object));
     particle_external_force_.push_back(std::vector<Vector<Scalar,Dim> >(particle_num_of_last_object));
     for(unsigned int i = 0; i < particle_num_of_last_object; ++i)
     {
         is_dirichlet_particle_[last_object_idx][i] = 0;
-        particle_initial_volume_[last_object_idx][i] = particles_[last_object_idx][i]->volume();
+        particle_initial_volume_[last_object_idx][i] = particle_data_[last_object_idx]->volume(i);
         particle_external_force_[last_object_idx][i] = Vector<Scalar,Dim>(0);
     }
 }
@@ -293,9 +491,9 @@ template <typename Scalar, int Dim>
 void MPMSolidBase<Scalar,Dim>::appendLastParticleRelatedDataOfObject(unsigned int object_idx)
 {
     PHYSIKA_ASSERT(object_idx < objectNum());
-    unsigned int last_particle_idx = particles_[object_idx].size() - 1;
+    unsigned int last_particle_idx = particleNumOfObject(object_idx) - 1;
     is_dirichlet_particle_[object_idx].push_back(0);
-    particle_initial_volume_[object_idx].push_back(particles_[object_idx][last_particle_idx]->volume());
+    particle_initial_volume_[object_idx].push_back(particle_data_[object_idx]->volume(last_particle_idx));
     particle_external_force_[object_idx].push_back(Vector<Scalar,Dim>(0));
 }
 
@@ -324,6 +522,24 @@ void MPMSolidBase<Scalar,Dim>::deleteOneParticleRelatedDataOfObject(unsigned int
     particle_external_force_[object_idx].erase(iter3);
 }
 
+template <typename Scalar, int Dim>
+void MPMSolidBase<Scalar,Dim>::permutateParticleRelatedDataOfObject(unsigned int object_idx, const std::vector<unsigned int> &permutation)
+{
+    PHYSIKA_ASSERT(object_idx < objectNum());
+    PHYSIKA_ASSERT(permutation.size() == particleNumOfObject(object_idx));
+    if(permutation.empty())
+        return;
+    applyParticleViewChanges(); //pending changes are made to particles with indices before permutation
+    std::vector<unsigned int> ids(permutation);
+    particle_data_[object_idx]->permutate(&ids[0],ids.size());
+    //the views follow their particles, their data are updated on access
+    if(!particle_views_[object_idx].empty())
+        MPMInternal::permutateVector(particle_views_[object_idx],permutation);
+    MPMInternal::permutateVector(is_dirichlet_particle_[object_idx],permutation);
+    MPMInternal::permutateVector(particle_initial_volume_[object_idx],permutation);
+    MPMInternal::permutateVector(particle_external_force_[object_idx],permutation);
+}
+
 //explicit instantiations
 template class MPMSolidBase<float,2>;
 template class MPMSolidBase<float,3>;
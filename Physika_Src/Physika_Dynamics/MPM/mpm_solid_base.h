@@ -17,6 +17,8 @@
 
 #include <string>
 #include <vector>
+#include <utility>
+#include <iosfwd>
 #include "Physika_Core/Vectors/vector_2d.h"
 #include "Physika_Core/Vectors/vector_3d.h"
 #include "Physika_Dynamics/MPM/mpm_base.h"
@@ -25,10 +27,31 @@ namespace Physika{
 
 template<typename Scalar> class DriverPluginBase;
 template<typename Scalar,int Dim> class SolidParticle;
+template<typename Scalar,int Dim> class SolidParticleData;
 
 /*
  * MPMSolidBase: base class of all MPM drivers for solid
  * each object is represented as particles
+ *
+ * The particles of each object are stored in structure of arrays (SolidParticleData), which is accessed
+ * via particleData() in loops over particles. The SolidParticle objects returned by particle() and
+ * allParticlesOfObject() are transient views of the particle data for convenient access to single particle:
+ * a view is created on first access and refers to the material in SolidParticleData instead of a copy,
+ * its data are copied from the particle data on each call, and changes made to the view returned by
+ * non-const particle() are written back before the particle data is accessed again.
+ * NOTE: earlier versions stored the SolidParticle objects as the simulation state, now a reference to a view
+ * kept across calls to the driver is not. Its data are not updated as the simulation advances, changes made
+ * via it after the driver accessed the particle data are lost, and it's deleted with its particle or object
+ * (including when objects are replaced by read()). Call particle() again for each access instead.
+ *
+ * The particles can be reordered periodically such that particles close in space are close in memory,
+ * see setParticleReorderInterval(). Particle indices change after reordering. Particles of one object
+ * share their materials, and reordering groups the particles of each material together such that the
+ * stresses are evaluated in long batches of the same material.
+ *
+ * For restart support, the objects can be written to/read from binary stream with writeObjects() and readObjects(),
+ * the data attached to particles are streamed via the virtual methods writeParticleRelatedDataOfObject() and
+ * readParticleRelatedDataOfObject() which are extended by subclasses the same way as the other particle related data.
  */
 
 template <typename Scalar, int Dim>
@@ -47,6 +70,8 @@ public:
     virtual bool withRestartSupport() const=0;
     virtual void write(const std::string &file_name)=0;
     virtual void read(const std::string &file_name)=0;
+    virtual void advanceStep(Scalar dt); //particles are reordered at the beginning of the step if needed
+    virtual Scalar computeTimeStep(); //the sound speed doesn't limit the time step if BACKWARD_EULER is used
 
     //get && set
     unsigned int totalParticleNum() const;  //total particle number of all objects
@@ -57,14 +82,23 @@ public:
     void addParticle(unsigned int object_idx, const SolidParticle<Scalar,Dim> &particle);
     void removeParticle(unsigned int object_idx, unsigned int particle_idx);
     const SolidParticle<Scalar,Dim>& particle(unsigned int object_idx, unsigned int particle_idx) const;
+    //the returned view is transient, call again for each modification of the particle
     SolidParticle<Scalar,Dim>& particle(unsigned int object_idx, unsigned int particle_idx);
-    const std::vector<SolidParticle<Scalar,Dim>*>& allParticlesOfObject(unsigned int object_idx) const;    
+    const std::vector<SolidParticle<Scalar,Dim>*>& allParticlesOfObject(unsigned int object_idx) const; //transient views for read only
+    //particle data of object stored in arrays, pending changes of particle views are applied here
+    //it's thread-safe only if there's no pending change, hence call it once before accessing the data in parallel
+    const SolidParticleData<Scalar,Dim>& particleData(unsigned int object_idx) const;
+    SolidParticleData<Scalar,Dim>& particleData(unsigned int object_idx);
     //set and get external force on particles, gravity is not included
     Vector<Scalar,Dim> externalForceOnParticle(unsigned int object_idx, unsigned int particle_idx) const;
     void setExternalForceOnParticle(unsigned int object_idx, unsigned int particle_idx, const Vector<Scalar,Dim> &force);   
     //particles used as Dirichlet boundary condition, velocity is prescribed 
     void addDirichletParticle(unsigned int object_idx, unsigned int particle_idx);  //the particle is set as boundary condition
     void addDirichletParticles(unsigned int object_idx, const std::vector<unsigned int> &particle_idx); //the particles are set as boundary condition
+    //reorder the particles every interval time steps for memory locality, 0 means never (default)
+    unsigned int particleReorderInterval() const;
+    void setParticleReorderInterval(unsigned int interval);
+    virtual void reorderParticles()=0; //reorder the particles of each object, the particle-related data are permutated accordingly
 
     //substeps in one time step
     virtual void rasterize()=0;  //rasterize data to grid
@@ -76,6 +110,8 @@ public:
     virtual void updateParticleVelocity()=0;  //update particle velocity using grid data
     virtual void applyExternalForceOnParticles(Scalar dt)=0;  //external force (gravity excluded) is applied on particles
     virtual void updateParticlePosition(Scalar dt)=0;  //update particle position with new particle velocity
+    //rasterize() followed by solveOnGrid(), subclasses may fuse the two substeps into fewer passes where possible
+    virtual void rasterizeAndSolveOnGrid(Scalar dt);
     
     //different time integration methods
     enum IntegrationMethod{
@@ -94,16 +130,34 @@ protected:
     virtual void appendLastParticleRelatedDataOfObject(unsigned int object_idx);
     virtual void deleteAllParticleRelatedDataOfObject(unsigned int object_idx);
     virtual void deleteOneParticleRelatedDataOfObject(unsigned int object_idx, unsigned int particle_idx);
+    //the i-th particle after permutation is the permutation[i]-th particle before
+    virtual void permutateParticleRelatedDataOfObject(unsigned int object_idx, const std::vector<unsigned int> &permutation);
     //solve on grid with different integration methods, called in solveOnGrid()
     virtual void solveOnGridForwardEuler(Scalar dt) = 0;
     virtual void solveOnGridBackwardEuler(Scalar dt) = 0;
+    void applyParticleViewChanges() const; //copy the particle views returned by non-const particle() to particle data
+    //view of the particle with data copied from particle_data_, the view is created on first access
+    SolidParticle<Scalar,Dim>& updatedParticleView(unsigned int object_idx, unsigned int particle_idx) const;
+    void releaseParticleViewsOfObject(unsigned int object_idx) const;
+    //binary io of all objects, readObjects() replaces the existing objects and returns false if the stream fails or data is invalid
+    void writeObjects(std::ostream &output) const;
+    bool readObjects(std::istream &input);
+    //binary io of data attached to particles of the object, called after the particle data is written/read
+    //on read, the data of the object are already allocated and initialized with appendAllParticleRelatedDataOfLastObject()
+    virtual void writeParticleRelatedDataOfObject(unsigned int object_idx, std::ostream &output) const;
+    virtual bool readParticleRelatedDataOfObject(unsigned int object_idx, std::istream &input);
 protected:
-    std::vector<std::vector<SolidParticle<Scalar,Dim>*> > particles_; //for each object, store the particles representing the object
-    std::vector<std::vector<unsigned char> > is_dirichlet_particle_;  //for each particle in particles_, 
+    std::vector<SolidParticleData<Scalar,Dim>*> particle_data_; //for each object, store the data of particles representing the object
+    //views of particle_data_ for each object, empty until a view of the object is accessed, NULL for particles never accessed
+    mutable std::vector<std::vector<SolidParticle<Scalar,Dim>*> > particle_views_;
+    mutable std::vector<std::pair<unsigned int,unsigned int> > modified_particle_views_; //[object, particle] of views that may be modified
+    std::vector<std::vector<unsigned char> > is_dirichlet_particle_;  //for each particle in particle_data_, 
                                                                       //use one byte to indicate whether it's set as dirichlet boundary condition
     std::vector<std::vector<Scalar> > particle_initial_volume_;
     std::vector<std::vector<Vector<Scalar,Dim> > > particle_external_force_; //external force(/N), not acceleration
     IntegrationMethod integration_method_; 
+    unsigned int particle_reorder_interval_;
+    unsigned int step_num_since_reorder_;
 };
 
 }//namespace Physika
@@ -0,0 +1,356 @@
+/*
+ * @file mpm_solid_grid_data.cpp
+ * @Brief data attached to the grid nodes of MPMSolid, stored in sparse blocks of flat arrays.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <utility>
+#include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Dynamics/MPM/mpm_solid_grid_data.h"
+
+namespace Physika{
+
+template <typename Scalar, int Dim>
+MPMSolidGridData<Scalar,Dim>::MPMSolidGridData()
+    :node_num_(0),block_num_(0),with_mass_gradient_(false)
+{
+}
+
+template <typename Scalar, int Dim>
+MPMSolidGridData<Scalar,Dim>::~MPMSolidGridData()
+{
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidGridData<Scalar,Dim>::resize(const Vector<unsigned int,Dim> &node_num)
+{
+    node_num_ = node_num;
+    unsigned int total_block_num = 1;
+    for(unsigned int i = 0; i < Dim; ++i)
+    {
+        block_num_[i] = (node_num[i] + BLOCK_EDGE - 1) >> BLOCK_EDGE_BITS;
+        total_block_num *= block_num_[i];
+    }
+    block_table_.assign(total_block_num,INVALID_SLOT);
+    block_index_.clear();
+    block_origin_.clear();
+    block_first_layer_.clear();
+    layer_object_.clear();
+    layer_next_.clear();
+    layer_block_.clear();
+    slot_occupied_.clear();
+    mass_.clear();
+    velocity_.clear();
+    velocity_before_.clear();
+    slot_dirichlet_.clear();
+    mass_gradient_.clear();
+    occupied_node_.clear();
+}
+
+template <typename Scalar, int Dim>
+const Vector<unsigned int,Dim>& MPMSolidGridData<Scalar,Dim>::nodeNum() const
+{
+    return node_num_;
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidGridData<Scalar,Dim>::clearData()
+{
+    //buffer the dirichlet slots before clearing
+    dirichlet_slot_buffer_.clear();
+    for(unsigned int slot_idx = 0; slot_idx < slot_dirichlet_.size(); ++slot_idx)
+        if(slot_dirichlet_[slot_idx])
+        {
+            DirichletSlot dirichlet_slot;
+            dirichlet_slot.node_idx_ = slotNode(slot_idx);
+            dirichlet_slot.object_idx_ = slotObject(slot_idx);
+            dirichlet_slot.velocity_ = velocity_[slot_idx];
+            dirichlet_slot.velocity_before_ = velocity_before_[slot_idx];
+            dirichlet_slot_buffer_.push_back(dirichlet_slot);
+        }
+    //release all allocated blocks, the capacity of the buffers is kept
+    for(unsigned int i = 0; i < block_index_.size(); ++i)
+        block_table_[block_index_[i]] = INVALID_SLOT;
+    block_index_.clear();
+    block_origin_.clear();
+    block_first_layer_.clear();
+    layer_object_.clear();
+    layer_next_.clear();
+    layer_block_.clear();
+    slot_occupied_.clear();
+    mass_.clear();
+    velocity_.clear();
+    velocity_before_.clear();
+    slot_dirichlet_.clear();
+    mass_gradient_.clear();
+    occupied_node_.clear();
+    //restore the dirichlet slots, with zero mass
+    for(unsigned int i = 0; i < dirichlet_slot_buffer_.size(); ++i)
+    {
+        const DirichletSlot &dirichlet_slot = dirichlet_slot_buffer_[i];
+        addDirichletNode(dirichlet_slot.node_idx_,dirichlet_slot.object_idx_);
+        unsigned int slot_idx = slot(dirichlet_slot.node_idx_,dirichlet_slot.object_idx_);
+        velocity_[slot_idx] = dirichlet_slot.velocity_;
+        velocity_before_[slot_idx] = dirichlet_slot.velocity_before_;
+    }
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidGridData<Scalar,Dim>::enableMassGradient()
+{
+    with_mass_gradient_ = true;
+    mass_gradient_.assign(mass_.size(),Vector<Scalar,Dim>(0));
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidGridData<Scalar,Dim>::disableMassGradient()
+{
+    with_mass_gradient_ = false;
+    mass_gradient_.clear();
+}
+
+template <typename Scalar, int Dim>
+unsigned int MPMSolidGridData<Scalar,Dim>::allocatedBlockNum() const
+{
+    return static_cast<unsigned int>(block_index_.size());
+}
+
+template <typename Scalar, int Dim>
+const Vector<unsigned int,Dim>& MPMSolidGridData<Scalar,Dim>::allocatedBlockOrigin(unsigned int block_id) const
+{
+    PHYSIKA_ASSERT(block_id < block_origin_.size());
+    return block_origin_[block_id];
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidGridData<Scalar,Dim>::reserveBlocks(const Vector<unsigned int,Dim> &min_node_idx, const Vector<unsigned int,Dim> &max_node_idx, unsigned int object_idx)
+{
+    Vector<unsigned int,Dim> min_block, max_block;
+    for(unsigned int i = 0; i < Dim; ++i)
+    {
+        PHYSIKA_ASSERT(min_node_idx[i] <= max_node_idx[i]);
+        PHYSIKA_ASSERT(max_node_idx[i] < node_num_[i]);
+        min_block[i] = min_node_idx[i]>>BLOCK_EDGE_BITS;
+        max_block[i] = max_node_idx[i]>>BLOCK_EDGE_BITS;
+    }
+    Vector<unsigned int,Dim> block = min_block;
+    while(true)
+    {
+        unsigned int block_idx = 0;
+        Vector<unsigned int,Dim> block_origin;
+        for(unsigned int i = 0; i < Dim; ++i)
+        {
+            block_idx = block_idx*block_num_[i] + block[i];
+            block_origin[i] = block[i]<<BLOCK_EDGE_BITS;
+        }
+        allocateLayer(block_idx,block_origin,object_idx);
+        //next block in the range
+        int i = Dim - 1;
+        for(; i >= 0; --i)
+        {
+            if(block[i] < max_block[i])
+            {
+                ++block[i];
+                break;
+            }
+            block[i] = min_block[i];
+        }
+        if(i < 0)
+            break;
+    }
+}
+
+template <typename Scalar, int Dim>
+unsigned int MPMSolidGridData<Scalar,Dim>::slot(const Vector<unsigned int,Dim> &node_idx, unsigned int object_idx) const
+{
+    unsigned int slot_idx = layerSlot(node_idx,object_idx);
+    return (slot_idx == INVALID_SLOT || slot_occupied_[slot_idx] == 0x00) ? INVALID_SLOT : slot_idx;
+}
+
+template <typename Scalar, int Dim>
+unsigned int MPMSolidGridData<Scalar,Dim>::insertSlot(const Vector<unsigned int,Dim> &node_idx, unsigned int object_idx)
+{
+    PHYSIKA_ASSERT(object_idx != INVALID_SLOT);
+    for(unsigned int i = 0; i < Dim; ++i)
+        PHYSIKA_ASSERT(node_idx[i] < node_num_[i]);
+    unsigned int slot_idx = layerSlot(node_idx,object_idx);
+    if(slot_idx == INVALID_SLOT)
+    {
+        Vector<unsigned int,Dim> block_origin;
+        for(unsigned int i = 0; i < Dim; ++i)
+            block_origin[i] = (node_idx[i]>>BLOCK_EDGE_BITS)<<BLOCK_EDGE_BITS;
+        unsigned int layer = allocateLayer(blockIndex(node_idx),block_origin,object_idx);
+        slot_idx = (layer<<BLOCK_SIZE_BITS) | localIndex(node_idx);
+    }
+    slot_occupied_[slot_idx] = 0x01;
+    return slot_idx;
+}
+
+template <typename Scalar, int Dim>
+Vector<unsigned int,Dim> MPMSolidGridData<Scalar,Dim>::slotNode(unsigned int slot_idx) const
+{
+    PHYSIKA_ASSERT(slot_idx < slotNum());
+    unsigned int local_idx = slot_idx&(BLOCK_SIZE-1);
+    Vector<unsigned int,Dim> node_idx = block_origin_[layer_block_[slot_idx>>BLOCK_SIZE_BITS]];
+    for(int i = Dim - 1; i >= 0; --i)
+    {
+        node_idx[i] += local_idx&(BLOCK_EDGE-1);
+        local_idx >>= BLOCK_EDGE_BITS;
+    }
+    return node_idx;
+}
+
+template <typename Scalar, int Dim>
+unsigned int MPMSolidGridData<Scalar,Dim>::objectNumAtNode(const Vector<unsigned int,Dim> &node_idx) const
+{
+    unsigned int object_num = 0;
+    for(unsigned int slot_idx = firstSlot(node_idx); slot_idx != INVALID_SLOT; slot_idx = nextSlot(slot_idx))
+        ++object_num;
+    return object_num;
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidGridData<Scalar,Dim>::addDirichletNode(const Vector<unsigned int,Dim> &node_idx, unsigned int object_idx)
+{
+    unsigned int slot_idx = insertSlot(node_idx,object_idx);
+    slot_dirichlet_[slot_idx] = 0x01;
+}
+
+template <typename Scalar, int Dim>
+bool MPMSolidGridData<Scalar,Dim>::isDirichletNode(const Vector<unsigned int,Dim> &node_idx) const
+{
+    for(unsigned int slot_idx = firstSlot(node_idx); slot_idx != INVALID_SLOT; slot_idx = nextSlot(slot_idx))
+        if(slot_dirichlet_[slot_idx])
+            return true;
+    return false;
+}
+
+template <typename Scalar, int Dim>
+bool MPMSolidGridData<Scalar,Dim>::isDirichletNode(const Vector<unsigned int,Dim> &node_idx, unsigned int object_idx) const
+{
+    unsigned int slot_idx = slot(node_idx,object_idx);
+    return slot_idx != INVALID_SLOT && isDirichletSlot(slot_idx);
+}
+
+template <typename Scalar, int Dim>
+void MPMSolidGridData<Scalar,Dim>::collectOccupiedNodes()
+{
+    occupied_node_.clear();
+    for(unsigned int block_id = 0; block_id < block_index_.size(); ++block_id)
+    {
+        Vector<unsigned int,Dim> node_idx;
+        for(unsigned int local_idx = 0; local_idx < BLOCK_SIZE; ++local_idx)
+        {
+            unsigned int slot_idx = validSlotFromLayer(block_first_layer_[block_id],local_idx);
+            if(slot_idx == INVALID_SLOT)
+                continue;
+            node_idx = block_origin_[block_id];
+            unsigned int local = local_idx;
+            for(int i = Dim - 1; i >= 0; --i)
+            {
+                node_idx[i] += local&(BLOCK_EDGE-1);
+                local >>= BLOCK_EDGE_BITS;
+            }
+            occupied_node_.push_back(std::make_pair(flatIndex(node_idx),slot_idx));
+        }
+    }
+    //radix sort on the flat index with 8 bits per pass, the flat indices are unique
+    //the number of passes depends on the number of grid nodes
+    unsigned int max_flat_idx = 0;
+    for(unsigned int i = 0; i < Dim; ++i)
+        max_flat_idx = max_flat_idx*node_num_[i] + node_num_[i] - 1;
+    occupied_node_buffer_.resize(occupied_node_.size());
+    for(unsigned int shift = 0; shift < 32 && (max_flat_idx>>shift) != 0; shift += 8)
+    {
+        unsigned int digit_start[257] = {0};
+        for(unsigned int i = 0; i < occupied_node_.size(); ++i)
+            ++digit_start[((occupied_node_[i].first>>shift)&0xFF)+1];
+        for(unsigned int digit = 0; digit < 256; ++digit)
+            digit_start[digit+1] += digit_start[digit];
+        for(unsigned int i = 0; i < occupied_node_.size(); ++i)
+            occupied_node_buffer_[digit_start[(occupied_node_[i].first>>shift)&0xFF]++] = occupied_node_[i];
+        occupied_node_.swap(occupied_node_buffer_);
+    }
+}
+
+template <typename Scalar, int Dim>
+Vector<unsigned int,Dim> MPMSolidGridData<Scalar,Dim>::occupiedNode(unsigned int idx) const
+{
+    //decode the node index from the block origin and the position of slot in block
+    unsigned int slot_idx = occupied_node_[idx].second;
+    Vector<unsigned int,Dim> node_idx = block_origin_[layer_block_[slot_idx>>BLOCK_SIZE_BITS]];
+    unsigned int local_idx = slot_idx&(BLOCK_SIZE-1);
+    for(int i = Dim - 1; i >= 0; --i)
+    {
+        node_idx[i] += local_idx&(BLOCK_EDGE-1);
+        local_idx >>= BLOCK_EDGE_BITS;
+    }
+    return node_idx;
+}
+
+template <typename Scalar, int Dim>
+unsigned int MPMSolidGridData<Scalar,Dim>::allocateLayer(unsigned int block_idx, const Vector<unsigned int,Dim> &block_origin, unsigned int object_idx)
+{
+    unsigned int block_id = block_table_[block_idx];
+    if(block_id == INVALID_SLOT) //allocate a new block
+    {
+        block_id = static_cast<unsigned int>(block_index_.size());
+        block_table_[block_idx] = block_id;
+        block_index_.push_back(block_idx);
+        block_origin_.push_back(block_origin);
+        block_first_layer_.push_back(INVALID_SLOT);
+    }
+    //find the position in the layer chain
+    unsigned int prev_layer = INVALID_SLOT;
+    unsigned int cur_layer = block_first_layer_[block_id];
+    while(cur_layer != INVALID_SLOT && layer_object_[cur_layer] < object_idx)
+    {
+        prev_layer = cur_layer;
+        cur_layer = layer_next_[cur_layer];
+    }
+    if(cur_layer != INVALID_SLOT && layer_object_[cur_layer] == object_idx)
+        return cur_layer;
+    //allocate a new layer
+    unsigned int layer = static_cast<unsigned int>(layer_object_.size());
+    layer_object_.push_back(object_idx);
+    layer_next_.push_back(cur_layer);
+    layer_block_.push_back(block_id);
+    if(prev_layer == INVALID_SLOT)
+        block_first_layer_[block_id] = layer;
+    else
+        layer_next_[prev_layer] = layer;
+    unsigned int new_size = (layer + 1)*BLOCK_SIZE;
+    slot_occupied_.resize(new_size,0x00);
+    mass_.resize(new_size,0);
+    velocity_.resize(new_size,Vector<Scalar,Dim>(0));
+    velocity_before_.resize(new_size,Vector<Scalar,Dim>(0));
+    slot_dirichlet_.resize(new_size,0x00);
+    if(with_mass_gradient_)
+        mass_gradient_.resize(new_size,Vector<Scalar,Dim>(0));
+    return layer;
+}
+
+template <typename Scalar, int Dim>
+unsigned int MPMSolidGridData<Scalar,Dim>::flatIndex(const Vector<unsigned int,Dim> &node_idx) const
+{
+    unsigned int flat_index = 0;
+    for(unsigned int i = 0; i < Dim; ++i)
+        flat_index = flat_index*node_num_[i] + node_idx[i];
+    return flat_index;
+}
+
+//explicit instantiations
+template class MPMSolidGridData<float,2>;
+template class MPMSolidGridData<float,3>;
+template class MPMSolidGridData<double,2>;
+template class MPMSolidGridData<double,3>;
+
+}  //end of namespace Physika
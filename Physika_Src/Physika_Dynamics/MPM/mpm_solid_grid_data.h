@@ -0,0 +1,237 @@
+/*
+ * @file mpm_solid_grid_data.h
+ * @Brief data attached to the grid nodes of MPMSolid, stored in sparse blocks of flat arrays.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_DYNAMICS_MPM_MPM_SOLID_GRID_DATA_H_
+#define PHYSIKA_DYNAMICS_MPM_MPM_SOLID_GRID_DATA_H_
+
+#include <vector>
+#include <utility>
+#include "Physika_Core/Vectors/vector_2d.h"
+#include "Physika_Core/Vectors/vector_3d.h"
+
+namespace Physika{
+
+/*
+ * MPMSolidGridData: mass, velocity and velocity before solve attached to grid nodes of MPMSolid
+ *
+ * Grid nodes are referred to with the same multi-dimensional index as Grid<Scalar,Dim>.
+ * The grid is tiled with blocks of 4^Dim nodes, the blocks are allocated on demand when a node
+ * inside is occupied, and a page table maps the block index to the allocated block.
+ * Hence memory use and the cost of clearData() scale with the occupied region of the grid, not the whole grid.
+ *
+ * Each allocated block owns one layer of slots for each object that occupies it, the layers of a block
+ * are chained in ascending object order. The values of one object at one node are stored in a "slot",
+ * and slots are referred to with an unsigned integer handle. A slot is valid only if the object occupies the node.
+ *
+ * Once the layers are allocated, rasterizing to different blocks does not modify any shared data.
+ * reserveBlocks() is provided to allocate the layers in advance, such that particles can be rasterized in parallel.
+ *
+ * Slots of dirichlet nodes survive clearData(), such that the prescribed velocity is kept across time steps.
+ *
+ * The mass gradient of each slot, i.e., the unnormalized outward normal of the object at the node used in contact,
+ * is stored only if enabled with enableMassGradient(), it's accumulated by the rasterizer together with mass.
+ */
+
+template <typename Scalar, int Dim>
+class MPMSolidGridData
+{
+public:
+    MPMSolidGridData();
+    ~MPMSolidGridData();
+    void resize(const Vector<unsigned int,Dim> &node_num); //all data are cleared, including the dirichlet nodes
+    const Vector<unsigned int,Dim>& nodeNum() const;
+    void clearData(); //clear data of all nodes, the velocities of dirichlet slots are kept while their mass is reset to zero
+
+    //allocated blocks
+    unsigned int allocatedBlockNum() const;
+    const Vector<unsigned int,Dim>& allocatedBlockOrigin(unsigned int block_id) const; //index of the first node in block
+    inline unsigned int allocatedBlockId(const Vector<unsigned int,Dim> &node_idx) const  //INVALID_SLOT if not allocated
+    {
+        return block_table_[blockIndex(node_idx)];
+    }
+    //allocate the layers of the object in all blocks that overlap with the node range [min_node_idx, max_node_idx]
+    void reserveBlocks(const Vector<unsigned int,Dim> &min_node_idx, const Vector<unsigned int,Dim> &max_node_idx, unsigned int object_idx);
+
+    //slot access, INVALID_SLOT is returned if the slot does not exist
+    inline unsigned int firstSlot(const Vector<unsigned int,Dim> &node_idx) const
+    {
+        unsigned int block_id = allocatedBlockId(node_idx);
+        if(block_id == INVALID_SLOT)
+            return INVALID_SLOT;
+        return validSlotFromLayer(block_first_layer_[block_id],localIndex(node_idx));
+    }
+    inline unsigned int nextSlot(unsigned int slot_idx) const
+    {
+        return validSlotFromLayer(layer_next_[slot_idx>>BLOCK_SIZE_BITS],slot_idx&(BLOCK_SIZE-1));
+    }
+    inline unsigned int slotObject(unsigned int slot_idx) const { return layer_object_[slot_idx>>BLOCK_SIZE_BITS]; }
+    Vector<unsigned int,Dim> slotNode(unsigned int slot_idx) const; //index of the node that the slot belongs to
+    unsigned int slot(const Vector<unsigned int,Dim> &node_idx, unsigned int object_idx) const;
+    unsigned int insertSlot(const Vector<unsigned int,Dim> &node_idx, unsigned int object_idx); //return the existing slot, or create a new one with zero values
+    unsigned int objectNumAtNode(const Vector<unsigned int,Dim> &node_idx) const;
+    inline unsigned int slotNum() const { return static_cast<unsigned int>(mass_.size()); } //the handles of all slots are less than slotNum()
+    //values stored in slot
+    inline Scalar& mass(unsigned int slot_idx) { return mass_[slot_idx]; }
+    inline Scalar mass(unsigned int slot_idx) const { return mass_[slot_idx]; }
+    inline Vector<Scalar,Dim>& velocity(unsigned int slot_idx) { return velocity_[slot_idx]; }
+    inline const Vector<Scalar,Dim>& velocity(unsigned int slot_idx) const { return velocity_[slot_idx]; }
+    inline Vector<Scalar,Dim>& velocityBefore(unsigned int slot_idx) { return velocity_before_[slot_idx]; }
+    inline const Vector<Scalar,Dim>& velocityBefore(unsigned int slot_idx) const { return velocity_before_[slot_idx]; }
+    //mass gradient, valid only if enabled
+    void enableMassGradient();  //the mass gradient of existing slots is set to zero
+    void disableMassGradient();
+    inline bool isMassGradientEnabled() const { return with_mass_gradient_; }
+    inline Vector<Scalar,Dim>& massGradient(unsigned int slot_idx) { return mass_gradient_[slot_idx]; }
+    inline const Vector<Scalar,Dim>& massGradient(unsigned int slot_idx) const { return mass_gradient_[slot_idx]; }
+    //rasterize mass and momentum of one object to the node, momentum is ignored if the node is dirichlet for the object
+    //thread-safe for nodes in different blocks if the layer of the object is already allocated
+    //return the slot, such that other quantities (e.g., mass gradient) can be accumulated to it
+    inline unsigned int accumulateMassAndMomentum(const Vector<unsigned int,Dim> &node_idx, unsigned int object_idx, Scalar node_mass, const Vector<Scalar,Dim> &node_momentum)
+    {
+        unsigned int slot_idx = layerSlot(node_idx,object_idx);
+        if(slot_idx == INVALID_SLOT)
+            slot_idx = insertSlot(node_idx,object_idx);
+        else
+            slot_occupied_[slot_idx] = 0x01;
+        mass_[slot_idx] += node_mass;
+        if(slot_dirichlet_[slot_idx] == 0x00)
+            velocity_[slot_idx] += node_momentum;
+        return slot_idx;
+    }
+    //same as above, and the momentum change is rasterized as well: the momentum is accumulated to velocity before solve,
+    //and the sum of momentum and its change is accumulated to velocity
+    inline void accumulateMassAndMomentum(const Vector<unsigned int,Dim> &node_idx, unsigned int object_idx, Scalar node_mass,
+                                          const Vector<Scalar,Dim> &node_momentum, const Vector<Scalar,Dim> &node_momentum_change)
+    {
+        unsigned int slot_idx = layerSlot(node_idx,object_idx);
+        if(slot_idx == INVALID_SLOT)
+            slot_idx = insertSlot(node_idx,object_idx);
+        else
+            slot_occupied_[slot_idx] = 0x01;
+        mass_[slot_idx] += node_mass;
+        if(slot_dirichlet_[slot_idx] == 0x00)
+        {
+            velocity_before_[slot_idx] += node_momentum;
+            velocity_[slot_idx] += node_momentum + node_momentum_change;
+        }
+    }
+
+    //dirichlet nodes
+    void addDirichletNode(const Vector<unsigned int,Dim> &node_idx, unsigned int object_idx);
+    inline bool isDirichletSlot(unsigned int slot_idx) const { return slot_dirichlet_[slot_idx] != 0x00; }
+    bool isDirichletNode(const Vector<unsigned int,Dim> &node_idx) const;  //dirichlet for any object
+    bool isDirichletNode(const Vector<unsigned int,Dim> &node_idx, unsigned int object_idx) const;
+
+    //the nodes that hold at least one slot, available after collectOccupiedNodes()
+    void collectOccupiedNodes(); //collect occupied nodes in ascending flat index order
+    inline unsigned int occupiedNodeNum() const { return static_cast<unsigned int>(occupied_node_.size()); }
+    inline unsigned int occupiedNodeFlatIndex(unsigned int idx) const { return occupied_node_[idx].first; } //row-major flat index of the node
+    inline unsigned int occupiedNodeFirstSlot(unsigned int idx) const { return occupied_node_[idx].second; }
+    Vector<unsigned int,Dim> occupiedNode(unsigned int idx) const;
+public:
+    static const unsigned int INVALID_SLOT = 0xFFFFFFFF;
+    static const unsigned int BLOCK_EDGE_BITS = 2; //4 nodes along each edge of block
+    static const unsigned int BLOCK_EDGE = 1<<BLOCK_EDGE_BITS;
+    static const unsigned int BLOCK_SIZE_BITS = BLOCK_EDGE_BITS*Dim;
+    static const unsigned int BLOCK_SIZE = 1<<BLOCK_SIZE_BITS;
+protected:
+    inline unsigned int blockIndex(const Vector<unsigned int,Dim> &node_idx) const
+    {
+        unsigned int block_idx = 0;
+        for(unsigned int i = 0; i < Dim; ++i)
+            block_idx = block_idx*block_num_[i] + (node_idx[i]>>BLOCK_EDGE_BITS);
+        return block_idx;
+    }
+    inline unsigned int localIndex(const Vector<unsigned int,Dim> &node_idx) const
+    {
+        unsigned int local_idx = 0;
+        for(unsigned int i = 0; i < Dim; ++i)
+            local_idx = (local_idx<<BLOCK_EDGE_BITS) | (node_idx[i]&(BLOCK_EDGE-1));
+        return local_idx;
+    }
+    //first valid slot at the local index, starting from the given layer
+    inline unsigned int validSlotFromLayer(unsigned int layer, unsigned int local_idx) const
+    {
+        for(; layer != INVALID_SLOT; layer = layer_next_[layer])
+        {
+            unsigned int slot_idx = (layer<<BLOCK_SIZE_BITS) | local_idx;
+            if(slot_occupied_[slot_idx])
+                return slot_idx;
+        }
+        return INVALID_SLOT;
+    }
+    //slot of the object at the node no matter it's valid or not, INVALID_SLOT if the layer is not allocated
+    inline unsigned int layerSlot(const Vector<unsigned int,Dim> &node_idx, unsigned int object_idx) const
+    {
+        unsigned int block_id = allocatedBlockId(node_idx);
+        if(block_id == INVALID_SLOT)
+            return INVALID_SLOT;
+        for(unsigned int layer = block_first_layer_[block_id]; layer != INVALID_SLOT; layer = layer_next_[layer])
+        {
+            if(layer_object_[layer] == object_idx)
+                return (layer<<BLOCK_SIZE_BITS) | localIndex(node_idx);
+            if(layer_object_[layer] > object_idx) //layers are in ascending object order
+                break;
+        }
+        return INVALID_SLOT;
+    }
+    unsigned int allocateLayer(unsigned int block_idx, const Vector<unsigned int,Dim> &block_origin, unsigned int object_idx); //allocate the block if needed
+    unsigned int flatIndex(const Vector<unsigned int,Dim> &node_idx) const;
+protected:
+    Vector<unsigned int,Dim> node_num_;
+    Vector<unsigned int,Dim> block_num_;
+    std::vector<unsigned int> block_table_;  //page table: block index to allocated block, INVALID_SLOT if not allocated
+    //allocated blocks
+    std::vector<unsigned int> block_index_;
+    std::vector<Vector<unsigned int,Dim> > block_origin_;
+    std::vector<unsigned int> block_first_layer_;
+    //layers, one for each object in each allocated block
+    std::vector<unsigned int> layer_object_;
+    std::vector<unsigned int> layer_next_;
+    std::vector<unsigned int> layer_block_;
+    //slots, BLOCK_SIZE for each layer
+    std::vector<unsigned char> slot_occupied_;
+    std::vector<Scalar> mass_;
+    std::vector<Vector<Scalar,Dim> > velocity_;
+    std::vector<Vector<Scalar,Dim> > velocity_before_;
+    std::vector<unsigned char> slot_dirichlet_;
+    bool with_mass_gradient_;
+    std::vector<Vector<Scalar,Dim> > mass_gradient_;  //empty if not enabled
+    std::vector<std::pair<unsigned int,unsigned int> > occupied_node_; //[flat node index, first slot]
+    std::vector<std::pair<unsigned int,unsigned int> > occupied_node_buffer_; //buffer for sorting occupied_node_
+    //buffer of dirichlet slots, used in clearData()
+    struct DirichletSlot
+    {
+        Vector<unsigned int,Dim> node_idx_;
+        unsigned int object_idx_;
+        Vector<Scalar,Dim> velocity_;
+        Vector<Scalar,Dim> velocity_before_;
+    };
+    std::vector<DirichletSlot> dirichlet_slot_buffer_;
+};
+
+template <typename Scalar, int Dim>
+const unsigned int MPMSolidGridData<Scalar,Dim>::INVALID_SLOT;
+template <typename Scalar, int Dim>
+const unsigned int MPMSolidGridData<Scalar,Dim>::BLOCK_EDGE_BITS;
+template <typename Scalar, int Dim>
+const unsigned int MPMSolidGridData<Scalar,Dim>::BLOCK_EDGE;
+template <typename Scalar, int Dim>
+const unsigned int MPMSolidGridData<Scalar,Dim>::BLOCK_SIZE_BITS;
+template <typename Scalar, int Dim>
+const unsigned int MPMSolidGridData<Scalar,Dim>::BLOCK_SIZE;
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_DYNAMICS_MPM_MPM_SOLID_GRID_DATA_H_
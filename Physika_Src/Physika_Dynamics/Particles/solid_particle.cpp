@@ -22,47 +22,44 @@ namespace Physika{
 
 template <typename Scalar, int Dim>
 SolidParticle<Scalar,Dim>::SolidParticle()
-    :Particle<Scalar,Dim>(),constitutive_model_(NULL)
+    :Particle<Scalar,Dim>(),constitutive_model_(NULL),own_constitutive_model_(false)
 {
     F_ = SquareMatrix<Scalar,Dim>::identityMatrix();
 }
 
 template <typename Scalar, int Dim>
 SolidParticle<Scalar,Dim>::SolidParticle(const Vector<Scalar,Dim> &pos, const Vector<Scalar,Dim> &vel, Scalar mass, Scalar vol)
-    :Particle<Scalar,Dim>(pos,vel,mass,vol),constitutive_model_(NULL)
+    :Particle<Scalar,Dim>(pos,vel,mass,vol),constitutive_model_(NULL),own_constitutive_model_(false)
 {
     F_ = SquareMatrix<Scalar,Dim>::identityMatrix();
 }
 
 template <typename Scalar, int Dim>
 SolidParticle<Scalar,Dim>::SolidParticle(const Vector<Scalar,Dim> &pos, const Vector<Scalar,Dim> &vel, Scalar mass, Scalar vol, const SquareMatrix<Scalar,Dim> &deform_grad)
-    :Particle<Scalar,Dim>(pos,vel,mass,vol),F_(deform_grad),constitutive_model_(NULL)
+    :Particle<Scalar,Dim>(pos,vel,mass,vol),F_(deform_grad),constitutive_model_(NULL),own_constitutive_model_(false)
 {
 }
 
 template <typename Scalar, int Dim>
 SolidParticle<Scalar,Dim>::SolidParticle(const Vector<Scalar,Dim> &pos, const Vector<Scalar,Dim> &vel, Scalar mass, Scalar vol, const SquareMatrix<Scalar,Dim> &deform_grad,
                                          const ConstitutiveModel<Scalar,Dim> &material)
-    :Particle<Scalar,Dim>(pos,vel,mass,vol),F_(deform_grad),constitutive_model_(NULL)
+    :Particle<Scalar,Dim>(pos,vel,mass,vol),F_(deform_grad),constitutive_model_(NULL),own_constitutive_model_(false)
 {
     setConstitutiveModel(material);
 }
 
 template <typename Scalar, int Dim>
 SolidParticle<Scalar,Dim>::SolidParticle(const SolidParticle<Scalar,Dim> &particle)
-    :Particle<Scalar,Dim>(particle), F_(particle.F_),constitutive_model_(NULL)
+    :Particle<Scalar,Dim>(particle), F_(particle.F_),constitutive_model_(NULL),own_constitutive_model_(false)
 {
     if(particle.constitutive_model_)
         setConstitutiveModel(*(particle.constitutive_model_));
-    else
-        constitutive_model_ = NULL;
 }
 
 template <typename Scalar, int Dim>
 SolidParticle<Scalar,Dim>::~SolidParticle()
 {
-    if(constitutive_model_)
-        delete constitutive_model_;
+    releaseConstitutiveModel();
 }
 
 template <typename Scalar, int Dim>
@@ -79,7 +76,7 @@ SolidParticle<Scalar,Dim>& SolidParticle<Scalar,Dim>::operator= (const SolidPart
     if(particle.constitutive_model_)
         setConstitutiveModel(*(particle.constitutive_model_));
     else
-        constitutive_model_ = NULL;
+        releaseConstitutiveModel();
     return *this;
 }
 
@@ -142,9 +139,36 @@ void SolidParticle<Scalar,Dim>::setDeformationGradient(const SquareMatrix<Scalar
 template <typename Scalar, int Dim>
 void SolidParticle<Scalar,Dim>::setConstitutiveModel(const ConstitutiveModel<Scalar,Dim> &material)
 {
-    if(constitutive_model_)
+    //material may be the model of this particle
+    ConstitutiveModel<Scalar,Dim> *material_copy = material.clone();
+    releaseConstitutiveModel();
+    constitutive_model_ = material_copy;
+    own_constitutive_model_ = true;
+}
+
+template <typename Scalar, int Dim>
+void SolidParticle<Scalar,Dim>::setConstitutiveModelReference(const ConstitutiveModel<Scalar,Dim> *material)
+{
+    if(material == constitutive_model_)
+        return;
+    releaseConstitutiveModel();
+    constitutive_model_ = material;
+    own_constitutive_model_ = false;
+}
+
+template <typename Scalar, int Dim>
+const ConstitutiveModel<Scalar,Dim>* SolidParticle<Scalar,Dim>::constitutiveModel() const
+{
+    return constitutive_model_;
+}
+
+template <typename Scalar, int Dim>
+void SolidParticle<Scalar,Dim>::releaseConstitutiveModel()
+{
+    if(constitutive_model_ && own_constitutive_model_)
         delete constitutive_model_;
-    constitutive_model_ = material.clone();
+    constitutive_model_ = NULL;
+    own_constitutive_model_ = false;
 }
 
 //explicit instantiations
@@ -43,10 +43,18 @@ public:
     SquareMatrix<Scalar,Dim> secondPiolaKirchhoffStress() const;
     SquareMatrix<Scalar,Dim> cauchyStress() const;
     void setDeformationGradient(const SquareMatrix<Scalar,Dim> &F);
-    void setConstitutiveModel(const ConstitutiveModel<Scalar,Dim> &material);
+    void setConstitutiveModel(const ConstitutiveModel<Scalar,Dim> &material); //a copy of material is stored
+    //refer to material without a copy, the material must outlive the reference or be replaced before it's destroyed
+    //e.g., the particle views of MPM drivers refer to the materials stored in SolidParticleData; NULL unsets the model
+    //copies of the particle store a copy of the material
+    void setConstitutiveModelReference(const ConstitutiveModel<Scalar,Dim> *material);
+    const ConstitutiveModel<Scalar,Dim>* constitutiveModel() const; //NULL if not set
+protected:
+    void releaseConstitutiveModel(); //the model is deleted if it's a copy owned by the particle
 protected:
     SquareMatrix<Scalar,Dim> F_;
-    ConstitutiveModel<Scalar,Dim> *constitutive_model_;
+    const ConstitutiveModel<Scalar,Dim> *constitutive_model_;
+    bool own_constitutive_model_; //false if constitutive_model_ refers to a material stored elsewhere
 };
 
 }  //end of namespace Physika
@@ -0,0 +1,531 @@
+/*
+ * @file solid_particle_data.cpp
+ * @Brief data of a set of solid particles, stored in structure of arrays.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include "Physika_Core/Utilities/physika_assert.h"
+#include "Physika_Core/Utilities/File_Utilities/binary_io.h"
+#include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Constitutive_Models/constitutive_model.h"
+#include "Physika_Dynamics/Constitutive_Models/neo_hookean.h"
+#include "Physika_Dynamics/Constitutive_Models/st_venant_kirchhoff.h"
+#include "Physika_Dynamics/Constitutive_Models/isotropic_linear_elasticity.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
+
+namespace Physika{
+
+namespace SolidParticleDataInternal{
+
+//grow the array to new_capacity elements, the first keep_num elements are kept
+//elements are copied with assignment because Vector and SquareMatrix are not trivially copyable
+template <typename ElementType>
+void growArrayKeepData(Array<ElementType> &arr, unsigned int new_capacity, unsigned int keep_num)
+{
+    PHYSIKA_ASSERT(keep_num <= arr.size() && keep_num <= new_capacity);
+    ElementType *old_data = keep_num > 0 ? new ElementType[keep_num] : NULL;
+    for(unsigned int i = 0; i < keep_num; ++i)
+        old_data[i] = arr.data()[i];
+    arr.resize(new_capacity);
+    for(unsigned int i = 0; i < keep_num; ++i)
+        arr.data()[i] = old_data[i];
+    delete[] old_data;
+}
+
+//shift the elements in [element_idx+1, element_num) forward by one, the last element becomes garbage
+template <typename ElementType>
+void shiftArrayElements(Array<ElementType> &arr, unsigned int element_idx, unsigned int element_num)
+{
+    PHYSIKA_ASSERT(element_num <= arr.size());
+    ElementType *data = arr.data();
+    for(unsigned int i = element_idx; i + 1 < element_num; ++i)
+        data[i] = data[i+1];
+}
+
+//type tag of constitutive models in binary stream
+enum ConstitutiveModelType{
+    NO_MODEL = 0,
+    NEO_HOOKEAN = 1,
+    STVK = 2,
+    ISOTROPIC_LINEAR_ELASTICITY = 3,
+    UNSUPPORTED_MODEL = 255
+};
+
+template <typename Scalar, int Dim>
+unsigned char constitutiveModelType(const ConstitutiveModel<Scalar,Dim> *model)
+{
+    if(model == NULL)
+        return NO_MODEL;
+    if(dynamic_cast<const NeoHookean<Scalar,Dim>*>(model))
+        return NEO_HOOKEAN;
+    if(dynamic_cast<const StVK<Scalar,Dim>*>(model))
+        return STVK;
+    if(dynamic_cast<const IsotropicLinearElasticity<Scalar,Dim>*>(model))
+        return ISOTROPIC_LINEAR_ELASTICITY;
+    return UNSUPPORTED_MODEL;
+}
+
+//two particles are in the same run if their models are of the same type and with the same parameters
+template <typename Scalar, int Dim>
+bool isSameMaterial(const ConstitutiveModel<Scalar,Dim> *model_a, const ConstitutiveModel<Scalar,Dim> *model_b)
+{
+    if(constitutiveModelType(model_a) != constitutiveModelType(model_b))
+        return false;
+    if(model_a == NULL)
+        return true;
+    const IsotropicHyperelasticMaterial<Scalar,Dim> *material_a = dynamic_cast<const IsotropicHyperelasticMaterial<Scalar,Dim>*>(model_a);
+    const IsotropicHyperelasticMaterial<Scalar,Dim> *material_b = dynamic_cast<const IsotropicHyperelasticMaterial<Scalar,Dim>*>(model_b);
+    return material_a->lambda() == material_b->lambda() && material_a->mu() == material_b->mu();
+}
+
+//create constitutive model of given type with lame coefficients, NULL is returned for NO_MODEL and invalid type
+template <typename Scalar, int Dim>
+ConstitutiveModel<Scalar,Dim>* createConstitutiveModel(unsigned char type, Scalar lambda, Scalar mu)
+{
+    switch(type)
+    {
+    case NEO_HOOKEAN:
+        return new NeoHookean<Scalar,Dim>(lambda,mu,IsotropicHyperelasticMaterialInternal::LAME_COEFFICIENTS);
+    case STVK:
+        return new StVK<Scalar,Dim>(lambda,mu,IsotropicHyperelasticMaterialInternal::LAME_COEFFICIENTS);
+    case ISOTROPIC_LINEAR_ELASTICITY:
+        return new IsotropicLinearElasticity<Scalar,Dim>(lambda,mu,IsotropicHyperelasticMaterialInternal::LAME_COEFFICIENTS);
+    default:
+        return NULL;
+    }
+}
+
+}  //end of namespace SolidParticleDataInternal
+
+template <typename Scalar, int Dim>
+SolidParticleData<Scalar,Dim>::SolidParticleData()
+    :particle_num_(0)
+{
+    array_manager_.addArray("position",&position_);
+    array_manager_.addArray("velocity",&velocity_);
+    array_manager_.addArray("mass",&mass_);
+    array_manager_.addArray("volume",&volume_);
+    array_manager_.addArray("deformation_gradient",&deform_grad_);
+    array_manager_.addArray("material_index",&material_idx_);
+}
+
+template <typename Scalar, int Dim>
+SolidParticleData<Scalar,Dim>::~SolidParticleData()
+{
+    clear();
+}
+
+template <typename Scalar, int Dim>
+unsigned int SolidParticleData<Scalar,Dim>::particleNum() const
+{
+    return particle_num_;
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::addParticle(const SolidParticle<Scalar,Dim> &particle)
+{
+    unsigned int particle_num = particleNum();
+    resizeArrays(particle_num+1);
+    material_idx_[particle_num] = NO_MATERIAL;
+    copyFromParticle(particle_num,particle);
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::addParticles(const std::vector<SolidParticle<Scalar,Dim>*> &particles)
+{
+    unsigned int particle_num = particleNum();
+    resizeArrays(particle_num+particles.size());
+    for(unsigned int i = 0; i < particles.size(); ++i)
+    {
+        PHYSIKA_ASSERT(particles[i]);
+        material_idx_[particle_num+i] = NO_MATERIAL;
+        copyFromParticle(particle_num+i,*particles[i]);
+    }
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::removeParticle(unsigned int particle_idx)
+{
+    unsigned int particle_num = particleNum();
+    if(particle_idx >= particle_num)
+    {
+        std::cerr<<"Warning: particle index out of range, operation ignored!\n";
+        return;
+    }
+    unsigned int material_idx = material_idx_[particle_idx];
+    SolidParticleDataInternal::shiftArrayElements(position_,particle_idx,particle_num);
+    SolidParticleDataInternal::shiftArrayElements(velocity_,particle_idx,particle_num);
+    SolidParticleDataInternal::shiftArrayElements(mass_,particle_idx,particle_num);
+    SolidParticleDataInternal::shiftArrayElements(volume_,particle_idx,particle_num);
+    SolidParticleDataInternal::shiftArrayElements(deform_grad_,particle_idx,particle_num);
+    SolidParticleDataInternal::shiftArrayElements(material_idx_,particle_idx,particle_num);
+    resizeArrays(particle_num-1);
+    releaseMaterial(material_idx);
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::clear()
+{
+    for(unsigned int i = 0; i < materials_.size(); ++i)
+        delete materials_[i];
+    materials_.clear();
+    material_particle_num_.clear();
+    position_.clear();
+    velocity_.clear();
+    mass_.clear();
+    volume_.clear();
+    deform_grad_.clear();
+    material_idx_.clear();
+    particle_num_ = 0;
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::copyToParticle(unsigned int particle_idx, SolidParticle<Scalar,Dim> &particle) const
+{
+    PHYSIKA_ASSERT(particle_idx < particleNum());
+    particle.setPosition(position_[particle_idx]);
+    particle.setVelocity(velocity_[particle_idx]);
+    particle.setMass(mass_[particle_idx]);
+    particle.setVolume(volume_[particle_idx]);
+    particle.setDeformationGradient(deform_grad_[particle_idx]);
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::copyFromParticle(unsigned int particle_idx, const SolidParticle<Scalar,Dim> &particle)
+{
+    PHYSIKA_ASSERT(particle_idx < particleNum());
+    position_[particle_idx] = particle.position();
+    velocity_[particle_idx] = particle.velocity();
+    mass_[particle_idx] = particle.mass();
+    volume_[particle_idx] = particle.volume();
+    deform_grad_[particle_idx] = particle.deformationGradient();
+    setMaterial(particle_idx,particle.constitutiveModel());
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::permutate(unsigned int *ids, unsigned int size)
+{
+    unsigned int particle_num = particleNum();
+    if(size != particle_num)
+    {
+        std::cerr<<"Warning: size of permutation does not match particle number, operation ignored!\n";
+        return;
+    }
+    //the arrays are permutated in full capacity, the unused tail is left in place
+    unsigned int capacity = position_.size();
+    if(capacity == particle_num)
+    {
+        array_manager_.permutate(ids,size);
+        return;
+    }
+    std::vector<unsigned int> full_ids(capacity);
+    for(unsigned int i = 0; i < particle_num; ++i)
+        full_ids[i] = ids[i];
+    for(unsigned int i = particle_num; i < capacity; ++i)
+        full_ids[i] = i;
+    array_manager_.permutate(&full_ids[0],capacity);
+}
+
+template <typename Scalar, int Dim>
+bool SolidParticleData<Scalar,Dim>::write(std::ostream &output) const
+{
+    //check the models and count the runs before anything is written
+    //supported materials are never duplicated, hence particles of a run share the material index
+    unsigned int particle_num = particleNum();
+    unsigned int run_num = 0;
+    for(unsigned int i = 0; i < particle_num; ++i)
+    {
+        if(SolidParticleDataInternal::constitutiveModelType(constitutiveModel(i)) == SolidParticleDataInternal::UNSUPPORTED_MODEL)
+        {
+            std::cerr<<"Warning: constitutive model of particle "<<i<<" cannot be written to binary stream!\n";
+            return false;
+        }
+        if(i == 0 || material_idx_[i-1] != material_idx_[i])
+            ++run_num;
+    }
+    FileUtilities::writeBinary(output,particle_num);
+    FileUtilities::writeBinary(output,position_.data(),particle_num);
+    FileUtilities::writeBinary(output,velocity_.data(),particle_num);
+    FileUtilities::writeBinary(output,mass_.data(),particle_num);
+    FileUtilities::writeBinary(output,volume_.data(),particle_num);
+    FileUtilities::writeBinary(output,deform_grad_.data(),particle_num);
+    //each run: particle number, model type and lame coefficients
+    FileUtilities::writeBinary(output,run_num);
+    unsigned int run_start = 0;
+    for(unsigned int i = 1; i <= particle_num; ++i)
+    {
+        if(i < particle_num && material_idx_[i-1] == material_idx_[i])
+            continue;
+        const ConstitutiveModel<Scalar,Dim> *model = constitutiveModel(run_start);
+        const IsotropicHyperelasticMaterial<Scalar,Dim> *material = dynamic_cast<const IsotropicHyperelasticMaterial<Scalar,Dim>*>(model);
+        unsigned int run_length = i - run_start;
+        unsigned char type = SolidParticleDataInternal::constitutiveModelType(model);
+        Scalar lambda = material ? material->lambda() : 0;
+        Scalar mu = material ? material->mu() : 0;
+        FileUtilities::writeBinary(output,run_length);
+        FileUtilities::writeBinary(output,type);
+        FileUtilities::writeBinary(output,lambda);
+        FileUtilities::writeBinary(output,mu);
+        run_start = i;
+    }
+    return static_cast<bool>(output);
+}
+
+template <typename Scalar, int Dim>
+bool SolidParticleData<Scalar,Dim>::read(std::istream &input)
+{
+    clear();
+    unsigned int particle_num = 0;
+    if(!FileUtilities::readBinary(input,particle_num))
+        return false;
+    resizeArrays(particle_num);
+    for(unsigned int i = 0; i < particle_num; ++i)
+        material_idx_[i] = NO_MATERIAL;
+    bool success = FileUtilities::readBinary(input,position_.data(),particle_num) && FileUtilities::readBinary(input,velocity_.data(),particle_num)
+                   && FileUtilities::readBinary(input,mass_.data(),particle_num) && FileUtilities::readBinary(input,volume_.data(),particle_num)
+                   && FileUtilities::readBinary(input,deform_grad_.data(),particle_num);
+    unsigned int run_num = 0;
+    success = success && FileUtilities::readBinary(input,run_num);
+    unsigned int particle_idx = 0;
+    for(unsigned int run_idx = 0; success && run_idx < run_num; ++run_idx)
+    {
+        unsigned int run_length = 0;
+        unsigned char type = SolidParticleDataInternal::UNSUPPORTED_MODEL;
+        Scalar lambda = 0, mu = 0;
+        success = FileUtilities::readBinary(input,run_length) && FileUtilities::readBinary(input,type)
+                  && FileUtilities::readBinary(input,lambda) && FileUtilities::readBinary(input,mu);
+        if(!success || run_length > particle_num - particle_idx)
+            success = false;
+        else if(type != SolidParticleDataInternal::NO_MODEL)
+        {
+            ConstitutiveModel<Scalar,Dim> *model = SolidParticleDataInternal::createConstitutiveModel<Scalar,Dim>(type,lambda,mu);
+            if(model == NULL || run_length == 0)
+            {
+                delete model;
+                success = false;
+            }
+            else
+            {
+                unsigned int material_idx = findOrAddMaterial(model);
+                delete model;
+                for(unsigned int i = 0; i < run_length; ++i)
+                    material_idx_[particle_idx+i] = material_idx;
+                material_particle_num_[material_idx] += run_length;
+            }
+        }
+        particle_idx += run_length;
+    }
+    if(!success || particle_idx != particle_num)
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+template <typename Scalar, int Dim>
+Scalar SolidParticleData<Scalar,Dim>::energy(unsigned int particle_idx) const
+{
+    return checkedConstitutiveModel(particle_idx).energy(deform_grad_.data()[particle_idx]);
+}
+
+template <typename Scalar, int Dim>
+SquareMatrix<Scalar,Dim> SolidParticleData<Scalar,Dim>::firstPiolaKirchhoffStress(unsigned int particle_idx) const
+{
+    return checkedConstitutiveModel(particle_idx).firstPiolaKirchhoffStress(deform_grad_.data()[particle_idx]);
+}
+
+template <typename Scalar, int Dim>
+SquareMatrix<Scalar,Dim> SolidParticleData<Scalar,Dim>::secondPiolaKirchhoffStress(unsigned int particle_idx) const
+{
+    return checkedConstitutiveModel(particle_idx).secondPiolaKirchhoffStress(deform_grad_.data()[particle_idx]);
+}
+
+template <typename Scalar, int Dim>
+SquareMatrix<Scalar,Dim> SolidParticleData<Scalar,Dim>::cauchyStress(unsigned int particle_idx) const
+{
+    return checkedConstitutiveModel(particle_idx).cauchyStress(deform_grad_.data()[particle_idx]);
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::energy(unsigned int start, unsigned int count, Scalar *energy) const
+{
+    PHYSIKA_ASSERT(start + count <= particleNum());
+    unsigned int end = start + count;
+    for(unsigned int run_start = start, run_end = start; run_start < end; run_start = run_end)
+    {
+        run_end = materialRunEnd(run_start,end);
+        checkedConstitutiveModel(run_start).batchEnergy(deform_grad_.data()+run_start,run_end-run_start,energy+(run_start-start));
+    }
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::firstPiolaKirchhoffStress(unsigned int start, unsigned int count, SquareMatrix<Scalar,Dim> *stress, bool volume_weighted) const
+{
+    PHYSIKA_ASSERT(start + count <= particleNum());
+    unsigned int end = start + count;
+    for(unsigned int run_start = start, run_end = start; run_start < end; run_start = run_end)
+    {
+        run_end = materialRunEnd(run_start,end);
+        const Scalar *volumes = volume_weighted ? volume_.data()+run_start : NULL;
+        checkedConstitutiveModel(run_start).batchFirstPiolaKirchhoffStress(deform_grad_.data()+run_start,volumes,run_end-run_start,stress+(run_start-start));
+    }
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::cauchyStress(unsigned int start, unsigned int count, SquareMatrix<Scalar,Dim> *stress, bool volume_weighted) const
+{
+    PHYSIKA_ASSERT(start + count <= particleNum());
+    unsigned int end = start + count;
+    for(unsigned int run_start = start, run_end = start; run_start < end; run_start = run_end)
+    {
+        run_end = materialRunEnd(run_start,end);
+        const Scalar *volumes = volume_weighted ? volume_.data()+run_start : NULL;
+        checkedConstitutiveModel(run_start).batchCauchyStress(deform_grad_.data()+run_start,volumes,run_end-run_start,stress+(run_start-start));
+    }
+}
+
+template <typename Scalar, int Dim>
+SquareMatrix<Scalar,Dim> SolidParticleData<Scalar,Dim>::firstPiolaKirchhoffStress(unsigned int particle_idx, const SquareMatrix<Scalar,Dim> &F) const
+{
+    return checkedConstitutiveModel(particle_idx).firstPiolaKirchhoffStress(F);
+}
+
+template <typename Scalar, int Dim>
+SquareMatrix<Scalar,Dim> SolidParticleData<Scalar,Dim>::firstPiolaKirchhoffStressDifferential(unsigned int particle_idx, const SquareMatrix<Scalar,Dim> &F,
+                                                                                              const SquareMatrix<Scalar,Dim> &dF) const
+{
+    return checkedConstitutiveModel(particle_idx).firstPiolaKirchhoffStressDifferential(F,dF);
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::resizeArrays(unsigned int particle_num)
+{
+    //capacity grows geometrically such that adding particles one by one costs amortized constant time
+    unsigned int capacity = position_.size();
+    if(particle_num > capacity)
+    {
+        unsigned int new_capacity = 2*capacity > particle_num ? 2*capacity : particle_num;
+        SolidParticleDataInternal::growArrayKeepData(position_,new_capacity,particle_num_);
+        SolidParticleDataInternal::growArrayKeepData(velocity_,new_capacity,particle_num_);
+        SolidParticleDataInternal::growArrayKeepData(mass_,new_capacity,particle_num_);
+        SolidParticleDataInternal::growArrayKeepData(volume_,new_capacity,particle_num_);
+        SolidParticleDataInternal::growArrayKeepData(deform_grad_,new_capacity,particle_num_);
+        SolidParticleDataInternal::growArrayKeepData(material_idx_,new_capacity,particle_num_);
+    }
+    particle_num_ = particle_num;
+}
+
+template <typename Scalar, int Dim>
+const ConstitutiveModel<Scalar,Dim>& SolidParticleData<Scalar,Dim>::checkedConstitutiveModel(unsigned int particle_idx) const
+{
+    PHYSIKA_ASSERT(particle_idx < particleNum());
+    const ConstitutiveModel<Scalar,Dim> *model = constitutiveModel(particle_idx);
+    if(model==NULL)
+    {
+        std::cerr<<"Error: SolidParticle constitutive model not set, program abort!\n";
+        std::exit(EXIT_FAILURE);
+    }
+    return *model;
+}
+
+template <typename Scalar, int Dim>
+unsigned int SolidParticleData<Scalar,Dim>::materialRunEnd(unsigned int run_start, unsigned int end) const
+{
+    const unsigned int *material_idx = material_idx_.data();
+    unsigned int run_end = run_start + 1;
+    while(run_end < end && material_idx[run_end] == material_idx[run_start])
+        ++run_end;
+    return run_end;
+}
+
+template <typename Scalar, int Dim>
+unsigned int SolidParticleData<Scalar,Dim>::findMaterial(const ConstitutiveModel<Scalar,Dim> *model) const
+{
+    //the number of distinct materials is small, models of unsupported types are not compared
+    if(SolidParticleDataInternal::constitutiveModelType(model) == SolidParticleDataInternal::UNSUPPORTED_MODEL)
+        return NO_MATERIAL;
+    for(unsigned int i = 0; i < materials_.size(); ++i)
+        if(SolidParticleDataInternal::isSameMaterial(materials_[i],model))
+            return i;
+    return NO_MATERIAL;
+}
+
+template <typename Scalar, int Dim>
+unsigned int SolidParticleData<Scalar,Dim>::findOrAddMaterial(const ConstitutiveModel<Scalar,Dim> *model)
+{
+    if(model == NULL)
+        return NO_MATERIAL;
+    unsigned int material_idx = findMaterial(model);
+    if(material_idx != NO_MATERIAL)
+        return material_idx;
+    materials_.push_back(model->clone());
+    material_particle_num_.push_back(0);
+    return materials_.size() - 1;
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::setMaterial(unsigned int particle_idx, const ConstitutiveModel<Scalar,Dim> *model)
+{
+    unsigned int old_idx = material_idx_[particle_idx];
+    if(old_idx != NO_MATERIAL && materials_[old_idx] == model)
+        return;
+    unsigned int new_idx = model == NULL ? NO_MATERIAL : findMaterial(model);
+    if(new_idx != NO_MATERIAL && new_idx == old_idx)
+        return;
+    //a material used by this particle only is replaced in place, e.g., the model of unsupported type
+    //is cloned again each time the particle is copied back from SolidParticle
+    if(model != NULL && new_idx == NO_MATERIAL && old_idx != NO_MATERIAL && material_particle_num_[old_idx] == 1)
+    {
+        delete materials_[old_idx];
+        materials_[old_idx] = model->clone();
+        return;
+    }
+    if(model != NULL && new_idx == NO_MATERIAL)
+        new_idx = findOrAddMaterial(model);
+    if(new_idx != NO_MATERIAL)
+        ++material_particle_num_[new_idx];
+    material_idx_[particle_idx] = new_idx;
+    releaseMaterial(old_idx);
+}
+
+template <typename Scalar, int Dim>
+void SolidParticleData<Scalar,Dim>::releaseMaterial(unsigned int material_idx)
+{
+    if(material_idx == NO_MATERIAL)
+        return;
+    PHYSIKA_ASSERT(material_idx < materials_.size() && material_particle_num_[material_idx] > 0);
+    if(--material_particle_num_[material_idx] > 0)
+        return;
+    //the last material takes the place of the unused one
+    unsigned int last_idx = materials_.size() - 1;
+    delete materials_[material_idx];
+    materials_[material_idx] = materials_[last_idx];
+    material_particle_num_[material_idx] = material_particle_num_[last_idx];
+    materials_.pop_back();
+    material_particle_num_.pop_back();
+    if(material_idx == last_idx)
+        return;
+    unsigned int *particle_material_idx = material_idx_.data();
+    for(unsigned int i = 0; i < particle_num_; ++i)
+        if(particle_material_idx[i] == last_idx)
+            particle_material_idx[i] = material_idx;
+}
+
+//explicit instantiations
+template class SolidParticleData<float,2>;
+template class SolidParticleData<float,3>;
+template class SolidParticleData<double,2>;
+template class SolidParticleData<double,3>;
+
+}  //end of namespace Physika
@@ -0,0 +1,140 @@
+/*
+ * @file solid_particle_data.h
+ * @Brief data of a set of solid particles, stored in structure of arrays.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef PHYSIKA_DYNAMICS_PARTICLES_SOLID_PARTICLE_DATA_H_
+#define PHYSIKA_DYNAMICS_PARTICLES_SOLID_PARTICLE_DATA_H_
+
+#include <vector>
+#include <iosfwd>
+#include "Physika_Core/Vectors/vector_2d.h"
+#include "Physika_Core/Vectors/vector_3d.h"
+#include "Physika_Core/Matrices/matrix_2x2.h"
+#include "Physika_Core/Matrices/matrix_3x3.h"
+#include "Physika_Core/Arrays/array.h"
+#include "Physika_Core/Arrays/array_manager.h"
+
+namespace Physika{
+
+template <typename Scalar, int Dim> class SolidParticle;
+template <typename Scalar, int Dim> class ConstitutiveModel;
+
+/*
+ * SolidParticleData: position, velocity, mass, volume, deformation gradient and constitutive model
+ * of a set of solid particles, each stored in a contiguous array.
+ * It's the storage for loops over many particles, e.g., in simulation drivers, SolidParticle is
+ * the interface for single particle and data can be copied between the two.
+ *
+ * The arrays are registered to an ArrayManager such that they're always permutated together.
+ * Their capacity grows geometrically, so adding particles one by one is cheap.
+ * The constitutive models are shared: SolidParticleData owns one clone of each distinct material
+ * and each particle stores the index of its material. NeoHookean, StVK and IsotropicLinearElasticity
+ * models with the same parameters are the same material, models of other types are never shared.
+ * The batch methods evaluate runs of consecutive particles with the same material in one call.
+ *
+ * The particles can be written to/read from binary stream, e.g., for snapshots of simulation.
+ * The arrays are streamed directly as raw bytes, and the constitutive models are stored as runs
+ * of consecutive particles with the same material. Only NeoHookean, StVK and IsotropicLinearElasticity
+ * models are supported.
+ */
+
+template <typename Scalar, int Dim>
+class SolidParticleData
+{
+public:
+    static const unsigned int NO_MATERIAL = 0xFFFFFFFF;
+public:
+    SolidParticleData();
+    ~SolidParticleData();
+    unsigned int particleNum() const;
+    void addParticle(const SolidParticle<Scalar,Dim> &particle); //data are copied
+    void addParticles(const std::vector<SolidParticle<Scalar,Dim>*> &particles);
+    void removeParticle(unsigned int particle_idx);
+    void clear();
+    //copy data of one particle between SolidParticleData and SolidParticle
+    void copyToParticle(unsigned int particle_idx, SolidParticle<Scalar,Dim> &particle) const; //constitutive model is not copied
+    void copyFromParticle(unsigned int particle_idx, const SolidParticle<Scalar,Dim> &particle);
+    //reorder the particles: the i-th particle after permutation is the ids[i]-th particle before
+    void permutate(unsigned int *ids, unsigned int size);
+    //binary io, return false if the stream fails or the data are not supported
+    bool write(std::ostream &output) const;
+    bool read(std::istream &input); //existing particles are replaced, no particle is left if it fails
+
+    //data of particles, no range check
+    inline Vector<Scalar,Dim>& position(unsigned int particle_idx) { return position_.data()[particle_idx]; }
+    inline const Vector<Scalar,Dim>& position(unsigned int particle_idx) const { return position_.data()[particle_idx]; }
+    inline Vector<Scalar,Dim>& velocity(unsigned int particle_idx) { return velocity_.data()[particle_idx]; }
+    inline const Vector<Scalar,Dim>& velocity(unsigned int particle_idx) const { return velocity_.data()[particle_idx]; }
+    inline Scalar& mass(unsigned int particle_idx) { return mass_.data()[particle_idx]; }
+    inline Scalar mass(unsigned int particle_idx) const { return mass_.data()[particle_idx]; }
+    inline Scalar& volume(unsigned int particle_idx) { return volume_.data()[particle_idx]; }
+    inline Scalar volume(unsigned int particle_idx) const { return volume_.data()[particle_idx]; }
+    inline SquareMatrix<Scalar,Dim>& deformationGradient(unsigned int particle_idx) { return deform_grad_.data()[particle_idx]; }
+    inline const SquareMatrix<Scalar,Dim>& deformationGradient(unsigned int particle_idx) const { return deform_grad_.data()[particle_idx]; }
+    inline const ConstitutiveModel<Scalar,Dim>* constitutiveModel(unsigned int particle_idx) const //NULL if not set
+    {
+        unsigned int material_idx = material_idx_.data()[particle_idx];
+        return material_idx == NO_MATERIAL ? NULL : materials_[material_idx];
+    }
+    inline unsigned int materialIndex(unsigned int particle_idx) const { return material_idx_.data()[particle_idx]; } //NO_MATERIAL if not set
+    //the distinct materials of the particles, a material is removed once no particle uses it and the last material takes its index
+    inline unsigned int materialNum() const { return materials_.size(); }
+    inline const ConstitutiveModel<Scalar,Dim>& material(unsigned int material_idx) const { return *materials_[material_idx]; }
+    //quantities evaluated with the constitutive model and deformation gradient of particle
+    Scalar energy(unsigned int particle_idx) const;
+    SquareMatrix<Scalar,Dim> firstPiolaKirchhoffStress(unsigned int particle_idx) const;
+    SquareMatrix<Scalar,Dim> secondPiolaKirchhoffStress(unsigned int particle_idx) const;
+    SquareMatrix<Scalar,Dim> cauchyStress(unsigned int particle_idx) const;
+    //the same quantities of count consecutive particles starting from start, evaluated with the batch methods of the constitutive
+    //models on runs of particles with the same material, the stresses are scaled by particle volume if volume_weighted is true
+    void energy(unsigned int start, unsigned int count, Scalar *energy) const;
+    void firstPiolaKirchhoffStress(unsigned int start, unsigned int count, SquareMatrix<Scalar,Dim> *stress, bool volume_weighted = false) const;
+    void cauchyStress(unsigned int start, unsigned int count, SquareMatrix<Scalar,Dim> *stress, bool volume_weighted = false) const;
+    //quantities evaluated with the constitutive model of particle at given deformation gradient, e.g., a trial state in implicit integration
+    SquareMatrix<Scalar,Dim> firstPiolaKirchhoffStress(unsigned int particle_idx, const SquareMatrix<Scalar,Dim> &F) const;
+    SquareMatrix<Scalar,Dim> firstPiolaKirchhoffStressDifferential(unsigned int particle_idx, const SquareMatrix<Scalar,Dim> &F, const SquareMatrix<Scalar,Dim> &dF) const;
+protected:
+    //disabled because the arrays are registered to array_manager_ with their address
+    SolidParticleData(const SolidParticleData<Scalar,Dim> &data);
+    SolidParticleData<Scalar,Dim>& operator= (const SolidParticleData<Scalar,Dim> &data);
+    void resizeArrays(unsigned int particle_num); //data of the first min(old_num, particle_num) particles are kept, capacity never shrinks
+    const ConstitutiveModel<Scalar,Dim>& checkedConstitutiveModel(unsigned int particle_idx) const; //abort if not set
+    unsigned int materialRunEnd(unsigned int run_start, unsigned int end) const; //end of the run of particles with the same material as run_start
+    //index of the material that equals model, NO_MATERIAL if there's none or model is of unsupported type
+    unsigned int findMaterial(const ConstitutiveModel<Scalar,Dim> *model) const;
+    //index of the material that equals model, a clone of model is added if there's none; NO_MATERIAL if model is NULL
+    //the particle number of the material is not changed
+    unsigned int findOrAddMaterial(const ConstitutiveModel<Scalar,Dim> *model);
+    //set material of particle to a copy of model and update the particle numbers of the materials
+    void setMaterial(unsigned int particle_idx, const ConstitutiveModel<Scalar,Dim> *model);
+    //one particle less uses the material, which is removed if no particle uses it
+    void releaseMaterial(unsigned int material_idx);
+protected:
+    Array<Vector<Scalar,Dim> > position_;
+    Array<Vector<Scalar,Dim> > velocity_;
+    Array<Scalar> mass_;
+    Array<Scalar> volume_;
+    Array<SquareMatrix<Scalar,Dim> > deform_grad_;
+    Array<unsigned int> material_idx_;
+    std::vector<ConstitutiveModel<Scalar,Dim>*> materials_;
+    std::vector<unsigned int> material_particle_num_; //number of particles that use each material
+    ArrayManager array_manager_;
+    unsigned int particle_num_; //the arrays may be larger than particle number, the tail is reserved for new particles
+};
+
+template <typename Scalar, int Dim>
+const unsigned int SolidParticleData<Scalar,Dim>::NO_MATERIAL;
+
+}  //end of namespace Physika
+
+#endif //PHYSIKA_DYNAMICS_PARTICLES_SOLID_PARTICLE_DATA_H_
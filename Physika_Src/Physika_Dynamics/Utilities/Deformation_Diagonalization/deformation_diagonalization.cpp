@@ -21,10 +21,200 @@
 #include "Physika_Core/Matrices/matrix_2x2.h"
 #include "Physika_Core/Matrices/matrix_3x3.h"
 #include "Physika_Core/Utilities/math_utilities.h"
+#include "Physika_Core/Utilities/physika_assert.h"
 #include "Physika_Dynamics/Utilities/Deformation_Diagonalization/deformation_diagonalization.h"
 
 namespace Physika{
 
+namespace DeformationDiagonalizationInternal{
+
+//number of matrices diagonalized together, each step of the SVD is a loop over the lanes that is vectorized by the compiler
+const unsigned int batch_lane_num = 8;
+
+//number of cyclic Jacobi sweeps on F^T*F in 3D, the convergence is quadratic and 4 sweeps reach machine precision for both float and double
+const unsigned int jacobi_sweep_num = 4;
+
+//Jacobi rotation in plane (p,q) that annihilates s_pq of symmetric matrices S, r is the remaining index in 3D
+//the rotation is accumulated to the columns of V, there's no branch except the selects
+template <typename Scalar, int Dim>
+inline void jacobiRotation(Scalar (&s_pp)[batch_lane_num], Scalar (&s_qq)[batch_lane_num], Scalar (&s_pq)[batch_lane_num],
+                           Scalar (&s_rp)[batch_lane_num], Scalar (&s_rq)[batch_lane_num], Scalar (&v)[Dim][Dim][batch_lane_num],
+                           unsigned int p, unsigned int q)
+{
+    Scalar c[batch_lane_num], s[batch_lane_num];
+    for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+    {
+        Scalar d = s_qq[lane] - s_pp[lane];
+        Scalar denominator = d + copysign(sqrt(d*d+4*s_pq[lane]*s_pq[lane]),d);
+        //tangent of rotation angle, zero if S is already diagonal
+        //the guard against zero denominator is an addition instead of a select such that the division is not moved into a branch
+        Scalar t = 2*s_pq[lane]/(denominator + static_cast<Scalar>(denominator == 0));
+        c[lane] = 1/sqrt(1+t*t);
+        s[lane] = t*c[lane];
+        s_pp[lane] -= t*s_pq[lane];
+        s_qq[lane] += t*s_pq[lane];
+        s_pq[lane] = 0;
+        Scalar s_rp_old = s_rp[lane];
+        s_rp[lane] = c[lane]*s_rp_old - s[lane]*s_rq[lane];
+        s_rq[lane] = s[lane]*s_rp_old + c[lane]*s_rq[lane];
+    }
+    for(unsigned int k = 0; k < Dim; ++k)
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+        {
+            Scalar v_kp = v[k][p][lane];
+            v[k][p][lane] = c[lane]*v_kp - s[lane]*v[k][q][lane];
+            v[k][q][lane] = s[lane]*v_kp + c[lane]*v[k][q][lane];
+        }
+}
+
+//swap columns i and j of B and V if column i of B is shorter than column j
+//one column is negated after swapping so that V remains a rotation
+template <typename Scalar, int Dim>
+inline void conditionalSwapColumns(Scalar (&b)[Dim][Dim][batch_lane_num], Scalar (&v)[Dim][Dim][batch_lane_num], Scalar (&norm_sqr)[Dim][batch_lane_num],
+                                   unsigned int i, unsigned int j)
+{
+    bool swap[batch_lane_num];
+    for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+    {
+        swap[lane] = norm_sqr[i][lane] < norm_sqr[j][lane];
+        Scalar norm_sqr_i = norm_sqr[i][lane], norm_sqr_j = norm_sqr[j][lane];
+        norm_sqr[i][lane] = swap[lane] ? norm_sqr_j : norm_sqr_i;
+        norm_sqr[j][lane] = swap[lane] ? norm_sqr_i : norm_sqr_j;
+    }
+    for(unsigned int k = 0; k < Dim; ++k)
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+        {
+            Scalar b_ki = b[k][i][lane], b_kj = b[k][j][lane];
+            b[k][i][lane] = swap[lane] ? b_kj : b_ki;
+            b[k][j][lane] = swap[lane] ? -b_ki : b_kj;
+            Scalar v_ki = v[k][i][lane], v_kj = v[k][j][lane];
+            v[k][i][lane] = swap[lane] ? v_kj : v_ki;
+            v[k][j][lane] = swap[lane] ? -v_ki : v_kj;
+        }
+}
+
+//Givens rotation on rows i and j of B that annihilates b_ji, b_ii becomes non-negative
+//the transpose of the rotation is accumulated to the columns of U
+template <typename Scalar, int Dim>
+inline void givensRotation(Scalar (&b)[Dim][Dim][batch_lane_num], Scalar (&u)[Dim][Dim][batch_lane_num], unsigned int i, unsigned int j)
+{
+    Scalar c[batch_lane_num], s[batch_lane_num];
+    for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+    {
+        Scalar rho = sqrt(b[i][i][lane]*b[i][i][lane]+b[j][i][lane]*b[j][i][lane]);
+        Scalar rho_inverse = 1/(rho + static_cast<Scalar>(rho == 0));
+        c[lane] = b[i][i][lane]*rho_inverse + static_cast<Scalar>(rho == 0);  //identity rotation if both entries are zero
+        s[lane] = b[j][i][lane]*rho_inverse;
+    }
+    for(unsigned int k = 0; k < Dim; ++k)
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+        {
+            Scalar b_ik = b[i][k][lane];
+            b[i][k][lane] = c[lane]*b_ik + s[lane]*b[j][k][lane];
+            b[j][k][lane] = -s[lane]*b_ik + c[lane]*b[j][k][lane];
+            Scalar u_ki = u[k][i][lane];
+            u[k][i][lane] = c[lane]*u_ki + s[lane]*u[k][j][lane];
+            u[k][j][lane] = -s[lane]*u_ki + c[lane]*u[k][j][lane];
+        }
+}
+
+//SVD of a block of matrices: F = U*diag(sigma)*V^T, with U and V rotations, |sigma| sorted in descending order and only the last sigma possibly negative
+//1. diagonalize F^T*F with Jacobi rotations to get V; 2. sort the columns of B = F*V by length; 3. QR decomposition of B with Givens rotations to get U and sigma
+template <typename Scalar, int Dim>
+void rotationalSVD(const Scalar (&f)[Dim][Dim][batch_lane_num], Scalar (&u)[Dim][Dim][batch_lane_num], Scalar (&sigma)[Dim][batch_lane_num], Scalar (&v)[Dim][Dim][batch_lane_num])
+{
+    //S = F^T*F
+    Scalar s[Dim][Dim][batch_lane_num];
+    for(unsigned int row = 0; row < Dim; ++row)
+        for(unsigned int col = row; col < Dim; ++col)
+        {
+            for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                s[row][col][lane] = 0;
+            for(unsigned int k = 0; k < Dim; ++k)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                    s[row][col][lane] += f[k][row][lane]*f[k][col][lane];
+        }
+    for(unsigned int row = 0; row < Dim; ++row)
+        for(unsigned int col = 0; col < Dim; ++col)
+            for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                v[row][col][lane] = u[row][col][lane] = (row == col) ? 1 : 0;
+    //upper triangle of S is used, s[r][p] and s[r][q] below are the entries (r,p) and (r,q)
+    if(Dim == 2)
+    {
+        Scalar dummy_rp[batch_lane_num], dummy_rq[batch_lane_num];
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            dummy_rp[lane] = dummy_rq[lane] = 0;
+        //one rotation diagonalizes a 2x2 symmetric matrix
+        jacobiRotation<Scalar,Dim>(s[0][0],s[1][1],s[0][1],dummy_rp,dummy_rq,v,0,1);
+    }
+    else
+    {
+        for(unsigned int sweep = 0; sweep < jacobi_sweep_num; ++sweep)
+        {
+            jacobiRotation<Scalar,Dim>(s[0][0],s[1][1],s[0][1],s[0][Dim-1],s[1][Dim-1],v,0,1);
+            jacobiRotation<Scalar,Dim>(s[0][0],s[Dim-1][Dim-1],s[0][Dim-1],s[0][1],s[1][Dim-1],v,0,Dim-1);
+            jacobiRotation<Scalar,Dim>(s[1][1],s[Dim-1][Dim-1],s[1][Dim-1],s[0][1],s[0][Dim-1],v,1,Dim-1);
+        }
+    }
+    //B = F*V, with columns sorted by length
+    Scalar b[Dim][Dim][batch_lane_num], norm_sqr[Dim][batch_lane_num];
+    for(unsigned int row = 0; row < Dim; ++row)
+        for(unsigned int col = 0; col < Dim; ++col)
+        {
+            for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                b[row][col][lane] = 0;
+            for(unsigned int k = 0; k < Dim; ++k)
+                for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                    b[row][col][lane] += f[row][k][lane]*v[k][col][lane];
+        }
+    for(unsigned int col = 0; col < Dim; ++col)
+    {
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            norm_sqr[col][lane] = 0;
+        for(unsigned int k = 0; k < Dim; ++k)
+            for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+                norm_sqr[col][lane] += b[k][col][lane]*b[k][col][lane];
+    }
+    for(unsigned int i = 0; i < Dim; ++i)
+        for(unsigned int j = i + 1; j < Dim; ++j)
+            conditionalSwapColumns<Scalar,Dim>(b,v,norm_sqr,i,j);
+    //B = U*R, the diagonal of R is sigma
+    for(unsigned int i = 0; i < Dim; ++i)
+        for(unsigned int j = i + 1; j < Dim; ++j)
+            givensRotation<Scalar,Dim>(b,u,i,j);
+    for(unsigned int i = 0; i < Dim; ++i)
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            sigma[i][lane] = b[i][i][lane];
+}
+
+//diagonalize the matrices in blocks of batch_lane_num, the entries of a block are stored lane by lane (structure of arrays)
+template <typename Scalar, int Dim>
+void batchRotationalSVD(const SquareMatrix<Scalar,Dim> *deform_grads, unsigned int count, SquareMatrix<Scalar,Dim> *left_rotations,
+                        SquareMatrix<Scalar,Dim> *diag_deform_grads, SquareMatrix<Scalar,Dim> *right_rotations)
+{
+    Scalar f[Dim][Dim][batch_lane_num], u[Dim][Dim][batch_lane_num], sigma[Dim][batch_lane_num], v[Dim][Dim][batch_lane_num];
+    for(unsigned int start = 0; start < count; start += batch_lane_num)
+    {
+        unsigned int lane_num = count - start < batch_lane_num ? count - start : batch_lane_num;
+        for(unsigned int lane = 0; lane < batch_lane_num; ++lane)
+            for(unsigned int row = 0; row < Dim; ++row)
+                for(unsigned int col = 0; col < Dim; ++col)
+                    f[row][col][lane] = lane < lane_num ? deform_grads[start+lane](row,col) : 0;  //pad the last block with zero matrices
+        rotationalSVD<Scalar,Dim>(f,u,sigma,v);
+        for(unsigned int lane = 0; lane < lane_num; ++lane)
+            for(unsigned int row = 0; row < Dim; ++row)
+                for(unsigned int col = 0; col < Dim; ++col)
+                {
+                    left_rotations[start+lane](row,col) = u[row][col][lane];
+                    diag_deform_grads[start+lane](row,col) = (row == col) ? sigma[row][lane] : 0;
+                    right_rotations[start+lane](row,col) = v[row][col][lane];
+                }
+    }
+}
+
+}  //end of namespace DeformationDiagonalizationInternal
+
+
 template <typename Scalar, int Dim>
 DeformationDiagonalization<Scalar,Dim>::DeformationDiagonalization()
     :epsilon_(std::numeric_limits<Scalar>::epsilon())
@@ -67,6 +257,17 @@ void DeformationDiagonalization<Scalar,Dim>::diagonalizeDeformationGradient(cons
     diagonalizationTrait(deform_grad,left_rotation,diag_deform_grad,right_rotation);
 }
       
+template <typename Scalar, int Dim>
+void DeformationDiagonalization<Scalar,Dim>::diagonalizeDeformationGradient(const SquareMatrix<Scalar,Dim> *deform_grads, unsigned int count,
+                                                                            SquareMatrix<Scalar,Dim> *left_rotations, SquareMatrix<Scalar,Dim> *diag_deform_grads,
+                                                                            SquareMatrix<Scalar,Dim> *right_rotations) const
+{
+    if(count == 0)
+        return;
+    PHYSIKA_ASSERT(deform_grads && left_rotations && diag_deform_grads && right_rotations);
+    batchDiagonalizationTrait(deform_grads,count,left_rotations,diag_deform_grads,right_rotations);
+}
+
 template <typename Scalar, int Dim>
 void DeformationDiagonalization<Scalar,Dim>::diagonalizationTrait(const SquareMatrix<Scalar,2> &deform_grad, SquareMatrix<Scalar,2> &left_rotation,
                                                                   SquareMatrix<Scalar,2> &diag_deform_grad, SquareMatrix<Scalar,2> &right_rotation) const
@@ -275,6 +476,20 @@ void DeformationDiagonalization<Scalar,Dim>::diagonalizationTrait(const SquareMa
     }
 }
 
+template <typename Scalar, int Dim>
+void DeformationDiagonalization<Scalar,Dim>::batchDiagonalizationTrait(const SquareMatrix<Scalar,2> *deform_grads, unsigned int count, SquareMatrix<Scalar,2> *left_rotations,
+                                                                       SquareMatrix<Scalar,2> *diag_deform_grads, SquareMatrix<Scalar,2> *right_rotations) const
+{
+    DeformationDiagonalizationInternal::batchRotationalSVD<Scalar,2>(deform_grads,count,left_rotations,diag_deform_grads,right_rotations);
+}
+
+template <typename Scalar, int Dim>
+void DeformationDiagonalization<Scalar,Dim>::batchDiagonalizationTrait(const SquareMatrix<Scalar,3> *deform_grads, unsigned int count, SquareMatrix<Scalar,3> *left_rotations,
+                                                                       SquareMatrix<Scalar,3> *diag_deform_grads, SquareMatrix<Scalar,3> *right_rotations) const
+{
+    DeformationDiagonalizationInternal::batchRotationalSVD<Scalar,3>(deform_grads,count,left_rotations,diag_deform_grads,right_rotations);
+}
+
 //explicit instantiations
 template class DeformationDiagonalization<float,2>;
 template class DeformationDiagonalization<float,3>;
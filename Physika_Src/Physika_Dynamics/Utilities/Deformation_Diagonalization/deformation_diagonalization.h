@@ -32,12 +32,22 @@ public:
     void setEpsilon(Scalar epsilon);
 	void diagonalizeDeformationGradient(const SquareMatrix<Scalar,Dim> &deform_grad, SquareMatrix<Scalar,Dim> &left_rotation,
 		                                SquareMatrix<Scalar,Dim> &diag_deform_grad, SquareMatrix<Scalar,Dim> &right_rotation) const;
+    //diagonalize a batch of count deformation gradients, with the same convention as above: the rotations have determinant 1,
+    //and the diagonal entry with smallest magnitude is negative if the deformation gradient is inverted
+    //the batch is processed in blocks with a branch-free Jacobi SVD (McAdams et al. 2011) instead of the eigen decomposition of F^T*F,
+    //such that the compiler can vectorize it across matrices of a block; the diagonal entries are sorted in descending order of magnitude
+    void diagonalizeDeformationGradient(const SquareMatrix<Scalar,Dim> *deform_grads, unsigned int count, SquareMatrix<Scalar,Dim> *left_rotations,
+                                        SquareMatrix<Scalar,Dim> *diag_deform_grads, SquareMatrix<Scalar,Dim> *right_rotations) const;
 protected:
     //trait method for different dimension
 	void diagonalizationTrait(const SquareMatrix<Scalar,2> &deform_grad, SquareMatrix<Scalar,2> &left_rotation,
                               SquareMatrix<Scalar,2> &diag_deform_grad, SquareMatrix<Scalar,2> &right_rotation) const;
 	void diagonalizationTrait(const SquareMatrix<Scalar,3> &deform_grad, SquareMatrix<Scalar,3> &left_rotation,
                               SquareMatrix<Scalar,3> &diag_deform_grad, SquareMatrix<Scalar,3> &right_rotation) const;
+	void batchDiagonalizationTrait(const SquareMatrix<Scalar,2> *deform_grads, unsigned int count, SquareMatrix<Scalar,2> *left_rotations,
+                                   SquareMatrix<Scalar,2> *diag_deform_grads, SquareMatrix<Scalar,2> *right_rotations) const;
+	void batchDiagonalizationTrait(const SquareMatrix<Scalar,3> *deform_grads, unsigned int count, SquareMatrix<Scalar,3> *left_rotations,
+                                   SquareMatrix<Scalar,3> *diag_deform_grads, SquareMatrix<Scalar,3> *right_rotations) const;
 protected:
     Scalar epsilon_; //the epsilon value used to determine if some value is close to zero
 };
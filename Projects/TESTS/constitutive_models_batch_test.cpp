@@ -0,0 +1,127 @@
+/*
+ * @file constitutive_models_batch_test.cpp
+ * @brief Test the batch evaluation of energy and stresses of constitutive models against the evaluation of one deformation gradient at a time.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include "Physika_Core/Matrices/matrix_2x2.h"
+#include "Physika_Core/Matrices/matrix_3x3.h"
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Dynamics/Constitutive_Models/neo_hookean.h"
+#include "Physika_Dynamics/Constitutive_Models/st_venant_kirchhoff.h"
+#include "Physika_Dynamics/Constitutive_Models/isotropic_linear_elasticity.h"
+using namespace std;
+using namespace Physika;
+
+template <typename Scalar>
+Scalar randomScalar(Scalar min_value, Scalar max_value)
+{
+    return min_value + (max_value-min_value)*static_cast<Scalar>(rand())/RAND_MAX;
+}
+
+template <typename Scalar, int Dim>
+Scalar maxEntryMagnitude(const SquareMatrix<Scalar,Dim> &matrix)
+{
+    Scalar max_magnitude = 0;
+    for(unsigned int row = 0; row < Dim; ++row)
+        for(unsigned int col = 0; col < Dim; ++col)
+            max_magnitude = max(max_magnitude,static_cast<Scalar>(fabs(matrix(row,col))));
+    return max_magnitude;
+}
+
+//relative difference between the batch results and the results of one by one evaluation, scaled by volume if volumes is not NULL
+template <typename Scalar, int Dim>
+Scalar maxRelativeDifference(const vector<SquareMatrix<Scalar,Dim> > &single, const vector<SquareMatrix<Scalar,Dim> > &batch, const Scalar *volumes)
+{
+    Scalar max_difference = 0;
+    for(unsigned int i = 0; i < single.size(); ++i)
+    {
+        SquareMatrix<Scalar,Dim> reference = volumes ? volumes[i]*single[i] : single[i];
+        Scalar scale = max(maxEntryMagnitude(reference),static_cast<Scalar>(1));
+        max_difference = max(max_difference,maxEntryMagnitude(SquareMatrix<Scalar,Dim>(batch[i]-reference))/scale);
+    }
+    return max_difference;
+}
+
+template <typename Scalar, int Dim>
+void testModel(const char *model_name, const char *type_name, const ConstitutiveModel<Scalar,Dim> &model,
+               const vector<SquareMatrix<Scalar,Dim> > &deform_grads, const vector<Scalar> &volumes, Scalar tolerance)
+{
+    unsigned int count = deform_grads.size();
+    vector<Scalar> energy(count), batch_energy(count);
+    vector<SquareMatrix<Scalar,Dim> > P(count), sigma(count), batch_P(count), batch_sigma(count), batch_weighted_P(count), batch_weighted_sigma(count);
+    Timer timer;
+    timer.startTimer();
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        P[i] = model.firstPiolaKirchhoffStress(deform_grads[i]);
+        sigma[i] = model.cauchyStress(deform_grads[i]);
+    }
+    timer.stopTimer();
+    double single_time = timer.getElapsedTime();
+    timer.startTimer();
+    model.batchFirstPiolaKirchhoffStress(&deform_grads[0],NULL,count,&batch_P[0]);
+    model.batchCauchyStress(&deform_grads[0],NULL,count,&batch_sigma[0]);
+    timer.stopTimer();
+    double batch_time = timer.getElapsedTime();
+    for(unsigned int i = 0; i < count; ++i)
+        energy[i] = model.energy(deform_grads[i]);
+    model.batchEnergy(&deform_grads[0],count,&batch_energy[0]);
+    model.batchFirstPiolaKirchhoffStress(&deform_grads[0],&volumes[0],count,&batch_weighted_P[0]);
+    model.batchCauchyStress(&deform_grads[0],&volumes[0],count,&batch_weighted_sigma[0]);
+    Scalar energy_difference = 0;
+    for(unsigned int i = 0; i < count; ++i)
+        energy_difference = max(energy_difference,static_cast<Scalar>(fabs(batch_energy[i]-energy[i]))/max(static_cast<Scalar>(fabs(energy[i])),static_cast<Scalar>(1)));
+    Scalar P_difference = max(maxRelativeDifference(P,batch_P,static_cast<const Scalar*>(NULL)),maxRelativeDifference(P,batch_weighted_P,&volumes[0]));
+    Scalar sigma_difference = max(maxRelativeDifference(sigma,batch_sigma,static_cast<const Scalar*>(NULL)),maxRelativeDifference(sigma,batch_weighted_sigma,&volumes[0]));
+    bool passed = energy_difference < tolerance && P_difference < tolerance && sigma_difference < tolerance;
+    cout<<Dim<<"D "<<type_name<<" "<<model_name<<", "<<count<<" matrices: P and sigma one by one "<<single_time<<" s, batch "<<batch_time
+        <<" s ("<<single_time/batch_time<<"x)\n";
+    cout<<"    max relative difference: energy "<<energy_difference<<", P "<<P_difference<<", sigma "<<sigma_difference<<": "<<(passed?"PASSED":"FAILED")<<"\n";
+}
+
+template <typename Scalar, int Dim>
+void testBatch(const char *type_name, unsigned int count, Scalar tolerance)
+{
+    //deformation gradients not far from identity such that det(F) > 0, and random volumes
+    vector<SquareMatrix<Scalar,Dim> > deform_grads(count);
+    vector<Scalar> volumes(count);
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                deform_grads[i](row,col) = (row == col ? 1 : 0) + randomScalar<Scalar>(-0.3,0.3);
+        volumes[i] = randomScalar<Scalar>(0.5,2.0);
+    }
+    Scalar lambda = 2.0, mu = 1.0;
+    NeoHookean<Scalar,Dim> neo_hookean(lambda,mu,IsotropicHyperelasticMaterialInternal::LAME_COEFFICIENTS);
+    StVK<Scalar,Dim> stvk(lambda,mu,IsotropicHyperelasticMaterialInternal::LAME_COEFFICIENTS);
+    IsotropicLinearElasticity<Scalar,Dim> linear(lambda,mu,IsotropicHyperelasticMaterialInternal::LAME_COEFFICIENTS);
+    testModel<Scalar,Dim>("NeoHookean",type_name,neo_hookean,deform_grads,volumes,tolerance);
+    testModel<Scalar,Dim>("StVK",type_name,stvk,deform_grads,volumes,tolerance);
+    testModel<Scalar,Dim>("IsotropicLinearElasticity",type_name,linear,deform_grads,volumes,tolerance);
+}
+
+int main()
+{
+    srand(0);
+    unsigned int count = 200003;  //not a multiple of the block size
+    testBatch<float,2>("float",count,1.0e-5f);
+    testBatch<double,2>("double",count,1.0e-12);
+    testBatch<float,3>("float",count,1.0e-5f);
+    testBatch<double,3>("double",count,1.0e-12);
+    return 0;
+}
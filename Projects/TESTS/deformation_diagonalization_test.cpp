@@ -0,0 +1,152 @@
+/*
+ * @file deformation_diagonalization_test.cpp
+ * @brief Test the batched diagonalization of deformation gradients against the diagonalization of one deformation gradient at a time.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include "Physika_Core/Matrices/matrix_2x2.h"
+#include "Physika_Core/Matrices/matrix_3x3.h"
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Dynamics/Utilities/Deformation_Diagonalization/deformation_diagonalization.h"
+using namespace std;
+using namespace Physika;
+
+template <typename Scalar>
+Scalar randomScalar(Scalar min_value, Scalar max_value)
+{
+    return min_value + (max_value-min_value)*static_cast<Scalar>(rand())/RAND_MAX;
+}
+
+//deformation gradients of different kinds: random, inverted, near singular, degenerated, zero and identity
+template <typename Scalar, int Dim>
+void generateDeformationGradients(unsigned int count, vector<SquareMatrix<Scalar,Dim> > &deform_grads)
+{
+    deform_grads.resize(count);
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        SquareMatrix<Scalar,Dim> &F = deform_grads[i];
+        for(unsigned int row = 0; row < Dim; ++row)
+            for(unsigned int col = 0; col < Dim; ++col)
+                F(row,col) = (row == col ? 1 : 0) + randomScalar<Scalar>(-0.5,0.5);
+        switch(i%6)
+        {
+        case 1:  //inverted
+            for(unsigned int col = 0; col < Dim; ++col)
+                F(0,col) *= -1;
+            break;
+        case 2:  //near singular: the last row almost equals the first one
+            for(unsigned int col = 0; col < Dim; ++col)
+                F(Dim-1,col) = F(0,col) + randomScalar<Scalar>(-1.0e-4,1.0e-4);
+            break;
+        case 3:  //collapsed to a plane/line
+            for(unsigned int col = 0; col < Dim; ++col)
+                F(Dim-1,col) = 0;
+            break;
+        case 4:
+            F = i%12 == 4 ? SquareMatrix<Scalar,Dim>(0) : SquareMatrix<Scalar,Dim>::identityMatrix();
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+template <typename Scalar, int Dim>
+Scalar maxEntryMagnitude(const SquareMatrix<Scalar,Dim> &matrix)
+{
+    Scalar max_magnitude = 0;
+    for(unsigned int row = 0; row < Dim; ++row)
+        for(unsigned int col = 0; col < Dim; ++col)
+            max_magnitude = max(max_magnitude,static_cast<Scalar>(fabs(matrix(row,col))));
+    return max_magnitude;
+}
+
+//singular values in descending order of magnitude, the sign of their product is the sign of det(F)
+template <typename Scalar, int Dim>
+void sortedSingularValues(const SquareMatrix<Scalar,Dim> &diag_deform_grad, vector<Scalar> &singular_values)
+{
+    singular_values.resize(Dim);
+    for(unsigned int i = 0; i < Dim; ++i)
+        singular_values[i] = fabs(diag_deform_grad(i,i));
+    sort(singular_values.begin(),singular_values.end(),greater<Scalar>());
+}
+
+template <typename Scalar, int Dim>
+void testDiagonalization(const char *type_name, unsigned int count, Scalar tolerance)
+{
+    vector<SquareMatrix<Scalar,Dim> > deform_grads;
+    generateDeformationGradients<Scalar,Dim>(count,deform_grads);
+    DeformationDiagonalization<Scalar,Dim> diagonalizer;
+    vector<SquareMatrix<Scalar,Dim> > U(count), S(count), V(count), batch_U(count), batch_S(count), batch_V(count);
+    Timer timer;
+    timer.startTimer();
+    for(unsigned int i = 0; i < count; ++i)
+        diagonalizer.diagonalizeDeformationGradient(deform_grads[i],U[i],S[i],V[i]);
+    timer.stopTimer();
+    double single_time = timer.getElapsedTime();
+    timer.startTimer();
+    diagonalizer.diagonalizeDeformationGradient(&deform_grads[0],count,&batch_U[0],&batch_S[0],&batch_V[0]);
+    timer.stopTimer();
+    double batch_time = timer.getElapsedTime();
+    //accuracy of the batched diagonalization, and its difference to the singular values of one by one diagonalization
+    Scalar max_reconstruction_error = 0, max_orthogonality_error = 0, max_singular_value_difference = 0, max_reference_reconstruction_error = 0;
+    bool valid_convention = true;
+    vector<Scalar> singular_values, batch_singular_values;
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        const SquareMatrix<Scalar,Dim> &F = deform_grads[i];
+        Scalar scale = max(maxEntryMagnitude(F),static_cast<Scalar>(1));
+        max_reconstruction_error = max(max_reconstruction_error,maxEntryMagnitude(SquareMatrix<Scalar,Dim>(batch_U[i]*batch_S[i]*batch_V[i].transpose()-F))/scale);
+        max_reference_reconstruction_error = max(max_reference_reconstruction_error,maxEntryMagnitude(SquareMatrix<Scalar,Dim>(U[i]*S[i]*V[i].transpose()-F))/scale);
+        max_orthogonality_error = max(max_orthogonality_error,maxEntryMagnitude(SquareMatrix<Scalar,Dim>(batch_U[i]*batch_U[i].transpose()-SquareMatrix<Scalar,Dim>::identityMatrix())));
+        max_orthogonality_error = max(max_orthogonality_error,maxEntryMagnitude(SquareMatrix<Scalar,Dim>(batch_V[i]*batch_V[i].transpose()-SquareMatrix<Scalar,Dim>::identityMatrix())));
+        sortedSingularValues(S[i],singular_values);
+        sortedSingularValues(batch_S[i],batch_singular_values);
+        for(unsigned int j = 0; j < Dim; ++j)
+            max_singular_value_difference = max(max_singular_value_difference,static_cast<Scalar>(fabs(singular_values[j]-batch_singular_values[j]))/scale);
+        //rotations, sorted diagonal, only the smallest entry may be negative, and it is negative if F is inverted
+        if(batch_U[i].determinant() < 0 || batch_V[i].determinant() < 0)
+            valid_convention = false;
+        for(unsigned int j = 0; j < Dim; ++j)
+        {
+            if(j + 1 < Dim && (batch_S[i](j,j) < 0 || batch_S[i](j,j) < fabs(batch_S[i](j+1,j+1))))
+                valid_convention = false;
+            for(unsigned int k = 0; k < Dim; ++k)
+                if(j != k && batch_S[i](j,k) != 0)
+                    valid_convention = false;
+        }
+        if(F.determinant() < -tolerance && batch_S[i](Dim-1,Dim-1) >= 0)
+            valid_convention = false;
+    }
+    //the singular values from the eigen values of F^T*F lose half of the precision for near singular F, their difference is only reported
+    bool passed = valid_convention && max_reconstruction_error < tolerance && max_orthogonality_error < tolerance;
+    cout<<Dim<<"D "<<type_name<<", "<<count<<" matrices: one by one "<<single_time<<" s, batch "<<batch_time<<" s ("<<single_time/batch_time<<"x)\n";
+    cout<<"    max error of batch: reconstruction "<<max_reconstruction_error<<" (one by one: "<<max_reference_reconstruction_error<<"), orthogonality "
+        <<max_orthogonality_error<<", singular value difference to one by one "<<max_singular_value_difference<<", sign convention "<<(valid_convention?"valid":"INVALID")
+        <<": "<<(passed?"PASSED":"FAILED")<<"\n";
+}
+
+int main()
+{
+    srand(0);
+    unsigned int count = 100003;  //not a multiple of the block size
+    testDiagonalization<float,2>("float",count,1.0e-4f);
+    testDiagonalization<double,2>("double",count,1.0e-10);
+    testDiagonalization<float,3>("float",count,1.0e-4f);
+    testDiagonalization<double,3>("double",count,1.0e-10);
+    return 0;
+}
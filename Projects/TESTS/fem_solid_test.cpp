@@ -0,0 +1,277 @@
+/*
+ * @file fem_solid_test.cpp
+ * @brief Test the explicit and implicit time integration of FEMSolid.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include "Physika_Core/Vectors/vector_2d.h"
+#include "Physika_Core/Vectors/vector_3d.h"
+#include "Physika_Core/Matrices/matrix_3x3.h"
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Geometry/Volumetric_Meshes/tri_mesh.h"
+#include "Physika_Geometry/Volumetric_Meshes/tet_mesh.h"
+#include "Physika_IO/Volumetric_Mesh_IO/volumetric_mesh_io.h"
+#include "Physika_Dynamics/Constitutive_Models/neo_hookean.h"
+#include "Physika_Dynamics/Constitutive_Models/isotropic_linear_elasticity.h"
+#include "Physika_Dynamics/FEM/fem_solid.h"
+using namespace std;
+using namespace Physika;
+
+//beam of nx*ny*nz cubes with edge length h along x axis, 6 tets per cube
+TetMesh<double> beamMesh(unsigned int nx, unsigned int ny, unsigned int nz, double h)
+{
+    vector<double> vertices;
+    for(unsigned int i = 0; i <= nx; ++i)
+        for(unsigned int j = 0; j <= ny; ++j)
+            for(unsigned int k = 0; k <= nz; ++k)
+            {
+                vertices.push_back(i*h);
+                vertices.push_back(j*h);
+                vertices.push_back(k*h);
+            }
+    vector<unsigned int> elements;
+    const unsigned int tets[6][4] = {{0,1,3,7},{0,1,5,7},{0,2,3,7},{0,2,6,7},{0,4,5,7},{0,4,6,7}};
+    for(unsigned int i = 0; i < nx; ++i)
+        for(unsigned int j = 0; j < ny; ++j)
+            for(unsigned int k = 0; k < nz; ++k)
+                for(unsigned int tet = 0; tet < 6; ++tet)
+                    for(unsigned int a = 0; a < 4; ++a)
+                    {
+                        unsigned int corner = tets[tet][a];
+                        unsigned int ci = i+corner/4, cj = j+(corner/2)%2, ck = k+corner%2;
+                        elements.push_back((ci*(ny+1)+cj)*(nz+1)+ck);
+                    }
+    return TetMesh<double>(vertices.size()/3,&vertices[0],elements.size()/4,&elements[0]);
+}
+
+void fixBeamEnd(FEMSolid<double,3> &solid)
+{
+    for(unsigned int i = 0; i < solid.numSimVertices(); ++i)
+        if(solid.vertexRestPosition(i)[0] == 0)
+            solid.addDirichletVertex(i);
+}
+
+Vector<double,3> totalMomentum(const FEMSolid<double,3> &solid)
+{
+    Vector<double,3> momentum(0);
+    for(unsigned int i = 0; i < solid.numSimVertices(); ++i)
+        momentum += solid.vertexVelocity(i)*solid.vertexMass(i);
+    return momentum;
+}
+
+double maxVelocityNorm(const FEMSolid<double,3> &solid)
+{
+    double max_norm = 0;
+    for(unsigned int i = 0; i < solid.numSimVertices(); ++i)
+        max_norm = max(max_norm,solid.vertexVelocity(i).norm());
+    return max_norm;
+}
+
+bool isFinite(const FEMSolid<double,3> &solid)
+{
+    for(unsigned int i = 0; i < solid.numSimVertices(); ++i)
+        for(unsigned int d = 0; d < 3; ++d)
+            if(!(fabs(solid.vertexDisplacement(i)[d]) < 1.0e10))
+                return false;
+    return true;
+}
+
+//tip displacement along y of the beam, averaged over the vertices of the free end
+double tipDeflection(const FEMSolid<double,3> &solid, double length)
+{
+    double sum = 0;
+    unsigned int num = 0;
+    for(unsigned int i = 0; i < solid.numSimVertices(); ++i)
+        if(solid.vertexRestPosition(i)[0] == length)
+        {
+            sum += solid.vertexDisplacement(i)[1];
+            ++num;
+        }
+    return sum/num;
+}
+
+void printResult(const char *name, bool passed)
+{
+    cout<<name<<": "<<(passed ? "PASSED" : "FAILED")<<"\n";
+}
+
+int main()
+{
+    const double youngs_modulus = 1.0e5, poisson_ratio = 0.3;
+    NeoHookean<double,3> neo_hookean(youngs_modulus,poisson_ratio,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+    //stiff material for the static equilibrium of linear elasticity with small deformation
+    IsotropicLinearElasticity<double,3> linear_elasticity(1.0e7,poisson_ratio,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+
+    //precomputed element data: volume, mass and identity deformation gradient at rest
+    {
+        TetMesh<double> mesh = beamMesh(2,1,1,0.5);
+        FEMSolid<double,3> solid(0,1,30,0.01,false,mesh);
+        solid.setHomogeneousMaterial(neo_hookean);
+        solid.initSimulationData();
+        double total_mass = 0;
+        for(unsigned int i = 0; i < solid.numSimVertices(); ++i)
+            total_mass += solid.vertexMass(i);
+        printResult("Lumped mass",fabs(total_mass-1000*0.5*0.5*0.5*2) < 1.0e-8);
+        solid.setGravity(0);
+        solid.advanceStep(0.01);
+        printResult("Zero force at rest",maxVelocityNorm(solid) < 1.0e-12);
+        float tri_vertices[6] = {0,0,2,0,0,1};
+        unsigned int tri_element[3] = {0,1,2};
+        TriMesh<float> tri_mesh(3,tri_vertices,1,tri_element);
+        FEMSolid<float,2> tri_solid(0,1,30,0.01f,false,tri_mesh);
+        tri_solid.setHomogeneousMaterial(NeoHookean<float,2>(1.0e5f,0.3f,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON));
+        tri_solid.initSimulationData();
+        printResult("Lumped mass of triangle",fabs(tri_solid.vertexMass(0)+tri_solid.vertexMass(1)+tri_solid.vertexMass(2)-1000) < 1.0e-2);
+    }
+
+    //free-floating deformed body: elastic forces conserve linear momentum
+    {
+        TetMesh<double> mesh = beamMesh(4,2,2,0.1);
+        FEMSolid<double,3> solid(0,1,30,0.01,false,mesh);
+        solid.setHomogeneousMaterial(neo_hookean);
+        solid.setGravity(0);
+        srand(5);
+        for(unsigned int i = 0; i < solid.numSimVertices(); ++i)
+            solid.setVertexDisplacement(i,Vector<double,3>(rand(),rand(),rand())*(0.02/RAND_MAX));
+        FEMSolid<double,3> implicit_solid(0,1,30,0.01,false,mesh);
+        implicit_solid.setHomogeneousMaterial(neo_hookean);
+        implicit_solid.setGravity(0);
+        implicit_solid.setTimeIntegrationMethod(FEMSolid<double,3>::BACKWARD_EULER);
+        implicit_solid.linearSolver().setTolerance(1.0e-10);
+        for(unsigned int i = 0; i < solid.numSimVertices(); ++i)
+            implicit_solid.setVertexDisplacement(i,solid.vertexDisplacement(i));
+        for(unsigned int step = 0; step < 10; ++step)
+        {
+            solid.advanceStep(solid.computeTimeStep());
+            implicit_solid.advanceStep(0.01);
+        }
+        printResult("Momentum conservation, forward Euler",totalMomentum(solid).norm() < 1.0e-9);
+        printResult("Momentum conservation, backward Euler",totalMomentum(implicit_solid).norm() < 1.0e-6);
+    }
+
+    //results don't depend on the number of threads
+    {
+        TetMesh<double> mesh = beamMesh(6,2,2,0.1);
+        FEMSolid<double,3> single_thread(0,1,30,0.01,false,mesh), multi_thread(0,1,30,0.01,false,mesh);
+        single_thread.setHomogeneousMaterial(neo_hookean);
+        multi_thread.setHomogeneousMaterial(neo_hookean);
+        single_thread.setThreadNum(1);
+        multi_thread.setThreadNum(4);
+        fixBeamEnd(single_thread);
+        fixBeamEnd(multi_thread);
+        double dt = single_thread.computeTimeStep();
+        for(unsigned int step = 0; step < 50; ++step)
+        {
+            single_thread.advanceStep(dt);
+            multi_thread.advanceStep(dt);
+        }
+        bool identical = true;
+        for(unsigned int i = 0; i < mesh.vertNum(); ++i)
+            identical = identical && single_thread.vertexDisplacement(i) == multi_thread.vertexDisplacement(i);
+        printResult("Thread number independence",identical);
+    }
+
+    //cantilever beam under gravity: backward Euler with large time step settles to static equilibrium,
+    //which agrees with the damped-out forward Euler solution
+    {
+        const double length = 1.0;
+        TetMesh<double> mesh = beamMesh(10,2,2,0.1);
+        FEMSolid<double,3> implicit_solid(0,1,30,0.02,false,mesh);
+        implicit_solid.setHomogeneousMaterial(linear_elasticity);
+        implicit_solid.setTimeIntegrationMethod(FEMSolid<double,3>::BACKWARD_EULER);
+        fixBeamEnd(implicit_solid);
+        for(unsigned int step = 0; step < 300; ++step)
+            implicit_solid.advanceStep(0.02);
+        double implicit_deflection = tipDeflection(implicit_solid,length);
+        //residual of static equilibrium: one explicit step from rest changes the velocity by dt*(f/m+g)
+        FEMSolid<double,3> check_solid(0,1,30,0.02,false,mesh);
+        check_solid.setHomogeneousMaterial(linear_elasticity);
+        fixBeamEnd(check_solid);
+        for(unsigned int i = 0; i < mesh.vertNum(); ++i)
+            check_solid.setVertexDisplacement(i,implicit_solid.vertexDisplacement(i));
+        double dt = 1.0e-6;
+        check_solid.advanceStep(dt);
+        double acceleration = maxVelocityNorm(check_solid)/dt;
+        printResult("Backward Euler stable with large time step",isFinite(implicit_solid) && implicit_deflection < 0);
+        printResult("Backward Euler static equilibrium",acceleration < 0.05*9.8);
+        cout<<"Tip deflection "<<implicit_deflection<<", equilibrium acceleration "<<acceleration<<"\n";
+    }
+
+    //backward Euler with too few CG iterations: the partial solutions still give a stable result
+    {
+        TetMesh<double> mesh = beamMesh(10,2,2,0.1);
+        FEMSolid<double,3> solid(0,1,30,0.02,false,mesh);
+        solid.setHomogeneousMaterial(linear_elasticity);
+        solid.setTimeIntegrationMethod(FEMSolid<double,3>::BACKWARD_EULER);
+        solid.linearSolver().setMaxIterationNum(3);
+        fixBeamEnd(solid);
+        for(unsigned int step = 0; step < 20; ++step)
+            solid.advanceStep(0.02);
+        printResult("Backward Euler with unconverged linear solve",isFinite(solid) && !solid.linearSolver().isConverged() && tipDeflection(solid,1.0) < 0);
+    }
+
+    //explicit integration with the CFL time step stays bounded
+    {
+        TetMesh<double> mesh = beamMesh(10,2,2,0.1);
+        FEMSolid<double,3> solid(0,1,30,0.02,false,mesh);
+        solid.setHomogeneousMaterial(neo_hookean);
+        fixBeamEnd(solid);
+        double dt = solid.computeTimeStep();
+        double max_velocity = 0;
+        for(unsigned int step = 0; step < 2000; ++step)
+        {
+            solid.advanceStep(dt);
+            max_velocity = max(max_velocity,maxVelocityNorm(solid));
+        }
+        printResult("Forward Euler stable with CFL time step",isFinite(solid) && max_velocity < 10);
+        cout<<"CFL time step "<<dt<<", max velocity "<<max_velocity<<"\n";
+    }
+
+    //simulation mesh loaded through VolumetricMeshIO, timing of large mesh
+    {
+        TetMesh<double> mesh = beamMesh(40,10,10,0.025);
+        const string file_name("fem_solid_test_beam.smesh");
+        if(VolumetricMeshIO<double,3>::save(file_name,&mesh))
+        {
+            FEMSolid<double,3> solid(0,1,30,0.02,false);
+            solid.loadSimulationMesh(file_name);
+            solid.setHomogeneousMaterial(neo_hookean);
+            fixBeamEnd(solid);
+            remove(file_name.c_str());
+            printResult("Load simulation mesh",solid.numSimElements() == mesh.eleNum() && solid.numSimVertices() == mesh.vertNum());
+            Timer timer;
+            solid.initSimulationData();
+            unsigned int explicit_steps = 50, implicit_steps = 5;
+            double dt = solid.computeTimeStep();
+            timer.startTimer();
+            for(unsigned int step = 0; step < explicit_steps; ++step)
+                solid.advanceStep(dt);
+            timer.stopTimer();
+            double explicit_time = timer.getElapsedTime()/explicit_steps;
+            solid.setTimeIntegrationMethod(FEMSolid<double,3>::BACKWARD_EULER);
+            timer.startTimer();
+            for(unsigned int step = 0; step < implicit_steps; ++step)
+                solid.advanceStep(1.0/30);
+            timer.stopTimer();
+            double implicit_time = timer.getElapsedTime()/implicit_steps;
+            cout<<mesh.eleNum()<<" tets, "<<mesh.vertNum()<<" vertices: forward Euler "<<explicit_time<<" s/step (dt "<<dt
+                <<"), backward Euler "<<implicit_time<<" s/step (dt "<<1.0/30<<", "<<solid.linearSolver().iterationNum()<<" CG iterations in last solve)\n";
+        }
+        else
+            printResult("Load simulation mesh",false);
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * @file grid_weight_function_kernel_test.cpp
+ * @brief Test and benchmark statically dispatched evaluation of grid-based weight functions.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "Physika_Core/Vectors/vector_3d.h"
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_weight_function.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_linear_weight_functions.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_quadratic_weight_functions.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_cubic_weight_functions.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_weight_function_kernel.h"
+using namespace std;
+using namespace Physika;
+
+#define PARTICLE_NUM 1000000
+#define STRIDE 5
+
+//the per-axis factors of all particles, the nodes in range along each axis are [floor(x-R), floor(x+R)]
+template <typename GridWeightFunctionType>
+double evaluate(const GridWeightFunction<double,3> &weight_function, const vector<Vector<double,3> > &positions,
+                vector<double> &weights, vector<double> &gradients)
+{
+    Timer timer;
+    timer.startTimer();
+    double radius = weight_function.supportRadius();
+    for(unsigned int i = 0; i < positions.size(); ++i)
+    {
+        Vector<double,3> center_to_first_node;
+        Vector<unsigned int,3> node_num;
+        for(unsigned int j = 0; j < 3; ++j)
+        {
+            double first_node = floor(positions[i][j]-radius) + 1;
+            center_to_first_node[j] = positions[i][j] - first_node;
+            node_num[j] = static_cast<unsigned int>(floor(positions[i][j]+radius) - first_node) + 1;
+        }
+        GridWeightFunctionKernel<GridWeightFunctionType>::axisWeightsAndGradients(weight_function,center_to_first_node,node_num,STRIDE,
+                                                                                  &weights[i*3*STRIDE],&gradients[i*3*STRIDE]);
+    }
+    timer.stopTimer();
+    return timer.getElapsedTime();
+}
+
+//the weights and gradients of all nodes in range evaluated with virtual weight() and gradient(), as done before the 1D factors are exposed
+double evaluateFull(const GridWeightFunction<double,3> &weight_function, const vector<Vector<double,3> > &positions, double &checksum)
+{
+    Timer timer;
+    timer.startTimer();
+    double radius = weight_function.supportRadius();
+    checksum = 0;
+    for(unsigned int i = 0; i < positions.size(); ++i)
+    {
+        Vector<double,3> first_node;
+        for(unsigned int j = 0; j < 3; ++j)
+            first_node[j] = floor(positions[i][j]-radius) + 1;
+        for(double x = first_node[0]; x <= positions[i][0]+radius; x += 1)
+            for(double y = first_node[1]; y <= positions[i][1]+radius; y += 1)
+                for(double z = first_node[2]; z <= positions[i][2]+radius; z += 1)
+                {
+                    Vector<double,3> center_to_x = positions[i] - Vector<double,3>(x,y,z);
+                    checksum += weight_function.weight(center_to_x) + weight_function.gradient(center_to_x)[0];
+                }
+    }
+    timer.stopTimer();
+    return timer.getElapsedTime();
+}
+
+template <typename GridWeightFunctionType>
+void benchmark(const char *name, const vector<Vector<double,3> > &positions)
+{
+    GridWeightFunctionType weight_function;
+    vector<double> virtual_weights(positions.size()*3*STRIDE,0), virtual_gradients(positions.size()*3*STRIDE,0);
+    vector<double> static_weights(positions.size()*3*STRIDE,0), static_gradients(positions.size()*3*STRIDE,0);
+    double checksum = 0;
+    double full_time = evaluateFull(weight_function,positions,checksum);
+    double virtual_time = evaluate<GridWeightFunction<double,3> >(weight_function,positions,virtual_weights,virtual_gradients);
+    double static_time = evaluate<GridWeightFunctionType>(weight_function,positions,static_weights,static_gradients);
+    bool same = (virtual_weights == static_weights) && (virtual_gradients == static_gradients);
+    cout<<name<<":\n";
+    cout<<"  static kernel matches virtual call: "<<(same?"yes":"NO")<<"\n";
+    cout<<"  weight()/gradient() of each node: "<<full_time<<" s (checksum "<<checksum<<")\n";
+    cout<<"  batched 1D factors, virtual: "<<virtual_time<<" s\n";
+    cout<<"  batched 1D factors, static: "<<static_time<<" s, speedup over virtual: "<<virtual_time/static_time<<"\n";
+}
+
+int main()
+{
+    vector<Vector<double,3> > positions(PARTICLE_NUM);
+    srand(0);
+    for(unsigned int i = 0; i < PARTICLE_NUM; ++i)
+        for(unsigned int j = 0; j < 3; ++j)
+            positions[i][j] = 100.0*rand()/RAND_MAX;
+    benchmark<GridLinearWeightFunction<double,3> >("GridLinearWeightFunction",positions);
+    benchmark<GridQuadraticBSpline<double,3> >("GridQuadraticBSpline",positions);
+    benchmark<GridPiecewiseCubicSpline<double,3> >("GridPiecewiseCubicSpline",positions);
+    return 0;
+}
@@ -0,0 +1,272 @@
+/*
+ * @file linear_solvers_test.cpp
+ * @brief Test the iterative linear solvers and preconditioners on FEM-sized laplacian and elasticity matrices,
+ *        and compare the solve time with Eigen.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <string>
+#include <iostream>
+#include <vector>
+#include "Physika_Dependency/Eigen/Sparse"
+#include "Physika_Core/Vectors/vector_3d.h"
+#include "Physika_Core/Vectors/vector_Nd.h"
+#include "Physika_Core/Matrices/matrix_3x3.h"
+#include "Physika_Core/Matrices/sparse_matrix.h"
+#include "Physika_Core/Matrices/sparse_matrix_builder.h"
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Core/Linear_Solvers/conjugate_gradient_solver.h"
+#include "Physika_Core/Linear_Solvers/minres_solver.h"
+#include "Physika_Core/Linear_Solvers/bicgstab_solver.h"
+#include "Physika_Core/Linear_Solvers/jacobi_preconditioner.h"
+#include "Physika_Core/Linear_Solvers/block_jacobi_preconditioner.h"
+#include "Physika_Core/Linear_Solvers/incomplete_cholesky_preconditioner.h"
+using namespace std;
+using namespace Physika;
+
+//7-point laplacian of a res^3 grid with Dirichlet boundary, shifted by -shift*I
+void laplacianMatrix(unsigned int res, double shift, SparseMatrix<double> &matrix)
+{
+    unsigned int node_num = res*res*res;
+    SparseMatrixBuilder<double> builder(node_num,node_num,1);
+    for(unsigned int i = 0; i < res; ++i)
+        for(unsigned int j = 0; j < res; ++j)
+            for(unsigned int k = 0; k < res; ++k)
+            {
+                unsigned int node = (i*res+j)*res+k;
+                builder.addEntry(node,node,6-shift);
+                if(i > 0) builder.addEntry(node,node-res*res,-1);
+                if(i+1 < res) builder.addEntry(node,node+res*res,-1);
+                if(j > 0) builder.addEntry(node,node-res,-1);
+                if(j+1 < res) builder.addEntry(node,node+res,-1);
+                if(k > 0) builder.addEntry(node,node-1,-1);
+                if(k+1 < res) builder.addEntry(node,node+1,-1);
+            }
+    matrix.resize(node_num,node_num);
+    builder.build(matrix);
+}
+
+//upwind convection-diffusion of a res^2 grid, nonsymmetric
+void convectionDiffusionMatrix(unsigned int res, double peclet, SparseMatrix<double> &matrix)
+{
+    unsigned int node_num = res*res;
+    SparseMatrixBuilder<double> builder(node_num,node_num,1);
+    for(unsigned int i = 0; i < res; ++i)
+        for(unsigned int j = 0; j < res; ++j)
+        {
+            unsigned int node = i*res+j;
+            builder.addEntry(node,node,4+2*peclet);
+            if(i > 0) builder.addEntry(node,node-res,-1-peclet);
+            if(i+1 < res) builder.addEntry(node,node+res,-1);
+            if(j > 0) builder.addEntry(node,node-1,-1-peclet);
+            if(j+1 < res) builder.addEntry(node,node+1,-1);
+        }
+    matrix.resize(node_num,node_num);
+    builder.build(matrix);
+}
+
+//linear elasticity of a cantilever beam of nx*ny*nz cubes, each split into 6 tetrahedra, fixed at x = 0
+//with gravity load, the rows and columns of fixed unknowns are replaced with identity
+void elasticityMatrix(unsigned int nx, unsigned int ny, unsigned int nz, SparseMatrix<double> &matrix, VectorND<double> &rhs)
+{
+    const double youngs_modulus = 1.0e6, poisson_ratio = 0.45;
+    const double lambda = youngs_modulus*poisson_ratio/((1+poisson_ratio)*(1-2*poisson_ratio));
+    const double mu = youngs_modulus/(2*(1+poisson_ratio));
+    unsigned int node_num = (nx+1)*(ny+1)*(nz+1), dof_num = 3*node_num;
+    vector<bool> fixed(node_num,false);
+    for(unsigned int j = 0; j <= ny; ++j)
+        for(unsigned int k = 0; k <= nz; ++k)
+            fixed[j*(nz+1)+k] = true;
+    SparseMatrixBuilder<double> builder(dof_num,dof_num,1);
+    rhs = VectorND<double>(dof_num,0);
+    const unsigned int tets[6][4] = {{0,1,3,7},{0,1,5,7},{0,2,3,7},{0,2,6,7},{0,4,5,7},{0,4,6,7}};
+    for(unsigned int i = 0; i < nx; ++i)
+        for(unsigned int j = 0; j < ny; ++j)
+            for(unsigned int k = 0; k < nz; ++k)
+                for(unsigned int tet = 0; tet < 6; ++tet)
+                {
+                    unsigned int nodes[4];
+                    Vector<double,3> positions[4];
+                    for(unsigned int a = 0; a < 4; ++a)
+                    {
+                        unsigned int corner = tets[tet][a];
+                        unsigned int ci = i+corner/4, cj = j+(corner/2)%2, ck = k+corner%2;
+                        nodes[a] = (ci*(ny+1)+cj)*(nz+1)+ck;
+                        positions[a] = Vector<double,3>(ci,cj,ck)*0.1;
+                    }
+                    SquareMatrix<double,3> dm;
+                    for(unsigned int a = 0; a < 3; ++a)
+                        for(unsigned int d = 0; d < 3; ++d)
+                            dm(d,a) = positions[a+1][d] - positions[0][d];
+                    double volume = fabs(dm.determinant())/6;
+                    SquareMatrix<double,3> dm_inv = dm.inverse();
+                    Vector<double,3> gradients[4];
+                    gradients[0] = Vector<double,3>(0.0);
+                    for(unsigned int a = 1; a < 4; ++a)
+                    {
+                        for(unsigned int d = 0; d < 3; ++d)
+                            gradients[a][d] = dm_inv(a-1,d);
+                        gradients[0] -= gradients[a];
+                    }
+                    for(unsigned int a = 0; a < 4; ++a)
+                    {
+                        if(!fixed[nodes[a]])
+                            rhs[3*nodes[a]+2] -= 1000*9.8*volume/4;
+                        for(unsigned int b = 0; b < 4; ++b)
+                            for(unsigned int d1 = 0; d1 < 3; ++d1)
+                                for(unsigned int d2 = 0; d2 < 3; ++d2)
+                                {
+                                    if(fixed[nodes[a]] || fixed[nodes[b]])
+                                        continue;
+                                    double value = lambda*gradients[a][d1]*gradients[b][d2] + mu*gradients[a][d2]*gradients[b][d1];
+                                    if(d1 == d2)
+                                        value += mu*gradients[a].dot(gradients[b]);
+                                    builder.addEntry(3*nodes[a]+d1,3*nodes[b]+d2,volume*value);
+                                }
+                    }
+                }
+    for(unsigned int node = 0; node < node_num; ++node)
+        if(fixed[node])
+            for(unsigned int d = 0; d < 3; ++d)
+                builder.addEntry(3*node+d,3*node+d,1);
+    matrix.resize(dof_num,dof_num);
+    builder.build(matrix);
+}
+
+double trueResidual(const SparseMatrix<double> &matrix, const VectorND<double> &rhs, const VectorND<double> &x)
+{
+    return (rhs - matrix*x).norm()/rhs.norm();
+}
+
+void runSolver(const string &name, IterativeSolver<double> &solver, const SparseMatrix<double> &matrix, const VectorND<double> &rhs)
+{
+    VectorND<double> x;
+    solver.solve(matrix,rhs,x);
+    double residual = trueResidual(matrix,rhs,x);
+    cout<<"    "<<name<<": "<<solver.iterationNum()<<" iterations, compute "<<solver.computeTime()<<" s, solve "<<solver.solveTime()
+        <<" s, residual "<<residual<<", "<<(solver.isConverged() && residual < 10*solver.tolerance() ? "PASSED" : "FAILED")<<"\n";
+}
+
+int main()
+{
+    Timer timer;
+    ConjugateGradientSolver<double> cg_solver;
+    MINRESSolver<double> minres_solver;
+    BiCGSTABSolver<double> bicgstab_solver;
+    cg_solver.setMaxIterationNum(5000);
+    minres_solver.setMaxIterationNum(5000);
+    bicgstab_solver.setMaxIterationNum(5000);
+    //laplacian
+    SparseMatrix<double> laplacian;
+    laplacianMatrix(40,0,laplacian);
+    VectorND<double> laplacian_rhs(laplacian.rows(),1.0);
+    cout<<"Laplacian, "<<laplacian.rows()<<" unknowns, "<<laplacian.nonZeros()<<" nonzeros:\n";
+    cg_solver.removePreconditioner();
+    runSolver("CG",cg_solver,laplacian,laplacian_rhs);
+    cg_solver.setPreconditioner(JacobiPreconditioner<double>());
+    runSolver("CG + Jacobi",cg_solver,laplacian,laplacian_rhs);
+    cg_solver.setPreconditioner(BlockJacobiPreconditioner<double>(4));
+    runSolver("CG + block Jacobi",cg_solver,laplacian,laplacian_rhs);
+    cg_solver.setPreconditioner(IncompleteCholeskyPreconditioner<double>());
+    runSolver("CG + incomplete Cholesky",cg_solver,laplacian,laplacian_rhs);
+    minres_solver.setPreconditioner(JacobiPreconditioner<double>());
+    runSolver("MINRES + Jacobi",minres_solver,laplacian,laplacian_rhs);
+    bicgstab_solver.setPreconditioner(JacobiPreconditioner<double>());
+    runSolver("BiCGSTAB + Jacobi",bicgstab_solver,laplacian,laplacian_rhs);
+    //Eigen with the same tolerance for reference
+    {
+        vector<Eigen::Triplet<double> > triplets;
+        for(unsigned int i = 0; i < laplacian.rows(); ++i)
+        {
+            vector<Trituple<double> > row_elements = laplacian.getRowElements(i);
+            for(unsigned int j = 0; j < row_elements.size(); ++j)
+                triplets.push_back(Eigen::Triplet<double>(i,row_elements[j].col(),row_elements[j].value()));
+        }
+        Eigen::SparseMatrix<double> eigen_laplacian(laplacian.rows(),laplacian.cols());
+        eigen_laplacian.setFromTriplets(triplets.begin(),triplets.end());
+        Eigen::VectorXd eigen_rhs = Eigen::VectorXd::Ones(laplacian.rows());
+        Eigen::ConjugateGradient<Eigen::SparseMatrix<double> > eigen_solver;
+        eigen_solver.setTolerance(cg_solver.tolerance());
+        timer.startTimer();
+        eigen_solver.compute(eigen_laplacian);
+        Eigen::VectorXd eigen_x = eigen_solver.solve(eigen_rhs);
+        timer.stopTimer();
+        cout<<"    Eigen CG + Jacobi: "<<eigen_solver.iterations()<<" iterations, "<<timer.getElapsedTime()<<" s\n";
+    }
+    //elasticity
+    SparseMatrix<double> stiffness;
+    VectorND<double> elasticity_rhs;
+    elasticityMatrix(40,10,10,stiffness,elasticity_rhs);
+    cout<<"Elasticity, "<<stiffness.rows()<<" unknowns, "<<stiffness.nonZeros()<<" nonzeros:\n";
+    cg_solver.setPreconditioner(JacobiPreconditioner<double>());
+    runSolver("CG + Jacobi",cg_solver,stiffness,elasticity_rhs);
+    cg_solver.setPreconditioner(BlockJacobiPreconditioner<double>(3));
+    runSolver("CG + block Jacobi",cg_solver,stiffness,elasticity_rhs);
+    cg_solver.setPreconditioner(IncompleteCholeskyPreconditioner<double>());
+    runSolver("CG + incomplete Cholesky",cg_solver,stiffness,elasticity_rhs);
+    minres_solver.setPreconditioner(BlockJacobiPreconditioner<double>(3));
+    runSolver("MINRES + block Jacobi",minres_solver,stiffness,elasticity_rhs);
+    bicgstab_solver.setPreconditioner(IncompleteCholeskyPreconditioner<double>());
+    runSolver("BiCGSTAB + incomplete Cholesky",bicgstab_solver,stiffness,elasticity_rhs);
+    //warm start with a slightly changed load, as in consecutive time steps
+    {
+        VectorND<double> x;
+        cg_solver.disableWarmStart();
+        cg_solver.solve(stiffness,elasticity_rhs,x);
+        VectorND<double> new_rhs = elasticity_rhs*1.01;
+        VectorND<double> cold_x;
+        cg_solver.solve(new_rhs,cold_x);
+        unsigned int cold_iterations = cg_solver.iterationNum();
+        cg_solver.enableWarmStart();
+        cg_solver.solve(new_rhs,x);
+        cout<<"    warm start: "<<cg_solver.iterationNum()<<" iterations instead of "<<cold_iterations<<", "
+            <<(cg_solver.iterationNum() < cold_iterations && trueResidual(stiffness,new_rhs,x) < 10*cg_solver.tolerance() ? "PASSED" : "FAILED")<<"\n";
+        cg_solver.disableWarmStart();
+        const vector<double> &history = cg_solver.residualHistory();
+        cout<<"    residual history: "<<history.front()<<" -> "<<history.back()<<" in "<<history.size()<<" records\n";
+    }
+    //symmetric indefinite
+    SparseMatrix<double> indefinite;
+    laplacianMatrix(30,0.5,indefinite);
+    VectorND<double> indefinite_rhs(indefinite.rows(),1.0);
+    cout<<"Indefinite laplacian, "<<indefinite.rows()<<" unknowns:\n";
+    minres_solver.setPreconditioner(JacobiPreconditioner<double>());
+    runSolver("MINRES + Jacobi",minres_solver,indefinite,indefinite_rhs);
+    //nonsymmetric
+    SparseMatrix<double> convection;
+    convectionDiffusionMatrix(200,2,convection);
+    VectorND<double> convection_rhs(convection.rows(),1.0);
+    cout<<"Convection-diffusion, "<<convection.rows()<<" unknowns:\n";
+    bicgstab_solver.setPreconditioner(JacobiPreconditioner<double>());
+    runSolver("BiCGSTAB + Jacobi",bicgstab_solver,convection,convection_rhs);
+    bicgstab_solver.setPreconditioner(BlockJacobiPreconditioner<double>(4));
+    runSolver("BiCGSTAB + block Jacobi",bicgstab_solver,convection,convection_rhs);
+    //single precision
+    {
+        SparseMatrix<float> float_laplacian(1000,1000);
+        vector<Trituple<float> > triplets;
+        for(unsigned int i = 0; i < 1000; ++i)
+        {
+            triplets.push_back(Trituple<float>(i,i,2.01f));
+            if(i > 0) triplets.push_back(Trituple<float>(i,i-1,-1.0f));
+            if(i+1 < 1000) triplets.push_back(Trituple<float>(i,i+1,-1.0f));
+        }
+        float_laplacian.setFromTriplets(triplets);
+        ConjugateGradientSolver<float> float_solver;
+        float_solver.setTolerance(1.0e-5f);
+        float_solver.setPreconditioner(JacobiPreconditioner<float>());
+        VectorND<float> float_rhs(1000,1.0f), float_x;
+        float_solver.solve(float_laplacian,float_rhs,float_x);
+        cout<<"Single precision CG + Jacobi: "<<float_solver.iterationNum()<<" iterations, "<<(float_solver.isConverged() ? "PASSED" : "FAILED")<<"\n";
+    }
+    return 0;
+}
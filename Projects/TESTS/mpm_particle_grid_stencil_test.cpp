@@ -0,0 +1,120 @@
+/*
+ * @file mpm_particle_grid_stencil_test.cpp
+ * @brief Test MPMParticleGridStencil, the compact storage of particle-grid interpolation weights.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <iostream>
+#include <vector>
+#include "Physika_Core/Vectors/vector_2d.h"
+#include "Physika_Core/Vectors/vector_3d.h"
+#include "Physika_Core/Range/range.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_weight_function.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_linear_weight_functions.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_quadratic_weight_functions.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_cubic_weight_functions.h"
+#include "Physika_Geometry/Cartesian_Grids/grid.h"
+#include "Physika_Dynamics/MPM/mpm_internal.h"
+#include "Physika_Dynamics/MPM/mpm_particle_grid_stencil.h"
+#include "Physika_Dynamics/MPM/Weight_Function_Influence_Iterators/uniform_grid_weight_function_influence_iterator.h"
+using namespace std;
+using namespace Physika;
+
+#define PARTICLE_NUM 1000
+
+//fill the stencil of a particle from the 1D factors of the weight function
+template <int Dim>
+void setStencil(MPMParticleGridStencil<double,Dim> &stencil, unsigned int particle_idx, const Grid<double,Dim> &grid,
+                const Vector<double,Dim> &position, const GridWeightFunction<double,Dim> &weight_function)
+{
+    UniformGridWeightFunctionInfluenceIterator<double,Dim> iter(grid,position,weight_function);
+    Vector<unsigned int,Dim> min_node_idx = iter.minNodeIndex(), axis_node_num = iter.nodeNum();
+    stencil.setNodeRange(particle_idx,min_node_idx,axis_node_num);
+    Vector<double,Dim> particle_to_first_node;
+    for(unsigned int i = 0; i < Dim; ++i)
+        particle_to_first_node[i] = (position[i]-grid.node(min_node_idx)[i])/grid.dX()[i];
+    weight_function.axisWeightsAndGradients(particle_to_first_node,axis_node_num,MPMParticleGridStencil<double,Dim>::MAX_AXIS_NODE_NUM,
+                                            stencil.axisWeights(particle_idx,0),stencil.axisGradients(particle_idx,0));
+}
+
+//compare the pairs reconstructed from stencil with the ones evaluated with the weight function
+template <int Dim>
+void testWeightFunction(const char *name, const GridWeightFunction<double,Dim> &weight_function)
+{
+    Grid<double,Dim> grid(Range<double,Dim>(Vector<double,Dim>(0.0),Vector<double,Dim>(1.0)),20);
+    vector<Vector<double,Dim> > positions(PARTICLE_NUM);
+    srand(0);
+    for(unsigned int i = 0; i < PARTICLE_NUM; ++i)
+        for(unsigned int j = 0; j < Dim; ++j)
+            positions[i][j] = static_cast<double>(rand())/RAND_MAX;
+    MPMParticleGridStencil<double,Dim> stencil;
+    stencil.resize(PARTICLE_NUM);
+    for(unsigned int i = 0; i < PARTICLE_NUM; ++i)
+        setStencil(stencil,i,grid,positions[i],weight_function);
+    //reverse the particles, and remove the first one
+    vector<unsigned int> permutation(PARTICLE_NUM);
+    for(unsigned int i = 0; i < PARTICLE_NUM; ++i)
+        permutation[i] = PARTICLE_NUM - 1 - i;
+    stencil.permutate(permutation);
+    stencil.removeParticle(0);
+    vector<MPMInternal::NodeIndexWeightGradientPair<double,Dim> > pairs(MPMParticleGridStencil<double,Dim>::MAX_NODE_NUM);
+    bool pass = true;
+    double max_error = 0, max_unity_error = 0;
+    for(unsigned int i = 0; i < stencil.particleNum() && pass; ++i)
+    {
+        const Vector<double,Dim> &position = positions[PARTICLE_NUM - 2 - i];
+        unsigned int pair_num = stencil.gridPairs(i,&pairs[0]), expected_pair_num = 0;
+        //partition of unity holds for particles away from the grid boundary
+        double weight_sum = 0;
+        bool interior = true;
+        for(unsigned int j = 0; j < Dim; ++j)
+            interior = interior && position[j] > 2.0*grid.dX()[j] && position[j] < 1.0 - 2.0*grid.dX()[j];
+        for(unsigned int j = 0; j < pair_num; ++j)
+            weight_sum += pairs[j].weight_value_;
+        if(interior)
+            max_unity_error = max(max_unity_error,fabs(weight_sum-1.0));
+        for(UniformGridWeightFunctionInfluenceIterator<double,Dim> iter(grid,position,weight_function); iter.valid(); ++iter)
+        {
+            Vector<unsigned int,Dim> node_idx = iter.nodeIndex();
+            Vector<double,Dim> particle_to_node = position - grid.node(node_idx);
+            for(unsigned int j = 0; j < Dim; ++j)
+                particle_to_node[j] /= grid.dX()[j];
+            double weight = weight_function.weight(particle_to_node);
+            if(weight <= numeric_limits<double>::epsilon())
+                continue;
+            if(expected_pair_num >= pair_num || pairs[expected_pair_num].node_idx_ != node_idx)
+            {
+                pass = false;
+                break;
+            }
+            max_error = max(max_error,fabs(pairs[expected_pair_num].weight_value_-weight));
+            max_error = max(max_error,(pairs[expected_pair_num].gradient_value_-weight_function.gradient(particle_to_node)).norm());
+            ++expected_pair_num;
+        }
+        pass = pass && (expected_pair_num == pair_num);
+    }
+    cout<<name<<": pairs match the weight function: "<<(pass?"yes":"NO")<<", max error of weight and gradient: "<<max_error
+        <<", max error of partition of unity: "<<max_unity_error<<"\n";
+}
+
+int main()
+{
+    testWeightFunction<2>("GridLinearWeightFunction 2D",GridLinearWeightFunction<double,2>());
+    testWeightFunction<3>("GridLinearWeightFunction 3D",GridLinearWeightFunction<double,3>());
+    testWeightFunction<2>("GridQuadraticBSpline 2D",GridQuadraticBSpline<double,2>());
+    testWeightFunction<3>("GridQuadraticBSpline 3D",GridQuadraticBSpline<double,3>());
+    testWeightFunction<2>("GridPiecewiseCubicSpline 2D",GridPiecewiseCubicSpline<double,2>());
+    testWeightFunction<3>("GridPiecewiseCubicSpline 3D",GridPiecewiseCubicSpline<double,3>());
+    return 0;
+}
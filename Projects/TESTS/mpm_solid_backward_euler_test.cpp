@@ -0,0 +1,170 @@
+/*
+ * @file mpm_solid_backward_euler_test.cpp
+ * @brief Test the implicit integration of MPMSolid and the stress differentials of constitutive models.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "Physika_Core/Vectors/vector_2d.h"
+#include "Physika_Core/Matrices/matrix_2x2.h"
+#include "Physika_Core/Range/range.h"
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_quadratic_weight_functions.h"
+#include "Physika_Geometry/Cartesian_Grids/grid.h"
+#include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
+#include "Physika_Dynamics/Constitutive_Models/neo_hookean.h"
+#include "Physika_Dynamics/Constitutive_Models/st_venant_kirchhoff.h"
+#include "Physika_Dynamics/Constitutive_Models/isotropic_linear_elasticity.h"
+#include "Physika_Dynamics/MPM/mpm_solid.h"
+using namespace std;
+using namespace Physika;
+
+//compare the stress differential with central difference of the stress
+void testStressDifferential(const char *model_name, const ConstitutiveModel<double,2> &material)
+{
+    SquareMatrix<double,2> F(1.2,0.3,-0.1,0.9), dF(0.5,-0.2,0.7,0.1);
+    double h = 1.0e-6;
+    SquareMatrix<double,2> numerical = (material.firstPiolaKirchhoffStress(F+h*dF)-material.firstPiolaKirchhoffStress(F-h*dF))/(2*h);
+    SquareMatrix<double,2> analytical = material.firstPiolaKirchhoffStressDifferential(F,dF);
+    SquareMatrix<double,2> difference = numerical-analytical;
+    double error = sqrt(difference.doubleContraction(difference)/analytical.doubleContraction(analytical));
+    cout<<model_name<<" stress differential relative error: "<<error<<(error < 1.0e-6 ? ", PASSED\n" : ", FAILED\n");
+}
+
+//a stiff block resting on fixed grid nodes at the bottom of the grid, moving with the given initial velocity
+void initDriver(MPMSolid<double,2> &driver, unsigned int particle_per_edge, const Vector<double,2> &velocity = Vector<double,2>(0.0))
+{
+    driver.setWeightFunction<GridQuadraticBSpline<double,2> >();
+    NeoHookean<double,2> material(1.0e7,0.3,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+    double spacing = 0.25/particle_per_edge;
+    double volume = spacing*spacing;
+    Vector<double,2> corner(0.375,0.1);
+    vector<SolidParticle<double,2>*> particles;
+    for(unsigned int i = 0; i < particle_per_edge; ++i)
+        for(unsigned int j = 0; j < particle_per_edge; ++j)
+        {
+            Vector<double,2> position = corner + Vector<double,2>(i+0.5,j+0.5)*spacing;
+            particles.push_back(new SolidParticle<double,2>(position,velocity,1000*volume,volume,
+                                                            SquareMatrix<double,2>::identityMatrix(),material));
+        }
+    driver.addObject(particles);
+    for(unsigned int i = 0; i < particles.size(); ++i)
+        delete particles[i];
+    Vector<unsigned int,2> node_num = driver.grid().nodeNum();
+    for(unsigned int i = 0; i < node_num[0]; ++i)
+        for(unsigned int j = 0; j < 7; ++j)
+            driver.addDirichletGridNode(0,Vector<unsigned int,2>(i,j));
+    driver.setSoundSpeed(sqrt(1.0e7/1000));
+    driver.initSimulationData();
+}
+
+//simulate for the given duration, return the lowest particle height, or a negative value if the simulation blows up
+double simulate(MPMSolid<double,2> &driver, double duration, unsigned int &step_num)
+{
+    double time = 0;
+    step_num = 0;
+    while(time < duration)
+    {
+        double dt = driver.computeTimeStep();
+        driver.advanceStep(dt);
+        time += dt;
+        ++step_num;
+    }
+    double lowest = 1.0;
+    for(unsigned int i = 0; i < driver.particleNumOfObject(0); ++i)
+    {
+        Vector<double,2> position = driver.particle(0,i).position();
+        if(!(position[1] == position[1]) || position[1] < 0 || position[1] > 1)
+            return -1;
+        lowest = position[1] < lowest ? position[1] : lowest;
+    }
+    return lowest;
+}
+
+int main()
+{
+    NeoHookean<double,2> neo_hookean(1.0,1.0,IsotropicHyperelasticMaterialInternal::LAME_COEFFICIENTS);
+    StVK<double,2> stvk(1.0,1.0,IsotropicHyperelasticMaterialInternal::LAME_COEFFICIENTS);
+    IsotropicLinearElasticity<double,2> linear(1.0,1.0,IsotropicHyperelasticMaterialInternal::LAME_COEFFICIENTS);
+    testStressDifferential("NeoHookean",neo_hookean);
+    testStressDifferential("StVK",stvk);
+    testStressDifferential("IsotropicLinearElasticity",linear);
+
+    Grid<double,2> grid(Range<double,2>(Vector<double,2>(0.0),Vector<double,2>(1.0)),64);
+    double duration = 0.05;
+    Timer timer;
+    unsigned int step_num = 0;
+    MPMSolid<double,2> explicit_driver(0,1,30,1.0e-2,false,grid);
+    initDriver(explicit_driver,32);
+    timer.startTimer();
+    double explicit_lowest = simulate(explicit_driver,duration,step_num);
+    timer.stopTimer();
+    cout<<"FORWARD_EULER: "<<step_num<<" steps, "<<timer.getElapsedTime()<<" s, lowest particle at "<<explicit_lowest<<"\n";
+    MPMSolid<double,2> implicit_driver(0,1,30,2.5e-3,false,grid);
+    initDriver(implicit_driver,32);
+    implicit_driver.setTimeIntegrationMethod(MPMSolidBase<double,2>::BACKWARD_EULER);
+    timer.startTimer();
+    double implicit_lowest = simulate(implicit_driver,duration,step_num);
+    timer.stopTimer();
+    cout<<"BACKWARD_EULER: "<<step_num<<" steps, "<<timer.getElapsedTime()<<" s, lowest particle at "<<implicit_lowest<<"\n";
+    if(explicit_lowest < 0 || implicit_lowest < 0 || fabs(explicit_lowest-implicit_lowest) > 0.01)
+        cout<<"FAILED\n";
+    else
+        cout<<"PASSED\n";
+
+    //fast particles: the time step of BACKWARD_EULER is limited such that particles travel at most cfl*cell size per step
+    MPMSolid<double,2> fast_driver(0,1,30,2.5e-3,false,grid);
+    initDriver(fast_driver,32,Vector<double,2>(20.0,0.0));
+    fast_driver.setTimeIntegrationMethod(MPMSolidBase<double,2>::BACKWARD_EULER);
+    double cell_size = 1.0/64, cfl = fast_driver.cflConstant();
+    double max_travel = 0;
+    bool limited = true;
+    for(unsigned int step = 0; step < 20; ++step)
+    {
+        double dt = fast_driver.computeTimeStep();
+        double max_speed = 0;
+        vector<Vector<double,2> > old_positions(fast_driver.particleNumOfObject(0));
+        for(unsigned int i = 0; i < old_positions.size(); ++i)
+        {
+            old_positions[i] = fast_driver.particleData(0).position(i);
+            max_speed = max(max_speed,fast_driver.particleData(0).velocity(i).norm());
+        }
+        limited = limited && fabs(dt - min(2.5e-3,cfl*cell_size/max_speed)) < 1.0e-12;
+        fast_driver.advanceStep(dt);
+        for(unsigned int i = 0; i < old_positions.size(); ++i)
+            max_travel = max(max_travel,(fast_driver.particleData(0).position(i)-old_positions[i]).norm());
+    }
+    cout<<"Fast particles: max travel per step "<<max_travel/cell_size<<" cells"<<(limited && max_travel < cell_size ? ", PASSED\n" : ", FAILED\n");
+
+    //the implicit solve gives the same result with any number of threads
+    MPMSolid<double,2> single_thread(0,1,30,2.5e-3,false,grid), multi_thread(0,1,30,2.5e-3,false,grid);
+    initDriver(single_thread,32,Vector<double,2>(1.0,-1.0));
+    initDriver(multi_thread,32,Vector<double,2>(1.0,-1.0));
+    single_thread.setTimeIntegrationMethod(MPMSolidBase<double,2>::BACKWARD_EULER);
+    multi_thread.setTimeIntegrationMethod(MPMSolidBase<double,2>::BACKWARD_EULER);
+    single_thread.setThreadNum(1);
+    multi_thread.setThreadNum(4);
+    for(unsigned int step = 0; step < 5; ++step)
+    {
+        single_thread.advanceStep(2.5e-3);
+        multi_thread.advanceStep(2.5e-3);
+    }
+    bool identical = true;
+    for(unsigned int i = 0; i < single_thread.particleNumOfObject(0); ++i)
+        identical = identical && single_thread.particleData(0).position(i) == multi_thread.particleData(0).position(i)
+                              && single_thread.particleData(0).velocity(i) == multi_thread.particleData(0).velocity(i);
+    cout<<"Thread number independence: "<<(identical ? "PASSED\n" : "FAILED\n");
+    return 0;
+}
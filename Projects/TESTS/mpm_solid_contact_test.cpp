@@ -0,0 +1,82 @@
+/*
+ * @file mpm_solid_contact_test.cpp
+ * @brief Test the contact between objects of MPMSolid on grids of different resolution, the cost of contact
+ *        should scale with the contact interface instead of the grid.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include "Physika_Core/Vectors/vector_2d.h"
+#include "Physika_Core/Matrices/matrix_2x2.h"
+#include "Physika_Core/Range/range.h"
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Geometry/Cartesian_Grids/grid.h"
+#include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
+#include "Physika_Dynamics/Constitutive_Models/neo_hookean.h"
+#include "Physika_Dynamics/MPM/mpm_solid.h"
+#include "Physika_Dynamics/MPM/MPM_Contact_Methods/mpm_solid_subgrid_friction_contact_method.h"
+using namespace std;
+using namespace Physika;
+
+//two blocks moving towards each other, the particle spacing is half the cell size
+void testContact(unsigned int grid_resolution, unsigned int cell_per_block_edge)
+{
+    Grid<double,2> grid(Range<double,2>(Vector<double,2>(0.0),Vector<double,2>(1.0)),grid_resolution);
+    MPMSolid<double,2> driver(0,1,30,1.0e-4,false,grid);
+    driver.disableTimer();
+    NeoHookean<double,2> material(1.0e5,0.3,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+    double dx = 1.0/grid_resolution, spacing = 0.5*dx, volume = spacing*spacing;
+    unsigned int particle_per_edge = 2*cell_per_block_edge;
+    for(unsigned int obj_idx = 0; obj_idx < 2; ++obj_idx)
+    {
+        //the blocks are one cell apart
+        double x_start = obj_idx == 0 ? 0.5 - 0.5*dx - particle_per_edge*spacing : 0.5 + 0.5*dx;
+        Vector<double,2> velocity(obj_idx == 0 ? 1.0 : -1.0,0.0);
+        vector<SolidParticle<double,2>*> particles;
+        for(unsigned int i = 0; i < particle_per_edge; ++i)
+            for(unsigned int j = 0; j < particle_per_edge; ++j)
+            {
+                Vector<double,2> position(x_start+(i+0.5)*spacing,0.5+(j+0.5)*spacing);
+                particles.push_back(new SolidParticle<double,2>(position,velocity,1000*volume,volume,SquareMatrix<double,2>::identityMatrix(),material));
+            }
+        driver.addObject(particles);
+        for(unsigned int i = 0; i < particles.size(); ++i)
+            delete particles[i];
+    }
+    driver.setContactMethod(MPMSolidSubgridFrictionContactMethod<double,2>());
+    driver.initSimulationData();
+    unsigned int step_num = 20;
+    Timer timer;
+    timer.startTimer();
+    for(unsigned int step = 0; step < step_num; ++step)
+        driver.advanceStep(0.05*dx);
+    timer.stopTimer();
+    //the blocks never interpenetrate
+    double max_x = 0, min_x = 1;
+    for(unsigned int i = 0; i < driver.particleNumOfObject(0); ++i)
+        max_x = max(max_x,driver.particleData(0).position(i)[0]);
+    for(unsigned int i = 0; i < driver.particleNumOfObject(1); ++i)
+        min_x = min(min_x,driver.particleData(1).position(i)[0]);
+    cout<<grid_resolution<<"^2 grid, "<<driver.totalParticleNum()<<" particles: "<<timer.getElapsedTime()/step_num<<" s per step, gap between blocks "
+        <<min_x-max_x<<": "<<(min_x > max_x ? "PASSED" : "FAILED")<<"\n";
+}
+
+int main()
+{
+    //the same number of particles and contact nodes on grids of increasing resolution
+    testContact(64,16);
+    testContact(256,16);
+    testContact(1024,16);
+    return 0;
+}
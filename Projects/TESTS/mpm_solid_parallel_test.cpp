@@ -0,0 +1,179 @@
+/*
+ * @file mpm_solid_parallel_test.cpp
+ * @brief Test the scaling and determinism of the parallel substeps of MPM solid drivers.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include "Physika_Core/Vectors/vector_3d.h"
+#include "Physika_Core/Matrices/matrix_3x3.h"
+#include "Physika_Core/Range/range.h"
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Core/Utilities/parallel_utilities.h"
+#include "Physika_Core/Grid_Weight_Functions/grid_cubic_weight_functions.h"
+#include "Physika_Geometry/Cartesian_Grids/grid.h"
+#include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Constitutive_Models/neo_hookean.h"
+#include "Physika_Dynamics/MPM/mpm_solid.h"
+#include "Physika_Dynamics/MPM/CPDI_mpm_solid.h"
+#include "Physika_Dynamics/MPM/invertible_mpm_solid.h"
+#include "Physika_Dynamics/MPM/CPDI_Update_Methods/CPDI2_update_method.h"
+using namespace std;
+using namespace Physika;
+
+#define REPEAT_NUM 5
+
+//two cubes of particles, slightly overlapping in grid so that some nodes are shared by two objects
+void addObjects(MPMSolid<double,3> &driver, unsigned int particle_per_edge)
+{
+    NeoHookean<double,3> material(1.0e4,0.3,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+    double spacing = 0.4/particle_per_edge;
+    double volume = spacing*spacing*spacing;
+    for(unsigned int obj_idx = 0; obj_idx < 2; ++obj_idx)
+    {
+        Vector<double,3> corner(0.1+0.42*obj_idx,0.2,0.1);
+        Vector<double,3> velocity(obj_idx==0?1.0:-1.0,0.0,0.5);
+        vector<SolidParticle<double,3>*> particles;
+        for(unsigned int i = 0; i < particle_per_edge; ++i)
+            for(unsigned int j = 0; j < particle_per_edge; ++j)
+                for(unsigned int k = 0; k < particle_per_edge; ++k)
+                {
+                    Vector<double,3> position = corner + Vector<double,3>(i+0.5,j+0.5,k+0.5)*spacing;
+                    particles.push_back(new SolidParticle<double,3>(position,velocity,1000*volume,volume,
+                                                                    SquareMatrix<double,3>::identityMatrix(),material));
+                }
+        driver.addObject(particles);
+        for(unsigned int i = 0; i < particles.size(); ++i)
+            delete particles[i];
+    }
+}
+
+//driver specific settings
+void initDriver(MPMSolid<double,3> &driver)
+{
+    driver.setWeightFunction<GridPiecewiseCubicSpline<double,3> >();
+}
+
+void initDriver(CPDIMPMSolid<double,3> &driver)
+{
+    driver.setCPDIUpdateMethod<CPDI2UpdateMethod<double,3> >();
+}
+
+void initDriver(InvertibleMPMSolid<double,3> &driver)
+{
+}
+
+//checksum of the rasterized grid data
+double gridChecksum(const MPMSolid<double,3> &driver)
+{
+    double checksum = 0;
+    Vector<unsigned int,3> node_num = driver.grid().nodeNum();
+    for(unsigned int obj_idx = 0; obj_idx < driver.objectNum(); ++obj_idx)
+        for(unsigned int i = 0; i < node_num[0]; ++i)
+            for(unsigned int j = 0; j < node_num[1]; ++j)
+                for(unsigned int k = 0; k < node_num[2]; ++k)
+                {
+                    Vector<unsigned int,3> node_idx(i,j,k);
+                    Vector<double,3> velocity = driver.gridVelocity(obj_idx,node_idx);
+                    checksum += driver.gridMass(obj_idx,node_idx)*(i+1) + (velocity[0]+2*velocity[1]+3*velocity[2])*(k+1);
+                }
+    return checksum;
+}
+
+//checksum of the particle state
+double particleChecksum(const MPMSolid<double,3> &driver)
+{
+    double checksum = 0;
+    for(unsigned int obj_idx = 0; obj_idx < driver.objectNum(); ++obj_idx)
+        for(unsigned int particle_idx = 0; particle_idx < driver.particleNumOfObject(obj_idx); ++particle_idx)
+        {
+            const SolidParticle<double,3> &particle = driver.particle(obj_idx,particle_idx);
+            Vector<double,3> position = particle.position(), velocity = particle.velocity();
+            checksum += (position[0]+2*position[1]+3*position[2])*(particle_idx%7+1) + (velocity[0]+velocity[1]+velocity[2])*(particle_idx%5+1);
+            checksum += particle.deformationGradient().determinant();
+        }
+    return checksum;
+}
+
+void printResult(const char *stage_name, unsigned int thread_num, double time, double serial_time, double checksum, double serial_checksum)
+{
+    cout<<"  "<<stage_name<<" with "<<thread_num<<" threads: "<<time<<" s, speedup: "<<serial_time/time;
+    if(checksum == serial_checksum)
+        cout<<", result identical to 1 thread\n";
+    else
+        cout<<", ERROR: result differs from 1 thread\n";
+}
+
+//time rasterize() and the particle update substeps with 1 to max_thread_num threads
+template <typename DriverType>
+void testDriver(const char *driver_name, const Grid<double,3> &grid, unsigned int particle_per_edge, unsigned int max_thread_num)
+{
+    Timer timer;
+    double serial_time[2] = {0,0}, serial_checksum[2] = {0,0};
+    double dt = 1.0e-4;
+    for(unsigned int thread_num = 1; thread_num <= max_thread_num; ++thread_num)
+    {
+        DriverType driver(0,1,30,1.0e-3,false,grid);
+        initDriver(driver);
+        addObjects(driver,particle_per_edge);
+        driver.initSimulationData();
+        driver.setThreadNum(thread_num);
+        if(thread_num == 1)
+            cout<<driver_name<<": "<<driver.totalParticleNum()<<" particles\n";
+        double time[2] = {0,0}, checksum[2] = {0,0};
+        //particle to grid
+        driver.rasterize();  //warm up
+        timer.startTimer();
+        for(unsigned int i = 0; i < REPEAT_NUM; ++i)
+            driver.rasterize();
+        timer.stopTimer();
+        time[0] = timer.getElapsedTime()/REPEAT_NUM;
+        checksum[0] = gridChecksum(driver);
+        //grid to particle and particle updates
+        for(unsigned int i = 0; i < REPEAT_NUM; ++i)
+        {
+            driver.rasterize();
+            driver.solveOnGrid(dt);
+            timer.startTimer();
+            driver.updateParticleVelocity();
+            driver.applyExternalForceOnParticles(dt);
+            driver.updateParticleConstitutiveModelState(dt);
+            driver.updateParticlePosition(dt);
+            driver.updateParticleInterpolationWeight();
+            timer.stopTimer();
+            time[1] += timer.getElapsedTime()/REPEAT_NUM;
+        }
+        checksum[1] = particleChecksum(driver);
+        if(thread_num == 1)
+            for(unsigned int i = 0; i < 2; ++i)
+            {
+                serial_time[i] = time[i];
+                serial_checksum[i] = checksum[i];
+            }
+        printResult("rasterize",thread_num,time[0],serial_time[0],checksum[0],serial_checksum[0]);
+        printResult("particle update",thread_num,time[1],serial_time[1],checksum[1],serial_checksum[1]);
+    }
+}
+
+//usage: mpm_solid_parallel_test [max_thread_num], the number of processors is used by default
+int main(int argc, char **argv)
+{
+    unsigned int max_thread_num = argc > 1 ? atoi(argv[1]) : maxThreadNum();
+    unsigned int particle_per_edge = 24;
+    Grid<double,3> grid(Range<double,3>(Vector<double,3>(0.0),Vector<double,3>(1.0)),64);
+    cout<<"Processor number: "<<maxThreadNum()<<"\n";
+    testDriver<MPMSolid<double,3> >("MPMSolid",grid,particle_per_edge,max_thread_num);
+    testDriver<CPDIMPMSolid<double,3> >("CPDIMPMSolid",grid,particle_per_edge,max_thread_num);
+    testDriver<InvertibleMPMSolid<double,3> >("InvertibleMPMSolid",grid,particle_per_edge,max_thread_num);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * @file mpm_solid_particle_reorder_test.cpp
+ * @brief Test reordering particles of MPM solid drivers by Morton code of grid cell.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include "Physika_Core/Vectors/vector_3d.h"
+#include "Physika_Core/Matrices/matrix_3x3.h"
+#include "Physika_Core/Range/range.h"
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Geometry/Cartesian_Grids/grid.h"
+#include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
+#include "Physika_Dynamics/Constitutive_Models/neo_hookean.h"
+#include "Physika_Dynamics/MPM/mpm_solid.h"
+#include "Physika_Dynamics/MPM/CPDI_mpm_solid.h"
+#include "Physika_Dynamics/MPM/invertible_mpm_solid.h"
+#include "Physika_Dynamics/MPM/CPDI_Update_Methods/CPDI2_update_method.h"
+using namespace std;
+using namespace Physika;
+
+#define REPEAT_NUM 5
+
+//a cube of particles, added in shuffled order such that particles close in memory are far apart in space
+void addShuffledObject(MPMSolid<double,3> &driver, unsigned int particle_per_edge)
+{
+    NeoHookean<double,3> material(1.0e4,0.3,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+    double spacing = 0.6/particle_per_edge;
+    double volume = spacing*spacing*spacing;
+    vector<SolidParticle<double,3>*> particles;
+    for(unsigned int i = 0; i < particle_per_edge; ++i)
+        for(unsigned int j = 0; j < particle_per_edge; ++j)
+            for(unsigned int k = 0; k < particle_per_edge; ++k)
+            {
+                Vector<double,3> position = Vector<double,3>(0.2) + Vector<double,3>(i+0.5,j+0.5,k+0.5)*spacing;
+                Vector<double,3> velocity(0.5*i/particle_per_edge,0.0,-0.5*k/particle_per_edge);
+                particles.push_back(new SolidParticle<double,3>(position,velocity,1000*volume,volume,
+                                                                SquareMatrix<double,3>::identityMatrix(),material));
+            }
+    srand(0);
+    random_shuffle(particles.begin(),particles.end());
+    driver.addObject(particles);
+    for(unsigned int i = 0; i < particles.size(); ++i)
+        delete particles[i];
+    //the bottom layer of particles is fixed
+    for(unsigned int i = 0; i < driver.particleNumOfObject(0); ++i)
+        if(driver.particle(0,i).position()[1] < 0.2 + spacing)
+            driver.addDirichletParticle(0,i);
+}
+
+void initDriver(MPMSolid<double,3> &driver)
+{
+}
+
+void initDriver(CPDIMPMSolid<double,3> &driver)
+{
+    driver.setCPDIUpdateMethod<CPDI2UpdateMethod<double,3> >();
+}
+
+void initDriver(InvertibleMPMSolid<double,3> &driver)
+{
+}
+
+//total mass and momentum on grid, independent of particle order up to rounding error
+void gridMassAndMomentum(const MPMSolid<double,3> &driver, double &mass, Vector<double,3> &momentum)
+{
+    mass = 0;
+    momentum = Vector<double,3>(0);
+    Vector<unsigned int,3> node_num = driver.grid().nodeNum();
+    for(unsigned int i = 0; i < node_num[0]; ++i)
+        for(unsigned int j = 0; j < node_num[1]; ++j)
+            for(unsigned int k = 0; k < node_num[2]; ++k)
+            {
+                Vector<unsigned int,3> node_idx(i,j,k);
+                double node_mass = driver.gridMass(0,node_idx);
+                mass += node_mass;
+                momentum += driver.gridVelocity(0,node_idx)*node_mass;
+            }
+}
+
+//sum of particle positions weighted by a function of position, independent of particle order up to rounding error
+double particleStateSum(const MPMSolid<double,3> &driver)
+{
+    double sum = 0;
+    const SolidParticleData<double,3> &particle_data = driver.particleData(0);
+    for(unsigned int i = 0; i < particle_data.particleNum(); ++i)
+    {
+        Vector<double,3> position = particle_data.position(i);
+        sum += position[0]*position[1] + position[2] + particle_data.deformationGradient(i).determinant();
+    }
+    return sum;
+}
+
+bool isSortedByMortonCode(const MPMSolid<double,3> &driver)
+{
+    const SolidParticleData<double,3> &particle_data = driver.particleData(0);
+    unsigned long long last_code = 0;
+    for(unsigned int i = 0; i < particle_data.particleNum(); ++i)
+    {
+        unsigned long long code = MPMInternal::mortonCode(driver.grid().cellIndex(particle_data.position(i)));
+        if(code < last_code)
+            return false;
+        last_code = code;
+    }
+    return true;
+}
+
+bool isDirichletFlagConsistent(const MPMSolid<double,3> &driver, double threshold)
+{
+    //particles do not move before the check, the external force tags must match the positions
+    for(unsigned int i = 0; i < driver.particleNumOfObject(0); ++i)
+    {
+        bool expected = driver.particle(0,i).position()[1] < threshold;
+        Vector<double,3> external_force = driver.externalForceOnParticle(0,i);
+        if(expected != (external_force[0] == 1.0))
+            return false;
+    }
+    return true;
+}
+
+template <typename DriverType>
+void testDriver(const char *driver_name, const Grid<double,3> &grid, unsigned int particle_per_edge)
+{
+    cout<<driver_name<<":\n";
+    Timer timer;
+    DriverType driver(0,1,30,1.0e-4,false,grid);
+    initDriver(driver);
+    addShuffledObject(driver,particle_per_edge);
+    driver.initSimulationData();
+    double threshold = 0.2 + 0.6/particle_per_edge;
+    //tag the bottom layer with external force to check that per-particle data are permutated together
+    for(unsigned int i = 0; i < driver.particleNumOfObject(0); ++i)
+        driver.setExternalForceOnParticle(0,i,Vector<double,3>(driver.particle(0,i).position()[1] < threshold ? 1.0 : 0.0,0,0));
+    double mass[2], state_sum[2], time[2];
+    Vector<double,3> momentum[2];
+    for(unsigned int pass = 0; pass < 2; ++pass)
+    {
+        if(pass == 1)
+            driver.reorderParticles();
+        driver.rasterize();
+        timer.startTimer();
+        for(unsigned int i = 0; i < REPEAT_NUM; ++i)
+            driver.rasterize();
+        timer.stopTimer();
+        time[pass] = timer.getElapsedTime()/REPEAT_NUM;
+        gridMassAndMomentum(driver,mass[pass],momentum[pass]);
+        state_sum[pass] = particleStateSum(driver);
+    }
+    cout<<"  rasterize of shuffled particles: "<<time[0]<<" s, of reordered particles: "<<time[1]<<" s, speedup: "<<time[0]/time[1]<<"\n";
+    cout<<"  particles sorted by Morton code: "<<(isSortedByMortonCode(driver)?"yes":"NO")<<"\n";
+    cout<<"  per-particle data follow the particles: "<<(isDirichletFlagConsistent(driver,threshold)?"yes":"NO")<<"\n";
+    bool same_grid = fabs(mass[0]-mass[1]) <= 1.0e-10*mass[0] && (momentum[0]-momentum[1]).norm() <= 1.0e-10*momentum[0].norm();
+    cout<<"  grid mass and momentum unchanged by reordering: "<<(same_grid?"yes":"NO")<<"\n";
+    cout<<"  particle state unchanged by reordering: "<<(fabs(state_sum[0]-state_sum[1]) <= 1.0e-10*fabs(state_sum[0])?"yes":"NO")<<"\n";
+    //simulate with reordering every 2 steps
+    driver.setParticleReorderInterval(2);
+    double dt = 1.0e-4;
+    for(unsigned int i = 0; i < 5; ++i)
+        driver.advanceStep(dt);
+    cout<<"  5 steps with reorder interval 2, particle state sum: "<<particleStateSum(driver)<<"\n";
+}
+
+int main()
+{
+    unsigned int particle_per_edge = 20;
+    Grid<double,3> grid(Range<double,3>(Vector<double,3>(0.0),Vector<double,3>(1.0)),64);
+    testDriver<MPMSolid<double,3> >("MPMSolid",grid,particle_per_edge);
+    testDriver<CPDIMPMSolid<double,3> >("CPDIMPMSolid",grid,particle_per_edge);
+    testDriver<InvertibleMPMSolid<double,3> >("InvertibleMPMSolid",grid,particle_per_edge);
+    return 0;
+}
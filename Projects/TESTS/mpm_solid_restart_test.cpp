@@ -0,0 +1,216 @@
+/*
+ * @file mpm_solid_restart_test.cpp
+ * @brief Test restart of MPM drivers from binary snapshot, and benchmark the snapshot io and asynchronous frame writing.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "Physika_Core/Vectors/vector_2d.h"
+#include "Physika_Core/Vectors/vector_3d.h"
+#include "Physika_Core/Matrices/matrix_2x2.h"
+#include "Physika_Core/Matrices/matrix_3x3.h"
+#include "Physika_Core/Range/range.h"
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Geometry/Cartesian_Grids/grid.h"
+#include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
+#include "Physika_Dynamics/Constitutive_Models/neo_hookean.h"
+#include "Physika_Dynamics/Constitutive_Models/st_venant_kirchhoff.h"
+#include "Physika_Dynamics/MPM/mpm_solid.h"
+#include "Physika_Dynamics/MPM/CPDI_mpm_solid.h"
+#include "Physika_Dynamics/MPM/invertible_mpm_solid.h"
+#include "Physika_Dynamics/MPM/CPDI_Update_Methods/CPDI2_update_method.h"
+using namespace std;
+using namespace Physika;
+
+void initDriver(MPMSolid<double,2> &driver)
+{
+}
+
+void initDriver(CPDIMPMSolid<double,2> &driver)
+{
+    driver.setCPDIUpdateMethod<CPDI2UpdateMethod<double,2> >();
+}
+
+void initDriver(InvertibleMPMSolid<double,2> &driver)
+{
+}
+
+//a falling block with two materials on fixed grid nodes, the particles are reordered every 3 steps
+template <typename DriverType>
+void setupDriver(DriverType &driver, unsigned int particle_per_edge)
+{
+    initDriver(driver);
+    NeoHookean<double,2> neo_hookean(1.0e5,0.3,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+    StVK<double,2> stvk(2.0e5,0.3,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+    double spacing = 0.25/particle_per_edge;
+    double volume = spacing*spacing;
+    vector<SolidParticle<double,2>*> particles;
+    for(unsigned int i = 0; i < particle_per_edge; ++i)
+        for(unsigned int j = 0; j < particle_per_edge; ++j)
+        {
+            Vector<double,2> position = Vector<double,2>(0.375,0.2) + Vector<double,2>(i+0.5,j+0.5)*spacing;
+            const ConstitutiveModel<double,2> &material = j < particle_per_edge/2 ? static_cast<const ConstitutiveModel<double,2>&>(neo_hookean) : stvk;
+            particles.push_back(new SolidParticle<double,2>(position,Vector<double,2>(0.2,-0.5),1000*volume,volume,
+                                                            SquareMatrix<double,2>::identityMatrix(),material));
+        }
+    driver.addObject(particles);
+    for(unsigned int i = 0; i < particles.size(); ++i)
+        delete particles[i];
+    Vector<unsigned int,2> node_num = driver.grid().nodeNum();
+    for(unsigned int i = 0; i < node_num[0]; ++i)
+        for(unsigned int j = 0; j < 4; ++j)
+            driver.addDirichletGridNode(0,Vector<unsigned int,2>(i,j));
+    driver.addDirichletParticle(0,particle_per_edge-1);
+    driver.setExternalForceOnParticle(0,particle_per_edge*particle_per_edge-1,Vector<double,2>(0.0,1.0e-3));
+    driver.setParticleReorderInterval(3);
+    driver.disableTimer();
+}
+
+//particle states of the two drivers are identical
+bool isSameState(const MPMSolid<double,2> &driver_a, const MPMSolid<double,2> &driver_b)
+{
+    if(driver_a.currentTime() != driver_b.currentTime() || driver_a.objectNum() != driver_b.objectNum())
+        return false;
+    for(unsigned int obj_idx = 0; obj_idx < driver_a.objectNum(); ++obj_idx)
+    {
+        const SolidParticleData<double,2> &data_a = driver_a.particleData(obj_idx), &data_b = driver_b.particleData(obj_idx);
+        if(data_a.particleNum() != data_b.particleNum())
+            return false;
+        for(unsigned int i = 0; i < data_a.particleNum(); ++i)
+            if(data_a.position(i) != data_b.position(i) || data_a.velocity(i) != data_b.velocity(i) || data_a.volume(i) != data_b.volume(i)
+               || data_a.deformationGradient(i) != data_b.deformationGradient(i) || data_a.energy(i) != data_b.energy(i))
+                return false;
+    }
+    return true;
+}
+
+//simulate 4 frames and write each frame to file, then restart another driver from frame 1 and simulate to the end
+template <typename DriverType>
+void testRestart(const char *driver_name, const Grid<double,2> &grid, bool async_write)
+{
+    unsigned int particle_per_edge = 16, end_frame = 3;
+    DriverType driver(0,end_frame,30,1.0e-3,true,grid);
+    setupDriver(driver,particle_per_edge);
+    if(async_write)
+        driver.enableAsyncWrite();
+    driver.run();
+    DriverType restarted_driver(0,end_frame,30,1.0e-3,false,grid);
+    setupDriver(restarted_driver,particle_per_edge);
+    restarted_driver.setRestartFrame(1);
+    restarted_driver.run();
+    cout<<driver_name<<(async_write?" (async write)":"")<<" restart support: "<<(restarted_driver.withRestartSupport()?"yes":"NO")
+        <<", restart from frame 1: "<<(isSameState(driver,restarted_driver)?"PASSED":"FAILED")<<"\n";
+    for(unsigned int frame = 0; frame <= end_frame; ++frame)
+        remove(DriverBase<double>::frameFileName(frame).c_str());
+}
+
+//time of writing and reading the snapshot of given number of particles, the particles are split into objects of at most 1M particles
+void benchmarkSnapshot(unsigned int particle_num)
+{
+    Grid<float,3> grid(Range<float,3>(Vector<float,3>(0.0f),Vector<float,3>(1.0f)),64);
+    MPMSolid<float,3> driver(0,1,30,1.0e-3f,false,grid);
+    NeoHookean<float,3> material(1.0e5f,0.3f,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+    unsigned int object_particle_num = 1000000;
+    for(unsigned int start = 0; start < particle_num; start += object_particle_num)
+    {
+        vector<SolidParticle<float,3>*> particles;
+        for(unsigned int i = start; i < particle_num && i < start + object_particle_num; ++i)
+        {
+            Vector<float,3> position(0.2f+0.6f*(i%997)/997.0f,0.2f+0.6f*(i%991)/991.0f,0.2f+0.6f*(i%983)/983.0f);
+            particles.push_back(new SolidParticle<float,3>(position,Vector<float,3>(0.0f,-1.0f,0.0f),1.0e-6f,1.0e-9f,
+                                                           SquareMatrix<float,3>::identityMatrix(),material));
+        }
+        driver.addObject(particles);
+        for(unsigned int i = 0; i < particles.size(); ++i)
+            delete particles[i];
+    }
+    double position_sum = 0;
+    for(unsigned int obj_idx = 0; obj_idx < driver.objectNum(); ++obj_idx)
+        for(unsigned int i = 0; i < driver.particleNumOfObject(obj_idx); ++i)
+            position_sum += driver.particleData(obj_idx).position(i)[1];
+    string file_name("mpm_solid_snapshot_benchmark");
+    Timer timer;
+    timer.startTimer();
+    driver.write(file_name);
+    timer.stopTimer();
+    double write_time = timer.getElapsedTime();
+    ifstream file(file_name.c_str(),ios::in|ios::binary|ios::ate);
+    double file_size = static_cast<double>(file.tellg())/(1024*1024);
+    file.close();
+    timer.startTimer();
+    driver.read(file_name);
+    timer.stopTimer();
+    double read_time = timer.getElapsedTime();
+    double read_position_sum = 0;
+    for(unsigned int obj_idx = 0; obj_idx < driver.objectNum(); ++obj_idx)
+        for(unsigned int i = 0; i < driver.particleNumOfObject(obj_idx); ++i)
+            read_position_sum += driver.particleData(obj_idx).position(i)[1];
+    remove(file_name.c_str());
+    cout<<"Snapshot of "<<particle_num<<" particles: "<<file_size<<" MB, write: "<<write_time<<" s ("<<file_size/write_time<<" MB/s), read: "
+        <<read_time<<" s ("<<file_size/read_time<<" MB/s), "<<(driver.totalParticleNum() == particle_num && read_position_sum == position_sum ? "PASSED" : "FAILED")<<"\n";
+}
+
+//time of simulating frames of a block with each frame written to file, synchronously and asynchronously
+void benchmarkAsyncWrite(unsigned int particle_per_edge)
+{
+    Grid<float,3> grid(Range<float,3>(Vector<float,3>(0.0f),Vector<float,3>(1.0f)),64);
+    NeoHookean<float,3> material(1.0e5f,0.3f,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+    float spacing = 0.4f/particle_per_edge, volume = spacing*spacing*spacing;
+    vector<SolidParticle<float,3>*> particles;
+    for(unsigned int i = 0; i < particle_per_edge; ++i)
+        for(unsigned int j = 0; j < particle_per_edge; ++j)
+            for(unsigned int k = 0; k < particle_per_edge; ++k)
+            {
+                Vector<float,3> position = Vector<float,3>(0.3f) + Vector<float,3>(i+0.5f,j+0.5f,k+0.5f)*spacing;
+                particles.push_back(new SolidParticle<float,3>(position,Vector<float,3>(0.0f),1000*volume,volume,
+                                                               SquareMatrix<float,3>::identityMatrix(),material));
+            }
+    //one time step per frame such that the output is a considerable part of the frame
+    unsigned int end_frame = 9;
+    double frame_time[2] = {0,0};
+    for(unsigned int async_write = 0; async_write < 2; ++async_write)
+    {
+        MPMSolid<float,3> driver(0,end_frame,1.0e5f,1.0e-5f,true,grid);
+        driver.addObject(particles);
+        driver.disableTimer();
+        if(async_write)
+            driver.enableAsyncWrite();
+        Timer timer;
+        timer.startTimer();
+        driver.run();
+        timer.stopTimer();
+        frame_time[async_write] = timer.getElapsedTime()/(end_frame+1);
+    }
+    for(unsigned int i = 0; i < particles.size(); ++i)
+        delete particles[i];
+    for(unsigned int frame = 0; frame <= end_frame; ++frame)
+        remove(DriverBase<float>::frameFileName(frame).c_str());
+    cout<<"Frame time with "<<particles.size()<<" particles written every frame: synchronous "<<frame_time[0]<<" s, asynchronous "<<frame_time[1]<<" s\n";
+}
+
+int main(int argc, char **argv)
+{
+    Grid<double,2> grid(Range<double,2>(Vector<double,2>(0.0),Vector<double,2>(1.0)),32);
+    testRestart<MPMSolid<double,2> >("MPMSolid",grid,false);
+    testRestart<CPDIMPMSolid<double,2> >("CPDIMPMSolid",grid,false);
+    testRestart<InvertibleMPMSolid<double,2> >("InvertibleMPMSolid",grid,false);
+    testRestart<MPMSolid<double,2> >("MPMSolid",grid,true);
+    testRestart<InvertibleMPMSolid<double,2> >("InvertibleMPMSolid",grid,true);
+    unsigned int particle_num = argc > 1 ? atoi(argv[1]) : 10000000;
+    benchmarkSnapshot(particle_num);
+    benchmarkAsyncWrite(50);
+    return 0;
+}
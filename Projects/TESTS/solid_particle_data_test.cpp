@@ -0,0 +1,144 @@
+/*
+ * @file solid_particle_data_test.cpp
+ * @brief Test SolidParticleData, the structure of arrays storage of solid particles.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "Physika_Core/Vectors/vector_2d.h"
+#include "Physika_Core/Matrices/matrix_2x2.h"
+#include "Physika_Dynamics/Particles/solid_particle.h"
+#include "Physika_Dynamics/Particles/solid_particle_data.h"
+#include "Physika_Dynamics/Constitutive_Models/neo_hookean.h"
+#include "Physika_Dynamics/Constitutive_Models/st_venant_kirchhoff.h"
+using namespace std;
+using namespace Physika;
+
+void printParticles(const SolidParticleData<double,2> &particle_data)
+{
+    for(unsigned int i = 0; i < particle_data.particleNum(); ++i)
+        cout<<"  particle "<<i<<": position "<<particle_data.position(i)<<", velocity "<<particle_data.velocity(i)
+            <<", mass "<<particle_data.mass(i)<<", volume "<<particle_data.volume(i)<<"\n";
+}
+
+int main()
+{
+    NeoHookean<double,2> material(1.0e4,0.3,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+    vector<SolidParticle<double,2>*> particles;
+    for(unsigned int i = 0; i < 4; ++i)
+        particles.push_back(new SolidParticle<double,2>(Vector<double,2>(i,0),Vector<double,2>(0,i),1.0+i,0.1*(i+1),
+                                                        SquareMatrix<double,2>::identityMatrix(),material));
+    SolidParticleData<double,2> particle_data;
+    particle_data.addParticles(particles);
+    cout<<"Add 4 particles:\n";
+    printParticles(particle_data);
+    SolidParticle<double,2> particle(*particles[0]);
+    particle.setPosition(Vector<double,2>(10,10));
+    particle_data.addParticle(particle);
+    cout<<"Append a particle at (10,10):\n";
+    printParticles(particle_data);
+    unsigned int ids[5] = {4,3,2,1,0};
+    particle_data.permutate(ids,5);
+    cout<<"Reverse the order of particles:\n";
+    printParticles(particle_data);
+    particle_data.removeParticle(0);
+    cout<<"Remove the first particle:\n";
+    printParticles(particle_data);
+    cout<<"Modify particle 1 via SolidParticle:\n";
+    particle_data.copyToParticle(1,particle);
+    particle.setVelocity(Vector<double,2>(-1,-1));
+    particle.setDeformationGradient(SquareMatrix<double,2>(1.1,0,0,0.9));
+    particle_data.copyFromParticle(1,particle);
+    printParticles(particle_data);
+    cout<<"Cauchy stress of particle 1 from SolidParticleData: "<<particle_data.cauchyStress(1)<<"\n";
+    cout<<"Cauchy stress of particle 1 from SolidParticle: "<<particle.cauchyStress()<<"\n";
+    for(unsigned int i = 0; i < particles.size(); ++i)
+        delete particles[i];
+    //particles with equal materials share one material, the batch stresses are evaluated on runs of the same material
+    StVK<double,2> stvk_material(1.0e4,0.3,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON);
+    NeoHookean<double,2> same_material(material.lambda(),material.mu(),IsotropicHyperelasticMaterialInternal::LAME_COEFFICIENTS);
+    particles.clear();
+    for(unsigned int i = 0; i < 1000; ++i)
+    {
+        const ConstitutiveModel<double,2> &particle_material = (i/100)%2 ? static_cast<const ConstitutiveModel<double,2>&>(stvk_material)
+                                                                         : (i%2 ? same_material : material);
+        particles.push_back(new SolidParticle<double,2>(Vector<double,2>(i,0),Vector<double,2>(0),1.0,0.1*(i%7+1),
+                                                        SquareMatrix<double,2>(1.0+0.001*i,0.0001*i,0,1.0-0.0005*i),particle_material));
+    }
+    SolidParticleData<double,2> shared_data;
+    shared_data.addParticles(particles);
+    vector<SquareMatrix<double,2> > batch_stress(particles.size());
+    shared_data.cauchyStress(0,particles.size(),&batch_stress[0],true);
+    bool same_stress = true;
+    for(unsigned int i = 0; i < particles.size(); ++i)
+    {
+        SquareMatrix<double,2> stress = shared_data.volume(i)*particles[i]->cauchyStress();
+        for(unsigned int row = 0; row < 2; ++row)
+            for(unsigned int col = 0; col < 2; ++col)
+                if(fabs(batch_stress[i](row,col)-stress(row,col)) > 1.0e-10*(1+fabs(stress(row,col))))
+                    same_stress = false;
+    }
+    cout<<"Add 1000 particles with 3 material instances of 2 distinct materials: "<<shared_data.materialNum()<<" materials stored, "
+        <<(shared_data.materialNum() == 2 && shared_data.constitutiveModel(0) == shared_data.constitutiveModel(1) ? "PASSED" : "FAILED")<<"\n";
+    cout<<"Volume weighted Cauchy stress in batch: "<<(same_stress ? "PASSED" : "FAILED")<<"\n";
+    //particles added one by one, the arrays keep spare capacity which must not show up in permutation and removal
+    SolidParticleData<double,2> appended_data;
+    for(unsigned int i = 0; i < particles.size(); ++i)
+        appended_data.addParticle(*particles[i]);
+    vector<unsigned int> reverse_ids(particles.size());
+    for(unsigned int i = 0; i < particles.size(); ++i)
+        reverse_ids[i] = particles.size()-1-i;
+    appended_data.permutate(&reverse_ids[0],particles.size());
+    appended_data.removeParticle(0);
+    bool same_data = appended_data.particleNum() == particles.size()-1 && appended_data.materialNum() == 2;
+    for(unsigned int i = 0; same_data && i < appended_data.particleNum(); ++i)
+    {
+        const SolidParticle<double,2> &source = *particles[particles.size()-2-i];
+        same_data = appended_data.position(i) == source.position() && appended_data.volume(i) == source.volume()
+                    && appended_data.deformationGradient(i) == source.deformationGradient();
+    }
+    cout<<"Add 1000 particles one by one, reverse and remove the first: "<<(same_data ? "PASSED" : "FAILED")<<"\n";
+    //materials that are no longer used are dropped: a particle edited many times keeps one material
+    SolidParticle<double,2> edited_particle(*particles[0]);
+    for(unsigned int i = 0; i < 100; ++i)
+    {
+        edited_particle.setConstitutiveModel(StVK<double,2>(1.0e4+i,0.3,IsotropicHyperelasticMaterialInternal::YOUNG_AND_POISSON));
+        appended_data.copyFromParticle(0,edited_particle);
+    }
+    unsigned int edited_material_num = appended_data.materialNum();
+    appended_data.copyFromParticle(0,*particles[particles.size()-2]);
+    appended_data.removeParticle(appended_data.particleNum()-1);
+    cout<<"Edit the material of a particle 100 times: "<<edited_material_num<<" materials stored, "
+        <<"restore the material: "<<appended_data.materialNum()<<" materials stored, "
+        <<(edited_material_num == 3 && appended_data.materialNum() == 2 && appended_data.constitutiveModel(0) == appended_data.constitutiveModel(1)
+           && appended_data.materialIndex(appended_data.particleNum()-1) < 2 ? "PASSED" : "FAILED")<<"\n";
+    //a particle refers to the shared material without a copy, copies of the particle and replaced models don't touch it
+    const ConstitutiveModel<double,2> *shared_material = appended_data.constitutiveModel(0);
+    bool same_reference = true;
+    {
+        SolidParticle<double,2> view;
+        appended_data.copyToParticle(0,view);
+        view.setConstitutiveModelReference(shared_material);
+        SolidParticle<double,2> view_copy(view);
+        same_reference = view.constitutiveModel() == shared_material && view_copy.constitutiveModel() != shared_material
+                         && view.cauchyStress() == appended_data.cauchyStress(0) && view_copy.cauchyStress() == appended_data.cauchyStress(0);
+        view.setConstitutiveModel(stvk_material);
+        same_reference = same_reference && view.constitutiveModel() != shared_material;
+    }
+    cout<<"Refer to the shared material of a particle: "
+        <<(same_reference && appended_data.constitutiveModel(0) == shared_material && appended_data.materialNum() == 2
+           && appended_data.cauchyStress(0) == particles[particles.size()-2]->cauchyStress() ? "PASSED" : "FAILED")<<"\n";
+    for(unsigned int i = 0; i < particles.size(); ++i)
+        delete particles[i];
+    return 0;
+}
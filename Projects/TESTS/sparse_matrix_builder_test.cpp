@@ -0,0 +1,135 @@
+/*
+ * @file sparse_matrix_builder_test.cpp
+ * @brief Test the bulk assembly of SparseMatrix with SparseMatrixBuilder, compared with inserting the entries one by one.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "Physika_Core/Matrices/sparse_matrix.h"
+#include "Physika_Core/Matrices/sparse_matrix_builder.h"
+#include "Physika_Core/Utilities/parallel_utilities.h"
+#include "Physika_Core/Timer/timer.h"
+using namespace std;
+using namespace Physika;
+
+//entries of the quad elements of a grid with edge_num*edge_num cells: each element adds a 4x4 block
+//to the rows/cols of its nodes, entries of nodes shared by elements are summed
+void elementEntry(unsigned int edge_num, unsigned int ele_idx, unsigned int local_i, unsigned int local_j,
+                  unsigned int &row, unsigned int &col, double &value)
+{
+    unsigned int ele_x = ele_idx/edge_num, ele_y = ele_idx%edge_num;
+    unsigned int node_i = (ele_x+local_i/2)*(edge_num+1) + ele_y+local_i%2;
+    unsigned int node_j = (ele_x+local_j/2)*(edge_num+1) + ele_y+local_j%2;
+    row = node_i;
+    col = node_j;
+    value = local_i == local_j ? 4.0 : -1.0 - 0.001*(ele_idx%7);
+}
+
+void buildWithBuilder(unsigned int edge_num, unsigned int thread_num, matrix_compressed_mode mode, SparseMatrix<double> &matrix)
+{
+    unsigned int node_num = (edge_num+1)*(edge_num+1);
+    int ele_num = static_cast<int>(edge_num*edge_num);
+    SparseMatrixBuilder<double> builder(node_num,node_num,thread_num);
+    builder.reserve(16*ele_num);
+#pragma omp parallel for num_threads(thread_num)
+    for(int ele_idx = 0; ele_idx < ele_num; ++ele_idx)
+        for(unsigned int local_i = 0; local_i < 4; ++local_i)
+            for(unsigned int local_j = 0; local_j < 4; ++local_j)
+            {
+                unsigned int row = 0, col = 0;
+                double value = 0;
+                elementEntry(edge_num,ele_idx,local_i,local_j,row,col,value);
+                builder.addEntry(row,col,value);
+            }
+    builder.build(matrix);
+}
+
+void buildWithSetEntry(unsigned int edge_num, SparseMatrix<double> &matrix)
+{
+    for(unsigned int ele_idx = 0; ele_idx < edge_num*edge_num; ++ele_idx)
+        for(unsigned int local_i = 0; local_i < 4; ++local_i)
+            for(unsigned int local_j = 0; local_j < 4; ++local_j)
+            {
+                unsigned int row = 0, col = 0;
+                double value = 0;
+                elementEntry(edge_num,ele_idx,local_i,local_j,row,col,value);
+                matrix.setEntry(row,col,matrix(row,col)+value);
+            }
+}
+
+//same entries, and the entries of each row are sorted by column
+bool isSameMatrix(const SparseMatrix<double> &matrix, const SparseMatrix<double> &reference)
+{
+    if(matrix.rows() != reference.rows() || matrix.cols() != reference.cols() || matrix.nonZeros() != reference.nonZeros())
+        return false;
+    for(unsigned int i = 0; i < matrix.rows(); ++i)
+    {
+        vector<Trituple<double> > row_elements = matrix.getRowElements(i);
+        for(unsigned int j = 0; j < row_elements.size(); ++j)
+        {
+            if(fabs(row_elements[j].value() - reference(i,row_elements[j].col())) > 1.0e-12)
+                return false;
+            if(j > 0 && row_elements[j].col() <= row_elements[j-1].col())
+                return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    //correctness against insertion one by one, in both compressed modes and with multiple threads
+    unsigned int small_edge_num = 20, node_num = (small_edge_num+1)*(small_edge_num+1);
+    SparseMatrix<double> reference(node_num,node_num);
+    buildWithSetEntry(small_edge_num,reference);
+    for(unsigned int mode = 0; mode < 2; ++mode)
+        for(unsigned int thread_num = 1; thread_num <= 4; thread_num *= 4)
+        {
+            SparseMatrix<double> matrix(node_num,node_num,mode == 0 ? ROW_MAJOR : COL_MAJOR);
+            buildWithBuilder(small_edge_num,thread_num,mode == 0 ? ROW_MAJOR : COL_MAJOR,matrix);
+            cout<<(mode == 0 ? "ROW_MAJOR" : "COL_MAJOR")<<", "<<thread_num<<" thread(s): "<<matrix.nonZeros()<<" nonzeros from "
+                <<16*small_edge_num*small_edge_num<<" triplets, "<<(isSameMatrix(matrix,reference) ? "PASSED" : "FAILED")<<"\n";
+        }
+    //setFromTriplets() of SparseMatrix
+    vector<Trituple<double> > triplets;
+    triplets.push_back(Trituple<double>(1,2,1.0));
+    triplets.push_back(Trituple<double>(0,0,2.0));
+    triplets.push_back(Trituple<double>(1,2,3.0));
+    SparseMatrix<double> small_matrix(2,3);
+    small_matrix.setEntry(1,1,5.0);
+    small_matrix.setFromTriplets(triplets);
+    cout<<"setFromTriplets with duplicates: "<<(small_matrix(0,0) == 2.0 && small_matrix(1,2) == 4.0 && small_matrix(1,1) == 0 && small_matrix.nonZeros() == 2
+                                               ? "PASSED" : "FAILED")<<"\n";
+    //time of assembly with increasing size
+    Timer timer;
+    for(unsigned int edge_num = 50; edge_num <= 800; edge_num *= 4)
+    {
+        unsigned int large_node_num = (edge_num+1)*(edge_num+1);
+        SparseMatrix<double> matrix(large_node_num,large_node_num);
+        timer.startTimer();
+        buildWithBuilder(edge_num,maxThreadNum(),ROW_MAJOR,matrix);
+        timer.stopTimer();
+        double builder_time = timer.getElapsedTime();
+        cout<<16*edge_num*edge_num<<" triplets, "<<matrix.nonZeros()<<" nonzeros: builder "<<builder_time<<" s";
+        if(edge_num <= 200)
+        {
+            SparseMatrix<double> set_entry_matrix(large_node_num,large_node_num);
+            timer.startTimer();
+            buildWithSetEntry(edge_num,set_entry_matrix);
+            timer.stopTimer();
+            cout<<", setEntry "<<timer.getElapsedTime()<<" s";
+        }
+        cout<<"\n";
+    }
+    return 0;
+}
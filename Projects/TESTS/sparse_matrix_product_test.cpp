@@ -0,0 +1,133 @@
+/*
+ * @file sparse_matrix_product_test.cpp
+ * @brief Test the product of two SparseMatrix in all combinations of compressed modes, and compare the time
+ *        with the sparse matrix of Eigen.
+ * @author Fei Zhu
+ *
+ * This file is part of Physika, a versatile physics simulation library.
+ * Copyright (C) 2013 Physika Group.
+ *
+ * This Source Code Form is subject to the terms of the GNU General Public License v2.0.
+ * If a copy of the GPL was not distributed with this file, you can obtain one at:
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "Physika_Core/Matrices/sparse_matrix.h"
+#include "Physika_Core/Matrices/sparse_matrix_builder.h"
+#include "Physika_Core/Utilities/parallel_utilities.h"
+#include "Physika_Core/Timer/timer.h"
+#include "Physika_Dependency/Eigen/Sparse"
+using namespace std;
+using namespace Physika;
+
+//random matrix with about entry_per_row positive entries in each row, so that no entry of the product cancels out
+void randomTriplets(unsigned int rows, unsigned int cols, unsigned int entry_per_row, vector<Trituple<double> > &triplets)
+{
+    triplets.clear();
+    for(unsigned int i = 0; i < rows; ++i)
+        for(unsigned int j = 0; j < entry_per_row; ++j)
+            triplets.push_back(Trituple<double>(i,rand()%cols,(rand()%1000+1)/100.0));
+}
+
+//same entries as the dense product of the triplets, and the entries of each row are sorted by column
+bool isSameAsDenseProduct(const SparseMatrix<double> &product, unsigned int rows, unsigned int inner_dim, unsigned int cols,
+                          const vector<Trituple<double> > &triplets1, const vector<Trituple<double> > &triplets2)
+{
+    vector<double> dense1(rows*inner_dim,0), dense2(inner_dim*cols,0), dense_product(rows*cols,0);
+    vector<bool> structure(rows*cols,false);
+    for(unsigned int i = 0; i < triplets1.size(); ++i)
+        dense1[triplets1[i].row()*inner_dim+triplets1[i].col()] += triplets1[i].value();
+    for(unsigned int i = 0; i < triplets2.size(); ++i)
+        dense2[triplets2[i].row()*cols+triplets2[i].col()] += triplets2[i].value();
+    for(unsigned int i = 0; i < triplets1.size(); ++i)
+        for(unsigned int j = 0; j < triplets2.size(); ++j)
+            if(triplets1[i].col() == triplets2[j].row())
+                structure[triplets1[i].row()*cols+triplets2[j].col()] = true;
+    for(unsigned int i = 0; i < rows; ++i)
+        for(unsigned int k = 0; k < inner_dim; ++k)
+            for(unsigned int j = 0; j < cols; ++j)
+                dense_product[i*cols+j] += dense1[i*inner_dim+k]*dense2[k*cols+j];
+    if(product.rows() != rows || product.cols() != cols)
+        return false;
+    unsigned int structure_num = 0;
+    for(unsigned int i = 0; i < rows*cols; ++i)
+        structure_num += structure[i] ? 1 : 0;
+    if(product.nonZeros() != structure_num)
+        return false;
+    for(unsigned int i = 0; i < rows; ++i)
+    {
+        vector<Trituple<double> > row_elements = product.getRowElements(i);
+        for(unsigned int j = 0; j < row_elements.size(); ++j)
+        {
+            unsigned int col = row_elements[j].col();
+            if(!structure[i*cols+col] || fabs(row_elements[j].value() - dense_product[i*cols+col]) > 1.0e-10)
+                return false;
+            if(j > 0 && col <= row_elements[j-1].col())
+                return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    srand(0);
+    //correctness against dense product, in all combinations of compressed modes and with multiple threads
+    unsigned int rows = 60, inner_dim = 45, cols = 70;
+    vector<Trituple<double> > triplets1, triplets2;
+    randomTriplets(rows,inner_dim,4,triplets1);
+    randomTriplets(inner_dim,cols,5,triplets2);
+    for(unsigned int mode1 = 0; mode1 < 2; ++mode1)
+        for(unsigned int mode2 = 0; mode2 < 2; ++mode2)
+            for(unsigned int thread_num = 1; thread_num <= 4; thread_num *= 4)
+            {
+                SparseMatrix<double> matrix1(rows,inner_dim,mode1 == 0 ? ROW_MAJOR : COL_MAJOR);
+                SparseMatrix<double> matrix2(inner_dim,cols,mode2 == 0 ? ROW_MAJOR : COL_MAJOR);
+                matrix1.setFromTriplets(triplets1);
+                matrix2.setFromTriplets(triplets2);
+                SparseMatrix<double> product = thread_num == 1 ? matrix1*matrix2 : matrix1.multiply(matrix2,thread_num);
+                cout<<(mode1 == 0 ? "ROW_MAJOR" : "COL_MAJOR")<<" * "<<(mode2 == 0 ? "ROW_MAJOR" : "COL_MAJOR")<<", "<<thread_num<<" thread(s): "
+                    <<product.nonZeros()<<" nonzeros, "<<(isSameAsDenseProduct(product,rows,inner_dim,cols,triplets1,triplets2) ? "PASSED" : "FAILED")<<"\n";
+            }
+    //0 thread falls back to 1 thread with a warning
+    SparseMatrix<double> matrix1(rows,inner_dim), matrix2(inner_dim,cols);
+    matrix1.setFromTriplets(triplets1);
+    matrix2.setFromTriplets(triplets2);
+    SparseMatrix<double> product = matrix1.multiply(matrix2,0);
+    cout<<"0 thread: "<<product.nonZeros()<<" nonzeros, "<<(isSameAsDenseProduct(product,rows,inner_dim,cols,triplets1,triplets2) ? "PASSED" : "FAILED")<<"\n";
+    //time of A*A with increasing size, compared with Eigen
+    Timer timer;
+    for(unsigned int size = 10000; size <= 200000; size *= 4)
+    {
+        vector<Trituple<double> > triplets;
+        randomTriplets(size,size,8,triplets);
+        SparseMatrix<double> matrix(size,size);
+        matrix.setFromTriplets(triplets);
+        timer.startTimer();
+        SparseMatrix<double> product = matrix*matrix;
+        timer.stopTimer();
+        double serial_time = timer.getElapsedTime();
+        timer.startTimer();
+        SparseMatrix<double> parallel_product = matrix.multiply(matrix,maxThreadNum());
+        timer.stopTimer();
+        double parallel_time = timer.getElapsedTime();
+        vector<Eigen::Triplet<double> > eigen_triplets;
+        for(unsigned int i = 0; i < triplets.size(); ++i)
+            eigen_triplets.push_back(Eigen::Triplet<double>(triplets[i].row(),triplets[i].col(),triplets[i].value()));
+        Eigen::SparseMatrix<double,Eigen::RowMajor> eigen_matrix(size,size);
+        eigen_matrix.setFromTriplets(eigen_triplets.begin(),eigen_triplets.end());
+        timer.startTimer();
+        Eigen::SparseMatrix<double,Eigen::RowMajor> eigen_product = eigen_matrix*eigen_matrix;
+        timer.stopTimer();
+        double eigen_time = timer.getElapsedTime();
+        cout<<size<<"x"<<size<<", "<<matrix.nonZeros()<<" nonzeros -> "<<product.nonZeros()<<" nonzeros: serial "<<serial_time<<" s, "
+            <<maxThreadNum()<<" thread(s) "<<parallel_time<<" s, Eigen "<<eigen_time<<" s, "
+            <<(product.nonZeros() == static_cast<unsigned int>(eigen_product.nonZeros()) && parallel_product.nonZeros() == product.nonZeros() ? "PASSED" : "FAILED")<<"\n";
+    }
+    return 0;
+}
@@ -17,11 +17,14 @@
 #include <vector>
 #include <ctime>
 #include "Physika_Dependency/Eigen/Eigen"
+#include "Physika_Dependency/Eigen/Sparse"
 #include "Physika_Core/Matrices/sparse_matrix.h"
 #include "Physika_Core/Vectors/vector_Nd.h"
 #include "Physika_Core/Timer/timer.h"
 #include "Physika_Core/Matrices/sparse_matrix_iterator.h"
 #include "Physika_Core/Matrices/matrix_MxN.h"
+#include "Physika_Core/Matrices/csr_matrix.h"
+#include "Physika_Core/Utilities/parallel_utilities.h"
 
 #define Max1 5000
 #define Max2 2000
@@ -119,5 +122,75 @@ int main()
 	psm2*pv1;
 	timer.stopTimer();
 	cout << "psm multiply vector time: " << timer.getElapsedTime() << endl;
+	//memory bandwidth of matrix-vector products on the 7-point laplacian of a grid, bytes of the matrix and vectors
+	//streamed per product divided by the time
+	cout << "****************************   bandwidth of *vect" << endl;
+	const unsigned int grid_res = 100, node_num = grid_res*grid_res*grid_res, repeat = 10;
+	std::vector<Physika::Trituple<mytype> > triplets;
+	for (unsigned int i = 0; i < grid_res; ++i)
+		for (unsigned int j = 0; j < grid_res; ++j)
+			for (unsigned int k = 0; k < grid_res; ++k)
+			{
+				unsigned int node = (i*grid_res + j)*grid_res + k;
+				triplets.push_back(Physika::Trituple<mytype>(node, node, 6));
+				if (i > 0) triplets.push_back(Physika::Trituple<mytype>(node, node - grid_res*grid_res, -1));
+				if (i + 1 < grid_res) triplets.push_back(Physika::Trituple<mytype>(node, node + grid_res*grid_res, -1));
+				if (j > 0) triplets.push_back(Physika::Trituple<mytype>(node, node - grid_res, -1));
+				if (j + 1 < grid_res) triplets.push_back(Physika::Trituple<mytype>(node, node + grid_res, -1));
+				if (k > 0) triplets.push_back(Physika::Trituple<mytype>(node, node - 1, -0.5));
+				if (k + 1 < grid_res) triplets.push_back(Physika::Trituple<mytype>(node, node + 1, -1.5));
+			}
+	Physika::SparseMatrix<mytype> laplacian(node_num, node_num);
+	laplacian.setFromTriplets(triplets);
+	Physika::CSRMatrix<mytype> csr_laplacian(laplacian, 1);
+	Physika::VectorND<mytype> x(node_num, 0), psm_result, csr_result, csr_transpose_result;
+	for (unsigned int i = 0; i < node_num; ++i)
+		x[i] = rand() % Maxv + 1;
+	double nnz = laplacian.nonZeros();
+	double vector_bytes = 2.0*node_num*sizeof(mytype);
+	double psm_bytes = nnz*sizeof(Physika::Trituple<mytype>) + vector_bytes;
+	double csr_bytes = nnz*(sizeof(unsigned int) + sizeof(mytype)) + (node_num + 1)*sizeof(unsigned int) + vector_bytes;
+	timer.startTimer();
+	for (unsigned int i = 0; i < repeat; ++i)
+		psm_result = laplacian*x;
+	timer.stopTimer();
+	cout << nnz << " nonzeros, psm multiply vector: " << psm_bytes*repeat / timer.getElapsedTime() / 1.0e9 << " GB/s" << endl;
+	for (unsigned int thread_num = 1; thread_num <= Physika::maxThreadNum(); thread_num *= 2)
+	{
+		csr_laplacian.setThreadNum(thread_num);
+		timer.startTimer();
+		for (unsigned int i = 0; i < repeat; ++i)
+			csr_laplacian.multiply(x, csr_result);
+		timer.stopTimer();
+		double multiply_time = timer.getElapsedTime();
+		timer.startTimer();
+		for (unsigned int i = 0; i < repeat; ++i)
+			csr_laplacian.transposeMultiply(x, csr_transpose_result);
+		timer.stopTimer();
+		double transpose_time = timer.getElapsedTime();
+		cout << "csr with " << thread_num << " thread(s), multiply vector: " << csr_bytes*repeat / multiply_time / 1.0e9 << " GB/s, "
+			<< "transpose multiply vector: " << csr_bytes*repeat / transpose_time / 1.0e9 << " GB/s, "
+			<< ((csr_result - psm_result).norm() < 1.0e-8*psm_result.norm() && (csr_transpose_result - x*laplacian).norm() < 1.0e-8*psm_result.norm() ? "PASSED" : "FAILED") << endl;
+	}
+	//several right-hand sides share the loads of the matrix
+	const unsigned int rhs_num = 4;
+	std::vector<Physika::VectorND<mytype> > rhs(rhs_num, x), rhs_result;
+	for (unsigned int i = 0; i < rhs_num; ++i)
+		rhs[i] *= i + 1;
+	csr_laplacian.setThreadNum(Physika::maxThreadNum());
+	timer.startTimer();
+	for (unsigned int i = 0; i < repeat; ++i)
+		csr_laplacian.multiply(x, csr_result);
+	timer.stopTimer();
+	double single_time = timer.getElapsedTime() / repeat;
+	timer.startTimer();
+	for (unsigned int i = 0; i < repeat; ++i)
+		csr_laplacian.multiply(rhs, rhs_result);
+	timer.stopTimer();
+	bool rhs_passed = true;
+	for (unsigned int i = 0; i < rhs_num; ++i)
+		rhs_passed = rhs_passed && (rhs_result[i] - psm_result*(i + 1)).norm() < 1.0e-8*psm_result.norm()*(i + 1);
+	cout << "csr multiply " << rhs_num << " vectors: " << timer.getElapsedTime() / repeat / rhs_num << " s per vector (" << single_time << " s for one vector), "
+		<< (rhs_passed ? "PASSED" : "FAILED") << endl;
 	return 0;
 }
\ No newline at end of file